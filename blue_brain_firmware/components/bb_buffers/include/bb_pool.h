@@ -0,0 +1,92 @@
+/**
+ * @file bb_pool.h
+ * @brief Pool de objetos de tamaño fijo con conteo de referencias
+ *
+ * Los objetos (tramas, reportes...) se reservan una vez y circulan por las
+ * colas de FreeRTOS como punteros. Cada consumidor que necesita el objeto
+ * hace retain(); al terminar llama release() y el último lo devuelve al pool.
+ * Reserva y liberación son lock-free (atómicos C11), aptas desde cualquier
+ * núcleo, y el módulo compila en el host sin FreeRTOS.
+ */
+
+#ifndef BB_POOL_H
+#define BB_POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_POOL_MAX_OBJS 32 // Un bit por objeto en free_mask
+
+typedef struct {
+  uint32_t capacity;
+  uint32_t in_use;
+  uint32_t high_watermark;
+  uint32_t allocs;
+  uint32_t exhausted; // Reservas fallidas por pool agotado
+} bb_pool_stats_t;
+
+typedef struct {
+  const char *name;
+  uint8_t *storage;
+  size_t obj_size;
+  uint16_t n_objs;
+  atomic_int *refs;
+
+  _Atomic uint32_t free_mask; // 1 = libre
+  _Atomic uint32_t allocs;
+  _Atomic uint32_t exhausted;
+  _Atomic uint32_t high_watermark;
+} bb_pool_t;
+
+/**
+ * @brief Declara el almacenamiento estático de un pool (tamaño en
+ * compilación). Usar después bb_pool_init(&name, ...) con BB_POOL_INIT_ARGS.
+ */
+#define BB_POOL_STATIC(_name, _type, _count)                                   \
+  _Static_assert((_count) > 0 && (_count) <= BB_POOL_MAX_OBJS,                 \
+                 "bb_pool: tamaño fuera de rango");                            \
+  static _type _name##_storage[_count];                                        \
+  static atomic_int _name##_refs[_count];                                      \
+  static bb_pool_t _name
+
+#define BB_POOL_INIT_ARGS(_name)                                               \
+  #_name, (uint8_t *)_name##_storage, sizeof(_name##_storage[0]),              \
+      (uint16_t)(sizeof(_name##_storage) / sizeof(_name##_storage[0])),        \
+      _name##_refs
+
+/**
+ * @brief Inicializa el pool (todos los objetos libres)
+ */
+bool bb_pool_init(bb_pool_t *pool, const char *name, uint8_t *storage,
+                  size_t obj_size, uint16_t n_objs, atomic_int *refs);
+
+/**
+ * @brief Reserva un objeto con una referencia
+ * @return Puntero al objeto o NULL si el pool está agotado
+ */
+void *bb_pool_alloc(bb_pool_t *pool);
+
+/**
+ * @brief Añade una referencia (otro consumidor comparte el objeto)
+ */
+void bb_pool_retain(bb_pool_t *pool, void *obj);
+
+/**
+ * @brief Suelta una referencia
+ * @return true si era la última y el objeto volvió al pool
+ */
+bool bb_pool_release(bb_pool_t *pool, void *obj);
+
+/**
+ * @brief Referencias actuales de un objeto (diagnóstico)
+ */
+int bb_pool_refcount(bb_pool_t *pool, const void *obj);
+
+/**
+ * @brief Copia las estadísticas de uso
+ */
+void bb_pool_get_stats(bb_pool_t *pool, bb_pool_stats_t *out);
+
+#endif // BB_POOL_H
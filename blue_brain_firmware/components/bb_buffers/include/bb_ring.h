@@ -0,0 +1,89 @@
+/**
+ * @file bb_ring.h
+ * @brief Ring buffer SPSC lock-free organizado en bloques de tamaño fijo
+ *
+ * Un único productor (adquisición) escribe bloques completos mientras un
+ * único consumidor (DSP) lee tramas formadas por varios bloques. Solo usa
+ * atómicos C11, sin dependencias de FreeRTOS: la señalización entre tareas
+ * (notificaciones) la hace el llamador.
+ */
+
+#ifndef BB_RING_H
+#define BB_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint8_t *storage;
+  int64_t *stamps; // Opcional: marca de tiempo por bloque (NULL = sin marcas)
+  uint16_t block_bytes;
+  uint16_t n_blocks; // Potencia de 2
+  uint16_t mask;
+
+  _Atomic uint32_t head; // Bloques confirmados por el productor
+  _Atomic uint32_t tail; // Bloques liberados por el consumidor
+
+  // Estadísticas
+  _Atomic uint32_t overruns; // Bloques descartados por ring lleno
+  uint32_t max_fill;         // Máxima ocupación observada (bloques)
+} bb_ring_t;
+
+/**
+ * @brief Inicializa el ring sobre un buffer externo
+ * @param storage Memoria de block_bytes * n_blocks bytes
+ * @param stamps Array de n_blocks marcas de tiempo (puede ser NULL)
+ * @param n_blocks Número de bloques (potencia de 2)
+ * @return false si los parámetros no son válidos
+ */
+bool bb_ring_init(bb_ring_t *ring, uint8_t *storage, int64_t *stamps,
+                  uint16_t block_bytes, uint16_t n_blocks);
+
+/**
+ * @brief Vacía el ring y pone a cero las estadísticas (sin concurrencia)
+ */
+void bb_ring_reset(bb_ring_t *ring);
+
+// --- Productor ---
+
+/**
+ * @brief Obtiene el siguiente bloque libre para escribir
+ * @return Puntero al bloque o NULL si el ring está lleno
+ */
+uint8_t *bb_ring_write_acquire(bb_ring_t *ring);
+
+/**
+ * @brief Publica el bloque obtenido con bb_ring_write_acquire()
+ * @param stamp Marca de tiempo de la última muestra del bloque (µs)
+ */
+void bb_ring_write_commit(bb_ring_t *ring, int64_t stamp);
+
+/**
+ * @brief Registra un bloque perdido (ring lleno): rompe la continuidad
+ */
+void bb_ring_mark_overrun(bb_ring_t *ring);
+
+// --- Consumidor ---
+
+/**
+ * @brief Bloques disponibles para leer
+ */
+uint32_t bb_ring_available(bb_ring_t *ring);
+
+/**
+ * @brief Copia n_blocks consecutivos a dst y los libera
+ * @param dst Buffer lineal de al menos n_blocks * block_bytes
+ * @param stamps_out Marcas de tiempo de cada bloque (puede ser NULL)
+ * @return true si había suficientes bloques
+ */
+bool bb_ring_read_frame(bb_ring_t *ring, uint8_t *dst, uint32_t n_blocks,
+                        int64_t *stamps_out);
+
+/**
+ * @brief Contador de overruns (para detectar huecos entre tramas)
+ */
+uint32_t bb_ring_overruns(bb_ring_t *ring);
+
+#endif // BB_RING_H
@@ -0,0 +1,110 @@
+/**
+ * @file bb_pool.c
+ * @brief Pool lock-free con conteo de referencias
+ */
+
+#include "bb_pool.h"
+
+static int pool_index(bb_pool_t *pool, const void *obj) {
+  if (obj == NULL)
+    return -1;
+  ptrdiff_t off = (const uint8_t *)obj - pool->storage;
+  if (off < 0 || (size_t)off % pool->obj_size != 0)
+    return -1;
+  size_t idx = (size_t)off / pool->obj_size;
+  return (idx < pool->n_objs) ? (int)idx : -1;
+}
+
+bool bb_pool_init(bb_pool_t *pool, const char *name, uint8_t *storage,
+                  size_t obj_size, uint16_t n_objs, atomic_int *refs) {
+  if (pool == NULL || storage == NULL || refs == NULL || obj_size == 0 ||
+      n_objs == 0 || n_objs > BB_POOL_MAX_OBJS) {
+    return false;
+  }
+
+  pool->name = name;
+  pool->storage = storage;
+  pool->obj_size = obj_size;
+  pool->n_objs = n_objs;
+  pool->refs = refs;
+
+  for (uint16_t i = 0; i < n_objs; i++)
+    atomic_store(&refs[i], 0);
+
+  uint32_t mask =
+      (n_objs == 32) ? 0xFFFFFFFFu : ((1u << n_objs) - 1u);
+  atomic_store(&pool->free_mask, mask);
+  atomic_store(&pool->allocs, 0);
+  atomic_store(&pool->exhausted, 0);
+  atomic_store(&pool->high_watermark, 0);
+  return true;
+}
+
+void *bb_pool_alloc(bb_pool_t *pool) {
+  uint32_t mask = atomic_load_explicit(&pool->free_mask, memory_order_acquire);
+
+  while (mask != 0) {
+    int idx = __builtin_ctz(mask);
+    uint32_t desired = mask & ~(1u << idx);
+    if (atomic_compare_exchange_weak_explicit(&pool->free_mask, &mask, desired,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      atomic_store_explicit(&pool->refs[idx], 1, memory_order_relaxed);
+      atomic_fetch_add_explicit(&pool->allocs, 1, memory_order_relaxed);
+
+      // Marca de agua: objetos en uso tras esta reserva
+      uint32_t in_use = pool->n_objs - (uint32_t)__builtin_popcount(desired);
+      uint32_t hw =
+          atomic_load_explicit(&pool->high_watermark, memory_order_relaxed);
+      while (in_use > hw &&
+             !atomic_compare_exchange_weak_explicit(
+                 &pool->high_watermark, &hw, in_use, memory_order_relaxed,
+                 memory_order_relaxed)) {
+      }
+      return &pool->storage[(size_t)idx * pool->obj_size];
+    }
+    // mask se actualizó con el valor actual: reintentar
+  }
+
+  atomic_fetch_add_explicit(&pool->exhausted, 1, memory_order_relaxed);
+  return NULL;
+}
+
+void bb_pool_retain(bb_pool_t *pool, void *obj) {
+  int idx = pool_index(pool, obj);
+  if (idx >= 0)
+    atomic_fetch_add_explicit(&pool->refs[idx], 1, memory_order_relaxed);
+}
+
+bool bb_pool_release(bb_pool_t *pool, void *obj) {
+  int idx = pool_index(pool, obj);
+  if (idx < 0)
+    return false;
+
+  int prev =
+      atomic_fetch_sub_explicit(&pool->refs[idx], 1, memory_order_acq_rel);
+  if (prev == 1) {
+    atomic_fetch_or_explicit(&pool->free_mask, 1u << idx,
+                             memory_order_release);
+    return true;
+  }
+  if (prev <= 0) {
+    // Doble liberación: restaurar y no tocar el objeto
+    atomic_fetch_add_explicit(&pool->refs[idx], 1, memory_order_relaxed);
+  }
+  return false;
+}
+
+int bb_pool_refcount(bb_pool_t *pool, const void *obj) {
+  int idx = pool_index(pool, obj);
+  return (idx >= 0) ? atomic_load(&pool->refs[idx]) : -1;
+}
+
+void bb_pool_get_stats(bb_pool_t *pool, bb_pool_stats_t *out) {
+  uint32_t mask = atomic_load(&pool->free_mask);
+  out->capacity = pool->n_objs;
+  out->in_use = pool->n_objs - (uint32_t)__builtin_popcount(mask);
+  out->high_watermark = atomic_load(&pool->high_watermark);
+  out->allocs = atomic_load(&pool->allocs);
+  out->exhausted = atomic_load(&pool->exhausted);
+}
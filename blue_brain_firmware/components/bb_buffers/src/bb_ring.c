@@ -0,0 +1,99 @@
+/**
+ * @file bb_ring.c
+ * @brief Ring buffer SPSC por bloques (adquisición continua -> DSP)
+ */
+
+#include "bb_ring.h"
+#include <string.h>
+
+bool bb_ring_init(bb_ring_t *ring, uint8_t *storage, int64_t *stamps,
+                  uint16_t block_bytes, uint16_t n_blocks) {
+  if (ring == NULL || storage == NULL || block_bytes == 0 || n_blocks < 2 ||
+      (n_blocks & (n_blocks - 1)) != 0) {
+    return false;
+  }
+
+  ring->storage = storage;
+  ring->stamps = stamps;
+  ring->block_bytes = block_bytes;
+  ring->n_blocks = n_blocks;
+  ring->mask = n_blocks - 1;
+  bb_ring_reset(ring);
+  return true;
+}
+
+void bb_ring_reset(bb_ring_t *ring) {
+  atomic_store(&ring->head, 0);
+  atomic_store(&ring->tail, 0);
+  atomic_store(&ring->overruns, 0);
+  ring->max_fill = 0;
+}
+
+uint8_t *bb_ring_write_acquire(bb_ring_t *ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if ((uint32_t)(head - tail) >= ring->n_blocks)
+    return NULL; // Lleno
+
+  return &ring->storage[(size_t)(head & ring->mask) * ring->block_bytes];
+}
+
+void bb_ring_write_commit(bb_ring_t *ring, int64_t stamp) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (ring->stamps != NULL)
+    ring->stamps[head & ring->mask] = stamp;
+
+  head++;
+  atomic_store_explicit(&ring->head, head, memory_order_release);
+
+  uint32_t fill =
+      head - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (fill > ring->max_fill)
+    ring->max_fill = fill;
+}
+
+void bb_ring_mark_overrun(bb_ring_t *ring) {
+  atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+}
+
+uint32_t bb_ring_available(bb_ring_t *ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  return head - tail;
+}
+
+bool bb_ring_read_frame(bb_ring_t *ring, uint8_t *dst, uint32_t n_blocks,
+                        int64_t *stamps_out) {
+  if (n_blocks == 0 || n_blocks > ring->n_blocks ||
+      bb_ring_available(ring) < n_blocks) {
+    return false;
+  }
+
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t first = tail & ring->mask;
+
+  // Copia en como máximo dos tramos (antes y después del wrap)
+  uint32_t n1 = ring->n_blocks - first;
+  if (n1 > n_blocks)
+    n1 = n_blocks;
+  memcpy(dst, &ring->storage[(size_t)first * ring->block_bytes],
+         (size_t)n1 * ring->block_bytes);
+  if (n_blocks > n1) {
+    memcpy(dst + (size_t)n1 * ring->block_bytes, ring->storage,
+           (size_t)(n_blocks - n1) * ring->block_bytes);
+  }
+
+  if (stamps_out != NULL && ring->stamps != NULL) {
+    for (uint32_t i = 0; i < n_blocks; i++)
+      stamps_out[i] = ring->stamps[(tail + i) & ring->mask];
+  }
+
+  atomic_store_explicit(&ring->tail, tail + n_blocks, memory_order_release);
+  return true;
+}
+
+uint32_t bb_ring_overruns(bb_ring_t *ring) {
+  return (uint32_t)atomic_load_explicit(&ring->overruns,
+                                        memory_order_relaxed);
+}
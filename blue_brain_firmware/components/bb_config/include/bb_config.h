@@ -18,11 +18,149 @@
 // Fixed Compile-time Macros for DSP Buffers (must match max possible values)
 #define BB_N_SAMPLES 2048
 #define BB_SAMPLE_RATE_HZ 4000 // Max supported rate
+
+// Rango de sample_rate en modo continuo (FIFO del MPU6050). Con DLPF_CFG=0
+// el reloj es de 8 kHz y SMPLRT_DIV es u8: por debajo de 8000/256 no llega
+#define BB_STREAM_RATE_MIN_HZ 32
+#define BB_STREAM_RATE_MAX_HZ 1000 // Límite del acelerómetro
 #define BB_FFT_SIZE 2048
+#define BB_REPORT_INTERVAL_MS 5000   // Cadencia de ráfagas (modo burst)
+#define BB_REPORT_SUBMIT_WAIT_MS 100 // Espera por hueco en la cola de envío
+
+// Máximo de sensores DS18B20 en el bus 1-Wire (rodamiento A/B + devanado)
+#define BB_MAX_TEMP_SENSORS 3
+#define BB_TEMP_PERIOD_MS 5000 // Lectura de todos (Convert T de 750 ms)
+#define BB_DS18B20_RESCAN_FAILS 3 // Fallos seguidos de un ROM -> re-enumerar
+
+// Máximo de MPU6050 en el bus I2C compartido (AD0 = 0 -> 0x68, AD0 = 1 -> 0x69)
+#define BB_MAX_IMUS 2
+
+// Ring de adquisición continua: bloques de 64 muestras (384 B)
+#define BB_ACQ_BLOCK_SAMPLES 64
+#define BB_ACQ_RING_BLOCKS 64 // 4096 muestras (~4 s a 1 kHz), potencia de 2
+
+// Pools de buffers compartidos (bb_pool, máx 32 objetos cada uno)
+#define BB_POOL_FRAMES 3  // Tramas en vuelo por el pipeline (12 KB x IMU c/u)
+#define BB_POOL_REPORTS 8 // Reportes compartidos por MQTT/ESP-NOW/Web UI
+
+// Calidad de adquisición (por IMU y trama)
+#define BB_QUAL_MAX_FAILED_PCT 2 // Lecturas fallidas > 2% -> trama descartada
+#define BB_QUAL_STUCK_RUN 32     // Muestras idénticas seguidas -> descartada
+
+// Benchmark JSON vs binario de la telemetría al arrancar (solo log)
+#define BB_TELEMETRY_BENCH 0
+
+// Batching MQTT: varios reportes por publicación (ver mqtt_batch_size)
+#define BB_MQTT_BATCH_MAX 10               // Reportes por lote como máximo
+#define BB_MQTT_BATCH_BYTES 4096           // Buffer del lote (JSON ~270-640 B)
+#define BB_MQTT_STATS_EVERY_N_REPORTS 60   // Log de publicaciones/h
+#define BB_DEFAULT_MQTT_BATCH_MAX_MS 30000 // Latencia máxima de un lote
+
+// Presupuesto de la partición "storage" (SPIFFS, 1 MB): los ficheros de
+// tamaño fijo no pasan del ~70% (~700 KB); más lleno, SPIFFS recolecta con
+// pausas largas. Registro = ranura de 12 B + datos:
+//   backlog   720 x 292 B = 210 KB (solo con el broker caído)
+//   trend    4320 x  32 B = 138 KB
+//   rollups  2912 x  52 B = 148 KB (minuto 736, hora 1440, día 736)
+//   dataset  2048 x  80 B = 160 KB (12 B + 17 features)
+// Total ~656 KB (~64%)
+// Además, ningún fichero crece si no quedan BB_STORAGE_RESERVE_BYTES libres
+// (bb_storage.h)
+
+// Store-and-forward: reportes sin broker al backlog en SPIFFS (bb_backlog.h)
+#define BB_BACKLOG_PATH "/spiffs/backlog.bin"
+#define BB_BACKLOG_MAX_RECORDS 720 // 1 h a 5 s/reporte (~210 KB)
+#define BB_BACKLOG_REPLAY_MS 200    // Una publicación de reenvío cada 200 ms
+
+// Tendencias en flash para la Web UI y MQTT (ver bb_trend.h)
+#define BB_TREND_PATH "/spiffs/trend.bin"
+#define BB_TREND_MAX_RECORDS 4320   // 12 h a un punto cada 10 s (~138 KB)
+#define BB_TREND_EVERY_S 10         // Reportes más seguidos: solo el primero
+#define BB_TREND_QUERY_MAX 512      // Puntos por consulta como mucho
+#define BB_TREND_DEFAULT_POINTS 288 // Sin "max": uno cada 2.5 min en 12 h
+
+// Agregados por minuto/hora/día en flash (ver bb_rollup.h y bb_history.h)
+#define BB_ROLLUP_MIN_PATH "/spiffs/roll_m.bin"
+#define BB_ROLLUP_HOUR_PATH "/spiffs/roll_h.bin"
+#define BB_ROLLUP_DAY_PATH "/spiffs/roll_d.bin"
+#define BB_ROLLUP_MIN_RECORDS 736   // ~12 h (~37 KB)
+#define BB_ROLLUP_HOUR_RECORDS 1440 // 60 días (~73 KB)
+#define BB_ROLLUP_DAY_RECORDS 736   // ~2 años (~37 KB)
+#define BB_ROLLUP_PERSIST_S 600     // Intervalos cerrados en RAM como mucho
+#define BB_ROLLUP_QUERY_MAX 256     // Puntos por consulta (44 B cada uno)
+
+// Dataset de entrenamiento: log binario en SPIFFS (ver bb_dataset.h)
+#define BB_DATASET_PATH "/spiffs/dataset.bin"
+#define BB_DATASET_SCHEMA 1         // rms, 15 bandas, peak_freq (bb_web_ui.c)
+#define BB_DATASET_MAX_RECORDS 2048 // ~3.4 min a 10 Hz (~160 KB)
+#define BB_DATASET_BENCH 0          // Benchmark CSV vs binario al arrancar
+
+// Forma de onda cruda bajo demanda por MQTT (ver bb_waveform.h)
+#define BB_WAVE_CHUNK_BYTES 1024 // Payload de cada trozo
+#define BB_WAVE_OUTBOX_MAX 4096  // Outbox MQTT sin confirmar: no más trozos
+#define BB_WAVE_CHUNK_GAP_MS 20  // Separación mínima entre trozos (~50 KB/s)
+#define BB_WAVE_TIMEOUT_MS 60000 // Subida abandonada (suelta la trama)
+#define BB_WAVE_WZ_BLOCK 256     // Muestras por trozo comprimido ("z")
+
+// Gestor de conexión WiFi/MQTT (ver bb_link.h)
+#define BB_LINK_BACKOFF_MIN_MS 1000    // Primer reintento tras una caída
+#define BB_LINK_BACKOFF_MAX_MS 120000  // Tope del backoff exponencial
+#define BB_LINK_STABLE_MS 60000        // Tras un enlace estable, backoff a 0
+#define BB_LINK_ASSOC_TIMEOUT_MS 15000 // Asociación sin respuesta del driver
+#define BB_LINK_DHCP_TIMEOUT_MS 20000  // Asociado sin IP (DHCP): reintentar
+
+// Hora UTC de los reportes: SNTP y deriva de esp_timer (ver bb_clock.h)
+#define BB_DEFAULT_SNTP_SERVER "pool.ntp.org"
+#define BB_SNTP_SYNC_INTERVAL_MS 3600000 // Resincronizar cada hora
+#define BB_CLOCK_DRIFT_MIN_S 600         // Tramo mínimo para medir la deriva
+#define BB_CLOCK_DRIFT_MAX_PPM 500       // Por encima: salto de hora, no deriva
+
+// Tramas ESP-NOW: reintentos y reensamblado (ver bb_packet.h)
+#define BB_ESPNOW_RETRIES 3            // Intentos por fragmento (ACK MAC)
+#define BB_ESPNOW_BACKOFF_MS 10        // Espera antes del 2º intento, x2 luego
+#define BB_ESPNOW_PEER_CACHE 8         // Peers registrados a la vez (máx. 20)
+#define BB_ESPNOW_REASM_SLOTS 4        // Mensajes fragmentados en paralelo
+#define BB_ESPNOW_REASM_TIMEOUT_MS 500 // Fragmentos que no llegan: descartar
+#define BB_ESPNOW_STATS_EVERY_N 60     // Log de envíos cada N mensajes
+
+// Gateway ESP-NOW -> MQTT (ver bb_gateway.h)
+#define BB_GW_MAX_NODES 64        // Nodos con estadísticas y lote propios
+#define BB_GW_POOL_MSGS 192       // Mensajes esperando lote (~50 KB)
+#define BB_GW_RX_RING 32          // Tramas sin procesar (potencia de 2)
+#define BB_GW_RESTART_GAP 1024    // Salto de packet_id: el nodo reinició
+#define BB_GW_NODE_IDLE_MS 600000 // Nodo callado: su hueco se reutiliza
+#define BB_GW_STATS_MS 60000      // Estadísticas por nodo en MQTT
+
+// Línea de tiempo común por balizas ESP-NOW (ver bb_sync.h)
+#define BB_SYNC_BEACON_MS 1000     // Periodo de baliza del maestro
+#define BB_SYNC_BLOCK 4            // Balizas por punto (la de menos retardo)
+#define BB_SYNC_FIT_POINTS 16      // Puntos de la recta offset/deriva (~64 s)
+#define BB_SYNC_STEP_US 5000       // Error mayor: retardo raro o salto
+#define BB_SYNC_HOLDOVER_MS 120000 // Sin balizas: la línea común caduca
+#define BB_SYNC_SPIN_US 2000       // Espera activa final antes de la ráfaga
+
+// Report-by-exception (ver bb_rbe.h)
+#define BB_RBE_DB_FREQ_HZ 2.0f         // Banda de la dominante (~2 bins FFT)
+#define BB_DEFAULT_RBE_DB_PCT 10.0f    // Banda relativa (% del publicado)
+#define BB_DEFAULT_RBE_DB_G 0.02f      // Banda absoluta RMS/pico (G)
+#define BB_DEFAULT_RBE_DB_TEMP_C 0.5f  // Banda absoluta temperatura (°C)
+#define BB_DEFAULT_RBE_HEARTBEAT_S 300 // Publicar al menos cada 5 min
 
 // =============================================================
 // 📦 Estructura de Configuración del Sistema
 // =============================================================
+/**
+ * @brief Calibración estática de un IMU (medida con la máquina en reposo)
+ * El kernel de conversión resta offset = bias + gravedad en cada eje, así
+ * RMS y espectros quedan solo con la vibración dinámica. Todo a cero
+ * (blob NVS anterior) equivale a "sin calibrar".
+ */
+typedef struct {
+  bool valid;
+  float bias_g[3];    // Offset del sensor a lo largo de la gravedad (G)
+  float gravity_g[3]; // Vector gravedad en ejes del sensor, |g| = 1 G
+} bb_imu_cal_t;
+
 typedef struct {
   // WiFi
   char wifi_ssid[32];
@@ -49,6 +187,46 @@ typedef struct {
   float temp_alert_warn; // C
   float temp_alert_crit; // C
 
+  // Adquisición continua (FIFO del MPU6050 -> ring SPSC, sin huecos)
+  bool acq_continuous;
+
+  // Modo 6 ejes: lectura de 14 bytes (acel + temp + giro) por muestra
+  bool acq_gyro;
+
+  // Mantenimiento: escaneo I2C/1-Wire completo en cada arranque (sin caché)
+  bool maint_mode;
+
+  // Calibración en reposo por IMU (ver bb_dsp_ai_request_calibration)
+  bb_imu_cal_t imu_cal[BB_MAX_IMUS];
+
+  // Telemetría MQTT en binario versionado (<topic>/bin) en lugar de JSON
+  bool mqtt_binary;
+
+  // Batching: 1 = un PUBLISH por reporte; N = hasta N reportes o
+  // mqtt_batch_max_ms por publicación (las alarmas salen sin esperar)
+  uint8_t mqtt_batch_size;
+  uint32_t mqtt_batch_max_ms;
+
+  // Report-by-exception: publicar solo cambios fuera de banda, cambios de
+  // alarma/estado o cada rbe_heartbeat_s (bandas detalladas en bb_rbe.h)
+  bool rbe_enabled;
+  float rbe_db_pct;    // % del último valor publicado (amplitudes)
+  float rbe_db_g;      // G (RMS y pico de ambos puntos)
+  float rbe_db_temp_c; // °C
+  uint32_t rbe_heartbeat_s;
+
+  // Servidor SNTP (hora UTC de los reportes; cambia al reiniciar)
+  char sntp_server[64];
+
+  // Gateway: publica por MQTT lo que recibe por ESP-NOW de otros nodos
+  // (bb_gateway.h; cambia al reiniciar)
+  bool espnow_gateway;
+
+  // Línea de tiempo común por balizas ESP-NOW: 0 = no, 1 = seguir al
+  // maestro, 2 = maestro (emite las balizas). Con ella las ráfagas empiezan
+  // a la vez en todos los nodos (bb_sync.h; cambia al reiniciar)
+  uint8_t espnow_sync;
+
 } bb_config_t;
 
 // =============================================================
@@ -27,10 +27,25 @@ static void load_defaults(bb_config_t *cfg) {
   // Acquisition
   cfg->sample_rate_hz = BB_DEFAULT_SAMPLE_RATE;
   cfg->n_samples = BB_DEFAULT_N_SAMPLES;
+  cfg->acq_continuous = false;
+  cfg->acq_gyro = false;
+  cfg->maint_mode = false;
+  memset(cfg->imu_cal, 0, sizeof(cfg->imu_cal)); // Sin calibrar
+  cfg->mqtt_binary = false;
+  cfg->mqtt_batch_size = 1;
+  cfg->mqtt_batch_max_ms = BB_DEFAULT_MQTT_BATCH_MAX_MS;
+  cfg->rbe_enabled = false;
+  cfg->rbe_db_pct = BB_DEFAULT_RBE_DB_PCT;
+  cfg->rbe_db_g = BB_DEFAULT_RBE_DB_G;
+  cfg->rbe_db_temp_c = BB_DEFAULT_RBE_DB_TEMP_C;
+  cfg->rbe_heartbeat_s = BB_DEFAULT_RBE_HEARTBEAT_S;
+  strlcpy(cfg->sntp_server, BB_DEFAULT_SNTP_SERVER, sizeof(cfg->sntp_server));
 
   // ESP-NOW (Default Disabled)
   cfg->espnow_enabled = false;
   memset(cfg->espnow_dest_mac, 0xFF, 6); // Broadcast by default
+  cfg->espnow_gateway = false;
+  cfg->espnow_sync = 0; // Sin línea común
 
   // Umbrales
   cfg->rms_alert_warn = 2.0f;
@@ -68,6 +83,20 @@ esp_err_t bb_config_init(void) {
       g_config.temp_alert_warn = 60.0f;
     if (g_config.temp_alert_crit == 0.0f)
       g_config.temp_alert_crit = 80.0f;
+    if (g_config.mqtt_batch_size == 0)
+      g_config.mqtt_batch_size = 1;
+    if (g_config.mqtt_batch_max_ms == 0)
+      g_config.mqtt_batch_max_ms = BB_DEFAULT_MQTT_BATCH_MAX_MS;
+    if (g_config.rbe_heartbeat_s == 0) {
+      // Blob anterior a RBE (las bandas sí pueden valer 0 a propósito)
+      g_config.rbe_db_pct = BB_DEFAULT_RBE_DB_PCT;
+      g_config.rbe_db_g = BB_DEFAULT_RBE_DB_G;
+      g_config.rbe_db_temp_c = BB_DEFAULT_RBE_DB_TEMP_C;
+      g_config.rbe_heartbeat_s = BB_DEFAULT_RBE_HEARTBEAT_S;
+    }
+    if (g_config.sntp_server[0] == '\0')
+      strlcpy(g_config.sntp_server, BB_DEFAULT_SNTP_SERVER,
+              sizeof(g_config.sntp_server));
 
   } else if (err == ESP_ERR_NVS_NOT_FOUND) {
     ESP_LOGW(TAG, "Config not found in NVS. Loading defaults.");
@@ -0,0 +1,75 @@
+/**
+ * @file bb_clock.h
+ * @brief Conversión esp_timer -> hora UTC con deriva estimada
+ *
+ * Cada sincronización (SNTP o manual desde la Web UI) fija un ancla
+ * (esp_timer, UTC). Cualquier instante de esp_timer del arranque actual,
+ * anterior o posterior al ancla, se convierte como
+ *
+ *   utc = ancla_utc + (t - ancla_t) · (1 + deriva)
+ *
+ * así que los reportes tomados antes de la primera sincronización se
+ * corrigen hacia atrás en cuanto llega (el reporte guarda siempre su
+ * t_first_us y la hora se calcula al publicarlo).
+ *
+ * La deriva del cristal frente a UTC (±10-40 ppm son 36-144 ms por hora)
+ * se mide entre dos sincronizaciones SNTP separadas al menos
+ * BB_CLOCK_DRIFT_MIN_S y se filtra con una media exponencial. Una hora
+ * manual (resolución de segundos) nunca corrige la deriva ni sustituye a
+ * SNTP. Una medida por encima de BB_CLOCK_DRIFT_MAX_PPM se toma como cambio
+ * de hora (servidor distinto, hora manual previa) y reinicia la medida.
+ *
+ * Lógica pura (sin FreeRTOS ni SNTP): el llamador serializa el acceso.
+ */
+
+#ifndef BB_CLOCK_H
+#define BB_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  BB_CLOCK_NONE = 0,   // Sin hora: solo esp_timer
+  BB_CLOCK_SNTP = 1,   // Servidor SNTP
+  BB_CLOCK_MANUAL = 2, // POST /api/v1/time (navegador)
+} bb_clock_source_t;
+
+typedef struct {
+  bb_clock_source_t source;
+  int64_t ref_mono_us; // Ancla: esp_timer...
+  int64_t ref_wall_us; // ...y UTC en ese instante (µs desde 1970)
+  int32_t drift_ppb;   // esp_timer respecto a UTC (+ = atrasa)
+  bool drift_valid;
+
+  // Base de la medida de deriva (última sincronización SNTP usada)
+  int64_t base_mono_us;
+  int64_t base_wall_us;
+
+  uint32_t syncs;      // Sincronizaciones aplicadas
+  int64_t last_err_us; // UTC recibido - predicción en la última
+} bb_clock_t;
+
+/**
+ * @brief Estado inicial: sin hora
+ */
+void bb_clock_init(bb_clock_t *c);
+
+/**
+ * @brief Aplica una sincronización: UTC wall_us en el instante mono_us
+ * @return false si se ignora (hora manual con SNTP ya disponible)
+ */
+bool bb_clock_sync(bb_clock_t *c, int64_t mono_us, int64_t wall_us,
+                   bb_clock_source_t src);
+
+/**
+ * @brief UTC (µs desde 1970) del instante mono_us de este arranque
+ * @return 0 si todavía no hay hora
+ */
+int64_t bb_clock_to_wall(const bb_clock_t *c, int64_t mono_us);
+
+/**
+ * @brief Nombre corto de la fuente (log, JSON)
+ */
+const char *bb_clock_source_name(bb_clock_source_t src);
+
+#endif // BB_CLOCK_H
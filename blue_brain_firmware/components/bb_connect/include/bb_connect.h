@@ -1,9 +1,14 @@
 #ifndef BB_CONNECT_H
 #define BB_CONNECT_H
 
+#include "bb_clock.h"
+#include "bb_config.h"
+#include "esp_bit_defs.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "freertos/queue.h"
+#include <stdbool.h>
 
 // --- Estructura de Telemetría Industrial ---
 typedef struct {
@@ -24,11 +29,145 @@ typedef struct {
   int ai_class;  // 0=Sano, 1=Desbalance, 2=Falla Rodamiento
   float ai_conf; // Confianza (0.0 - 1.0)
   float batt_v;  // Battery Voltage (V)
+
+  // Reloj de muestreo medido (esp_timer, µs desde el arranque)
+  int64_t t_first_us;
+  int64_t t_last_us;
+  float fs_hz;        // Frecuencia efectiva usada en todas las conversiones Hz
+  float fs_jitter_us; // Jitter del intervalo entre muestras
+
+  // Temperatura multipunto (DS18B20 en orden de búsqueda ROM)
+  uint8_t temp_count;
+  float temp_points_c[BB_MAX_TEMP_SENSORS];
+  uint64_t temp_rom[BB_MAX_TEMP_SENSORS];
+
+  // Segundo punto de medida (MPU6050 en 0x69) y relación A/B
+  uint8_t n_points;    // IMUs analizados en esta trama (1..BB_MAX_IMUS)
+  float p2_rms;
+  float p2_peak;
+  float p2_crest;
+  float p2_dom_freq;   // Frecuencia dominante del punto B (Hz)
+  float coh_dom;       // Coherencia A/B en la dominante de A (0..1)
+  float phase_dom_deg; // Fase de A respecto a B en esa frecuencia (grados)
+
+  // Giroscopio del punto A (modo 6 ejes): vibración torsional/rotacional
+  uint8_t n_axes;      // 3 = solo acelerómetro, 6 = acelerómetro + giroscopio
+  uint8_t gyro_axis;   // Eje con más energía AC (0 = X, 1 = Y, 2 = Z)
+  float gyro_rms_dps;  // RMS de la velocidad angular sin bias (°/s)
+  float gyro_dom_freq; // Frecuencia dominante del eje gyro_axis (Hz)
+
+  uint32_t boot_to_sample_ms; // Arranque -> primera muestra (este ciclo)
+
+  uint8_t calibrated; // 1 = gravedad y bias restados (solo vibración dinámica)
+
+  // Calidad de adquisición: suma de todos los IMU (racha = la mayor)
+  uint8_t quality; // 0 = OK, 1 = marcada, 2 = descartada (sin DSP)
+  uint16_t q_failed_reads;
+  uint16_t q_clipped;
+  uint16_t q_stuck_run;
+  uint16_t q_gaps;
+
+  // Identidad del reporte: (arranque, secuencia) es única y permite detectar
+  // pérdidas o duplicados en el destino (reenvíos del backlog incluidos)
+  uint32_t boot_id; // Número de arranque (bb_storage_boot_id)
+  uint32_t seq;     // Reporte dentro del arranque, desde 1
+  uint16_t rbe_skipped; // Omitidos por RBE justo antes de éste (huecos de seq)
+
+  // Enlace del nodo al pasar el reporte por Task_Comms (bb_link.h)
+  int8_t link_rssi;         // dBm del AP (0 = sin asociar)
+  uint16_t link_reconnects; // Vueltas al broker desde el arranque
+  uint16_t link_connect_ms; // Latencia de la última conexión (intento->broker)
+  uint16_t link_uptime_pm;  // Tiempo con broker desde el arranque (por mil)
+
+  // Hora UTC de la adquisición: t_first_us convertido al publicar
+  int64_t t_unix_us; // µs desde 1970 (0 = sin hora)
+  uint8_t time_src;  // bb_clock_source_t con que se convirtió
+
+  // t_first_us en la línea de tiempo común de las balizas ESP-NOW
+  // (espnow_sync): igual en todos los nodos para comparar fases
+  int64_t t_sync_us;    // µs del reloj del maestro (0 = sin línea común)
+  uint16_t sync_err_us; // Error RMS de la estimación (0 en el maestro)
 } bb_telemetry_t;
 
 // Handle de la cola (Visible para main.c)
+// Transporta punteros bb_telemetry_t* del pool de reportes: quien recibe el
+// puntero es dueño de una referencia y debe llamar bb_report_release().
+// NULL no es un reporte: despierta a Task_Comms al volver el broker o al
+// llegar tramas al gateway ESP-NOW.
 extern QueueHandle_t xQueueTelemetry;
 
+// --- Estado del enlace (event group del gestor de conexión) ---
+#define BB_LINK_BIT_IP BIT0     // STA con IP
+#define BB_LINK_BIT_ONLINE BIT1 // Broker MQTT conectado
+
+/**
+ * @brief Espera a que el broker esté conectado (publicadores)
+ * @return true si lo está al volver
+ */
+bool bb_connect_wait_online(TickType_t wait);
+
+// --- Hora UTC (SNTP o manual) ---
+
+/**
+ * @brief Convierte un instante de esp_timer de este arranque a UTC
+ * @return µs desde 1970, o 0 si todavía no hay hora
+ */
+int64_t bb_connect_wall_time_us(int64_t mono_us);
+
+/**
+ * @brief Hora manual (Web UI): ajusta el reloj del sistema y, si no hay
+ * SNTP, la conversión de los reportes
+ * @return false si se ignora porque SNTP ya da la hora
+ */
+bool bb_connect_set_time(int64_t wall_us);
+
+/**
+ * @brief Copia del estado de la hora (fuente, deriva, sincronizaciones)
+ */
+void bb_connect_clock_get(bb_clock_t *out);
+
+// --- Pool de Reportes (zero-copy) ---
+
+/**
+ * @brief Reserva un reporte del pool con una referencia
+ * @return NULL si el pool está agotado (consumidores atrasados)
+ */
+bb_telemetry_t *bb_report_alloc(void);
+
+/**
+ * @brief Añade una referencia para otro consumidor
+ */
+void bb_report_retain(bb_telemetry_t *report);
+
+/**
+ * @brief Suelta una referencia; el último consumidor lo devuelve al pool
+ */
+void bb_report_release(bb_telemetry_t *report);
+
+/**
+ * @brief Publica un reporte terminado: le asigna boot_id/seq, lo fija como
+ * "último" (Web UI) y lo encola para Task_Comms. Toma la referencia del
+ * llamador. A partir de aquí el reporte es de solo lectura. Con la cola
+ * llena espera hasta BB_REPORT_SUBMIT_WAIT_MS; si sigue llena, el reporte se
+ * descarta y cuenta en bb_report_dropped().
+ */
+void bb_report_submit(bb_telemetry_t *report);
+
+/**
+ * @brief Reportes descartados por bb_report_submit() desde el arranque
+ */
+uint32_t bb_report_dropped(void);
+
+/**
+ * @brief Copia el último reporte publicado (o ceros si aún no hay)
+ */
+void bb_report_get_latest(bb_telemetry_t *out);
+
+/**
+ * @brief Registra en el log el uso del pool de reportes
+ */
+void bb_report_log_stats(void);
+
 void bb_connect_init(void);
 void Task_Comms(void *pvParameters); // Declarar la tarea
 
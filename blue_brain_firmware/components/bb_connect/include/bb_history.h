@@ -0,0 +1,92 @@
+/**
+ * @file bb_history.h
+ * @brief Histórico en flash: serie de 10 s y agregados por minuto/hora/día
+ *
+ * Cuatro series de bb_trend, una por resolución:
+ *   raw    un punto cada BB_TREND_EVERY_S (bb_telemetry_trend_point), 12 h
+ *   minute, hour, day  intervalos cerrados de bb_rollup (min/max/media/rms)
+ *
+ * Task_Comms alimenta todo con bb_history_add(): cada reporte suma O(1) a
+ * los tres intervalos en curso y cada intervalo cerrado es un registro más
+ * de su serie. Las series de agregados bajan a flash cada
+ * BB_ROLLUP_PERSIST_S (o al completar un bloque); tras un reinicio, la hora
+ * y el día en curso se rehacen con los minutos y horas ya guardados, así que
+ * solo se pierde el minuto en curso y lo que aún no había bajado a flash.
+ *
+ * Una consulta de largo plazo lee pocos registros: un año son 365 del
+ * nivel día, no tres millones de reportes.
+ */
+
+#ifndef BB_HISTORY_H
+#define BB_HISTORY_H
+
+#include "bb_connect.h"
+#include "bb_trend.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  BB_HIST_RAW = 0, // Respuesta 'B' 'R' (bb_telemetry_codec.h)
+  BB_HIST_MINUTE,  // Respuesta 'B' 'U' nivel 0
+  BB_HIST_HOUR,    // Respuesta 'B' 'U' nivel 1
+  BB_HIST_DAY,     // Respuesta 'B' 'U' nivel 2
+  BB_HIST_COUNT
+} bb_history_res_t;
+
+/**
+ * @brief Abre (o crea) las cuatro series en SPIFFS
+ * @return ESP_OK si se abrieron todas (las que sí, funcionan igual)
+ */
+esp_err_t bb_history_init(void);
+
+/**
+ * @brief Añade el reporte (solo Task_Comms). Sin hora UTC o con la trama
+ * descartada no hace nada
+ */
+void bb_history_add(const bb_telemetry_t *report);
+
+/**
+ * @brief Baja a flash lo pendiente de todas las series (antes de reiniciar)
+ */
+void bb_history_flush(void);
+
+/**
+ * @brief Resolución por nombre: "raw", "min", "hour" o "day"
+ */
+bool bb_history_parse_res(const char *name, bb_history_res_t *out);
+
+/**
+ * @brief Consulta por defecto: hasta el último registro de la serie y hacia
+ * atrás lo que cubre la serie llena (12 h, 12 h, 60 d, 2 años), en
+ * BB_TREND_DEFAULT_POINTS (raw) o bb_history_query_max() puntos
+ */
+void bb_history_default_query(bb_history_res_t res, uint32_t *from_s,
+                              uint32_t *to_s, uint32_t *max_points);
+
+/**
+ * @brief Máximo de puntos por consulta de la resolución
+ */
+uint32_t bb_history_query_max(bb_history_res_t res);
+
+/**
+ * @brief Consulta from_s..to_s en como mucho max_points puntos y devuelve la
+ * respuesta binaria completa (cabecera incluida) en un buffer nuevo
+ * @param out Recibe el buffer (liberar con free)
+ * @param len Bytes de la respuesta
+ * @param n_out Puntos (puede ser NULL)
+ * @param matched Registros en el rango, antes de diezmar (puede ser NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (max_points fuera de rango),
+ * ESP_ERR_NO_MEM o ESP_ERR_INVALID_STATE (serie no disponible)
+ */
+esp_err_t bb_history_query(bb_history_res_t res, uint32_t from_s,
+                           uint32_t to_s, uint32_t max_points, uint8_t **out,
+                           size_t *len, uint32_t *n_out, uint32_t *matched);
+
+/**
+ * @brief Estadísticas de la serie de una resolución
+ */
+void bb_history_get_stats(bb_history_res_t res, bb_trend_stats_t *out);
+
+#endif // BB_HISTORY_H
@@ -0,0 +1,124 @@
+/**
+ * @file bb_link.h
+ * @brief Gestor de conexión WiFi/MQTT: máquina de estados con backoff
+ *
+ *   IDLE --start--> CONNECTING --asociado--> ASSOCIATED --IP--> IP
+ *   IP --broker--> ONLINE;  ONLINE --broker caído--> IP (reintenta ESP-MQTT)
+ *   Caída WiFi o IP perdida en cualquier estado --> BACKOFF --plazo-->
+ *   CONNECTING
+ *
+ * Tras cada fallo seguido el plazo se duplica desde BB_LINK_BACKOFF_MIN_MS
+ * hasta BB_LINK_BACKOFF_MAX_MS, con jitter uniforme en [plazo/2, plazo]:
+ * si el AP se reinicia, los nodos de la planta no vuelven todos a la vez.
+ * La cuenta vuelve a cero cuando el enlace aguanta BB_LINK_STABLE_MS con
+ * broker (un enlace que oscila no resetea el backoff en cada asociación).
+ * Una asociación o un DHCP que no contestan cuentan como fallo.
+ *
+ * El cliente MQTT solo corre con IP: se arranca al obtenerla y se para al
+ * perderla. Sin broker no hay publicaciones que intentar.
+ *
+ * Lógica pura (sin FreeRTOS ni esp_wifi): el llamador traduce los eventos,
+ * ejecuta las acciones devueltas y arma un temporizador con el plazo. Así
+ * se prueba en el host con eventos simulados.
+ */
+
+#ifndef BB_LINK_H
+#define BB_LINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  BB_LINK_IDLE = 0,   // WiFi sin arrancar
+  BB_LINK_CONNECTING, // esp_wifi_connect() en curso
+  BB_LINK_ASSOCIATED, // Asociado al AP, esperando DHCP
+  BB_LINK_IP,         // Con IP, esperando al broker
+  BB_LINK_ONLINE,     // Broker conectado: se puede publicar
+  BB_LINK_BACKOFF,    // Esperando para reintentar la asociación
+} bb_link_state_t;
+
+typedef enum {
+  BB_LINK_EV_START,     // WIFI_EVENT_STA_START
+  BB_LINK_EV_WIFI_UP,   // WIFI_EVENT_STA_CONNECTED
+  BB_LINK_EV_WIFI_DOWN, // WIFI_EVENT_STA_DISCONNECTED
+  BB_LINK_EV_GOT_IP,    // IP_EVENT_STA_GOT_IP
+  BB_LINK_EV_LOST_IP,   // IP_EVENT_STA_LOST_IP
+  BB_LINK_EV_MQTT_TRY,  // MQTT_EVENT_BEFORE_CONNECT
+  BB_LINK_EV_MQTT_UP,   // MQTT_EVENT_CONNECTED
+  BB_LINK_EV_MQTT_DOWN, // MQTT_EVENT_DISCONNECTED
+  BB_LINK_EV_TIMER,     // Venció el temporizador pedido
+} bb_link_event_t;
+
+// Acciones para el llamador (máscara de bits, en este orden)
+#define BB_LINK_ACT_MQTT_STOP 0x01  // esp_mqtt_client_stop()
+#define BB_LINK_ACT_DISCONNECT 0x02 // esp_wifi_disconnect()
+#define BB_LINK_ACT_CONNECT 0x04    // esp_wifi_connect()
+#define BB_LINK_ACT_MQTT_START 0x08 // esp_mqtt_client_start()
+#define BB_LINK_ACT_TIMER 0x10      // (Re)armar el temporizador: timer_us
+
+typedef struct {
+  uint32_t actions;
+  int64_t timer_us; // Con BB_LINK_ACT_TIMER: plazo desde ahora
+} bb_link_out_t;
+
+typedef struct {
+  bb_link_state_t state;
+  int64_t deadline_us; // Plazo del estado actual (0 = ninguno)
+  uint32_t failures;   // Fallos seguidos (exponente del backoff)
+  uint32_t rng;        // xorshift32 del jitter
+  bool mqtt_running;
+  bool mqtt_retry; // El broker ya falló con esta IP
+  bool been_online;
+
+  // Métricas desde el arranque
+  int64_t t_start_us;
+  int64_t t_attempt_us; // Inicio del intento en curso (WiFi o solo broker)
+  int64_t t_online_us;  // Entrada en ONLINE (tramo en curso)
+  int64_t online_us;    // Tiempo en ONLINE sin contar el tramo en curso
+  uint32_t attempts;    // Intentos de asociación
+  uint32_t reconnects;  // Entradas en ONLINE después de la primera
+  uint32_t connect_ms;  // Intento que acabó con broker: inicio -> conectado
+  int64_t last_backoff_us;
+  int8_t rssi; // dBm del AP (0 = sin asociar); lo actualiza el llamador
+} bb_link_t;
+
+// Métricas exportadas en la telemetría
+typedef struct {
+  int8_t rssi;
+  uint16_t reconnects;
+  uint16_t connect_ms;
+  uint16_t uptime_pm; // Tiempo con broker desde el arranque (por mil)
+} bb_link_metrics_t;
+
+/**
+ * @brief Estado inicial (IDLE). La semilla varía el jitter entre nodos
+ * (MAC o esp_random()).
+ */
+void bb_link_init(bb_link_t *l, uint32_t seed, int64_t now_us);
+
+/**
+ * @brief Aplica un evento y devuelve las acciones a ejecutar. Un
+ * BB_LINK_EV_TIMER que no corresponde al plazo vigente se ignora (el
+ * temporizador no hace falta pararlo al cambiar de estado).
+ */
+bb_link_out_t bb_link_event(bb_link_t *l, bb_link_event_t ev,
+                            int64_t now_us);
+
+/**
+ * @brief true si se puede publicar (broker conectado)
+ */
+static inline bool bb_link_online(const bb_link_t *l) {
+  return l->state == BB_LINK_ONLINE;
+}
+
+/**
+ * @brief Métricas a la vista del reporte (saturadas a su tipo)
+ */
+bb_link_metrics_t bb_link_metrics(const bb_link_t *l, int64_t now_us);
+
+/**
+ * @brief Nombre corto del estado (log)
+ */
+const char *bb_link_state_name(bb_link_state_t state);
+
+#endif // BB_LINK_H
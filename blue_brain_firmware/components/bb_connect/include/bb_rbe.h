@@ -0,0 +1,67 @@
+/**
+ * @file bb_rbe.h
+ * @brief Report-by-exception: filtro de reportes antes de publicar
+ *
+ * Un reporte sale (MQTT y ESP-NOW) solo si:
+ *   - es el primero tras el arranque,
+ *   - cambia el nivel de alarma (OK / aviso / crítico),
+ *   - cambia un estado discreto (clase IA, calidad, calibración, puntos,
+ *     ejes, sensores de temperatura),
+ *   - una magnitud se aleja del último valor publicado más que su banda
+ *     muerta: amplitudes (G) max(rbe_db_g, rbe_db_pct % del valor
+ *     publicado); cresta y giro solo la relativa; temperatura y
+ *     frecuencias solo la absoluta,
+ *   - o vence el heartbeat (rbe_heartbeat_s sin publicar).
+ * La referencia es el último reporte publicado, no el anterior: una deriva
+ * lenta acaba saliendo aunque cada paso quede dentro de la banda.
+ */
+
+#ifndef BB_RBE_H
+#define BB_RBE_H
+
+#include "bb_config.h"
+#include "bb_connect.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  BB_RBE_SKIP = 0,  // Dentro de todas las bandas: no publicar
+  BB_RBE_FIRST,     // Primer reporte
+  BB_RBE_ALARM,     // Cambio de nivel de alarma
+  BB_RBE_STATE,     // Cambio de estado discreto
+  BB_RBE_DEADBAND,  // Magnitud fuera de banda
+  BB_RBE_HEARTBEAT, // Heartbeat vencido
+} bb_rbe_reason_t;
+
+typedef struct {
+  bool primed;
+  bb_telemetry_t last; // Último reporte publicado (referencia de las bandas)
+  int64_t last_pub_us;
+  uint16_t skipped; // Omitidos desde el último publicado
+
+  // Estadísticas desde el arranque
+  uint32_t evaluated;
+  uint32_t published;
+} bb_rbe_t;
+
+/**
+ * @brief Nivel de alarma del reporte: 0 = OK, 1 = aviso, 2 = crítico
+ * (RMS del punto A o temperatura frente a los umbrales de configuración)
+ */
+int bb_rbe_alarm_level(const bb_telemetry_t *r, const bb_config_t *cfg);
+
+/**
+ * @brief Decide si el reporte se publica. Si sale, pasa a ser la
+ * referencia y *skipped recibe los omitidos desde el anterior publicado.
+ * Solo tiene sentido con cfg->rbe_enabled (lo comprueba el llamador).
+ */
+bb_rbe_reason_t bb_rbe_evaluate(bb_rbe_t *st, const bb_telemetry_t *r,
+                                const bb_config_t *cfg, int64_t now_us,
+                                uint16_t *skipped);
+
+/**
+ * @brief Nombre corto del motivo (log)
+ */
+const char *bb_rbe_reason_name(bb_rbe_reason_t reason);
+
+#endif // BB_RBE_H
@@ -0,0 +1,81 @@
+/**
+ * @file bb_remote.h
+ * @brief Comandos y configuración remotos por MQTT (uno o todos los nodos)
+ *
+ * Cada nodo escucha BB_MQTT_TOPIC_NODE/<id>/cmd (id = MAC STA en hex,
+ * p. ej. "a0b1c2d3e4f5") y BB_MQTT_TOPIC_NODE/all/cmd (toda la flota), y
+ * responde siempre en BB_MQTT_TOPIC_NODE/<id>/ack. Payload JSON:
+ *
+ *   {"id": 17, "set": {"n_samples": 2048, "rms_warn": 1.5}}
+ *   {"id": 18, "action": "capture"}
+ *   {"id": 19, "action": "waveform", "which": "next", "z": true}
+ *   {"id": 20, "set": {"acq_gyro": true}, "action": "restart"}
+ *   {"id": 21, "action": "trend", "from": 1760000000, "max": 288}
+ *   {"id": 22, "action": "trend", "res": "day"}
+ *
+ * "set" usa las mismas claves que /api/v1/config de la Web UI (sin las de
+ * WiFi/MQTT: un error ahí dejaría el nodo fuera de la red) y se aplica
+ * entero o nada, con bb_config_set(). Casi todo tiene efecto en la
+ * siguiente trama; acq_continuous, acq_gyro y maint_mode necesitan
+ * reiniciar y el ack lo indica con "restart": true.
+ *
+ * Acciones: capture (ráfaga inmediata), waveform (como cmd/waveform),
+ * baseline (nueva calibración en reposo con la próxima ráfaga),
+ * get_config, restart y trend: puntos del histórico en flash
+ * (bb_history.h) de resolución "res" ("raw" por defecto, "min", "hour" o
+ * "day") entre "from" y "to" (UTC, s; por defecto lo que cubre la serie
+ * hasta el último), como mucho "max", en binario a
+ * BB_MQTT_TOPIC_NODE/<id>/trend (formato en bb_telemetry_codec.h). El ack
+ * lleva "res", "points" y "matched".
+ *
+ * Ack: {"id": 17, "ok": true, "applied": ["n_samples", "rms_warn"],
+ *       "restart": false} o {"id": 17, "ok": false, "err": "..."}.
+ * Un id repetido (reentrega QoS 1) se confirma sin volver a ejecutarse.
+ */
+
+#ifndef BB_REMOTE_H
+#define BB_REMOTE_H
+
+#include "esp_err.h"
+#include "mqtt_client.h"
+#include <stdbool.h>
+
+#define BB_MQTT_TOPIC_NODE "hcaa/plcs/bluebrain/node"
+#define BB_REMOTE_MAX_PAYLOAD 768 // Cabe entero en el buffer MQTT (1 KB)
+
+// Acciones que dependen del pipeline (las registra main)
+typedef struct {
+  esp_err_t (*capture_now)(void);    // ESP_ERR_NOT_SUPPORTED en continuo
+  esp_err_t (*baseline_reset)(void); // Recalibrar en reposo
+} bb_remote_hooks_t;
+
+/**
+ * @brief Registra las acciones del pipeline (antes de conectar MQTT)
+ */
+void bb_remote_set_hooks(const bb_remote_hooks_t *hooks);
+
+/**
+ * @brief Identificador del nodo en los topics (MAC STA en hex)
+ */
+const char *bb_remote_node_id(void);
+
+// --- Uso interno de bb_connect ---
+
+/**
+ * @brief Lee la MAC y arma los topics del nodo
+ */
+esp_err_t bb_remote_init(void);
+
+/**
+ * @brief Suscribe los topics de comandos (en MQTT_EVENT_CONNECTED)
+ */
+void bb_remote_subscribe(esp_mqtt_client_handle_t client);
+
+/**
+ * @brief Si el topic es de comandos, ejecuta el comando y publica el ack
+ * (tarea MQTT). @return false si el topic no es de este módulo
+ */
+bool bb_remote_handle(esp_mqtt_client_handle_t client, const char *topic,
+                      int topic_len, const char *data, int data_len);
+
+#endif // BB_REMOTE_H
@@ -0,0 +1,103 @@
+/**
+ * @file bb_rollup.h
+ * @brief Agregados por minuto, hora y día calculados reporte a reporte
+ *
+ * Cada nivel tiene un intervalo en curso (alineado a UTC) con, por métrica,
+ * cuenta, mínimo, máximo, suma y suma de cuadrados: añadir una muestra es
+ * O(1) en los tres niveles, sin guardar las muestras. Cuando llega una
+ * muestra de un intervalo posterior, el anterior se cierra y sale para
+ * guardarlo (bb_history lo escribe en su serie de bb_trend).
+ *
+ * El registro guardado va cuantizado (BB_ROLLUP_BYTES, little-endian), por
+ * métrica y en el orden de bb_rollup_metric_t:
+ *   n u16 (satura), min, max, media, rms
+ * en mG (u16) las vibraciones y en 0.01 °C (i16) la temperatura. Con media
+ * y rms se recuperan suma y suma de cuadrados: bb_rollup_merge() rehace el
+ * intervalo en curso de un nivel a partir de los cerrados del nivel
+ * inferior (al arrancar, sin esperar una hora o un día enteros).
+ *
+ * Módulo puro (sin FreeRTOS ni IDF): compila y se prueba en el host.
+ */
+
+#ifndef BB_ROLLUP_H
+#define BB_ROLLUP_H
+
+#include <stdint.h>
+
+typedef enum {
+  BB_ROLLUP_RMS_A = 0, // vib_rms (G)
+  BB_ROLLUP_PEAK_A,    // vib_peak (G)
+  BB_ROLLUP_RMS_B,     // p2_rms (G), solo con dos puntos de medida
+  BB_ROLLUP_TEMP,      // temp_c (°C), solo con sensor
+  BB_ROLLUP_METRICS
+} bb_rollup_metric_t;
+
+typedef enum {
+  BB_ROLLUP_MINUTE = 0,
+  BB_ROLLUP_HOUR,
+  BB_ROLLUP_DAY,
+  BB_ROLLUP_LEVELS
+} bb_rollup_level_t;
+
+#define BB_ROLLUP_BYTES (BB_ROLLUP_METRICS * 10) // Registro cuantizado
+
+typedef struct {
+  uint32_t n;
+  float min;
+  float max;
+  float sum;
+  float sumsq;
+} bb_rollup_agg_t;
+
+typedef struct {
+  uint32_t start_s; // Inicio del intervalo (s UTC); 0 = sin abrir
+  bb_rollup_agg_t m[BB_ROLLUP_METRICS];
+} bb_rollup_bucket_t;
+
+typedef struct {
+  bb_rollup_bucket_t cur[BB_ROLLUP_LEVELS]; // Intervalos en curso
+  uint32_t added;                           // Muestras desde el arranque
+} bb_rollup_t;
+
+/**
+ * @brief Duración del intervalo de un nivel (60, 3600 o 86400 s)
+ */
+uint32_t bb_rollup_period_s(bb_rollup_level_t level);
+
+/**
+ * @brief Todos los niveles sin abrir
+ */
+void bb_rollup_init(bb_rollup_t *r);
+
+/**
+ * @brief Abre (vacío) el intervalo del nivel que contiene t_s, descartando
+ * el que hubiera en curso. Para reconstruirlo después con bb_rollup_merge()
+ */
+void bb_rollup_open(bb_rollup_t *r, bb_rollup_level_t level, uint32_t t_s);
+
+/**
+ * @brief Añade una muestra en t_s (s UTC) a los tres niveles
+ *
+ * Una hora anterior al intervalo en curso (reloj ajustado hacia atrás) cuenta
+ * en el intervalo en curso.
+ * @param v Valor de cada métrica; NAN = ausente en esta muestra
+ * @param closed Recibe los intervalos que se cierran (con alguna muestra)
+ * @return Máscara de niveles cerrados (bit = bb_rollup_level_t)
+ */
+uint8_t bb_rollup_add(bb_rollup_t *r, uint32_t t_s,
+                      const float v[BB_ROLLUP_METRICS],
+                      bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS]);
+
+/**
+ * @brief Registro cuantizado de un intervalo (formato arriba)
+ */
+void bb_rollup_encode(const bb_rollup_bucket_t *b,
+                      uint8_t out[BB_ROLLUP_BYTES]);
+
+/**
+ * @brief Suma al intervalo b un registro cuantizado de otro nivel
+ */
+void bb_rollup_merge(bb_rollup_bucket_t *b,
+                     const uint8_t rec[BB_ROLLUP_BYTES]);
+
+#endif // BB_ROLLUP_H
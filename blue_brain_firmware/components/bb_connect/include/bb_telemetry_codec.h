@@ -0,0 +1,157 @@
+/**
+ * @file bb_telemetry_codec.h
+ * @brief Codificación de bb_telemetry_t para MQTT: JSON legible o binario
+ *
+ * Formato binario v1 (little-endian, sin padding):
+ *
+ *   Cabecera (6 B): 'B' 'T' | versión u8 | flags u8 | longitud cuerpo u16
+ *   Núcleo (130 B): t_first_us i64, t_last_us i64, boot_ms u32,
+ *     rms, peak, p2p, crest, dom_freq, band_lo, band_hi, fs_hz, jitter_us,
+ *     temp_c, batt_v, ai_conf (f32), fft_bands low/mid/high (15 x f32),
+ *     ai_class i8, quality u8
+ *   Secciones opcionales, en este orden según flags:
+ *     BB_TLM_F_P2      (24 B): p2_rms, p2_peak, p2_crest, p2_dom_freq,
+ *                              coh, phase_deg (f32)
+ *     BB_TLM_F_GYRO    (9 B):  axis u8, gyro_rms_dps f32, gyro_dom_freq f32
+ *     BB_TLM_F_QUALITY (8 B):  failed, clipped, stuck_run, gaps (u16)
+ *     BB_TLM_F_SEQ     (8 B):  boot_id u32, seq u32
+ *     BB_TLM_F_RBE     (2 B):  rbe_skipped u16
+ *     BB_TLM_F_LINK    (7 B):  rssi i8, reconnects u16, connect_ms u16,
+ *                              uptime_pm u16 (enlace WiFi/MQTT, bb_link.h)
+ *     BB_TLM_F_TIME    (9 B):  t_unix_us i64 (UTC de t_first_us), src u8
+ *                              (bb_clock_source_t)
+ *   Temperaturas: count u8 + count x (rom u64, temp_c f32)
+ *   Extensión (solo si hay alguna sección): flags u8 y, en este orden:
+ *     BB_TLM_X_SYNC    (10 B): t_sync_us i64 (t_first_us en la línea
+ *                              común, bb_sync.h), sync_err_us u16
+ *
+ * Un lector debe rechazar versiones mayores que la suya y puede saltar
+ * bytes sobrantes del cuerpo (campos añadidos al final en versiones
+ * compatibles). Decodificador de referencia: tools/bb_telemetry_decode.py
+ *
+ * Lote (varios reportes en una publicación):
+ *   binario: 'B' 'K' | versión u8 | count u8, y por reporte u16 longitud +
+ *            reporte completo (cada uno con sus marcas de tiempo)
+ *   JSON:    {"batch":[{...},{...}]}
+ *
+ * Tendencias (serie en flash, bb_trend.h), respuesta a /api/v1/trend y a
+ * la acción MQTT "trend":
+ *   'B' 'R' | versión u8 | bytes por punto u8 | count u16 | matched u32
+ *   (registros en el rango, antes de diezmar), y count puntos de
+ *   t_s u32 (UTC, s) + BB_TLM_TREND_BYTES:
+ *     rms, peak, p2_rms, p2_peak (mG u16), crest (x100 u16),
+ *     dom_freq (0.1 Hz u16), temp_c (0.01 °C i16, -99 = sin sensor),
+ *     gyro_rms (0.01 °/s u16), batt (mV u16), ai_class i8, quality u8
+ *   Los valores saturan en los límites del entero; p2_* y gyro_rms son 0
+ *   sin segundo punto o sin giroscopio.
+ *
+ * Agregados por minuto/hora/día (bb_rollup.h), misma consulta con "res":
+ *   'B' 'U' | versión u8 | nivel u8 (0 = minuto, 1 = hora, 2 = día) |
+ *   bytes por punto u8 | reservado u8 | count u16 | matched u32, y count
+ *   puntos de t_s u32 (inicio del intervalo) + BB_ROLLUP_BYTES (registro
+ *   de bb_rollup.h). El último puede ser el intervalo aún en curso.
+ */
+
+#ifndef BB_TELEMETRY_CODEC_H
+#define BB_TELEMETRY_CODEC_H
+
+#include "bb_connect.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_TLM_MAGIC0 'B'
+#define BB_TLM_MAGIC1 'T'
+#define BB_TLM_VERSION 1
+#define BB_TLM_HEADER_BYTES 6
+
+// Flags de la cabecera
+#define BB_TLM_F_P2 0x01      // Segundo punto de medida y coherencia A/B
+#define BB_TLM_F_GYRO 0x02    // Rasgos del giroscopio (modo 6 ejes)
+#define BB_TLM_F_CAL 0x04     // Gravedad y bias restados
+#define BB_TLM_F_QUALITY 0x08 // Contadores de calidad (trama no limpia)
+#define BB_TLM_F_SEQ 0x10     // Identidad del reporte (arranque, secuencia)
+#define BB_TLM_F_RBE 0x20     // Reportes omitidos por RBE antes de éste
+#define BB_TLM_F_LINK 0x40    // Métricas del enlace (RSSI, reconexiones...)
+#define BB_TLM_F_TIME 0x80    // Hora UTC de la adquisición (SNTP o manual)
+
+// Flags de la extensión (tras las temperaturas: los 8 de la cabecera ya
+// están usados; un lector v1 anterior la salta como bytes sobrantes)
+#define BB_TLM_X_SYNC 0x01 // Línea de tiempo común entre nodos (ESP-NOW)
+
+#define BB_TLM_BATCH_MAGIC1 'K'
+#define BB_TLM_BATCH_HEADER_BYTES 4
+#define BB_TLM_BATCH_MAX_COUNT 255
+
+#define BB_TLM_TREND_MAGIC1 'R'
+#define BB_TLM_TREND_HEADER_BYTES 10
+#define BB_TLM_TREND_BYTES 20 // Punto sin la hora
+
+#define BB_TLM_ROLLUP_MAGIC1 'U'
+#define BB_TLM_ROLLUP_HEADER_BYTES 12
+
+// Peor caso: cabecera + núcleo + todas las secciones + 3 temperaturas +
+// extensión completa
+#define BB_TLM_MAX_BYTES                                                       \
+  (BB_TLM_HEADER_BYTES + 130 + 24 + 9 + 8 + 8 + 2 + 7 + 9 + 1 +                \
+   BB_MAX_TEMP_SENSORS * 12 + 1 + 10)
+
+/**
+ * @brief Codifica el reporte completo (bandas incluidas) en formato binario
+ * @param buf Destino (BB_TLM_MAX_BYTES basta siempre)
+ * @return Bytes escritos, o 0 si buf es demasiado pequeño
+ */
+size_t bb_telemetry_encode(const bb_telemetry_t *report, uint8_t *buf,
+                           size_t cap);
+
+/**
+ * @brief Formatea el reporte como JSON (payload MQTT histórico)
+ * No incluye las 15 bandas fft_bands_*: para eso está el formato binario.
+ * @return Longitud del texto (truncado a cap - 1 si no cabe)
+ */
+size_t bb_telemetry_format_json(const bb_telemetry_t *report, char *buf,
+                                size_t cap);
+
+/**
+ * @brief Inicia un lote vacío en buf
+ * @return Longitud escrita (cabecera), 0 si no cabe
+ */
+size_t bb_telemetry_batch_begin(bool binary, uint8_t *buf, size_t cap);
+
+/**
+ * @brief Añade un reporte al lote
+ * @param len Longitud actual del lote
+ * @return Nueva longitud, o 0 si el reporte no cabe (el lote no cambia)
+ */
+size_t bb_telemetry_batch_append(bool binary, uint8_t *buf, size_t len,
+                                 size_t cap, const bb_telemetry_t *report);
+
+/**
+ * @brief Cierra el lote (JSON: "]}" y terminador)
+ * @return Longitud final del payload
+ */
+size_t bb_telemetry_batch_end(bool binary, uint8_t *buf, size_t len,
+                              size_t cap);
+
+/**
+ * @brief Punto de tendencia del reporte (BB_TLM_TREND_BYTES, sin la hora)
+ * @return BB_TLM_TREND_BYTES, o 0 si buf es demasiado pequeño
+ */
+size_t bb_telemetry_trend_point(const bb_telemetry_t *report, uint8_t *buf,
+                                size_t cap);
+
+/**
+ * @brief Cabecera de una respuesta de tendencias (los puntos van detrás)
+ * @return BB_TLM_TREND_HEADER_BYTES, o 0 si buf es demasiado pequeño
+ */
+size_t bb_telemetry_trend_header(uint8_t *buf, size_t cap, uint16_t count,
+                                 uint32_t matched);
+
+/**
+ * @brief Cabecera de una respuesta de agregados de un nivel de bb_rollup
+ * @return BB_TLM_ROLLUP_HEADER_BYTES, o 0 si buf es demasiado pequeño
+ */
+size_t bb_telemetry_rollup_header(uint8_t *buf, size_t cap, uint8_t level,
+                                  uint16_t count, uint32_t matched);
+
+#endif // BB_TELEMETRY_CODEC_H
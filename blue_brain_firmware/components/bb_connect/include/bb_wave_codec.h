@@ -0,0 +1,52 @@
+/**
+ * @file bb_wave_codec.h
+ * @brief Compresión sin pérdidas de ráfagas crudas del MPU6050 ("WZ")
+ *
+ * Una sola pasada con estado fijo (32 B por eje), sin tablas ni buffers:
+ *   1. Predicción por eje con el mejor de los predictores fijos de orden
+ *      1..3 (x[n-1], 2x[n-1]-x[n-2], 3x[n-1]-3x[n-2]+x[n-3]). El elegido es
+ *      el de menor |residuo| medio reciente: el decodificador lo reproduce
+ *      sin que viaje ningún bit.
+ *   2. Residuo en zigzag y código Rice con k adaptativo por eje (LOCO-I:
+ *      menor k con N·2^k >= A, A = suma de |residuo|, N = cuenta, ambos
+ *      divididos por 2 cada 32 muestras, k <= 16). Un cociente >= 24 se
+ *      escapa: 24 unos + 20 bits del residuo en zigzag.
+ *
+ * Bloque (little-endian, bits de más a menos significativo):
+ *   Cabecera (8 B): 'W' 'Z' | versión u8 | modo u8 | ejes u8 | reservado u8
+ *                   | muestras u16
+ *   modo 0: flujo Rice de las muestras entrelazadas, relleno a byte
+ *   modo 1: muestras tal cual (big-endian del MPU6050), si comprimir no
+ *           ahorra nada (ruido blanco a fondo de escala)
+ * Cada bloque arranca con el estado a cero y se decodifica por sí solo.
+ * Decodificador de referencia: tools/bb_wave_reassemble.py
+ */
+
+#ifndef BB_WAVE_CODEC_H
+#define BB_WAVE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_WZ_MAGIC0 'W'
+#define BB_WZ_MAGIC1 'Z'
+#define BB_WZ_VERSION 1
+#define BB_WZ_HEADER_BYTES 8
+#define BB_WZ_MAX_AXES 6
+
+#define BB_WZ_MODE_RICE 0
+#define BB_WZ_MODE_STORED 1
+
+// Peor caso de un bloque: nunca más que las muestras crudas + cabecera
+#define BB_WZ_MAX_BYTES(n_samples, n_axes)                                     \
+  (BB_WZ_HEADER_BYTES + (size_t)(n_samples) * (n_axes) * 2)
+
+/**
+ * @brief Comprime un bloque de muestras entrelazadas (int16 big-endian)
+ * @param out Al menos BB_WZ_MAX_BYTES(n_samples, n_axes)
+ * @return Bytes escritos o -1 si los argumentos no son válidos
+ */
+int bb_wz_encode(const uint8_t *raw, int n_samples, int n_axes, uint8_t *out,
+                 size_t cap);
+
+#endif // BB_WAVE_CODEC_H
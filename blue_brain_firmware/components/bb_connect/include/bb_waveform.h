@@ -0,0 +1,82 @@
+/**
+ * @file bb_waveform.h
+ * @brief Subida bajo demanda de la forma de onda cruda por MQTT
+ *
+ * Petición: "last" o "next" en BB_MQTT_TOPIC_CMD_WAVE.
+ *   - last: la ráfaga más reciente ya capturada (en modo ráfaga se guarda
+ *     la última trama terminada; en continuo, la siguiente en salir del
+ *     pipeline, que ya estaba capturada).
+ *   - next: la primera ráfaga que empiece después de la petición.
+ * Con " z" ("last z", "next z") los trozos van comprimidos sin pérdidas
+ * (bb_wave_codec.h): ~2.2x menos bytes en vibración típica.
+ *
+ * Respuesta en BB_MQTT_TOPIC_WAVE/<arranque>/<id>/:
+ *   m   Manifiesto JSON: formato de muestra, fs, tamaños, número de trozos,
+ *       CRC32 de cada trozo tal como viaja y de las muestras crudas
+ *       (zlib.crc32); "codec" es "raw" o "wz1".
+ *   <n> Trozo n (0..n_chunks-1): BB_WAVE_CHUNK_BYTES crudos como máximo, o
+ *       un bloque WZ de BB_WAVE_WZ_BLOCK muestras. Los trozos no cruzan de
+ *       un IMU a otro: IMU k = n / chunks_per_imu.
+ *
+ * Sin copias propias: la trama del pool se retiene hasta publicar el último
+ * trozo y cada publish apunta directamente a frame->raw (el cliente MQTT
+ * copia el mensaje QoS 1 a su outbox para poder retransmitirlo). Comprimida,
+ * cada trozo se codifica al publicarlo en un buffer de un solo bloque.
+ */
+
+#ifndef BB_WAVEFORM_H
+#define BB_WAVEFORM_H
+
+#include "bb_config.h"
+#include "mqtt_client.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BB_MQTT_TOPIC_CMD_WAVE "hcaa/plcs/bluebrain/cmd/waveform"
+#define BB_MQTT_TOPIC_WAVE "hcaa/plcs/bluebrain/wave"
+
+// Ráfaga terminada, tal como sale del pipeline (sin copiar los datos)
+typedef struct {
+  const uint8_t *raw[BB_MAX_IMUS]; // Muestras MPU6050 (int16 big-endian)
+  uint8_t n_imus;
+  uint8_t sample_bytes; // 6 (acelerómetro) o 12 (con giroscopio)
+  uint16_t n_samples;
+  uint32_t frame_seq;
+  int64_t t_first_us; // Primera muestra del IMU A (esp_timer)
+  float fs_hz;
+  float accel_lsb_per_g; // Escalas del sensor (el host convierte a G, °/s)
+  float gyro_lsb_per_dps;
+  uint8_t quality; // bb_quality_level_t de la trama
+
+  // Objeto del pool que contiene raw: el módulo lo retiene mientras lo usa
+  void *owner;
+  void (*retain)(void *owner);
+  void (*release)(void *owner);
+} bb_wave_src_t;
+
+/**
+ * @brief Entrega una trama terminada (Task_Inference, una vez por trama).
+ * Si satisface la petición pendiente se retiene para subirla; con keep_last
+ * se retiene además como "última" (sustituye a la anterior). El llamador
+ * conserva su referencia y la suelta como siempre.
+ */
+void bb_wave_frame_done(const bb_wave_src_t *src, bool keep_last);
+
+// --- Uso interno de bb_connect ---
+
+/**
+ * @brief Procesa un comando recibido en BB_MQTT_TOPIC_CMD_WAVE (tarea MQTT)
+ * @return false si el comando no es válido o ya hay una subida en curso
+ */
+bool bb_wave_command(const char *data, int len);
+
+/**
+ * @brief Avanza la subida en curso: como mucho un mensaje por llamada y
+ * solo si el outbox MQTT tiene hueco (Task_Comms, con la cola de
+ * telemetría vacía). Sin broker la subida espera hasta BB_WAVE_TIMEOUT_MS.
+ * @return µs hasta la siguiente llamada útil (INT64_MAX si no hay subida)
+ */
+int64_t bb_wave_poll(esp_mqtt_client_handle_t client, bool online,
+                     int64_t now_us);
+
+#endif // BB_WAVEFORM_H
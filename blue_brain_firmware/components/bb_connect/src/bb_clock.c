@@ -0,0 +1,87 @@
+/**
+ * @file bb_clock.c
+ * @brief Ancla esp_timer/UTC y estimación de la deriva del cristal
+ */
+
+#include "bb_clock.h"
+#include "bb_config.h"
+#include <stddef.h>
+
+#define PPB 1000000000LL
+#define DRIFT_FILTER_DIV 4 // Media exponencial: 1/4 de cada medida nueva
+
+void bb_clock_init(bb_clock_t *c) { *c = (bb_clock_t){0}; }
+
+// dt · ppb / 1e9 sin desbordar con tramos de años
+static int64_t drift_us(int64_t dt_us, int32_t ppb) {
+  return (dt_us / PPB) * ppb + (dt_us % PPB) * ppb / PPB;
+}
+
+static int64_t predict(const bb_clock_t *c, int64_t mono_us) {
+  int64_t dt = mono_us - c->ref_mono_us;
+  int64_t wall = c->ref_wall_us + dt;
+  if (c->drift_valid)
+    wall += drift_us(dt, c->drift_ppb);
+  return wall;
+}
+
+// Deriva entre la base y esta sincronización SNTP (tramo suficiente)
+static void drift_update(bb_clock_t *c, int64_t mono_us, int64_t wall_us) {
+  int64_t span = mono_us - c->base_mono_us;
+  if (c->base_mono_us != 0 && span < BB_CLOCK_DRIFT_MIN_S * 1000000LL)
+    return; // Demasiado cerca: la base sigue siendo la anterior
+
+  if (c->base_mono_us != 0) {
+    // Pocas veces por hora: double no cuesta nada aquí
+    double ppb = (double)((wall_us - c->base_wall_us) - span) * 1e9 /
+                 (double)span;
+    if (ppb > BB_CLOCK_DRIFT_MAX_PPM * 1000.0 ||
+        ppb < -BB_CLOCK_DRIFT_MAX_PPM * 1000.0) {
+      c->drift_valid = false; // Cambio de hora, no deriva: medir de nuevo
+    } else if (!c->drift_valid) {
+      c->drift_ppb = (int32_t)ppb;
+      c->drift_valid = true;
+    } else {
+      c->drift_ppb += ((int32_t)ppb - c->drift_ppb) / DRIFT_FILTER_DIV;
+    }
+  }
+  c->base_mono_us = mono_us;
+  c->base_wall_us = wall_us;
+}
+
+bool bb_clock_sync(bb_clock_t *c, int64_t mono_us, int64_t wall_us,
+                   bb_clock_source_t src) {
+  if (src == BB_CLOCK_MANUAL && c->source == BB_CLOCK_SNTP)
+    return false; // SNTP es más fino que un navegador
+
+  c->last_err_us =
+      (c->source != BB_CLOCK_NONE) ? wall_us - predict(c, mono_us) : 0;
+  if (src == BB_CLOCK_SNTP) {
+    if (c->source != BB_CLOCK_SNTP)
+      c->base_mono_us = 0; // Primera SNTP: solo fija la base
+    drift_update(c, mono_us, wall_us);
+  }
+
+  c->source = src;
+  c->ref_mono_us = mono_us;
+  c->ref_wall_us = wall_us;
+  c->syncs++;
+  return true;
+}
+
+int64_t bb_clock_to_wall(const bb_clock_t *c, int64_t mono_us) {
+  if (c->source == BB_CLOCK_NONE)
+    return 0;
+  return predict(c, mono_us);
+}
+
+const char *bb_clock_source_name(bb_clock_source_t src) {
+  switch (src) {
+  case BB_CLOCK_SNTP:
+    return "sntp";
+  case BB_CLOCK_MANUAL:
+    return "manual";
+  default:
+    return "none";
+  }
+}
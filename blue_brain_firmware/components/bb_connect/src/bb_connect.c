@@ -1,11 +1,27 @@
 #include "bb_connect.h"
+#include "bb_backlog.h"
+#include "bb_clock.h"
+#include "bb_history.h"
+#include "bb_link.h"
+#include "bb_pool.h"
 #include "bb_power.h"
+#include "bb_rbe.h"
+#include "bb_remote.h"
+#include "bb_storage.h"
+#include "bb_telemetry_codec.h"
+#include "bb_waveform.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "mqtt_client.h"
+#include "freertos/semphr.h"
 #include "nvs_flash.h"
 #include <string.h>
+#include <sys/time.h>
+#include <time.h>
 
 #include "bb_config.h"
 
@@ -13,21 +29,320 @@ static const char *TAG = "bb_connect";
 static esp_mqtt_client_handle_t mqtt_client = NULL;
 QueueHandle_t xQueueTelemetry = NULL;
 
+// --- Pool de Reportes ---
+BB_POOL_STATIC(s_report_pool, bb_telemetry_t, BB_POOL_REPORTS);
+static bb_telemetry_t *s_latest_report = NULL;
+static uint32_t s_report_seq = 0; // Solo Vib_Infer llama a submit
+static volatile uint32_t s_report_dropped = 0;
+static portMUX_TYPE s_latest_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bb_telemetry_t *bb_report_alloc(void) {
+  bb_telemetry_t *r = (bb_telemetry_t *)bb_pool_alloc(&s_report_pool);
+  if (r != NULL)
+    memset(r, 0, sizeof(*r));
+  return r;
+}
+
+void bb_report_retain(bb_telemetry_t *report) {
+  bb_pool_retain(&s_report_pool, report);
+}
+
+void bb_report_release(bb_telemetry_t *report) {
+  bb_pool_release(&s_report_pool, report);
+}
+
+void bb_report_submit(bb_telemetry_t *report) {
+  report->boot_id = bb_storage_boot_id();
+  report->seq = ++s_report_seq;
+
+  // Referencia extra para el "último reporte" (Web UI, training)
+  bb_report_retain(report);
+  taskENTER_CRITICAL(&s_latest_lock);
+  bb_telemetry_t *old = s_latest_report;
+  s_latest_report = report;
+  taskEXIT_CRITICAL(&s_latest_lock);
+  if (old != NULL)
+    bb_report_release(old);
+
+  // La referencia del llamador pasa a Task_Comms. Sin hueco tras una espera
+  // corta se descarta: meterlo aquí en el backlog adelantaría a lo que aún
+  // está en la cola y se saltaría histórico, RBE y ESP-NOW (el backlog solo
+  // lo escribe Task_Comms)
+  if (xQueueTelemetry == NULL ||
+      xQueueSend(xQueueTelemetry, &report,
+                 pdMS_TO_TICKS(BB_REPORT_SUBMIT_WAIT_MS)) != pdPASS) {
+    s_report_dropped++;
+    ESP_LOGW(TAG, "Cola llena, reporte %lu descartado (%lu)",
+             (unsigned long)report->seq, (unsigned long)s_report_dropped);
+    bb_report_release(report);
+  }
+}
+
+uint32_t bb_report_dropped(void) { return s_report_dropped; }
+
+void bb_report_get_latest(bb_telemetry_t *out) {
+  taskENTER_CRITICAL(&s_latest_lock);
+  bb_telemetry_t *r = s_latest_report;
+  if (r != NULL)
+    bb_report_retain(r);
+  taskEXIT_CRITICAL(&s_latest_lock);
+
+  if (r == NULL) {
+    memset(out, 0, sizeof(*out));
+    return;
+  }
+  memcpy(out, r, sizeof(*out));
+  bb_report_release(r);
+}
+
+void bb_report_log_stats(void) {
+  bb_pool_stats_t st;
+  bb_pool_get_stats(&s_report_pool, &st);
+  ESP_LOGI(TAG,
+           "Pool reportes: %lu/%lu en uso, max %lu, agotado %lu veces, "
+           "%lu descartados con la cola llena",
+           (unsigned long)st.in_use, (unsigned long)st.capacity,
+           (unsigned long)st.high_watermark, (unsigned long)st.exhausted,
+           (unsigned long)s_report_dropped);
+}
+
 // --- WiFi Configuration (Loaded from bb_config.h) ---
 #define WIFI_SSID BB_WIFI_SSID
 #define WIFI_PASS BB_WIFI_PASS
 #define MQTT_BROKER CONFIG_BB_MQTT_URI
+#define BB_MQTT_TOPIC_TELEMETRY "hcaa/plcs/bluebrain/telemetry"
+#define BB_MQTT_TOPIC_TELEMETRY_BIN BB_MQTT_TOPIC_TELEMETRY "/bin"
+
+// Formato de los registros del backlog: subir al cambiar bb_telemetry_t
+// (un backlog de otro formato se descarta al arrancar)
+#define BB_BACKLOG_SCHEMA 5
+
+// --- Gestor de conexión (bb_link.h) ---
+// Eventos del bucle por defecto (WiFi/IP), de la tarea MQTT y del
+// temporizador de reintentos. El mutex ordena las transiciones y los bits;
+// las acciones se ejecutan fuera (esp_mqtt_client_stop espera a la tarea
+// MQTT, que puede estar esperando el mutex)
+static bb_link_t s_link;
+static SemaphoreHandle_t s_link_mutex = NULL;
+static EventGroupHandle_t s_link_events = NULL;
+static esp_timer_handle_t s_link_timer = NULL;
+
+static bool link_online(void) {
+  return (xEventGroupGetBits(s_link_events) & BB_LINK_BIT_ONLINE) != 0;
+}
+
+bool bb_connect_wait_online(TickType_t wait) {
+  if (s_link_events == NULL)
+    return false;
+  return (xEventGroupWaitBits(s_link_events, BB_LINK_BIT_ONLINE, pdFALSE,
+                              pdTRUE, wait) &
+          BB_LINK_BIT_ONLINE) != 0;
+}
+
+static void link_dispatch(bb_link_event_t ev) {
+  int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(s_link_mutex, portMAX_DELAY);
+  bb_link_state_t before = s_link.state;
+  bb_link_out_t out = bb_link_event(&s_link, ev, now);
+  bb_link_state_t after = s_link.state;
+  if (after != before) {
+    EventBits_t bits = 0;
+    if (after == BB_LINK_IP || after == BB_LINK_ONLINE)
+      bits |= BB_LINK_BIT_IP;
+    if (bb_link_online(&s_link))
+      bits |= BB_LINK_BIT_ONLINE;
+    xEventGroupClearBits(s_link_events,
+                         (BB_LINK_BIT_IP | BB_LINK_BIT_ONLINE) & ~bits);
+    xEventGroupSetBits(s_link_events, bits);
+  }
+  bb_link_metrics_t m = bb_link_metrics(&s_link, now);
+  uint32_t failures = s_link.failures;
+  xSemaphoreGive(s_link_mutex);
+
+  if (after != before) {
+    if (after == BB_LINK_ONLINE) {
+      ESP_LOGI(TAG,
+               "Enlace: %s -> online en %u ms (reconexiones %u, con broker "
+               "%.1f%% desde el arranque)",
+               bb_link_state_name(before), m.connect_ms, m.reconnects,
+               m.uptime_pm / 10.0f);
+    } else if (after == BB_LINK_BACKOFF) {
+      ESP_LOGW(TAG, "Enlace: %s -> reintento en %lld ms (fallo %lu)",
+               bb_link_state_name(before), (long long)(out.timer_us / 1000),
+               (unsigned long)failures);
+    } else {
+      ESP_LOGI(TAG, "Enlace: %s -> %s", bb_link_state_name(before),
+               bb_link_state_name(after));
+    }
+  }
+
+  if (out.actions & BB_LINK_ACT_MQTT_STOP)
+    esp_mqtt_client_stop(mqtt_client);
+  if (out.actions & BB_LINK_ACT_DISCONNECT)
+    esp_wifi_disconnect();
+  if (out.actions & BB_LINK_ACT_CONNECT)
+    esp_wifi_connect();
+  if (out.actions & BB_LINK_ACT_MQTT_START)
+    esp_mqtt_client_start(mqtt_client);
+  if (out.actions & BB_LINK_ACT_TIMER) {
+    esp_timer_stop(s_link_timer); // Solo un plazo vigente
+    esp_timer_start_once(s_link_timer, (uint64_t)out.timer_us);
+  }
+
+  // Broker de vuelta: Task_Comms despierta para vaciar el backlog sin
+  // esperar al próximo reporte (cola llena = ya está despierta)
+  if (after == BB_LINK_ONLINE && before != BB_LINK_ONLINE) {
+    bb_telemetry_t *wake = NULL;
+    xQueueSend(xQueueTelemetry, &wake, 0);
+  }
+}
+
+static void link_timer_cb(void *arg) { link_dispatch(BB_LINK_EV_TIMER); }
+
+// Métricas del enlace en el reporte que sale (RSSI leído ahora)
+static void link_fill_metrics(bb_telemetry_t *out) {
+  wifi_ap_record_t ap;
+  bool associated = esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+
+  xSemaphoreTake(s_link_mutex, portMAX_DELAY);
+  s_link.rssi = associated ? ap.rssi : 0;
+  bb_link_metrics_t m = bb_link_metrics(&s_link, esp_timer_get_time());
+  xSemaphoreGive(s_link_mutex);
+
+  out->link_rssi = m.rssi;
+  out->link_reconnects = m.reconnects;
+  out->link_connect_ms = m.connect_ms;
+  out->link_uptime_pm = m.uptime_pm;
+}
+
+// --- Hora UTC (bb_clock.h) ---
+// Sincronizan SNTP (tarea tcpip) y la Web UI; convierten Task_Comms y
+// quien consulte la hora. Sección crítica corta: el ancla es un struct
+static bb_clock_t s_clock;
+static portMUX_TYPE s_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+static char s_sntp_server[64]; // lwIP guarda el puntero, no una copia
+
+// Ancla de este arranque en node/<id>/clock (retenido): con ella el destino
+// corrige los reportes publicados antes de la primera sincronización
+// (boot igual, sin "ts"): utc = utc_us + (t0_us - mono_us)·(1 + ppm·1e-6)
+static void clock_publish_anchor(void) {
+  bb_clock_t c;
+  bb_connect_clock_get(&c);
+  if (mqtt_client == NULL || !link_online() || c.source == BB_CLOCK_NONE)
+    return;
+
+  char topic[64];
+  char msg[160];
+  snprintf(topic, sizeof(topic), "%s/%s/clock", BB_MQTT_TOPIC_NODE,
+           bb_remote_node_id());
+  int len = snprintf(
+      msg, sizeof(msg),
+      "{\"boot\":%lu,\"mono_us\":%lld,\"utc_us\":%lld,\"drift_ppm\":%.3f,"
+      "\"src\":\"%s\"}",
+      (unsigned long)bb_storage_boot_id(), (long long)c.ref_mono_us,
+      (long long)c.ref_wall_us, c.drift_valid ? c.drift_ppb / 1000.0 : 0.0,
+      bb_clock_source_name(c.source));
+  // Sin bloquear: se llama desde la tarea tcpip (SNTP) y la de MQTT
+  esp_mqtt_client_enqueue(mqtt_client, topic, msg, len, 1, 1, true);
+}
+
+static bool clock_sync(int64_t mono_us, int64_t wall_us,
+                       bb_clock_source_t src) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  bool applied = bb_clock_sync(&s_clock, mono_us, wall_us, src);
+  bb_clock_t c = s_clock;
+  taskEXIT_CRITICAL(&s_clock_lock);
+  if (!applied)
+    return false;
+
+  time_t secs = (time_t)(wall_us / 1000000);
+  struct tm utc;
+  char when[24];
+  gmtime_r(&secs, &utc);
+  strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &utc);
+  if (c.syncs == 1) {
+    ESP_LOGI(TAG, "Hora %s: %s UTC (los reportes sin hora se corrigen)",
+             bb_clock_source_name(src), when);
+  } else if (c.drift_valid) {
+    ESP_LOGI(TAG, "Hora %s: %s UTC, error %+.1f ms, deriva %+.2f ppm",
+             bb_clock_source_name(src), when, c.last_err_us / 1000.0f,
+             c.drift_ppb / 1000.0f);
+  } else {
+    ESP_LOGI(TAG, "Hora %s: %s UTC, error %+.1f ms, deriva sin medir",
+             bb_clock_source_name(src), when, c.last_err_us / 1000.0f);
+  }
+  clock_publish_anchor();
+  return true;
+}
+
+static void sntp_sync_cb(struct timeval *tv) {
+  int64_t wall = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+  clock_sync(esp_timer_get_time(), wall, BB_CLOCK_SNTP);
+}
+
+int64_t bb_connect_wall_time_us(int64_t mono_us) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  int64_t wall = bb_clock_to_wall(&s_clock, mono_us);
+  taskEXIT_CRITICAL(&s_clock_lock);
+  return wall;
+}
+
+bool bb_connect_set_time(int64_t wall_us) {
+  if (!clock_sync(esp_timer_get_time(), wall_us, BB_CLOCK_MANUAL)) {
+    ESP_LOGW(TAG, "Hora manual ignorada: la da SNTP");
+    return false;
+  }
+  struct timeval tv = {.tv_sec = (time_t)(wall_us / 1000000),
+                       .tv_usec = (suseconds_t)(wall_us % 1000000)};
+  settimeofday(&tv, NULL);
+  return true;
+}
+
+void bb_connect_clock_get(bb_clock_t *out) {
+  taskENTER_CRITICAL(&s_clock_lock);
+  *out = s_clock;
+  taskEXIT_CRITICAL(&s_clock_lock);
+}
+
+// Hora UTC del reporte al publicarlo: los tomados antes de la primera
+// sincronización (en cola o en el backlog) salen ya corregidos. Los de un
+// arranque anterior que no llegó a tener hora se quedan sin ella
+static void report_fill_time(bb_telemetry_t *r) {
+  if (r->t_unix_us != 0 || r->t_first_us == 0 ||
+      r->boot_id != bb_storage_boot_id())
+    return;
+  taskENTER_CRITICAL(&s_clock_lock);
+  r->t_unix_us = bb_clock_to_wall(&s_clock, r->t_first_us);
+  r->time_src = (uint8_t)s_clock.source;
+  taskEXIT_CRITICAL(&s_clock_lock);
+}
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data) {
-  if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-    esp_wifi_connect();
-  } else if (event_base == WIFI_EVENT &&
-             event_id == WIFI_EVENT_STA_DISCONNECTED) {
-    ESP_LOGW(TAG, "WiFi desconectado, reintentando...");
-    esp_wifi_connect();
+  if (event_base == WIFI_EVENT) {
+    switch (event_id) {
+    case WIFI_EVENT_STA_START:
+      link_dispatch(BB_LINK_EV_START);
+      break;
+    case WIFI_EVENT_STA_CONNECTED:
+      link_dispatch(BB_LINK_EV_WIFI_UP);
+      break;
+    case WIFI_EVENT_STA_DISCONNECTED: {
+      wifi_event_sta_disconnected_t *d = event_data;
+      ESP_LOGW(TAG, "WiFi desconectado (motivo %d, %d dBm)", d->reason,
+               d->rssi);
+      link_dispatch(BB_LINK_EV_WIFI_DOWN);
+      break;
+    }
+    default:
+      break;
+    }
   } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-    ESP_LOGI(TAG, "WiFi conectado, iniciando MQTT...");
+    link_dispatch(BB_LINK_EV_GOT_IP);
+    esp_netif_sntp_start(); // Consulta inmediata; luego cada hora
+  } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+    link_dispatch(BB_LINK_EV_LOST_IP);
   }
 }
 
@@ -36,11 +351,29 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
   esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
 
   switch (event->event_id) {
+  case MQTT_EVENT_BEFORE_CONNECT:
+    link_dispatch(BB_LINK_EV_MQTT_TRY);
+    break;
   case MQTT_EVENT_CONNECTED:
     ESP_LOGI(TAG, "MQTT Conectado");
+    link_dispatch(BB_LINK_EV_MQTT_UP);
+    esp_mqtt_client_subscribe(event->client, BB_MQTT_TOPIC_CMD_WAVE, 1);
+    bb_remote_subscribe(event->client);
+    clock_publish_anchor();
     break;
   case MQTT_EVENT_DISCONNECTED:
     ESP_LOGW(TAG, "MQTT Desconectado");
+    link_dispatch(BB_LINK_EV_MQTT_DOWN);
+    break;
+  case MQTT_EVENT_DATA:
+    if (bb_remote_handle(event->client, event->topic, event->topic_len,
+                         event->data, event->data_len)) {
+      break;
+    }
+    if (event->topic_len == (int)strlen(BB_MQTT_TOPIC_CMD_WAVE) &&
+        strncmp(event->topic, BB_MQTT_TOPIC_CMD_WAVE, event->topic_len) == 0) {
+      bb_wave_command(event->data, event->data_len);
+    }
     break;
   default:
     break;
@@ -49,53 +382,427 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 
 #include "bb_espnow.h"
 
+#if BB_TELEMETRY_BENCH
+// Reporte sintético en el peor caso (2 puntos, giro, 3 temperaturas, calidad
+// degradada) codificado N veces en cada formato: µs por reporte y bytes
+static void telemetry_bench(void) {
+  static char json[768];
+  static uint8_t bin[BB_TLM_MAX_BYTES];
+  bb_telemetry_t r = {0};
+  const int n_iter = 1000;
+
+  r.vib_rms = 0.1234f;
+  r.vib_peak = 0.5678f;
+  r.vib_p2p = 1.0123f;
+  r.crest_factor = 4.6f;
+  r.temp_c = 21.5f;
+  r.vib_dom_freq = 49.8f;
+  r.fs_hz = 998.7f;
+  r.fs_jitter_us = 3.2f;
+  r.t_first_us = 123456789;
+  r.t_last_us = 125456789;
+  for (int i = 0; i < 5; i++) {
+    r.fft_bands_low[i] = 0.01f * (i + 1);
+    r.fft_bands_mid[i] = 0.002f * (i + 1);
+    r.fft_bands_high[i] = 0.0003f * (i + 1);
+  }
+  r.n_points = 2;
+  r.p2_rms = 0.1f;
+  r.coh_dom = 0.93f;
+  r.phase_dom_deg = -12.5f;
+  r.n_axes = 6;
+  r.gyro_rms_dps = 3.3f;
+  r.calibrated = 1;
+  r.quality = 1;
+  r.q_clipped = 2;
+  r.link_rssi = -67;
+  r.link_reconnects = 3;
+  r.link_connect_ms = 2450;
+  r.link_uptime_pm = 987;
+  r.t_unix_us = 1760000000123456LL;
+  r.time_src = BB_CLOCK_SNTP;
+  r.temp_count = BB_MAX_TEMP_SENSORS;
+  for (int i = 0; i < BB_MAX_TEMP_SENSORS; i++) {
+    r.temp_rom[i] = 0x28FF4A3B1C160301ULL + i;
+    r.temp_points_c[i] = 20.0f + i;
+  }
+
+  size_t json_len = 0, bin_len = 0;
+  int64_t t0 = esp_timer_get_time();
+  for (int i = 0; i < n_iter; i++)
+    json_len = bb_telemetry_format_json(&r, json, sizeof(json));
+  int64_t t1 = esp_timer_get_time();
+  for (int i = 0; i < n_iter; i++)
+    bin_len = bb_telemetry_encode(&r, bin, sizeof(bin));
+  int64_t t2 = esp_timer_get_time();
+
+  ESP_LOGI(TAG, "Bench telemetría: JSON %u B %.2f us/reporte (sin bandas)",
+           (unsigned)json_len, (float)(t1 - t0) / n_iter);
+  ESP_LOGI(TAG, "Bench telemetría: binario %u B %.2f us/reporte (completo)",
+           (unsigned)bin_len, (float)(t2 - t1) / n_iter);
+}
+#endif
+
+// --- Publicación MQTT: reporte suelto o lote ---
+// Estadísticas para medir el efecto del batching (solo Task_Comms)
+typedef struct {
+  uint32_t publishes;
+  uint32_t reports;
+  uint32_t payload_bytes;
+  uint32_t header_bytes; // Cabecera MQTT PUBLISH estimada
+  int64_t window_start_us;
+} mqtt_pub_stats_t;
+
+static mqtt_pub_stats_t s_pub_stats;
+
+// false si no hay broker: el llamador guarda los reportes en el backlog
+static bool mqtt_publish_payload(bool binary, const uint8_t *payload,
+                                 size_t len, int n_reports) {
+  const char *topic =
+      binary ? BB_MQTT_TOPIC_TELEMETRY_BIN : BB_MQTT_TOPIC_TELEMETRY;
+  if (mqtt_client == NULL || !link_online() ||
+      esp_mqtt_client_publish(mqtt_client, topic, (const char *)payload,
+                              (int)len, 1, 0) < 0) {
+    return false;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (s_pub_stats.publishes == 0)
+    s_pub_stats.window_start_us = now;
+  s_pub_stats.publishes++;
+  s_pub_stats.reports += n_reports;
+  s_pub_stats.payload_bytes += len;
+  // Tipo + longitud restante (1..3) + topic (2 + n) + packet id (QoS 1)
+  s_pub_stats.header_bytes +=
+      1 + (len < 128 ? 1 : (len < 16384 ? 2 : 3)) + 2 + strlen(topic) + 2;
+
+  if (s_pub_stats.reports >= BB_MQTT_STATS_EVERY_N_REPORTS) {
+    mqtt_pub_stats_t *st = &s_pub_stats;
+    float hours = (float)(now - st->window_start_us) / 3.6e9f;
+    ESP_LOGI(TAG,
+             "MQTT[%lu reportes]: %lu publicaciones (%.0f/h), %.1f "
+             "reportes/pub, payload %lu B/reporte, cabecera %lu B/reporte",
+             (unsigned long)st->reports, (unsigned long)st->publishes,
+             (hours > 0.0f) ? (float)st->publishes / hours : 0.0f,
+             (float)st->reports / (float)st->publishes,
+             (unsigned long)(st->payload_bytes / st->reports),
+             (unsigned long)(st->header_bytes / st->reports));
+    memset(st, 0, sizeof(*st));
+  }
+  return true;
+}
+
+static bool publish_single(bool binary, const bb_telemetry_t *data) {
+  static char json_payload[768]; // Punto B + 3 temperaturas caben holgados
+  static uint8_t bin_payload[BB_TLM_MAX_BYTES];
+
+  if (binary) {
+    // Binario versionado: reporte completo (bandas incluidas)
+    size_t len =
+        bb_telemetry_encode(data, bin_payload, sizeof(bin_payload));
+    if (!mqtt_publish_payload(true, bin_payload, len, 1))
+      return false;
+    ESP_LOGI(TAG, "Tel: %u bytes (binario v%d)", (unsigned)len,
+             BB_TLM_VERSION);
+  } else {
+    size_t len =
+        bb_telemetry_format_json(data, json_payload, sizeof(json_payload));
+    if (!mqtt_publish_payload(false, (const uint8_t *)json_payload, len, 1))
+      return false;
+    ESP_LOGI(TAG, "Tel: %s", json_payload);
+  }
+  return true;
+}
+
+/**
+ * Publica n reportes en orden: suelto si n == 1, si no en tantos lotes como
+ * hagan falta para BB_MQTT_BATCH_BYTES.
+ * @return Reportes publicados (los siguientes quedan sin enviar)
+ */
+static int publish_reports(bool binary, const bb_telemetry_t *reports,
+                           int n) {
+  static uint8_t buf[BB_MQTT_BATCH_BYTES];
+
+  if (n == 1)
+    return publish_single(binary, reports) ? 1 : 0;
+
+  int done = 0;
+  while (done < n) {
+    size_t len = bb_telemetry_batch_begin(binary, buf, sizeof(buf));
+    int k = 0;
+    for (; done + k < n; k++) {
+      size_t next = bb_telemetry_batch_append(binary, buf, len, sizeof(buf),
+                                              &reports[done + k]);
+      if (next == 0)
+        break; // Lote lleno en bytes: el resto va en el siguiente
+      len = next;
+    }
+    if (k == 0)
+      return done; // No cabe ni uno (no ocurre con 4 KiB)
+
+    len = bb_telemetry_batch_end(binary, buf, len, sizeof(buf));
+    if (!mqtt_publish_payload(binary, buf, len, k))
+      return done;
+    ESP_LOGI(TAG, "Tel: lote de %d reportes, %u bytes", k, (unsigned)len);
+    done += k;
+  }
+  return done;
+}
+
+// --- Store-and-forward ---
+// Sin broker los reportes van al backlog en SPIFFS y se reenvían en orden,
+// BB_BACKLOG_REPLAY_MS entre publicaciones, al reconectar
+static void backlog_store(const bb_telemetry_t *data) {
+  if (bb_backlog_push(data, sizeof(*data)) != ESP_OK) {
+    ESP_LOGE(TAG, "Reporte %lu/%lu perdido (backlog)",
+             (unsigned long)data->boot_id, (unsigned long)data->seq);
+  }
+}
+
+// Un lote del backlog por llamada (tamaño del lote configurado)
+static void backlog_replay(bool binary, int batch_size) {
+  static bb_telemetry_t replay[BB_MQTT_BATCH_MAX];
+  int n = 0;
+  uint32_t skip = 0;
+
+  while (n < batch_size) {
+    size_t len = 0;
+    esp_err_t err = bb_backlog_peek(skip + n, &replay[n], sizeof(replay[n]),
+                                    &len);
+    if (err == ESP_ERR_INVALID_CRC ||
+        (err == ESP_OK && len != sizeof(replay[n]))) {
+      if (n > 0)
+        break; // Primero lo bueno; el dañado se salta en la próxima vuelta
+      skip++;
+      continue;
+    }
+    if (err != ESP_OK)
+      break;
+    n++;
+  }
+  if (skip > 0) {
+    ESP_LOGW(TAG, "Backlog: %lu registros dañados descartados",
+             (unsigned long)skip);
+    bb_backlog_pop(skip);
+  }
+  if (n == 0)
+    return;
+  for (int i = 0; i < n; i++)
+    report_fill_time(&replay[i]);
+
+  int sent = publish_reports(binary, replay, n);
+  if (sent > 0) {
+    bb_backlog_pop(sent);
+    ESP_LOGI(TAG, "Backlog: %d reenviados, quedan %lu", sent,
+             (unsigned long)bb_backlog_count());
+  }
+}
+
+// Lote en curso: copias de los reportes (no retienen objetos del pool), se
+// codifican al publicar con el formato vigente
+typedef struct {
+  bb_telemetry_t reports[BB_MQTT_BATCH_MAX];
+  int count;
+  int64_t t_open_us; // Llegada del primer reporte
+} mqtt_batch_t;
+
+static mqtt_batch_t s_batch;
+
+static void batch_flush(bool binary) {
+  if (s_batch.count == 0)
+    return;
+  int sent = publish_reports(binary, s_batch.reports, s_batch.count);
+  // Lo no publicado (broker caído a mitad) no se pierde
+  for (int i = sent; i < s_batch.count; i++)
+    backlog_store(&s_batch.reports[i]);
+  s_batch.count = 0;
+}
+
+static void comms_handle_report(const bb_telemetry_t *data,
+                                const bb_config_t *cfg, int batch_size) {
+  bool binary = cfg->mqtt_binary;
+  // Reportes en alarma (umbral de aviso o superior) no esperan al lote
+  bool alarm = bb_rbe_alarm_level(data, cfg) > 0;
+  bool online = link_online();
+
+  // Sin broker, o con histórico por reenviar, el reporte se pone a la cola
+  // del backlog para conservar el orden. Las alarmas con broker no esperan.
+  if (!online || (bb_backlog_count() > 0 && !alarm)) {
+    batch_flush(binary);
+    backlog_store(data);
+    return;
+  }
+
+  if (batch_size <= 1 || alarm) {
+    // Primero lo pendiente (orden temporal) y después este reporte
+    batch_flush(binary);
+    if (!publish_single(binary, data))
+      backlog_store(data);
+    return;
+  }
+
+  if (s_batch.count == 0)
+    s_batch.t_open_us = esp_timer_get_time();
+  s_batch.reports[s_batch.count++] = *data;
+  if (s_batch.count >= batch_size)
+    batch_flush(binary);
+}
+
+// --- Report-by-exception ---
+// Filtro delante de ESP-NOW y MQTT: lo omitido no gasta radio ni broker
+static bb_rbe_t s_rbe;
+
+static void comms_process(const bb_telemetry_t *report, const bb_config_t *cfg,
+                          int batch_size) {
+  // Copia propia: el reporte compartido es de solo lectura
+  static bb_telemetry_t out;
+  out = *report;
+  report_fill_time(&out);
+  bb_history_add(&out); // El histórico guarda también lo que RBE omite
+
+  if (cfg->rbe_enabled) {
+    uint16_t skipped = 0;
+    bb_rbe_reason_t why = bb_rbe_evaluate(&s_rbe, report, cfg,
+                                          esp_timer_get_time(), &skipped);
+    if (s_rbe.evaluated % BB_MQTT_STATS_EVERY_N_REPORTS == 0) {
+      ESP_LOGI(TAG, "RBE: %lu de %lu reportes publicados (%.0f%%)",
+               (unsigned long)s_rbe.published,
+               (unsigned long)s_rbe.evaluated,
+               100.0f * s_rbe.published / s_rbe.evaluated);
+    }
+    if (why == BB_RBE_SKIP)
+      return;
+    out.rbe_skipped = skipped;
+    ESP_LOGI(TAG, "RBE: reporte %lu sale (%s, %u omitidos)",
+             (unsigned long)out.seq, bb_rbe_reason_name(why), skipped);
+  }
+
+  link_fill_metrics(&out);
+
+  // Send via ESP-NOW
+  bb_espnow_send(&out);
+  comms_handle_report(&out, cfg, batch_size);
+}
+
 void Task_Comms(void *pvParameters) {
-  bb_telemetry_t data;
-  char json_payload[256]; // Increased buffer size
+  bb_telemetry_t *report = NULL;
+  const bb_config_t *sys_cfg = bb_config_get();
+  int64_t next_replay_us = 0;
+  int64_t next_wave_us = INT64_MAX;
+  int64_t next_gw_us = INT64_MAX;
 
   while (1) {
-    if (xQueueReceive(xQueueTelemetry, &data, portMAX_DELAY)) {
-
-      // Update Battery Voltage
-      data.batt_v = bb_power_get_battery_voltage();
-
-      // Send via ESP-NOW
-      bb_espnow_send(&data);
-
-      // JSON for MQTT
-      snprintf(
-          json_payload, sizeof(json_payload),
-          "{\"rms\":%.3f,\"peak\":%.3f,\"p2p\":%.3f,\"crest\":%.2f,"
-          "\"temp\":%.2f,\"dom_freq\":%.1f,\"band_lo\":%.3f,\"band_hi\":%.3f,"
-          "\"ai_class\":%d,\"ai_conf\":%.2f,\"batt\":%.2f}",
-          data.vib_rms, data.vib_peak, data.vib_p2p, data.crest_factor,
-          data.temp_c, data.vib_dom_freq, data.vib_band_low, data.vib_band_high,
-          data.ai_class, data.ai_conf, data.batt_v);
-
-      if (mqtt_client != NULL) {
-        esp_mqtt_client_publish(mqtt_client, "hcaa/plcs/bluebrain/telemetry",
-                                json_payload, 0, 1, 0);
-        ESP_LOGI(TAG, "Tel: %s", json_payload);
-      } else {
-        ESP_LOGW(TAG, "No MQTT: %s", json_payload);
-      }
+    int batch_size = sys_cfg->mqtt_batch_size;
+    if (batch_size < 1)
+      batch_size = 1;
+    if (batch_size > BB_MQTT_BATCH_MAX)
+      batch_size = BB_MQTT_BATCH_MAX;
+
+    // Esperar como mucho hasta la latencia máxima del lote abierto o el
+    // siguiente reenvío del backlog. Sin broker no hay nada que intentar:
+    // solo un reporte nuevo o la vuelta del broker (NULL en la cola)
+    // despiertan la tarea
+    bool online = link_online();
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = INT64_MAX;
+    if (s_batch.count > 0)
+      wait_us = s_batch.t_open_us + sys_cfg->mqtt_batch_max_ms * 1000LL - now;
+    if (online && bb_backlog_count() > 0 && next_replay_us - now < wait_us)
+      wait_us = next_replay_us - now;
+    if (next_wave_us != INT64_MAX && next_wave_us - now < wait_us)
+      wait_us = next_wave_us - now;
+    if (next_gw_us != INT64_MAX && next_gw_us - now < wait_us)
+      wait_us = next_gw_us - now;
+
+    // Plazo redondeado al tick hacia arriba: por debajo de un tick la
+    // espera sería 0 y la tarea giraría en vacío hasta el vencimiento
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000LL;
+    TickType_t wait = portMAX_DELAY;
+    if (wait_us != INT64_MAX) {
+      wait = (wait_us > 0) ? (TickType_t)((wait_us + tick_us - 1) / tick_us)
+                           : 0;
+    }
+
+    if (xQueueReceive(xQueueTelemetry, &report, wait) == pdTRUE &&
+        report != NULL) {
+      comms_process(report, sys_cfg, batch_size);
+      bb_report_release(report);
+    }
+
+    now = esp_timer_get_time();
+    if (s_batch.count > 0 &&
+        now - s_batch.t_open_us >= sys_cfg->mqtt_batch_max_ms * 1000LL) {
+      batch_flush(sys_cfg->mqtt_binary); // Venció la latencia máxima
+    }
+    online = link_online();
+    if (online && bb_backlog_count() > 0 && now >= next_replay_us) {
+      backlog_replay(sys_cfg->mqtt_binary, batch_size);
+      next_replay_us = now + BB_BACKLOG_REPLAY_MS * 1000LL;
+    }
+
+    // Gateway: tramas ESP-NOW de otros nodos y sus lotes vencidos o llenos
+    int64_t gw_us =
+        bb_espnow_gateway_poll(mqtt_client, online, now, batch_size,
+                               sys_cfg->mqtt_batch_max_ms * 1000LL);
+    next_gw_us = (gw_us == INT64_MAX) ? INT64_MAX : now + gw_us;
+
+    // Forma de onda bajo demanda: un trozo por vuelta y solo con la cola
+    // de telemetría vacía (los reportes nunca esperan a la subida)
+    if (uxQueueMessagesWaiting(xQueueTelemetry) == 0) {
+      int64_t in_us = bb_wave_poll(mqtt_client, online, now);
+      next_wave_us = (in_us == INT64_MAX) ? INT64_MAX : now + in_us;
     }
   }
 }
 
 void bb_connect_init(void) {
-  // 1. Create Queue
-  xQueueTelemetry = xQueueCreate(10, sizeof(bb_telemetry_t));
+  // 1. Create Pool + Queue (punteros, no copias del reporte)
+  bb_pool_init(&s_report_pool, BB_POOL_INIT_ARGS(s_report_pool));
+  xQueueTelemetry = xQueueCreate(10, sizeof(bb_telemetry_t *));
   ESP_LOGI(TAG, "Queue Created");
 
+  // 1.2 Backlog store-and-forward (SPIFFS ya montado por bb_storage_init)
+  if (bb_backlog_init(BB_BACKLOG_PATH, BB_BACKLOG_SCHEMA,
+                      sizeof(bb_telemetry_t),
+                      BB_BACKLOG_MAX_RECORDS) != ESP_OK) {
+    ESP_LOGE(TAG, "Backlog no disponible: sin broker se perderán reportes");
+  }
+
+  // 1.3 Tendencias y agregados para la Web UI y MQTT (bb_history.h)
+  if (bb_history_init() != ESP_OK)
+    ESP_LOGE(TAG, "Histórico incompleto: alguna serie no está disponible");
+
   // 1.5 Init Power
   bb_power_init();
 
+#if BB_TELEMETRY_BENCH
+  telemetry_bench();
+#endif
+
   const bb_config_t *sys_cfg = bb_config_get();
 
-  // 2. Init WiFi
+  // 2. Init WiFi (reconexiones a cargo del gestor de conexión)
+  s_link_mutex = xSemaphoreCreateMutex();
+  s_link_events = xEventGroupCreate();
+  const esp_timer_create_args_t link_timer = {.callback = link_timer_cb,
+                                              .name = "bb_link"};
+  ESP_ERROR_CHECK(esp_timer_create(&link_timer, &s_link_timer));
+  bb_link_init(&s_link, esp_random(), esp_timer_get_time());
+
   ESP_ERROR_CHECK(esp_netif_init());
   ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+  // 2.1 SNTP: arranca con cada IP (evento GOT_IP) y resincroniza cada
+  // BB_SNTP_SYNC_INTERVAL_MS; cada respuesta ancla bb_clock
+  bb_clock_init(&s_clock);
+  strlcpy(s_sntp_server, sys_cfg->sntp_server, sizeof(s_sntp_server));
+  esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(s_sntp_server);
+  sntp_cfg.start = false;
+  sntp_cfg.sync_cb = sntp_sync_cb;
+  sntp_set_sync_interval(BB_SNTP_SYNC_INTERVAL_MS);
+  if (esp_netif_sntp_init(&sntp_cfg) != ESP_OK)
+    ESP_LOGE(TAG, "SNTP no disponible: reportes sin hora UTC");
+  ESP_LOGI(TAG, "SNTP: %s", s_sntp_server);
   esp_netif_create_default_wifi_sta();
   esp_netif_create_default_wifi_ap();
 
@@ -106,6 +813,8 @@ void bb_connect_init(void) {
                                              &wifi_event_handler, NULL));
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
                                              &wifi_event_handler, NULL));
+  ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_LOST_IP,
+                                             &wifi_event_handler, NULL));
 
   // Configure STA
   wifi_config_t wifi_con = {0};
@@ -130,12 +839,10 @@ void bb_connect_init(void) {
   ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
   ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
 
-  ESP_ERROR_CHECK(esp_wifi_start());
-
-  // 2.5 Init ESP-NOW (Must be after WiFi Start)
-  bb_espnow_init();
-
-  // 3. Init MQTT
+  // 2.2 Init MQTT (topics de comandos del nodo: MAC STA). Antes de
+  // esp_wifi_start(): el gestor de conexión arranca el cliente al tener IP
+  if (bb_remote_init() != ESP_OK)
+    ESP_LOGE(TAG, "Sin canal de comandos MQTT");
   esp_mqtt_client_config_t mqtt_cfg = {
       .broker.address.uri = sys_cfg->mqtt_broker_uri,
       .broker.address.port = sys_cfg->mqtt_port,
@@ -146,8 +853,12 @@ void bb_connect_init(void) {
   mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
   esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID,
                                  mqtt_event_handler, NULL);
-  esp_mqtt_client_start(mqtt_client);
+
+  ESP_ERROR_CHECK(esp_wifi_start());
+
+  // 2.5 Init ESP-NOW (Must be after WiFi Start)
+  bb_espnow_init();
 
   // 4. Launch Task
-  xTaskCreatePinnedToCore(Task_Comms, "Task_Comms", 4096, NULL, 3, NULL, 0);
+  xTaskCreatePinnedToCore(Task_Comms, "Task_Comms", 6144, NULL, 3, NULL, 0);
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+/**
+ * @file bb_history.c
+ * @brief Series de tendencias y agregados en flash (ver bb_history.h)
+ */
+
+#include "bb_history.h"
+#include "bb_config.h"
+#include "bb_rollup.h"
+#include "bb_telemetry_codec.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "BB_HISTORY";
+
+// Formato de los registros en flash: subir al cambiar
+// bb_telemetry_trend_point o el registro de bb_rollup (una serie de otro
+// formato se descarta)
+#define BB_TREND_SCHEMA 1
+#define BB_ROLLUP_SCHEMA 1
+
+// Registros del nivel inferior que rehacen un intervalo en curso (60
+// minutos o 24 horas, con margen)
+#define HISTORY_RESUME_POINTS 64
+
+typedef struct {
+  const char *name; // Valor de "res" en las consultas
+  const char *path;
+  uint16_t schema;
+  uint16_t data_bytes;
+  uint32_t capacity;
+  uint32_t query_max;
+} history_def_t;
+
+static const history_def_t s_def[BB_HIST_COUNT] = {
+    {"raw", BB_TREND_PATH, BB_TREND_SCHEMA, BB_TLM_TREND_BYTES,
+     BB_TREND_MAX_RECORDS, BB_TREND_QUERY_MAX},
+    {"min", BB_ROLLUP_MIN_PATH, BB_ROLLUP_SCHEMA, BB_ROLLUP_BYTES,
+     BB_ROLLUP_MIN_RECORDS, BB_ROLLUP_QUERY_MAX},
+    {"hour", BB_ROLLUP_HOUR_PATH, BB_ROLLUP_SCHEMA, BB_ROLLUP_BYTES,
+     BB_ROLLUP_HOUR_RECORDS, BB_ROLLUP_QUERY_MAX},
+    {"day", BB_ROLLUP_DAY_PATH, BB_ROLLUP_SCHEMA, BB_ROLLUP_BYTES,
+     BB_ROLLUP_DAY_RECORDS, BB_ROLLUP_QUERY_MAX},
+};
+
+static bb_trend_t s_series[BB_HIST_COUNT];
+
+// Intervalos en curso: los modifica Task_Comms; las consultas (Web UI,
+// MQTT) copian el suyo bajo el mismo cerrojo
+static bb_rollup_t s_rollup;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool s_resumed;       // Hora y día en curso rehechos desde flash
+static uint32_t s_persist_s; // Última bajada a flash de los agregados
+
+static bb_rollup_level_t level_of(bb_history_res_t res) {
+  return (bb_rollup_level_t)(res - BB_HIST_MINUTE);
+}
+
+static uint32_t period_s(bb_history_res_t res) {
+  return (res == BB_HIST_RAW) ? BB_TREND_EVERY_S
+                              : bb_rollup_period_s(level_of(res));
+}
+
+esp_err_t bb_history_init(void) {
+  esp_err_t ret = ESP_OK;
+  bb_rollup_init(&s_rollup);
+  for (int r = 0; r < BB_HIST_COUNT; r++) {
+    const history_def_t *d = &s_def[r];
+    esp_err_t err = bb_trend_init(&s_series[r], d->path, d->schema,
+                                  d->data_bytes, d->capacity);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Serie %s no disponible (%s)", d->name,
+               esp_err_to_name(err));
+      ret = err;
+    }
+  }
+  return ret;
+}
+
+// Un punto cada BB_TREND_EVERY_S como mucho en la serie de 10 s
+static void raw_store(const bb_telemetry_t *r, uint32_t t_s) {
+  static int64_t s_last_s = -1;
+  if (s_last_s >= 0 && t_s >= s_last_s && t_s < s_last_s + BB_TREND_EVERY_S)
+    return;
+  uint8_t point[BB_TLM_TREND_BYTES];
+  bb_telemetry_trend_point(r, point, sizeof(point));
+  if (bb_trend_append(&s_series[BB_HIST_RAW], t_s, point) == ESP_OK)
+    s_last_s = t_s;
+}
+
+// Suma a b los registros de una serie de agregados en from_s..to_s
+static void resume_merge(bb_history_res_t res, uint32_t from_s, uint32_t to_s,
+                         bb_rollup_bucket_t *b, uint8_t *buf) {
+  const size_t point = 4 + BB_ROLLUP_BYTES;
+  uint32_t n = 0;
+  if (from_s > to_s ||
+      bb_trend_query(&s_series[res], from_s, to_s, HISTORY_RESUME_POINTS, buf,
+                     HISTORY_RESUME_POINTS * point, &n, NULL) != ESP_OK)
+    return;
+  for (uint32_t i = 0; i < n; i++)
+    bb_rollup_merge(b, buf + i * point + 4);
+}
+
+// El intervalo que estaba abierto al apagar (el del último registro del
+// nivel inferior) no llegó a cerrarse: si ya terminó, se cierra ahora con
+// lo que el nivel inferior tiene guardado
+static void resume_close(bb_history_res_t res, uint32_t t_s, uint8_t *buf) {
+  bb_trend_stats_t lower, own;
+  bb_trend_get_stats(&s_series[res - 1], &lower);
+  bb_trend_get_stats(&s_series[res], &own);
+  uint32_t p = period_s(res);
+  uint32_t start = lower.newest_t - lower.newest_t % p;
+  if (lower.count == 0 || start >= t_s - t_s % p ||
+      (own.count > 0 && own.newest_t >= start))
+    return;
+
+  bb_rollup_bucket_t b = {.start_s = start};
+  resume_merge(res - 1, start, start + p - 1, &b, buf);
+  uint8_t rec[BB_ROLLUP_BYTES];
+  bb_rollup_encode(&b, rec);
+  bb_trend_append(&s_series[res], start, rec);
+}
+
+// Tras arrancar, la hora y el día en curso parten de lo ya guardado: los
+// minutos de esta hora y las horas de hoy (el minuto en curso se pierde)
+static void rollup_resume(uint32_t t_s) {
+  uint8_t *buf = malloc(HISTORY_RESUME_POINTS * (4 + BB_ROLLUP_BYTES));
+  if (buf == NULL)
+    return;
+  resume_close(BB_HIST_HOUR, t_s, buf);
+  resume_close(BB_HIST_DAY, t_s, buf);
+  bb_rollup_t tmp;
+  bb_rollup_init(&tmp);
+  bb_rollup_open(&tmp, BB_ROLLUP_HOUR, t_s);
+  bb_rollup_open(&tmp, BB_ROLLUP_DAY, t_s);
+  bb_rollup_bucket_t *hour = &tmp.cur[BB_ROLLUP_HOUR];
+  bb_rollup_bucket_t *day = &tmp.cur[BB_ROLLUP_DAY];
+
+  resume_merge(BB_HIST_MINUTE, hour->start_s, t_s, hour, buf);
+  resume_merge(BB_HIST_HOUR, day->start_s, hour->start_s - 1, day, buf);
+  resume_merge(BB_HIST_MINUTE, hour->start_s, t_s, day, buf);
+  free(buf);
+
+  taskENTER_CRITICAL(&s_mux);
+  s_rollup.cur[BB_ROLLUP_HOUR] = *hour;
+  s_rollup.cur[BB_ROLLUP_DAY] = *day;
+  taskEXIT_CRITICAL(&s_mux);
+  ESP_LOGI(TAG, "Agregados retomados: %lu muestras esta hora, %lu hoy",
+           (unsigned long)hour->m[BB_ROLLUP_RMS_A].n,
+           (unsigned long)day->m[BB_ROLLUP_RMS_A].n);
+}
+
+static void rollup_sample(const bb_telemetry_t *r,
+                          float v[BB_ROLLUP_METRICS]) {
+  v[BB_ROLLUP_RMS_A] = r->vib_rms;
+  v[BB_ROLLUP_PEAK_A] = r->vib_peak;
+  v[BB_ROLLUP_RMS_B] = (r->n_points > 1) ? r->p2_rms : NAN;
+  v[BB_ROLLUP_TEMP] = (r->temp_c > -99.0f) ? r->temp_c : NAN;
+}
+
+void bb_history_add(const bb_telemetry_t *r) {
+  // Sin hora UTC no hay eje; las tramas descartadas no tienen DSP
+  if (r->t_unix_us <= 0 || r->quality == 2)
+    return;
+  uint32_t t_s = (uint32_t)(r->t_unix_us / 1000000);
+  raw_store(r, t_s);
+
+  if (!s_resumed) {
+    rollup_resume(t_s);
+    s_resumed = true;
+    s_persist_s = t_s;
+  }
+  float v[BB_ROLLUP_METRICS];
+  rollup_sample(r, v);
+  bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS];
+  taskENTER_CRITICAL(&s_mux);
+  uint8_t mask = bb_rollup_add(&s_rollup, t_s, v, closed);
+  taskEXIT_CRITICAL(&s_mux);
+
+  for (int l = 0; l < BB_ROLLUP_LEVELS; l++) {
+    if (!(mask & (1u << l)))
+      continue;
+    uint8_t rec[BB_ROLLUP_BYTES];
+    bb_rollup_encode(&closed[l], rec);
+    bb_trend_append(&s_series[BB_HIST_MINUTE + l], closed[l].start_s, rec);
+  }
+
+  // Horas y días cierran pocos registros: sin esto esperarían en RAM a
+  // completar un bloque de BB_TREND_FLUSH_RECORDS
+  if (t_s - s_persist_s >= BB_ROLLUP_PERSIST_S) {
+    for (int i = BB_HIST_MINUTE; i < BB_HIST_COUNT; i++)
+      bb_trend_flush(&s_series[i]);
+    s_persist_s = t_s;
+  }
+}
+
+void bb_history_flush(void) {
+  for (int r = 0; r < BB_HIST_COUNT; r++)
+    bb_trend_flush(&s_series[r]);
+}
+
+bool bb_history_parse_res(const char *name, bb_history_res_t *out) {
+  for (int r = 0; r < BB_HIST_COUNT; r++) {
+    if (strcmp(name, s_def[r].name) == 0) {
+      *out = (bb_history_res_t)r;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t bb_history_query_max(bb_history_res_t res) {
+  return s_def[res].query_max;
+}
+
+// Copia del intervalo en curso de una resolución de agregados
+static bb_rollup_bucket_t current(bb_history_res_t res) {
+  taskENTER_CRITICAL(&s_mux);
+  bb_rollup_bucket_t b = s_rollup.cur[level_of(res)];
+  taskEXIT_CRITICAL(&s_mux);
+  return b;
+}
+
+void bb_history_default_query(bb_history_res_t res, uint32_t *from_s,
+                              uint32_t *to_s, uint32_t *max_points) {
+  bb_trend_stats_t st;
+  bb_trend_get_stats(&s_series[res], &st);
+  uint32_t to = st.newest_t;
+  if (res != BB_HIST_RAW) {
+    uint32_t start = current(res).start_s;
+    if (start > to)
+      to = start;
+  }
+  uint32_t span = s_def[res].capacity * period_s(res);
+  *to_s = to;
+  *from_s = (to > span) ? to - span : 0;
+  *max_points = (res == BB_HIST_RAW) ? BB_TREND_DEFAULT_POINTS
+                                     : s_def[res].query_max;
+}
+
+esp_err_t bb_history_query(bb_history_res_t res, uint32_t from_s,
+                           uint32_t to_s, uint32_t max_points, uint8_t **out,
+                           size_t *len, uint32_t *n_out, uint32_t *matched) {
+  if (res >= BB_HIST_COUNT || out == NULL || len == NULL || max_points < 1 ||
+      max_points > s_def[res].query_max)
+    return ESP_ERR_INVALID_ARG;
+  *out = NULL;
+  *len = 0;
+
+  bool raw = (res == BB_HIST_RAW);
+  size_t head = raw ? BB_TLM_TREND_HEADER_BYTES : BB_TLM_ROLLUP_HEADER_BYTES;
+  size_t point = 4 + s_def[res].data_bytes;
+
+  // El intervalo en curso va como último punto si cae en el rango (un hueco
+  // reservado: no se pierde al diezmar)
+  bb_rollup_bucket_t cur = {0};
+  bool partial = false;
+  if (!raw) {
+    cur = current(res);
+    for (int m = 0; m < BB_ROLLUP_METRICS; m++)
+      partial |= cur.m[m].n > 0;
+    partial = partial && cur.start_s >= from_s && cur.start_s <= to_s;
+  }
+
+  uint8_t *buf = malloc(head + max_points * point);
+  if (buf == NULL)
+    return ESP_ERR_NO_MEM;
+  uint32_t n = 0, m = 0;
+  esp_err_t err =
+      bb_trend_query(&s_series[res], from_s, to_s, max_points - partial,
+                     buf + head, max_points * point, &n, &m);
+  if (err != ESP_OK) {
+    free(buf);
+    return err;
+  }
+  // Si se cerró mientras tanto, ya está en la serie
+  uint32_t last_t = 0;
+  if (n > 0)
+    memcpy(&last_t, buf + head + (n - 1) * point, 4);
+  if (partial && (n == 0 || last_t < cur.start_s)) {
+    memcpy(buf + head + n * point, &cur.start_s, 4);
+    bb_rollup_encode(&cur, buf + head + n * point + 4);
+    n++;
+    m++;
+  }
+
+  if (raw)
+    bb_telemetry_trend_header(buf, head, (uint16_t)n, m);
+  else
+    bb_telemetry_rollup_header(buf, head, (uint8_t)level_of(res), (uint16_t)n,
+                               m);
+  *out = buf;
+  *len = head + n * point;
+  if (n_out != NULL)
+    *n_out = n;
+  if (matched != NULL)
+    *matched = m;
+  return ESP_OK;
+}
+
+void bb_history_get_stats(bb_history_res_t res, bb_trend_stats_t *out) {
+  bb_trend_get_stats(&s_series[res], out);
+}
@@ -0,0 +1,189 @@
+/**
+ * @file bb_link.c
+ * @brief Máquina de estados de la conexión WiFi/MQTT con backoff y jitter
+ */
+
+#include "bb_link.h"
+#include "bb_config.h"
+#include <stddef.h>
+
+#define MS 1000LL
+
+static uint32_t next_rand(bb_link_t *l) {
+  uint32_t x = l->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  l->rng = x;
+  return x;
+}
+
+static void arm(bb_link_t *l, int64_t now_us, int64_t timeout_us,
+                bb_link_out_t *out) {
+  l->deadline_us = now_us + timeout_us;
+  out->actions |= BB_LINK_ACT_TIMER;
+  out->timer_us = timeout_us;
+}
+
+// Cambia de estado; timeout_us > 0 fija el plazo y pide el temporizador
+static void enter(bb_link_t *l, bb_link_state_t state, int64_t now_us,
+                  int64_t timeout_us, bb_link_out_t *out) {
+  if (l->state == BB_LINK_ONLINE && state != BB_LINK_ONLINE) {
+    int64_t stretch = now_us - l->t_online_us;
+    l->online_us += stretch;
+    if (stretch >= BB_LINK_STABLE_MS * MS)
+      l->failures = 0; // Enlace estable: la próxima caída empieza de cero
+  }
+  l->state = state;
+  l->deadline_us = 0;
+  if (timeout_us > 0)
+    arm(l, now_us, timeout_us, out);
+}
+
+// MIN·2^(fallos-1) con tope, y jitter uniforme en [plazo/2, plazo]
+static int64_t backoff_us(bb_link_t *l) {
+  int64_t d = BB_LINK_BACKOFF_MAX_MS * MS;
+  uint32_t shift = (l->failures > 0) ? l->failures - 1 : 0;
+  if (shift < 20 && (BB_LINK_BACKOFF_MIN_MS * MS << shift) < d)
+    d = BB_LINK_BACKOFF_MIN_MS * MS << shift;
+  int64_t half = d / 2;
+  return half + (int64_t)(next_rand(l) % (uint32_t)(half + 1));
+}
+
+static void start_attempt(bb_link_t *l, int64_t now_us, bb_link_out_t *out) {
+  out->actions |= BB_LINK_ACT_CONNECT;
+  l->attempts++;
+  l->t_attempt_us = now_us;
+  enter(l, BB_LINK_CONNECTING, now_us, BB_LINK_ASSOC_TIMEOUT_MS * MS, out);
+}
+
+// Caída o intento fallido: sin IP no hay MQTT; esperar antes de reintentar
+static void link_down(bb_link_t *l, int64_t now_us, bool disconnect,
+                      bb_link_out_t *out) {
+  if (l->mqtt_running) {
+    out->actions |= BB_LINK_ACT_MQTT_STOP;
+    l->mqtt_running = false;
+  }
+  l->mqtt_retry = false;
+  if (disconnect)
+    out->actions |= BB_LINK_ACT_DISCONNECT;
+  l->rssi = 0;
+
+  // enter() puede poner la cuenta a cero: el plazo se calcula después
+  enter(l, BB_LINK_BACKOFF, now_us, 0, out);
+  l->failures++;
+  l->last_backoff_us = backoff_us(l);
+  arm(l, now_us, l->last_backoff_us, out);
+}
+
+void bb_link_init(bb_link_t *l, uint32_t seed, int64_t now_us) {
+  *l = (bb_link_t){0};
+  l->state = BB_LINK_IDLE;
+  l->rng = seed ? seed : 0x9E3779B9u; // xorshift no sale del 0
+  l->t_start_us = now_us;
+}
+
+bb_link_out_t bb_link_event(bb_link_t *l, bb_link_event_t ev,
+                            int64_t now_us) {
+  bb_link_out_t out = {0};
+
+  switch (ev) {
+  case BB_LINK_EV_START:
+    if (l->state == BB_LINK_IDLE)
+      start_attempt(l, now_us, &out);
+    break;
+
+  case BB_LINK_EV_WIFI_UP:
+    // También en BACKOFF: una asociación tardía vale igual
+    if (l->state == BB_LINK_CONNECTING || l->state == BB_LINK_BACKOFF)
+      enter(l, BB_LINK_ASSOCIATED, now_us, BB_LINK_DHCP_TIMEOUT_MS * MS,
+            &out);
+    break;
+
+  case BB_LINK_EV_WIFI_DOWN:
+    if (l->state != BB_LINK_IDLE && l->state != BB_LINK_BACKOFF)
+      link_down(l, now_us, false, &out);
+    break;
+
+  case BB_LINK_EV_GOT_IP:
+    if (l->state == BB_LINK_CONNECTING || l->state == BB_LINK_ASSOCIATED) {
+      enter(l, BB_LINK_IP, now_us, 0, &out);
+      if (!l->mqtt_running) {
+        out.actions |= BB_LINK_ACT_MQTT_START;
+        l->mqtt_running = true;
+      }
+    }
+    break;
+
+  case BB_LINK_EV_LOST_IP:
+    // Asociado pero sin IP válida: desasociar para pedir DHCP de nuevo
+    if (l->state == BB_LINK_IP || l->state == BB_LINK_ONLINE)
+      link_down(l, now_us, true, &out);
+    break;
+
+  case BB_LINK_EV_MQTT_TRY:
+    // Tras un fallo del broker la latencia cuenta desde su último intento;
+    // el primero con esta IP sigue contando desde esp_wifi_connect()
+    if (l->state == BB_LINK_IP && l->mqtt_retry)
+      l->t_attempt_us = now_us;
+    break;
+
+  case BB_LINK_EV_MQTT_UP:
+    if (l->state == BB_LINK_IP) {
+      enter(l, BB_LINK_ONLINE, now_us, 0, &out);
+      l->t_online_us = now_us;
+      l->mqtt_retry = false;
+      int64_t ms = (now_us - l->t_attempt_us) / MS;
+      l->connect_ms = (ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)ms;
+      if (l->been_online)
+        l->reconnects++;
+      l->been_online = true;
+    }
+    break;
+
+  case BB_LINK_EV_MQTT_DOWN:
+    // Solo el broker (caída o intento fallido): ESP-MQTT reintenta con la
+    // IP que ya hay
+    if (l->state == BB_LINK_ONLINE)
+      enter(l, BB_LINK_IP, now_us, 0, &out);
+    if (l->state == BB_LINK_IP)
+      l->mqtt_retry = true;
+    break;
+
+  case BB_LINK_EV_TIMER:
+    if (l->deadline_us == 0 || now_us < l->deadline_us)
+      break; // Plazo de un estado anterior
+    if (l->state == BB_LINK_BACKOFF)
+      start_attempt(l, now_us, &out);
+    else if (l->state == BB_LINK_CONNECTING ||
+             l->state == BB_LINK_ASSOCIATED)
+      link_down(l, now_us, true, &out); // Sin respuesta: abortar
+    break;
+  }
+  return out;
+}
+
+static uint16_t sat_u16(uint32_t v) { return (v > 0xFFFF) ? 0xFFFF : v; }
+
+bb_link_metrics_t bb_link_metrics(const bb_link_t *l, int64_t now_us) {
+  bb_link_metrics_t m = {
+      .rssi = l->rssi,
+      .reconnects = sat_u16(l->reconnects),
+      .connect_ms = sat_u16(l->connect_ms),
+  };
+  int64_t online = l->online_us;
+  if (l->state == BB_LINK_ONLINE)
+    online += now_us - l->t_online_us;
+  int64_t total = now_us - l->t_start_us;
+  if (total > 0)
+    m.uptime_pm = (uint16_t)(online * 1000 / total);
+  return m;
+}
+
+const char *bb_link_state_name(bb_link_state_t state) {
+  static const char *const names[] = {"idle",   "connecting", "associated",
+                                      "ip",     "online",     "backoff"};
+  if ((unsigned)state >= sizeof(names) / sizeof(names[0]))
+    return "?";
+  return names[state];
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bb_rbe.c
+ * @brief Report-by-exception con bandas muertas y heartbeat
+ */
+
+#include "bb_rbe.h"
+#include <math.h>
+#include <stddef.h>
+
+// Banda de cada magnitud según su unidad. La relativa solo tiene sentido en
+// amplitudes (cero físico): 10 % de 40 °C o de 25 Hz no significa nada
+typedef enum {
+  RBE_UNIT_G,    // max(rbe_db_g, relativa)
+  RBE_UNIT_TEMP, // rbe_db_temp_c
+  RBE_UNIT_FREQ, // BB_RBE_DB_FREQ_HZ (resolución de la FFT)
+  RBE_UNIT_REL,  // Solo relativa (factor de cresta, °/s)
+} rbe_unit_t;
+
+static const struct {
+  size_t offset;
+  rbe_unit_t unit;
+} k_features[] = {
+    {offsetof(bb_telemetry_t, vib_rms), RBE_UNIT_G},
+    {offsetof(bb_telemetry_t, vib_peak), RBE_UNIT_G},
+    {offsetof(bb_telemetry_t, crest_factor), RBE_UNIT_REL},
+    {offsetof(bb_telemetry_t, vib_dom_freq), RBE_UNIT_FREQ},
+    {offsetof(bb_telemetry_t, temp_c), RBE_UNIT_TEMP},
+    {offsetof(bb_telemetry_t, p2_rms), RBE_UNIT_G},
+    {offsetof(bb_telemetry_t, p2_dom_freq), RBE_UNIT_FREQ},
+    {offsetof(bb_telemetry_t, gyro_rms_dps), RBE_UNIT_REL},
+};
+
+static float feature(const bb_telemetry_t *r, size_t offset) {
+  return *(const float *)((const uint8_t *)r + offset);
+}
+
+int bb_rbe_alarm_level(const bb_telemetry_t *r, const bb_config_t *cfg) {
+  if (r->vib_rms >= cfg->rms_alert_crit || r->temp_c >= cfg->temp_alert_crit)
+    return 2;
+  if (r->vib_rms >= cfg->rms_alert_warn || r->temp_c >= cfg->temp_alert_warn)
+    return 1;
+  return 0;
+}
+
+static bool state_changed(const bb_telemetry_t *a, const bb_telemetry_t *b) {
+  return a->ai_class != b->ai_class || a->quality != b->quality ||
+         a->calibrated != b->calibrated || a->n_points != b->n_points ||
+         a->n_axes != b->n_axes || a->temp_count != b->temp_count;
+}
+
+static bool outside_deadband(const bb_telemetry_t *r,
+                             const bb_telemetry_t *last,
+                             const bb_config_t *cfg) {
+  for (size_t i = 0; i < sizeof(k_features) / sizeof(k_features[0]); i++) {
+    float ref = feature(last, k_features[i].offset);
+    float delta = fabsf(feature(r, k_features[i].offset) - ref);
+
+    float db_rel = cfg->rbe_db_pct * 0.01f * fabsf(ref);
+    float db = 0.0f;
+    switch (k_features[i].unit) {
+    case RBE_UNIT_G:
+      db = fmaxf(cfg->rbe_db_g, db_rel);
+      break;
+    case RBE_UNIT_TEMP:
+      db = cfg->rbe_db_temp_c;
+      break;
+    case RBE_UNIT_FREQ:
+      db = BB_RBE_DB_FREQ_HZ;
+      break;
+    case RBE_UNIT_REL:
+      db = db_rel;
+      break;
+    }
+    if (delta > db)
+      return true;
+  }
+  return false;
+}
+
+bb_rbe_reason_t bb_rbe_evaluate(bb_rbe_t *st, const bb_telemetry_t *r,
+                                const bb_config_t *cfg, int64_t now_us,
+                                uint16_t *skipped) {
+  bb_rbe_reason_t reason = BB_RBE_SKIP;
+  st->evaluated++;
+
+  if (!st->primed)
+    reason = BB_RBE_FIRST;
+  else if (bb_rbe_alarm_level(r, cfg) != bb_rbe_alarm_level(&st->last, cfg))
+    reason = BB_RBE_ALARM;
+  else if (state_changed(r, &st->last))
+    reason = BB_RBE_STATE;
+  else if (outside_deadband(r, &st->last, cfg))
+    reason = BB_RBE_DEADBAND;
+  else if (now_us - st->last_pub_us >= (int64_t)cfg->rbe_heartbeat_s * 1000000)
+    reason = BB_RBE_HEARTBEAT;
+
+  if (reason == BB_RBE_SKIP) {
+    if (st->skipped < UINT16_MAX)
+      st->skipped++;
+    return reason;
+  }
+
+  *skipped = st->skipped;
+  st->skipped = 0;
+  st->primed = true;
+  st->last = *r;
+  st->last_pub_us = now_us;
+  st->published++;
+  return reason;
+}
+
+const char *bb_rbe_reason_name(bb_rbe_reason_t reason) {
+  static const char *const names[] = {"omitido", "primero", "alarma",
+                                      "estado", "banda", "heartbeat"};
+  return ((unsigned)reason < sizeof(names) / sizeof(names[0]))
+             ? names[reason]
+             : "?";
+}
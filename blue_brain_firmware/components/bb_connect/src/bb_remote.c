@@ -0,0 +1,427 @@
+/**
+ * @file bb_remote.c
+ * @brief Canal de comandos MQTT: parches de configuración y acciones
+ */
+
+#include "bb_remote.h"
+#include "bb_config.h"
+#include "bb_dataset.h"
+#include "bb_history.h"
+#include "bb_waveform.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "BB_REMOTE";
+
+#define REMOTE_RESTART_DELAY_MS 1000 // El ack sale antes de reiniciar
+
+typedef enum {
+  RF_INT,
+  RF_U8,
+  RF_U32,
+  RF_FLOAT,
+  RF_BOOL,
+} remote_type_t;
+
+typedef struct {
+  const char *key; // Misma clave que /api/v1/config (Web UI)
+  remote_type_t type;
+  size_t offset;
+  double min;
+  double max;
+  bool restart; // Solo tiene efecto tras reiniciar
+} remote_field_t;
+
+#define FIELD(key, type, member, min, max, restart)                            \
+  {key, type, offsetof(bb_config_t, member), min, max, restart}
+
+// Lo que se puede cambiar por MQTT (WiFi y broker solo desde la Web UI)
+static const remote_field_t k_fields[] = {
+    FIELD("sample_rate", RF_INT, sample_rate_hz, BB_STREAM_RATE_MIN_HZ,
+          BB_STREAM_RATE_MAX_HZ, false),
+    FIELD("n_samples", RF_INT, n_samples, 64, BB_N_SAMPLES, false),
+    FIELD("rms_warn", RF_FLOAT, rms_alert_warn, 0.0, 16.0, false),
+    FIELD("rms_crit", RF_FLOAT, rms_alert_crit, 0.0, 16.0, false),
+    FIELD("temp_warn", RF_FLOAT, temp_alert_warn, -55.0, 125.0, false),
+    FIELD("temp_crit", RF_FLOAT, temp_alert_crit, -55.0, 125.0, false),
+    FIELD("espnow_en", RF_BOOL, espnow_enabled, 0, 1, false),
+    FIELD("espnow_gw", RF_BOOL, espnow_gateway, 0, 1, true),
+    FIELD("espnow_sync", RF_U8, espnow_sync, 0, 2, true),
+    FIELD("mqtt_binary", RF_BOOL, mqtt_binary, 0, 1, false),
+    FIELD("mqtt_batch_size", RF_U8, mqtt_batch_size, 1, BB_MQTT_BATCH_MAX,
+          false),
+    FIELD("mqtt_batch_max_ms", RF_U32, mqtt_batch_max_ms, 100, 3600000,
+          false),
+    FIELD("rbe_en", RF_BOOL, rbe_enabled, 0, 1, false),
+    FIELD("rbe_db_pct", RF_FLOAT, rbe_db_pct, 0.0, 100.0, false),
+    FIELD("rbe_db_g", RF_FLOAT, rbe_db_g, 0.0, 16.0, false),
+    FIELD("rbe_db_temp", RF_FLOAT, rbe_db_temp_c, 0.0, 50.0, false),
+    FIELD("rbe_heartbeat_s", RF_U32, rbe_heartbeat_s, 10, 86400, false),
+    FIELD("acq_continuous", RF_BOOL, acq_continuous, 0, 1, true),
+    FIELD("acq_gyro", RF_BOOL, acq_gyro, 0, 1, true),
+    FIELD("maint_mode", RF_BOOL, maint_mode, 0, 1, true),
+};
+#define N_FIELDS (sizeof(k_fields) / sizeof(k_fields[0]))
+
+static char s_node_id[13];
+static char s_topic_cmd[64];
+static char s_topic_all[64];
+static char s_topic_ack[64];
+static char s_topic_trend[64];
+static bb_remote_hooks_t s_hooks;
+static esp_timer_handle_t s_restart_timer = NULL;
+
+// Último comando con id (solo la tarea MQTT): reentregas QoS 1
+static bool s_have_last = false;
+static double s_last_id;
+static bool s_last_ok;
+
+void bb_remote_set_hooks(const bb_remote_hooks_t *hooks) { s_hooks = *hooks; }
+
+const char *bb_remote_node_id(void) { return s_node_id; }
+
+static void restart_cb(void *arg) {
+  bb_history_flush();     // Los puntos aún en RAM
+  bb_dataset_flush(1000); // Bloque de entrenamiento a medias
+  esp_restart();
+}
+
+esp_err_t bb_remote_init(void) {
+  uint8_t mac[6];
+  esp_err_t err = esp_read_mac(mac, ESP_MAC_WIFI_STA);
+  if (err != ESP_OK)
+    return err;
+  snprintf(s_node_id, sizeof(s_node_id), "%02x%02x%02x%02x%02x%02x", mac[0],
+           mac[1], mac[2], mac[3], mac[4], mac[5]);
+  snprintf(s_topic_cmd, sizeof(s_topic_cmd), "%s/%s/cmd", BB_MQTT_TOPIC_NODE,
+           s_node_id);
+  snprintf(s_topic_all, sizeof(s_topic_all), "%s/all/cmd", BB_MQTT_TOPIC_NODE);
+  snprintf(s_topic_ack, sizeof(s_topic_ack), "%s/%s/ack", BB_MQTT_TOPIC_NODE,
+           s_node_id);
+  snprintf(s_topic_trend, sizeof(s_topic_trend), "%s/%s/trend",
+           BB_MQTT_TOPIC_NODE, s_node_id);
+
+  const esp_timer_create_args_t args = {.callback = restart_cb,
+                                        .name = "bb_restart"};
+  err = esp_timer_create(&args, &s_restart_timer);
+  ESP_LOGI(TAG, "Comandos en %s (y %s)", s_topic_cmd, s_topic_all);
+  return err;
+}
+
+void bb_remote_subscribe(esp_mqtt_client_handle_t client) {
+  esp_mqtt_client_subscribe(client, s_topic_cmd, 1);
+  esp_mqtt_client_subscribe(client, s_topic_all, 1);
+}
+
+static const remote_field_t *field_find(const char *key) {
+  for (size_t i = 0; i < N_FIELDS; i++) {
+    if (strcmp(k_fields[i].key, key) == 0)
+      return &k_fields[i];
+  }
+  return NULL;
+}
+
+static double field_get(const bb_config_t *cfg, const remote_field_t *f) {
+  const uint8_t *p = (const uint8_t *)cfg + f->offset;
+  switch (f->type) {
+  case RF_INT:
+    return *(const int *)p;
+  case RF_U8:
+    return *p;
+  case RF_U32:
+    return *(const uint32_t *)p;
+  case RF_FLOAT:
+    return *(const float *)p;
+  case RF_BOOL:
+    return *(const bool *)p;
+  }
+  return 0.0;
+}
+
+static void field_set(bb_config_t *cfg, const remote_field_t *f, double v) {
+  uint8_t *p = (uint8_t *)cfg + f->offset;
+  switch (f->type) {
+  case RF_INT:
+    *(int *)p = (int)v;
+    break;
+  case RF_U8:
+    *p = (uint8_t)v;
+    break;
+  case RF_U32:
+    *(uint32_t *)p = (uint32_t)v;
+    break;
+  case RF_FLOAT:
+    *(float *)p = (float)v;
+    break;
+  case RF_BOOL:
+    *(bool *)p = v != 0.0;
+    break;
+  }
+}
+
+// Valida el parche entero sobre una copia: se aplica todo o nada
+static esp_err_t apply_patch(const cJSON *set, bb_config_t *cfg, cJSON *ack,
+                             bool *changed, char *err, size_t err_len) {
+  if (!cJSON_IsObject(set)) {
+    snprintf(err, err_len, "\"set\" debe ser un objeto");
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_err_t ret = ESP_OK;
+  bool restart = false;
+  cJSON *applied = cJSON_CreateArray();
+  const cJSON *item;
+  cJSON_ArrayForEach(item, set) {
+    const remote_field_t *f = field_find(item->string);
+    if (f == NULL) {
+      snprintf(err, err_len, "%s: clave desconocida o solo local",
+               item->string);
+      ret = ESP_ERR_NOT_FOUND;
+      break;
+    }
+    double v;
+    if (f->type == RF_BOOL) {
+      v = cJSON_IsBool(item) ? (cJSON_IsTrue(item) ? 1.0 : 0.0) : NAN;
+    } else {
+      v = cJSON_IsNumber(item) ? item->valuedouble : NAN;
+      if (f->type != RF_FLOAT && v != floor(v))
+        v = NAN; // Entero esperado
+    }
+    if (!(v >= f->min && v <= f->max)) {
+      if (f->type == RF_BOOL)
+        snprintf(err, err_len, "%s: se espera true/false", f->key);
+      else
+        snprintf(err, err_len, "%s: fuera de rango (%g..%g%s)", f->key,
+                 f->min, f->max, f->type == RF_FLOAT ? "" : ", entero");
+      ret = ESP_ERR_INVALID_ARG;
+      break;
+    }
+    double old = field_get(cfg, f);
+    field_set(cfg, f, v);
+    if (field_get(cfg, f) != old) {
+      *changed = true;
+      restart |= f->restart;
+    }
+    cJSON_AddItemToArray(applied, cJSON_CreateString(f->key));
+  }
+  if (ret == ESP_OK && (cfg->rms_alert_warn > cfg->rms_alert_crit ||
+                        cfg->temp_alert_warn > cfg->temp_alert_crit)) {
+    snprintf(err, err_len, "umbral de aviso por encima del crítico");
+    ret = ESP_ERR_INVALID_ARG;
+  }
+  if (ret != ESP_OK) {
+    cJSON_Delete(applied);
+    return ret;
+  }
+  cJSON_AddItemToObject(ack, "applied", applied);
+  cJSON_AddBoolToObject(ack, "restart", restart);
+  return ESP_OK;
+}
+
+// Entero sin signo de 32 bits opcional: def si falta, false si no vale
+static bool json_u32(const cJSON *cmd, const char *key, uint32_t def,
+                     uint32_t *out) {
+  const cJSON *item = cJSON_GetObjectItem(cmd, key);
+  if (item == NULL) {
+    *out = def;
+    return true;
+  }
+  double v = cJSON_IsNumber(item) ? item->valuedouble : NAN;
+  if (!(v >= 0.0 && v <= UINT32_MAX) || v != floor(v))
+    return false;
+  *out = (uint32_t)v;
+  return true;
+}
+
+// Consulta el histórico y encola la respuesta binaria (sale en el siguiente
+// ciclo de la tarea MQTT, como el ack)
+static esp_err_t trend_publish(esp_mqtt_client_handle_t client,
+                               const cJSON *cmd, cJSON *ack, char *err,
+                               size_t err_len) {
+  bb_history_res_t res = BB_HIST_RAW;
+  const cJSON *res_item = cJSON_GetObjectItem(cmd, "res");
+  if (res_item != NULL && (!cJSON_IsString(res_item) ||
+                           !bb_history_parse_res(res_item->valuestring,
+                                                 &res))) {
+    snprintf(err, err_len, "trend: res raw, min, hour o day");
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uint32_t def_from, def_to, def_max, from_s, to_s, max_points;
+  bb_history_default_query(res, &def_from, &def_to, &def_max);
+  uint32_t span = def_to - def_from;
+  if (!json_u32(cmd, "to", def_to, &to_s) ||
+      !json_u32(cmd, "from", (to_s > span) ? to_s - span : 0, &from_s) ||
+      !json_u32(cmd, "max", def_max, &max_points) || max_points < 1 ||
+      max_points > bb_history_query_max(res)) {
+    snprintf(err, err_len, "trend: from/to en s UTC, max 1..%lu",
+             (unsigned long)bb_history_query_max(res));
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uint8_t *buf = NULL;
+  size_t len = 0;
+  uint32_t n = 0, matched = 0;
+  esp_err_t ret = bb_history_query(res, from_s, to_s, max_points, &buf, &len,
+                                   &n, &matched);
+  if (ret == ESP_OK && esp_mqtt_client_enqueue(client, s_topic_trend,
+                                               (const char *)buf, len, 1, 0,
+                                               true) < 0)
+    ret = ESP_FAIL;
+  free(buf);
+  if (ret == ESP_OK) {
+    cJSON_AddStringToObject(ack, "res",
+                            res_item ? res_item->valuestring : "raw");
+    cJSON_AddNumberToObject(ack, "from", from_s);
+    cJSON_AddNumberToObject(ack, "to", to_s);
+    cJSON_AddNumberToObject(ack, "points", n);
+    cJSON_AddNumberToObject(ack, "matched", matched);
+  }
+  return ret;
+}
+
+static esp_err_t run_action(esp_mqtt_client_handle_t client,
+                            const char *action, const cJSON *cmd, cJSON *ack,
+                            char *err, size_t err_len) {
+  esp_err_t ret = ESP_OK;
+
+  if (strcmp(action, "capture") == 0) {
+    ret = s_hooks.capture_now ? s_hooks.capture_now() : ESP_ERR_NOT_SUPPORTED;
+  } else if (strcmp(action, "baseline") == 0) {
+    ret = s_hooks.baseline_reset ? s_hooks.baseline_reset()
+                                 : ESP_ERR_NOT_SUPPORTED;
+  } else if (strcmp(action, "waveform") == 0) {
+    // Misma petición que cmd/waveform ("last", "next z"...)
+    const cJSON *which = cJSON_GetObjectItem(cmd, "which");
+    char text[16];
+    snprintf(text, sizeof(text), "%s%s",
+             cJSON_IsString(which) ? which->valuestring : "next",
+             cJSON_IsTrue(cJSON_GetObjectItem(cmd, "z")) ? " z" : "");
+    if (!bb_wave_command(text, (int)strlen(text))) {
+      snprintf(err, err_len, "waveform: en curso o \"which\" no válido");
+      return ESP_ERR_INVALID_STATE;
+    }
+  } else if (strcmp(action, "get_config") == 0) {
+    const bb_config_t *cfg = bb_config_get();
+    cJSON *out = cJSON_AddObjectToObject(ack, "config");
+    for (size_t i = 0; i < N_FIELDS; i++) {
+      const remote_field_t *f = &k_fields[i];
+      if (f->type == RF_BOOL)
+        cJSON_AddBoolToObject(out, f->key, field_get(cfg, f) != 0.0);
+      else
+        cJSON_AddNumberToObject(out, f->key, field_get(cfg, f));
+    }
+  } else if (strcmp(action, "trend") == 0) {
+    ret = trend_publish(client, cmd, ack, err, err_len);
+    if (ret == ESP_ERR_INVALID_ARG)
+      return ret; // Mensaje ya escrito
+  } else if (strcmp(action, "restart") == 0) {
+    ret = esp_timer_start_once(s_restart_timer,
+                               REMOTE_RESTART_DELAY_MS * 1000ULL);
+  } else {
+    snprintf(err, err_len, "acción desconocida: %s", action);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  if (ret != ESP_OK)
+    snprintf(err, err_len, "%s: %s", action, esp_err_to_name(ret));
+  return ret;
+}
+
+static esp_err_t remote_execute(esp_mqtt_client_handle_t client,
+                                const char *data, int len, cJSON *ack,
+                                char *err, size_t err_len) {
+  if (len > BB_REMOTE_MAX_PAYLOAD) {
+    snprintf(err, err_len, "comando de %d B (máx %d)", len,
+             BB_REMOTE_MAX_PAYLOAD);
+    return ESP_ERR_INVALID_SIZE;
+  }
+  cJSON *cmd = cJSON_ParseWithLength(data, len);
+  if (!cJSON_IsObject(cmd)) {
+    cJSON_Delete(cmd);
+    snprintf(err, err_len, "JSON no válido");
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t ret = ESP_OK;
+  const cJSON *id = cJSON_GetObjectItem(cmd, "id");
+  const cJSON *set = cJSON_GetObjectItem(cmd, "set");
+  const cJSON *action = cJSON_GetObjectItem(cmd, "action");
+  if (cJSON_IsNumber(id)) {
+    cJSON_AddNumberToObject(ack, "id", id->valuedouble);
+    if (s_have_last && id->valuedouble == s_last_id) {
+      cJSON_AddBoolToObject(ack, "dup", true);
+      snprintf(err, err_len, "id repetido, ya rechazado");
+      cJSON_Delete(cmd);
+      return s_last_ok ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+  }
+
+  if (set == NULL && !cJSON_IsString(action)) {
+    snprintf(err, err_len, "sin \"set\" ni \"action\"");
+    ret = ESP_ERR_INVALID_ARG;
+  }
+  if (ret == ESP_OK && set != NULL) {
+    // Solo la tarea MQTT escribe por aquí: copia estática, no en la pila
+    static bb_config_t cfg;
+    bool changed = false;
+    cfg = *bb_config_get();
+    ret = apply_patch(set, &cfg, ack, &changed, err, err_len);
+    // Sin cambios (mismo parche a toda la flota otra vez) no se escribe NVS
+    if (ret == ESP_OK && changed) {
+      ret = bb_config_set(&cfg);
+      if (ret != ESP_OK)
+        snprintf(err, err_len, "NVS: %s", esp_err_to_name(ret));
+    }
+  }
+  if (ret == ESP_OK && cJSON_IsString(action))
+    ret = run_action(client, action->valuestring, cmd, ack, err, err_len);
+
+  if (cJSON_IsNumber(id)) {
+    s_have_last = true;
+    s_last_id = id->valuedouble;
+    s_last_ok = (ret == ESP_OK);
+  }
+  cJSON_Delete(cmd);
+  return ret;
+}
+
+static bool topic_is(const char *topic, int len, const char *want) {
+  return len == (int)strlen(want) && strncmp(topic, want, len) == 0;
+}
+
+bool bb_remote_handle(esp_mqtt_client_handle_t client, const char *topic,
+                      int topic_len, const char *data, int data_len) {
+  if (s_node_id[0] == '\0' || (!topic_is(topic, topic_len, s_topic_cmd) &&
+                               !topic_is(topic, topic_len, s_topic_all))) {
+    return false;
+  }
+
+  cJSON *ack = cJSON_CreateObject();
+  char err[96] = "";
+  esp_err_t ret =
+      remote_execute(client, data, data_len, ack, err, sizeof(err));
+  cJSON_AddBoolToObject(ack, "ok", ret == ESP_OK);
+  if (ret != ESP_OK) {
+    cJSON_AddStringToObject(ack, "err", err);
+    ESP_LOGW(TAG, "Comando rechazado: %s", err);
+  } else {
+    ESP_LOGI(TAG, "Comando aplicado: %.*s", data_len, data);
+  }
+
+  // Desde el evento MQTT: enqueue no bloquea (sale en el siguiente ciclo)
+  char *json = cJSON_PrintUnformatted(ack);
+  if (json != NULL) {
+    esp_mqtt_client_enqueue(client, s_topic_ack, json, 0, 1, 0, true);
+    cJSON_free(json);
+  }
+  cJSON_Delete(ack);
+  return true;
+}
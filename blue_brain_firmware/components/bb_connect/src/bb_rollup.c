@@ -0,0 +1,134 @@
+/**
+ * @file bb_rollup.c
+ * @brief Agregados incrementales por minuto/hora/día (ver bb_rollup.h)
+ */
+
+#include "bb_rollup.h"
+#include <math.h>
+#include <string.h>
+
+static const uint32_t s_period_s[BB_ROLLUP_LEVELS] = {60, 3600, 86400};
+
+// Escala del registro cuantizado: G -> mG (u16), °C -> 0.01 °C (i16)
+static const float s_scale[BB_ROLLUP_METRICS] = {1000.0f, 1000.0f, 1000.0f,
+                                                 100.0f};
+#define ROLLUP_SIGNED_METRIC BB_ROLLUP_TEMP
+
+uint32_t bb_rollup_period_s(bb_rollup_level_t level) {
+  return s_period_s[level];
+}
+
+static void bucket_reset(bb_rollup_bucket_t *b, uint32_t start_s) {
+  memset(b, 0, sizeof(*b));
+  b->start_s = start_s;
+}
+
+static void agg_add(bb_rollup_agg_t *a, float v, uint32_t n, float sum,
+                    float sumsq) {
+  if (a->n == 0 || v < a->min)
+    a->min = v;
+  if (a->n == 0 || v > a->max)
+    a->max = v;
+  a->n += n;
+  a->sum += sum;
+  a->sumsq += sumsq;
+}
+
+void bb_rollup_init(bb_rollup_t *r) { memset(r, 0, sizeof(*r)); }
+
+void bb_rollup_open(bb_rollup_t *r, bb_rollup_level_t level, uint32_t t_s) {
+  bucket_reset(&r->cur[level], t_s - t_s % s_period_s[level]);
+}
+
+uint8_t bb_rollup_add(bb_rollup_t *r, uint32_t t_s,
+                      const float v[BB_ROLLUP_METRICS],
+                      bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS]) {
+  uint8_t mask = 0;
+  for (int l = 0; l < BB_ROLLUP_LEVELS; l++) {
+    bb_rollup_bucket_t *b = &r->cur[l];
+    uint32_t start = t_s - t_s % s_period_s[l];
+    if (start > b->start_s) {
+      for (int m = 0; m < BB_ROLLUP_METRICS; m++) {
+        if (b->m[m].n > 0) {
+          closed[l] = *b;
+          mask |= 1u << l;
+          break;
+        }
+      }
+      bucket_reset(b, start);
+    }
+    for (int m = 0; m < BB_ROLLUP_METRICS; m++) {
+      if (!isnan(v[m]))
+        agg_add(&b->m[m], v[m], 1, v[m], v[m] * v[m]);
+    }
+  }
+  r->added++;
+  return mask;
+}
+
+// Valor en unidades del registro, saturado al rango del tipo
+static int32_t quant(int metric, float v) {
+  float q = roundf(v * s_scale[metric]);
+  float lo = (metric == ROLLUP_SIGNED_METRIC) ? INT16_MIN : 0.0f;
+  float hi = (metric == ROLLUP_SIGNED_METRIC) ? INT16_MAX : UINT16_MAX;
+  if (!(q >= lo)) // También NAN
+    q = lo;
+  if (q > hi)
+    q = hi;
+  return (int32_t)q;
+}
+
+static float unquant(int metric, const uint8_t *p) {
+  if (metric == ROLLUP_SIGNED_METRIC) {
+    int16_t v;
+    memcpy(&v, p, 2);
+    return v / s_scale[metric];
+  }
+  uint16_t v;
+  memcpy(&v, p, 2);
+  return v / s_scale[metric];
+}
+
+static void put_q(uint8_t *p, int metric, float v) {
+  int32_t q = quant(metric, v);
+  if (metric == ROLLUP_SIGNED_METRIC) {
+    int16_t s = (int16_t)q;
+    memcpy(p, &s, 2);
+  } else {
+    uint16_t u = (uint16_t)q;
+    memcpy(p, &u, 2);
+  }
+}
+
+void bb_rollup_encode(const bb_rollup_bucket_t *b,
+                      uint8_t out[BB_ROLLUP_BYTES]) {
+  memset(out, 0, BB_ROLLUP_BYTES);
+  for (int m = 0; m < BB_ROLLUP_METRICS; m++) {
+    const bb_rollup_agg_t *a = &b->m[m];
+    uint8_t *p = out + m * 10;
+    uint16_t n = (a->n > UINT16_MAX) ? UINT16_MAX : (uint16_t)a->n;
+    memcpy(p, &n, 2);
+    if (a->n == 0)
+      continue;
+    put_q(p + 2, m, a->min);
+    put_q(p + 4, m, a->max);
+    put_q(p + 6, m, a->sum / a->n);
+    put_q(p + 8, m, sqrtf(a->sumsq / a->n));
+  }
+}
+
+void bb_rollup_merge(bb_rollup_bucket_t *b,
+                     const uint8_t rec[BB_ROLLUP_BYTES]) {
+  for (int m = 0; m < BB_ROLLUP_METRICS; m++) {
+    const uint8_t *p = rec + m * 10;
+    uint16_t n;
+    memcpy(&n, p, 2);
+    if (n == 0)
+      continue;
+    bb_rollup_agg_t *a = &b->m[m];
+    float mean = unquant(m, p + 6), rms = unquant(m, p + 8);
+    agg_add(a, unquant(m, p + 2), n, mean * n, rms * rms * n);
+    if (unquant(m, p + 4) > a->max)
+      a->max = unquant(m, p + 4);
+  }
+}
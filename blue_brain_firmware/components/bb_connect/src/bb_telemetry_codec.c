@@ -0,0 +1,401 @@
+/**
+ * @file bb_telemetry_codec.c
+ * @brief Serialización de reportes: binario versionado y JSON
+ */
+
+#include "bb_telemetry_codec.h"
+#include "bb_rollup.h"
+#include <stdio.h>
+#include <string.h>
+
+// --- Escritor little-endian con cursor ---
+// (el tamaño se valida una sola vez antes de escribir)
+typedef struct {
+  uint8_t *p;
+} tlm_writer_t;
+
+static inline void put_u8(tlm_writer_t *w, uint8_t v) { *w->p++ = v; }
+
+static inline void put_u16(tlm_writer_t *w, uint16_t v) {
+  w->p[0] = (uint8_t)v;
+  w->p[1] = (uint8_t)(v >> 8);
+  w->p += 2;
+}
+
+static inline void put_u32(tlm_writer_t *w, uint32_t v) {
+  w->p[0] = (uint8_t)v;
+  w->p[1] = (uint8_t)(v >> 8);
+  w->p[2] = (uint8_t)(v >> 16);
+  w->p[3] = (uint8_t)(v >> 24);
+  w->p += 4;
+}
+
+static inline void put_u64(tlm_writer_t *w, uint64_t v) {
+  put_u32(w, (uint32_t)v);
+  put_u32(w, (uint32_t)(v >> 32));
+}
+
+static inline void put_f32(tlm_writer_t *w, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  put_u32(w, bits);
+}
+
+static void put_f32_array(tlm_writer_t *w, const float *v, int n) {
+  for (int i = 0; i < n; i++)
+    put_f32(w, v[i]);
+}
+
+size_t bb_telemetry_encode(const bb_telemetry_t *r, uint8_t *buf,
+                           size_t cap) {
+  uint8_t flags = 0;
+  if (r->n_points > 1)
+    flags |= BB_TLM_F_P2;
+  if (r->n_axes == 6)
+    flags |= BB_TLM_F_GYRO;
+  if (r->calibrated)
+    flags |= BB_TLM_F_CAL;
+  if (r->quality != 0)
+    flags |= BB_TLM_F_QUALITY;
+  if (r->seq != 0)
+    flags |= BB_TLM_F_SEQ;
+  if (r->rbe_skipped != 0)
+    flags |= BB_TLM_F_RBE;
+  if (r->link_rssi != 0 || r->link_uptime_pm != 0 || r->link_reconnects != 0)
+    flags |= BB_TLM_F_LINK;
+  if (r->t_unix_us != 0)
+    flags |= BB_TLM_F_TIME;
+
+  uint8_t ext = 0;
+  if (r->t_sync_us != 0)
+    ext |= BB_TLM_X_SYNC;
+
+  int n_temps = r->temp_count;
+  if (n_temps > BB_MAX_TEMP_SENSORS)
+    n_temps = BB_MAX_TEMP_SENSORS;
+
+  size_t body = 130 + 1 + (size_t)n_temps * 12;
+  if (ext != 0)
+    body += 1;
+  if (ext & BB_TLM_X_SYNC)
+    body += 10;
+  if (flags & BB_TLM_F_P2)
+    body += 24;
+  if (flags & BB_TLM_F_GYRO)
+    body += 9;
+  if (flags & BB_TLM_F_QUALITY)
+    body += 8;
+  if (flags & BB_TLM_F_SEQ)
+    body += 8;
+  if (flags & BB_TLM_F_RBE)
+    body += 2;
+  if (flags & BB_TLM_F_LINK)
+    body += 7;
+  if (flags & BB_TLM_F_TIME)
+    body += 9;
+  if (buf == NULL || cap < BB_TLM_HEADER_BYTES + body)
+    return 0;
+
+  tlm_writer_t w = {buf};
+
+  // Cabecera
+  put_u8(&w, BB_TLM_MAGIC0);
+  put_u8(&w, BB_TLM_MAGIC1);
+  put_u8(&w, BB_TLM_VERSION);
+  put_u8(&w, flags);
+  put_u16(&w, (uint16_t)body);
+
+  // Núcleo
+  put_u64(&w, (uint64_t)r->t_first_us);
+  put_u64(&w, (uint64_t)r->t_last_us);
+  put_u32(&w, r->boot_to_sample_ms);
+  put_f32(&w, r->vib_rms);
+  put_f32(&w, r->vib_peak);
+  put_f32(&w, r->vib_p2p);
+  put_f32(&w, r->crest_factor);
+  put_f32(&w, r->vib_dom_freq);
+  put_f32(&w, r->vib_band_low);
+  put_f32(&w, r->vib_band_high);
+  put_f32(&w, r->fs_hz);
+  put_f32(&w, r->fs_jitter_us);
+  put_f32(&w, r->temp_c);
+  put_f32(&w, r->batt_v);
+  put_f32(&w, r->ai_conf);
+  put_f32_array(&w, r->fft_bands_low, 5);
+  put_f32_array(&w, r->fft_bands_mid, 5);
+  put_f32_array(&w, r->fft_bands_high, 5);
+  put_u8(&w, (uint8_t)(int8_t)r->ai_class);
+  put_u8(&w, r->quality);
+
+  if (flags & BB_TLM_F_P2) {
+    put_f32(&w, r->p2_rms);
+    put_f32(&w, r->p2_peak);
+    put_f32(&w, r->p2_crest);
+    put_f32(&w, r->p2_dom_freq);
+    put_f32(&w, r->coh_dom);
+    put_f32(&w, r->phase_dom_deg);
+  }
+  if (flags & BB_TLM_F_GYRO) {
+    put_u8(&w, r->gyro_axis);
+    put_f32(&w, r->gyro_rms_dps);
+    put_f32(&w, r->gyro_dom_freq);
+  }
+  if (flags & BB_TLM_F_QUALITY) {
+    put_u16(&w, r->q_failed_reads);
+    put_u16(&w, r->q_clipped);
+    put_u16(&w, r->q_stuck_run);
+    put_u16(&w, r->q_gaps);
+  }
+  if (flags & BB_TLM_F_SEQ) {
+    put_u32(&w, r->boot_id);
+    put_u32(&w, r->seq);
+  }
+  if (flags & BB_TLM_F_RBE)
+    put_u16(&w, r->rbe_skipped);
+  if (flags & BB_TLM_F_LINK) {
+    put_u8(&w, (uint8_t)r->link_rssi);
+    put_u16(&w, r->link_reconnects);
+    put_u16(&w, r->link_connect_ms);
+    put_u16(&w, r->link_uptime_pm);
+  }
+  if (flags & BB_TLM_F_TIME) {
+    put_u64(&w, (uint64_t)r->t_unix_us);
+    put_u8(&w, r->time_src);
+  }
+
+  put_u8(&w, (uint8_t)n_temps);
+  for (int i = 0; i < n_temps; i++) {
+    put_u64(&w, r->temp_rom[i]);
+    put_f32(&w, r->temp_points_c[i]);
+  }
+
+  if (ext != 0)
+    put_u8(&w, ext);
+  if (ext & BB_TLM_X_SYNC) {
+    put_u64(&w, (uint64_t)r->t_sync_us);
+    put_u16(&w, r->sync_err_us);
+  }
+
+  return (size_t)(w.p - buf);
+}
+
+size_t bb_telemetry_format_json(const bb_telemetry_t *data, char *buf,
+                                size_t cap) {
+  snprintf(buf, cap,
+           "{\"rms\":%.3f,\"peak\":%.3f,\"p2p\":%.3f,\"crest\":%.2f,"
+           "\"temp\":%.2f,\"dom_freq\":%.1f,\"band_lo\":%.3f,\"band_hi\":%.3f,"
+           "\"ai_class\":%d,\"ai_conf\":%.2f,\"batt\":%.2f,"
+           "\"fs\":%.1f,\"jitter_us\":%.1f,\"t0_us\":%lld,\"t1_us\":%lld,"
+           "\"boot_ms\":%lu,\"cal\":%d,\"quality\":%d,\"boot\":%lu,"
+           "\"seq\":%lu}",
+           data->vib_rms, data->vib_peak, data->vib_p2p, data->crest_factor,
+           data->temp_c, data->vib_dom_freq, data->vib_band_low,
+           data->vib_band_high, data->ai_class, data->ai_conf, data->batt_v,
+           data->fs_hz, data->fs_jitter_us, (long long)data->t_first_us,
+           (long long)data->t_last_us,
+           (unsigned long)data->boot_to_sample_ms, data->calibrated,
+           data->quality, (unsigned long)data->boot_id,
+           (unsigned long)data->seq);
+
+  size_t len = strlen(buf) - 1; // Sobrescribir '}'
+
+  // Contadores de calidad (solo si la trama no salió limpia)
+  if (data->quality != 0) {
+    len += snprintf(buf + len, cap - len,
+                    ",\"q\":{\"fail\":%u,\"clip\":%u,\"stuck\":%u,"
+                    "\"gaps\":%u}",
+                    data->q_failed_reads, data->q_clipped, data->q_stuck_run,
+                    data->q_gaps);
+  }
+
+  // Omitidos por RBE antes de este reporte (explica el salto de seq)
+  if (data->rbe_skipped != 0 && len < cap) {
+    len += snprintf(buf + len, cap - len, ",\"rbe_skip\":%u",
+                    data->rbe_skipped);
+  }
+
+  // Hora UTC de la adquisición en ms (Node-RED, Telegraf); sin hora no va
+  if (data->t_unix_us != 0 && len < cap) {
+    len += snprintf(buf + len, cap - len, ",\"ts\":%lld,\"ts_src\":\"%s\"",
+                    (long long)(data->t_unix_us / 1000),
+                    bb_clock_source_name((bb_clock_source_t)data->time_src));
+  }
+
+  // Inicio en la línea común (µs del maestro): igual en todos los nodos
+  if (data->t_sync_us != 0 && len < cap) {
+    len += snprintf(buf + len, cap - len,
+                    ",\"sync_us\":%lld,\"sync_err_us\":%u",
+                    (long long)data->t_sync_us, data->sync_err_us);
+  }
+
+  // Enlace del nodo: RSSI, reconexiones, última conexión y disponibilidad
+  if ((data->link_rssi != 0 || data->link_uptime_pm != 0 ||
+       data->link_reconnects != 0) &&
+      len < cap) {
+    len += snprintf(buf + len, cap - len,
+                    ",\"link\":{\"rssi\":%d,\"reconn\":%u,\"conn_ms\":%u,"
+                    "\"up\":%.3f}",
+                    data->link_rssi, data->link_reconnects,
+                    data->link_connect_ms, data->link_uptime_pm / 1000.0f);
+  }
+
+  // Segundo punto de medida y relación A/B (solo con dos IMU)
+  if (data->n_points > 1 && len < cap) {
+    len += snprintf(buf + len, cap - len,
+                    ",\"p2\":{\"rms\":%.3f,\"peak\":%.3f,\"crest\":%.2f,"
+                    "\"dom_freq\":%.1f},\"coh\":%.2f,\"phase\":%.1f",
+                    data->p2_rms, data->p2_peak, data->p2_crest,
+                    data->p2_dom_freq, data->coh_dom, data->phase_dom_deg);
+  }
+
+  // Giroscopio (modo 6 ejes)
+  if (data->n_axes == 6 && len < cap) {
+    len += snprintf(buf + len, cap - len,
+                    ",\"gyro\":{\"rms\":%.2f,\"dom_freq\":%.1f,"
+                    "\"axis\":\"%c\"}",
+                    data->gyro_rms_dps, data->gyro_dom_freq,
+                    "xyz"[data->gyro_axis % 3]);
+  }
+
+  // Temperaturas por ROM: {...,"temps":[{"rom":"28..","c":21.50}]}
+  if (len < cap)
+    len += snprintf(buf + len, cap - len, ",\"temps\":[");
+  for (int i = 0; i < data->temp_count && len < cap; i++) {
+    len += snprintf(buf + len, cap - len, "%s{\"rom\":\"%016llX\",\"c\":%.2f}",
+                    i ? "," : "", (unsigned long long)data->temp_rom[i],
+                    data->temp_points_c[i]);
+  }
+  if (len < cap)
+    len += snprintf(buf + len, cap - len, "]}");
+
+  return (len < cap) ? len : cap - 1;
+}
+
+// --- Lotes ---
+// JSON reserva sitio para el cierre "]}" y el terminador
+#define JSON_BATCH_TAIL 3
+
+size_t bb_telemetry_batch_begin(bool binary, uint8_t *buf, size_t cap) {
+  if (binary) {
+    if (cap < BB_TLM_BATCH_HEADER_BYTES)
+      return 0;
+    buf[0] = BB_TLM_MAGIC0;
+    buf[1] = BB_TLM_BATCH_MAGIC1;
+    buf[2] = BB_TLM_VERSION;
+    buf[3] = 0; // count
+    return BB_TLM_BATCH_HEADER_BYTES;
+  }
+
+  static const char head[] = "{\"batch\":[";
+  if (cap < sizeof(head) - 1 + JSON_BATCH_TAIL)
+    return 0;
+  memcpy(buf, head, sizeof(head) - 1);
+  return sizeof(head) - 1;
+}
+
+size_t bb_telemetry_batch_append(bool binary, uint8_t *buf, size_t len,
+                                 size_t cap, const bb_telemetry_t *report) {
+  if (binary) {
+    if (buf[3] == BB_TLM_BATCH_MAX_COUNT || cap < len + 2)
+      return 0;
+    size_t n = bb_telemetry_encode(report, buf + len + 2, cap - len - 2);
+    if (n == 0)
+      return 0;
+    buf[len] = (uint8_t)n;
+    buf[len + 1] = (uint8_t)(n >> 8);
+    buf[3]++;
+    return len + 2 + n;
+  }
+
+  if (cap < len + JSON_BATCH_TAIL + 2)
+    return 0;
+  bool first = (buf[len - 1] == '[');
+  size_t room = cap - len - JSON_BATCH_TAIL;
+  char *dst = (char *)buf + len;
+  if (!first) {
+    *dst++ = ',';
+    room--;
+  }
+  // Un texto que llena todo el hueco puede estar truncado: no cabe
+  size_t n = bb_telemetry_format_json(report, dst, room);
+  if (n + 1 >= room)
+    return 0;
+  return len + (first ? 0 : 1) + n;
+}
+
+size_t bb_telemetry_batch_end(bool binary, uint8_t *buf, size_t len,
+                              size_t cap) {
+  if (binary || cap < len + JSON_BATCH_TAIL)
+    return len;
+  memcpy(buf + len, "]}", 3);
+  return len + 2;
+}
+
+// --- Tendencias ---
+
+// Escala y satura al rango del entero (NaN -> 0)
+static uint16_t q_u16(float v, float scale) {
+  float x = v * scale + 0.5f;
+  if (!(x > 0.0f))
+    return 0;
+  return (x >= 65535.0f) ? 65535 : (uint16_t)x;
+}
+
+static int16_t q_i16(float v, float scale) {
+  float x = v * scale;
+  if (!(x > -32768.0f))
+    return (x != x) ? 0 : -32768;
+  if (x >= 32767.0f)
+    return 32767;
+  return (int16_t)((x < 0.0f) ? x - 0.5f : x + 0.5f);
+}
+
+size_t bb_telemetry_trend_point(const bb_telemetry_t *r, uint8_t *buf,
+                                size_t cap) {
+  if (cap < BB_TLM_TREND_BYTES)
+    return 0;
+  bool p2 = r->n_points > 1;
+  tlm_writer_t w = {buf};
+  put_u16(&w, q_u16(r->vib_rms, 1000.0f));
+  put_u16(&w, q_u16(r->vib_peak, 1000.0f));
+  put_u16(&w, p2 ? q_u16(r->p2_rms, 1000.0f) : 0);
+  put_u16(&w, p2 ? q_u16(r->p2_peak, 1000.0f) : 0);
+  put_u16(&w, q_u16(r->crest_factor, 100.0f));
+  put_u16(&w, q_u16(r->vib_dom_freq, 10.0f));
+  put_u16(&w, (uint16_t)q_i16(r->temp_c, 100.0f));
+  put_u16(&w, (r->n_axes == 6) ? q_u16(r->gyro_rms_dps, 100.0f) : 0);
+  put_u16(&w, q_u16(r->batt_v, 1000.0f));
+  put_u8(&w, (uint8_t)(int8_t)r->ai_class);
+  put_u8(&w, r->quality);
+  return BB_TLM_TREND_BYTES;
+}
+
+size_t bb_telemetry_trend_header(uint8_t *buf, size_t cap, uint16_t count,
+                                 uint32_t matched) {
+  if (cap < BB_TLM_TREND_HEADER_BYTES)
+    return 0;
+  tlm_writer_t w = {buf};
+  put_u8(&w, BB_TLM_MAGIC0);
+  put_u8(&w, BB_TLM_TREND_MAGIC1);
+  put_u8(&w, BB_TLM_VERSION);
+  put_u8(&w, 4 + BB_TLM_TREND_BYTES);
+  put_u16(&w, count);
+  put_u32(&w, matched);
+  return BB_TLM_TREND_HEADER_BYTES;
+}
+
+size_t bb_telemetry_rollup_header(uint8_t *buf, size_t cap, uint8_t level,
+                                  uint16_t count, uint32_t matched) {
+  if (cap < BB_TLM_ROLLUP_HEADER_BYTES)
+    return 0;
+  tlm_writer_t w = {buf};
+  put_u8(&w, BB_TLM_MAGIC0);
+  put_u8(&w, BB_TLM_ROLLUP_MAGIC1);
+  put_u8(&w, BB_TLM_VERSION);
+  put_u8(&w, level);
+  put_u8(&w, 4 + BB_ROLLUP_BYTES);
+  put_u8(&w, 0);
+  put_u16(&w, count);
+  put_u32(&w, matched);
+  return BB_TLM_ROLLUP_HEADER_BYTES;
+}
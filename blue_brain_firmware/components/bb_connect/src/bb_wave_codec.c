@@ -0,0 +1,159 @@
+/**
+ * @file bb_wave_codec.c
+ * @brief Predicción fija adaptativa + Rice adaptativo para int16 crudo
+ */
+
+#include "bb_wave_codec.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define WZ_ESCAPE_Q 24    // Cociente a partir del cual se escapa
+#define WZ_ESCAPE_BITS 20 // |residuo| < 2^18 con orden 3 sobre int16
+#define WZ_RESET 32       // Olvido del k adaptativo (muestras)
+#define WZ_COST_SHIFT 4   // Media exponencial del coste (1/16)
+#define WZ_MAX_K 16       // |residuo de orden 1| <= 65535
+
+typedef struct {
+  int32_t h0, h1, h2; // x[n-1], x[n-2], x[n-3]
+  uint32_t cost[3];   // |residuo| medio (x16) de los predictores 1..3
+  uint32_t a, n;      // Rice adaptativo
+} wz_chan_t;
+
+typedef struct {
+  uint8_t *out;
+  size_t cap;
+  size_t len;
+  uint32_t acc;
+  int nbits;
+  bool full;
+} wz_bits_t;
+
+static inline void put_bits(wz_bits_t *w, uint32_t v, int n) {
+  // n <= 24: con < 8 bits pendientes el acumulador no pasa de 31
+  w->acc = (w->acc << n) | (v & ((1u << n) - 1u));
+  w->nbits += n;
+  while (w->nbits >= 8) {
+    w->nbits -= 8;
+    if (w->len < w->cap)
+      w->out[w->len++] = (uint8_t)(w->acc >> w->nbits);
+    else
+      w->full = true;
+  }
+}
+
+static inline void put_ones(wz_bits_t *w, int n) {
+  while (n > 16) {
+    put_bits(w, 0xFFFF, 16);
+    n -= 16;
+  }
+  put_bits(w, 0xFFFF, n);
+}
+
+static inline uint32_t wz_abs(int32_t v) {
+  return (uint32_t)(v < 0 ? -v : v);
+}
+
+static inline int rice_k(const wz_chan_t *c) {
+  int k = 0;
+  while (k < WZ_MAX_K && (c->n << k) < c->a)
+    k++;
+  return k;
+}
+
+static void write_header(uint8_t *out, int mode, int n_axes, int n_samples) {
+  out[0] = BB_WZ_MAGIC0;
+  out[1] = BB_WZ_MAGIC1;
+  out[2] = BB_WZ_VERSION;
+  out[3] = (uint8_t)mode;
+  out[4] = (uint8_t)n_axes;
+  out[5] = 0;
+  out[6] = (uint8_t)(n_samples & 0xFF);
+  out[7] = (uint8_t)(n_samples >> 8);
+}
+
+int bb_wz_encode(const uint8_t *raw, int n_samples, int n_axes, uint8_t *out,
+                 size_t cap) {
+  size_t raw_bytes = (size_t)n_samples * n_axes * 2;
+  if (raw == NULL || out == NULL || n_axes < 1 || n_axes > BB_WZ_MAX_AXES ||
+      n_samples < 1 || n_samples > 0xFFFF ||
+      cap < BB_WZ_MAX_BYTES(n_samples, n_axes)) {
+    return -1;
+  }
+
+  wz_chan_t ch[BB_WZ_MAX_AXES];
+  memset(ch, 0, sizeof(ch));
+  for (int a = 0; a < n_axes; a++) {
+    ch[a].a = 32; // k = 5 al empezar: el primer residuo es la muestra
+    ch[a].n = 1;
+  }
+
+  // Sin ahorro posible el flujo se corta y el bloque va tal cual
+  wz_bits_t w = {.out = out + BB_WZ_HEADER_BYTES, .cap = raw_bytes};
+  const uint8_t *p = raw;
+
+  for (int i = 0; i < n_samples && !w.full; i++) {
+    for (int a = 0; a < n_axes; a++, p += 2) {
+      wz_chan_t *c = &ch[a];
+      int32_t x = (int16_t)((p[0] << 8) | p[1]);
+
+      // Residuos de los tres predictores (el decodificador hace lo mismo)
+      int32_t e1 = x - c->h0;
+      int32_t e2 = e1 - (c->h0 - c->h1);
+      int32_t e3 = e2 - (c->h0 - 2 * c->h1 + c->h2);
+      int32_t e = x;
+      if (i > 0) {
+        // El orden o+1 entra en la elección cuando su coste ya tiene
+        // historia (una muestra después de tener residuo válido)
+        int best = 0;
+        int max_o = (i - 2 < 2) ? i - 2 : 2;
+        for (int o = 1; o <= max_o; o++) {
+          if (c->cost[o] < c->cost[best])
+            best = o;
+        }
+        e = (best == 0) ? e1 : (best == 1) ? e2 : e3;
+      }
+
+      uint32_t u = ((uint32_t)e << 1) ^ (uint32_t)(e >> 31);
+      int k = rice_k(c);
+      uint32_t q = u >> k;
+      if (q < WZ_ESCAPE_Q) {
+        put_ones(&w, (int)q);
+        put_bits(&w, 0, 1);
+        if (k > 0)
+          put_bits(&w, u, k);
+      } else {
+        put_ones(&w, WZ_ESCAPE_Q);
+        put_bits(&w, u, WZ_ESCAPE_BITS);
+      }
+
+      c->a += wz_abs(e);
+      if (++c->n >= WZ_RESET) {
+        c->a = (c->a + 1) >> 1;
+        c->n >>= 1;
+      }
+      // Coste de cada orden desde su primer residuo válido (arranca con
+      // el del orden anterior para competir en igualdad)
+      if (i >= 1)
+        c->cost[0] += wz_abs(e1) - (c->cost[0] >> WZ_COST_SHIFT);
+      for (int o = 1; o < 3 && i >= o + 1; o++) {
+        if (i == o + 1)
+          c->cost[o] = c->cost[o - 1];
+        int32_t eo = (o == 1) ? e2 : e3;
+        c->cost[o] += wz_abs(eo) - (c->cost[o] >> WZ_COST_SHIFT);
+      }
+      c->h2 = c->h1;
+      c->h1 = c->h0;
+      c->h0 = x;
+    }
+  }
+  if (w.nbits > 0)
+    put_bits(&w, 0, 8 - w.nbits);
+
+  if (w.full || w.len >= raw_bytes) {
+    write_header(out, BB_WZ_MODE_STORED, n_axes, n_samples);
+    memcpy(out + BB_WZ_HEADER_BYTES, raw, raw_bytes);
+    return (int)(BB_WZ_HEADER_BYTES + raw_bytes);
+  }
+  write_header(out, BB_WZ_MODE_RICE, n_axes, n_samples);
+  return (int)(BB_WZ_HEADER_BYTES + w.len);
+}
@@ -0,0 +1,321 @@
+/**
+ * @file bb_waveform.c
+ * @brief Subida por trozos de una ráfaga cruda, directamente desde el pool
+ */
+
+#include "bb_waveform.h"
+#include "bb_storage.h"
+#include "bb_wave_codec.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "BB_WAVE";
+
+// raw[] de bb_frame_t: BB_N_SAMPLES x 6 B (o la mitad de muestras de 12 B)
+#define WAVE_MAX_CHUNKS                                                        \
+  (BB_MAX_IMUS * ((BB_N_SAMPLES * 6 + BB_WAVE_CHUNK_BYTES - 1) /               \
+                  BB_WAVE_CHUNK_BYTES))
+#define WAVE_TOO_BIG (-2) // El manifiesto no cabe: la subida no es posible
+
+// Un bloque WZ por trozo: nunca más trozos que en crudo (mismo manifiesto)
+_Static_assert(BB_WAVE_WZ_BLOCK * 6 >= BB_WAVE_CHUNK_BYTES &&
+                   BB_WAVE_WZ_BLOCK <= 0xFFFF,
+               "BB_WAVE_WZ_BLOCK");
+
+typedef enum {
+  WAVE_NONE = 0,
+  WAVE_LAST,
+  WAVE_NEXT,
+} wave_mode_t;
+
+static struct {
+  // Petición pendiente (tarea MQTT -> Task_Inference / Task_Comms)
+  wave_mode_t pending;
+  bool pending_wz;
+  int64_t t_req_us;
+
+  // Última trama terminada (solo si el pipeline tiene holgura)
+  bool has_last;
+  bb_wave_src_t last;
+
+  // Subida en curso: una vez activa solo la toca Task_Comms
+  bool active;
+  bb_wave_src_t src;
+  wave_mode_t mode;
+  bool wz; // Trozos = bloques WZ de BB_WAVE_WZ_BLOCK muestras
+  uint32_t id;
+  uint16_t chunks_per_imu;
+  uint16_t n_chunks;
+  int next; // -1 = manifiesto, después el trozo a publicar
+  int64_t t_start_us;
+  int64_t t_next_us;
+  uint32_t retries; // Publicaciones rechazadas por el cliente MQTT
+} s_wave;
+
+static portMUX_TYPE s_wave_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_wave_ids = 0;
+
+// Trozo comprimido en curso (solo Task_Comms; el cliente MQTT lo copia)
+static uint8_t s_wz_buf[BB_WZ_MAX_BYTES(BB_WAVE_WZ_BLOCK, BB_WZ_MAX_AXES)];
+
+// Llamar con s_wave_lock tomado: la referencia de src pasa a la subida
+static void wave_start_locked(const bb_wave_src_t *src, wave_mode_t mode,
+                              bool wz, int64_t now_us) {
+  uint32_t imu_bytes = (uint32_t)src->n_samples * src->sample_bytes;
+
+  s_wave.src = *src;
+  s_wave.mode = mode;
+  s_wave.wz = wz;
+  s_wave.id = ++s_wave_ids;
+  if (wz) {
+    s_wave.chunks_per_imu = (uint16_t)((src->n_samples + BB_WAVE_WZ_BLOCK - 1) /
+                                       BB_WAVE_WZ_BLOCK);
+  } else {
+    s_wave.chunks_per_imu = (uint16_t)((imu_bytes + BB_WAVE_CHUNK_BYTES - 1) /
+                                       BB_WAVE_CHUNK_BYTES);
+  }
+  s_wave.n_chunks = (uint16_t)(s_wave.chunks_per_imu * src->n_imus);
+  s_wave.next = -1;
+  s_wave.t_start_us = now_us;
+  s_wave.t_next_us = 0;
+  s_wave.retries = 0;
+  s_wave.active = true;
+}
+
+// Suelta la trama de la subida (solo Task_Comms)
+static void wave_finish(void) {
+  bb_wave_src_t src = s_wave.src;
+  taskENTER_CRITICAL(&s_wave_lock);
+  s_wave.active = false;
+  taskEXIT_CRITICAL(&s_wave_lock);
+  src.release(src.owner);
+}
+
+void bb_wave_frame_done(const bb_wave_src_t *src, bool keep_last) {
+  bb_wave_src_t old = {0};
+  int64_t now = esp_timer_get_time();
+
+  taskENTER_CRITICAL(&s_wave_lock);
+  if (!s_wave.active && s_wave.pending != WAVE_NONE &&
+      (s_wave.pending == WAVE_LAST || src->t_first_us >= s_wave.t_req_us)) {
+    src->retain(src->owner);
+    wave_start_locked(src, s_wave.pending, s_wave.pending_wz, now);
+    s_wave.pending = WAVE_NONE;
+  }
+  if (keep_last) {
+    if (s_wave.has_last)
+      old = s_wave.last;
+    src->retain(src->owner);
+    s_wave.last = *src;
+    s_wave.has_last = true;
+  }
+  taskEXIT_CRITICAL(&s_wave_lock);
+
+  if (old.release != NULL)
+    old.release(old.owner);
+}
+
+bool bb_wave_command(const char *data, int len) {
+  // Payload de texto sin terminador (mosquitto_pub -m last)
+  while (len > 0 && isspace((unsigned char)data[len - 1]))
+    len--;
+  wave_mode_t mode = WAVE_NONE;
+  bool wz = len == 6 && strncmp(data + 4, " z", 2) == 0; // "last z", "next z"
+  if ((len == 4 || wz) && strncmp(data, "last", 4) == 0)
+    mode = WAVE_LAST;
+  else if ((len == 4 || wz) && strncmp(data, "next", 4) == 0)
+    mode = WAVE_NEXT;
+  if (mode == WAVE_NONE) {
+    ESP_LOGW(TAG, "Comando desconocido: %.*s", len, data);
+    return false;
+  }
+
+  bool busy = false;
+  bool started = false;
+  int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&s_wave_lock);
+  // Una petición sin trama (pipeline parado) caduca como una subida
+  if (s_wave.active || (s_wave.pending != WAVE_NONE &&
+                        now - s_wave.t_req_us < BB_WAVE_TIMEOUT_MS * 1000LL)) {
+    busy = true;
+  } else if (mode == WAVE_LAST && s_wave.has_last) {
+    // La referencia de "última" pasa a la subida
+    wave_start_locked(&s_wave.last, WAVE_LAST, wz, now);
+    s_wave.has_last = false;
+    started = true;
+  } else {
+    s_wave.pending = mode;
+    s_wave.pending_wz = wz;
+    s_wave.t_req_us = now;
+  }
+  taskEXIT_CRITICAL(&s_wave_lock);
+
+  if (busy) {
+    ESP_LOGW(TAG, "Subida en curso: se ignora '%.*s'", len, data);
+    return false;
+  }
+  ESP_LOGI(TAG, "Forma de onda '%.*s' %s", len, data,
+           started ? "lista" : "en espera de trama");
+  return true;
+}
+
+// Muestras crudas del trozo n: nunca cruza de un IMU a otro
+static const uint8_t *chunk_span(int n, size_t *len) {
+  int imu = n / s_wave.chunks_per_imu;
+  size_t imu_bytes = (size_t)s_wave.src.n_samples * s_wave.src.sample_bytes;
+  size_t span = s_wave.wz
+                    ? (size_t)BB_WAVE_WZ_BLOCK * s_wave.src.sample_bytes
+                    : BB_WAVE_CHUNK_BYTES;
+  size_t off = (size_t)(n % s_wave.chunks_per_imu) * span;
+  *len = imu_bytes - off;
+  if (*len > span)
+    *len = span;
+  return s_wave.src.raw[imu] + off;
+}
+
+// Lo que viaja del trozo n: frame->raw tal cual o su bloque WZ
+static const uint8_t *chunk_payload(int n, size_t *len) {
+  const uint8_t *raw = chunk_span(n, len);
+  if (!s_wave.wz)
+    return raw;
+  int n_axes = s_wave.src.sample_bytes / 2;
+  int z = bb_wz_encode(raw, (int)(*len / s_wave.src.sample_bytes), n_axes,
+                       s_wz_buf, sizeof(s_wz_buf));
+  *len = (z > 0) ? (size_t)z : 0;
+  return s_wz_buf;
+}
+
+static int wave_publish(esp_mqtt_client_handle_t client, const char *leaf,
+                        const void *data, size_t len) {
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%lu/%lu/%s", BB_MQTT_TOPIC_WAVE,
+           (unsigned long)bb_storage_boot_id(), (unsigned long)s_wave.id,
+           leaf);
+  return esp_mqtt_client_publish(client, topic, (const char *)data, (int)len,
+                                 1, 0);
+}
+
+static int wave_send_manifest(esp_mqtt_client_handle_t client) {
+  static char json[384 + WAVE_MAX_CHUNKS * 11];
+  const bb_wave_src_t *src = &s_wave.src;
+  uint32_t total_crc = 0;
+  size_t total = 0;
+  size_t zbytes = 0;
+  uint32_t cycles = 0;
+
+  int n = snprintf(
+      json, sizeof(json),
+      "{\"id\":%lu,\"boot\":%lu,\"frame\":%lu,\"mode\":\"%s\","
+      "\"t_first_us\":%lld,\"fs\":%.3f,\"quality\":%u,\"n_imus\":%u,"
+      "\"n_samples\":%u,\"sample_bytes\":%u,\"fmt\":\"i16be\","
+      "\"g_lsb\":%.1f,\"dps_lsb\":%.1f,\"codec\":\"%s\",\"chunk\":%u,"
+      "\"chunks_per_imu\":%u,\"n_chunks\":%u,\"crc\":[",
+      (unsigned long)s_wave.id, (unsigned long)bb_storage_boot_id(),
+      (unsigned long)src->frame_seq,
+      s_wave.mode == WAVE_LAST ? "last" : "next", (long long)src->t_first_us,
+      src->fs_hz, src->quality, src->n_imus, src->n_samples,
+      src->sample_bytes, src->accel_lsb_per_g, src->gyro_lsb_per_dps,
+      s_wave.wz ? "wz1" : "raw",
+      s_wave.wz ? BB_WAVE_WZ_BLOCK : BB_WAVE_CHUNK_BYTES, // Muestras o bytes
+      s_wave.chunks_per_imu, s_wave.n_chunks);
+
+  // CRC de cada trozo tal como viaja (el host dice cuál falta o llegó mal)
+  // y de las muestras crudas completas. Comprimida se codifica aquí una vez
+  // para los CRC y otra al publicar cada trozo: sin buffer del tamaño total
+  for (int i = 0; i < s_wave.n_chunks && n < (int)sizeof(json); i++) {
+    size_t len, zlen;
+    const uint8_t *p = chunk_span(i, &len);
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    const uint8_t *z = chunk_payload(i, &zlen);
+    cycles += esp_cpu_get_cycle_count() - t0;
+    n += snprintf(json + n, sizeof(json) - n, "%s%lu", i ? "," : "",
+                  (unsigned long)esp_rom_crc32_le(0, z, zlen));
+    total_crc = esp_rom_crc32_le(total_crc, p, len);
+    total += len;
+    zbytes += zlen;
+  }
+  if (n < (int)sizeof(json)) {
+    n += snprintf(json + n, sizeof(json) - n,
+                  "],\"bytes\":%u,\"zbytes\":%u,\"crc32\":%lu}",
+                  (unsigned)total, (unsigned)zbytes, (unsigned long)total_crc);
+  }
+  if (n >= (int)sizeof(json)) {
+    ESP_LOGE(TAG, "Manifiesto demasiado grande (%d B)", n);
+    return WAVE_TOO_BIG;
+  }
+  if (s_wave.wz && zbytes > 0) {
+    uint32_t values = (uint32_t)src->n_imus * src->n_samples;
+    ESP_LOGI(TAG, "WZ #%lu: %u -> %u B (x%.2f), %lu ciclos/muestra",
+             (unsigned long)s_wave.id, (unsigned)total, (unsigned)zbytes,
+             (double)total / zbytes, (unsigned long)(cycles / values));
+  }
+  return wave_publish(client, "m", json, n);
+}
+
+int64_t bb_wave_poll(esp_mqtt_client_handle_t client, bool online,
+                     int64_t now_us) {
+  taskENTER_CRITICAL(&s_wave_lock);
+  bool active = s_wave.active;
+  taskEXIT_CRITICAL(&s_wave_lock);
+  if (!active)
+    return INT64_MAX;
+
+  if (now_us - s_wave.t_start_us > BB_WAVE_TIMEOUT_MS * 1000LL) {
+    ESP_LOGW(TAG, "Forma de onda #%lu abandonada en el trozo %d/%u",
+             (unsigned long)s_wave.id, s_wave.next, s_wave.n_chunks);
+    wave_finish();
+    return INT64_MAX;
+  }
+  if (client == NULL || !online) {
+    // Sin broker: la trama sigue retenida hasta el timeout (la vuelta del
+    // broker despierta a Task_Comms antes)
+    return s_wave.t_start_us + BB_WAVE_TIMEOUT_MS * 1000LL - now_us + 1;
+  }
+  if (now_us < s_wave.t_next_us)
+    return s_wave.t_next_us - now_us;
+
+  // Control de flujo: lo que el broker aún no confirmó (telemetría incluida)
+  s_wave.t_next_us = now_us + BB_WAVE_CHUNK_GAP_MS * 1000LL;
+  if (esp_mqtt_client_get_outbox_size(client) > BB_WAVE_OUTBOX_MAX)
+    return BB_WAVE_CHUNK_GAP_MS * 1000LL;
+
+  int msg_id;
+  if (s_wave.next < 0) {
+    msg_id = wave_send_manifest(client);
+  } else {
+    char leaf[12];
+    size_t len;
+    const uint8_t *p = chunk_payload(s_wave.next, &len);
+    snprintf(leaf, sizeof(leaf), "%d", s_wave.next);
+    msg_id = wave_publish(client, leaf, p, len); // frame->raw o s_wz_buf
+  }
+  if (msg_id == WAVE_TOO_BIG) {
+    wave_finish();
+    return INT64_MAX;
+  }
+  if (msg_id < 0) {
+    s_wave.retries++;
+    return BB_WAVE_CHUNK_GAP_MS * 1000LL;
+  }
+
+  if (++s_wave.next < s_wave.n_chunks)
+    return BB_WAVE_CHUNK_GAP_MS * 1000LL;
+
+  size_t bytes = (size_t)s_wave.src.n_imus * s_wave.src.n_samples *
+                 s_wave.src.sample_bytes;
+  ESP_LOGI(TAG,
+           "Forma de onda #%lu (trama %lu): %u B en %u trozos, %lld ms, "
+           "%lu reintentos",
+           (unsigned long)s_wave.id, (unsigned long)s_wave.src.frame_seq,
+           (unsigned)bytes, s_wave.n_chunks,
+           (long long)((now_us - s_wave.t_start_us) / 1000),
+           (unsigned long)s_wave.retries);
+  wave_finish();
+  return INT64_MAX;
+}
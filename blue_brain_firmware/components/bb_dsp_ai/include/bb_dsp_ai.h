@@ -1,9 +1,21 @@
 #ifndef BB_DSP_AI_H
 #define BB_DSP_AI_H
 
+#include "bb_config.h"  // Para bb_imu_cal_t
 #include "bb_connect.h" // Para bb_telemetry_t
+#include "bb_sensors.h" // Para bb_acq_meta_t
+#include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
 
+typedef enum {
+  BB_CAL_IDLE = 0, // Sin petición desde el arranque
+  BB_CAL_PENDING,  // Se calibrará con la próxima trama
+  BB_CAL_OK,       // Calibración guardada en NVS
+  BB_CAL_MOVING,   // Rechazada: la máquina no estaba en reposo
+  BB_CAL_FAILED,   // Rechazada: |g| fuera de rango o error de NVS
+} bb_cal_status_t;
+
 /**
  * @brief Inicializa el motor DSP/AI
  */
@@ -11,14 +23,73 @@ void bb_dsp_ai_init(void);
 
 /**
  * @brief Procesa datos crudos de vibración y rellena el reporte
- * @param raw_data Buffer de datos crudos (6 bytes por muestra: HiLo X, HiLo Y,
- * HiLo Z)
+ * Con el IMU calibrado, RMS/pico/cresta son solo vibración dinámica y el
+ * espectro se toma del eje principal. En modo 6 ejes añade RMS y frecuencia
+ * dominante del giroscopio.
+ * @param raw_data Buffer de datos crudos (bb_sensors_sample_bytes() por
+ * muestra: HiLo X, HiLo Y, HiLo Z del acelerómetro y, en 6 ejes, del giro)
  * @param sample_count Número de muestras en el buffer
+ * @param meta Reloj de muestreo medido (fs_hz se usa en todas las
+ * conversiones a Hz; si no es válido se usa cfg->sample_rate_hz)
  * @param report Puntero a la estructura de telemetría a rellenar
  */
 void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
+                                 const bb_acq_meta_t *meta,
                                  bb_telemetry_t *report);
 
+/**
+ * @brief Analiza el segundo punto de medida y su relación con el primero
+ * Llamar después de bb_dsp_ai_process_vibration() con la trama del punto A:
+ * rellena p2_* (RMS, pico, cresta, dominante) y la coherencia/fase A-B en la
+ * frecuencia dominante de A (Welch, segmentos de 256 muestras).
+ * @param raw_a Datos crudos del punto A (mismo layout que la ráfaga)
+ * @param raw_b Datos crudos del punto B, capturados en paralelo
+ * @param sample_count Muestras de cada buffer
+ * @param meta_b Reloj del punto B: se remuestrea sobre la rejilla de A
+ * @param report Reporte ya rellenado con el punto A
+ */
+void bb_dsp_ai_process_cross(uint8_t *raw_a, uint8_t *raw_b, int sample_count,
+                             const bb_acq_meta_t *meta_b,
+                             bb_telemetry_t *report);
+
+/**
+ * @brief Pide una calibración en reposo (bias + vector gravedad)
+ * Se ejecuta en Task_DSP con la siguiente trama capturada: la máquina debe
+ * estar parada durante esa ráfaga.
+ */
+void bb_dsp_ai_request_calibration(void);
+
+/**
+ * @brief true si hay una calibración pedida y aún no ejecutada
+ */
+bool bb_dsp_ai_calibration_pending(void);
+
+/**
+ * @brief Estado de la última petición de calibración
+ */
+bb_cal_status_t bb_dsp_ai_calibration_status(void);
+
+/**
+ * @brief Estima bias y gravedad de cada IMU con una trama en reposo y los
+ * guarda en bb_config (imu_cal). Rechaza la trama si hay movimiento.
+ * @param raw Buffers crudos de cada IMU (mismo layout que la ráfaga)
+ * @param n_imus IMUs presentes en la trama
+ * @param sample_count Muestras de cada buffer
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (movimiento) u otro error
+ */
+esp_err_t bb_dsp_ai_calibrate(uint8_t *const raw[], int n_imus,
+                              int sample_count);
+
+/**
+ * @brief Borra la calibración de todos los IMU (vuelve a |a| con gravedad)
+ */
+esp_err_t bb_dsp_ai_clear_calibration(void);
+
+/**
+ * @brief Inclinación del sensor: ángulo entre su eje Z y la gravedad (grados)
+ */
+float bb_dsp_ai_cal_tilt_deg(const bb_imu_cal_t *cal);
+
 /**
  * @brief Obtiene la última telemetría calculada
  * @param out Puntero donde copiar los datos
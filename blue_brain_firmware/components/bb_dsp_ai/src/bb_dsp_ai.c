@@ -8,6 +8,7 @@
 #include "bb_sensors.h"
 #include "esp_log.h"
 #include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -18,25 +19,30 @@
 
 static const char *TAG = "BB_DSP_AI";
 
-// Shareable telemetry storage
-static bb_telemetry_t g_last_report = {0};
-
+// Latest report lives in the shared report pool (bb_connect)
 void bb_dsp_ai_get_latest(bb_telemetry_t *out) {
   if (out) {
-    memcpy(out, &g_last_report, sizeof(bb_telemetry_t));
+    bb_report_get_latest(out);
   }
 }
 
 // FFT Configuration (Loaded from bb_config.h)
 #define N_SAMPLES BB_N_SAMPLES
 #define FFT_SIZE BB_FFT_SIZE
-#define SAMPLE_RATE_HZ BB_SAMPLE_RATE_HZ
 
 // Static buffers to save stack size (1024 * 4 * 2 = 8KB for complex input)
 // Check if these fit in RAM (we have plenty of heap/bss)
 static float wind_hann[N_SAMPLES];
 static float fft_input[N_SAMPLES * 2]; // Real + Imag interleaved
 
+// Welch segments for the A/B cross-spectrum (50% overlap)
+#define COH_SEG 256
+static float wind_seg[COH_SEG];
+
+// Rest calibration acceptance
+#define BB_CAL_REST_MAX_STD_G 0.03f // Spread per axis: above it, not at rest
+#define BB_CAL_MAX_NORM_ERR_G 0.15f // |mean| must be 1 G within this
+
 void bb_dsp_ai_init(void) {
   // Initialize DSP library
   esp_err_t ret = dsps_fft2r_init_fc32(NULL, FFT_SIZE);
@@ -47,44 +53,54 @@ void bb_dsp_ai_init(void) {
 
   // Generate Hann Window
   dsps_wind_hann_f32(wind_hann, N_SAMPLES);
+  dsps_wind_hann_f32(wind_seg, COH_SEG);
 
   ESP_LOGI(TAG, "DSP Engine Initialized: FFT Size=%d, Window=Hann", FFT_SIZE);
 }
 
-// Suppress false positive from GCC 14.2.0's aggressive flow analysis
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
-
-void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
-                                 bb_telemetry_t *report) {
-  if (sample_count > N_SAMPLES) {
-    ESP_LOGW(TAG, "Sample count %d > FFT Size %d, truncating", sample_count,
-             N_SAMPLES);
-    sample_count = N_SAMPLES;
-  }
+// Static offset of an IMU (bias + gravity, in G) from its stored calibration.
+// All zeros when the IMU is not calibrated.
+static bool accel_offset(int imu, float offset[3]) {
+  const bb_imu_cal_t *cal = &bb_config_get()->imu_cal[imu];
+  for (int ax = 0; ax < 3; ax++)
+    offset[ax] = cal->valid ? cal->bias_g[ax] + cal->gravity_g[ax] : 0.0f;
+  return cal->valid;
+}
 
-  // Allocate working buffer for magnitude time-domain calculations
-  float *magnitude = (float *)malloc(sample_count * sizeof(float));
-  if (magnitude == NULL) {
-    ESP_LOGE(TAG, "Failed to allocate memory for DSP processing");
-    return;
-  }
+static inline float accel_axis_g(const uint8_t *sample, int ax,
+                                 const float offset[3]) {
+  // One fused multiply-add per axis: raw * (1 / sens) - offset
+  return fmaf((float)(int16_t)((sample[ax * 2] << 8) | sample[ax * 2 + 1]),
+              1.0f / BB_ACCEL_SENS_16G, -offset[ax]);
+}
 
-  // Initialize tracking variables
+// Raw MPU6050 samples (big-endian X, Y, Z, then gyro in 6-axis mode) -> |a|
+// in G, tracking min/max. The calibration offset is folded into the
+// conversion: calibrated, |a| is the dynamic acceleration only; otherwise it
+// still carries the 1 G gravity term. Returns the axis with the most energy
+// (the principal vibration axis once gravity is out).
+static int accel_magnitude(const uint8_t *raw_data, int sample_count,
+                           const float offset[3], float *magnitude,
+                           float *min_out, float *max_out) {
+  const int stride = bb_sensors_sample_bytes();
   float max_value = 0.0f;
   float min_value = 100.0f;
+  float sum_sq[3] = {0};
 
-  // Step 1: Convert raw sensor data to G-force magnitudes
   for (int i = 0; i < sample_count; i++) {
-    uint8_t *sample = &raw_data[i * 6];
+    const uint8_t *sample = &raw_data[i * stride];
 
     // Convert 16-bit raw values to float G-forces
-    float ax = (int16_t)((sample[0] << 8) | sample[1]) / BB_ACCEL_SENS_16G;
-    float ay = (int16_t)((sample[2] << 8) | sample[3]) / BB_ACCEL_SENS_16G;
-    float az = (int16_t)((sample[4] << 8) | sample[5]) / BB_ACCEL_SENS_16G;
+    float ax = accel_axis_g(sample, 0, offset);
+    float ay = accel_axis_g(sample, 1, offset);
+    float az = accel_axis_g(sample, 2, offset);
+    float ax2 = ax * ax, ay2 = ay * ay, az2 = az * az;
+    sum_sq[0] += ax2;
+    sum_sq[1] += ay2;
+    sum_sq[2] += az2;
 
     // Calculate magnitude vector
-    magnitude[i] = sqrtf(ax * ax + ay * ay + az * az);
+    magnitude[i] = sqrtf(ax2 + ay2 + az2);
 
     // Track max and min (manual loops - esp-dsp doesn't have these)
     if (magnitude[i] > max_value) {
@@ -94,6 +110,204 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
       min_value = magnitude[i];
     }
   }
+  *min_out = min_value;
+  *max_out = max_value;
+
+  int axis = 0;
+  for (int ax = 1; ax < 3; ax++) {
+    if (sum_sq[ax] > sum_sq[axis])
+      axis = ax;
+  }
+  return axis;
+}
+
+// Signed series of one calibrated axis. The spectrum is taken here rather
+// than on |a|: without gravity the magnitude rectifies the vibration and
+// doubles its frequency.
+static void accel_axis_series(const uint8_t *raw_data, int sample_count,
+                              const float offset[3], int axis, float *out) {
+  const int stride = bb_sensors_sample_bytes();
+  for (int i = 0; i < sample_count; i++)
+    out[i] = accel_axis_g(&raw_data[i * stride], axis, offset);
+}
+
+// Windowed, zero-padded FFT input. The DC term (1 G gravity when the IMU is
+// not calibrated, residual offset otherwise) is removed first: left in, its
+// window lobe leaks into bin 1 and wins the dominant search.
+static void fft_load_windowed(const float *magnitude, int sample_count) {
+  float mean = 0.0f;
+  for (int i = 0; i < sample_count; i++)
+    mean += magnitude[i];
+  mean /= (float)sample_count;
+
+  for (int i = 0; i < sample_count; i++) {
+    fft_input[i * 2 + 0] = (magnitude[i] - mean) * wind_hann[i]; // Real part
+    fft_input[i * 2 + 1] = 0.0f;                                // Imag part
+  }
+
+  // Zero pad if necessary (though our burst is 1024)
+  for (int i = sample_count; i < FFT_SIZE; i++) {
+    fft_input[i * 2 + 0] = 0.0f;
+    fft_input[i * 2 + 1] = 0.0f;
+  }
+}
+
+// Bin with the largest |X|^2 in fft_input (DC excluded)
+static int fft_peak_bin(void) {
+  float max_fft_mag = 0.0f;
+  int max_fft_idx = 0;
+  for (int i = 1; i < FFT_SIZE / 2; i++) {
+    float re = fft_input[i * 2 + 0];
+    float im = fft_input[i * 2 + 1];
+    float mag = re * re + im * im;
+    if (mag > max_fft_mag) {
+      max_fft_mag = mag;
+      max_fft_idx = i;
+    }
+  }
+  return max_fft_idx;
+}
+
+// Gyro channels (6-axis mode): bias-free RMS of the angular rate and the
+// dominant frequency of the axis carrying most AC energy. The rate vector
+// magnitude would rectify the signal and double its frequency, so the
+// spectrum is taken on a single axis instead.
+static void gyro_features(const uint8_t *raw_data, int sample_count, float fs,
+                          float *scratch, bb_telemetry_t *report) {
+  const int stride = bb_sensors_sample_bytes();
+  float sum[3] = {0}, sum_sq[3] = {0};
+
+  for (int i = 0; i < sample_count; i++) {
+    const uint8_t *g = &raw_data[i * stride + BB_ACCEL_SAMPLE_BYTES];
+    for (int ax = 0; ax < 3; ax++) {
+      float w = (int16_t)((g[ax * 2] << 8) | g[ax * 2 + 1]) /
+                BB_GYRO_SENS_2000DPS;
+      sum[ax] += w;
+      sum_sq[ax] += w * w;
+    }
+  }
+
+  float var_total = 0.0f, var_max = -1.0f;
+  int axis = 0;
+  for (int ax = 0; ax < 3; ax++) {
+    float mean = sum[ax] / sample_count;
+    float var = sum_sq[ax] / sample_count - mean * mean;
+    if (var < 0.0f)
+      var = 0.0f;
+    var_total += var;
+    if (var > var_max) {
+      var_max = var;
+      axis = ax;
+    }
+  }
+
+  for (int i = 0; i < sample_count; i++) {
+    const uint8_t *g = &raw_data[i * stride + BB_ACCEL_SAMPLE_BYTES];
+    scratch[i] = (int16_t)((g[axis * 2] << 8) | g[axis * 2 + 1]) /
+                 BB_GYRO_SENS_2000DPS;
+  }
+  fft_load_windowed(scratch, sample_count);
+  dsps_fft2r_fc32(fft_input, FFT_SIZE);
+  dsps_bit_rev_fc32(fft_input, FFT_SIZE);
+
+  report->n_axes = 6;
+  report->gyro_axis = (uint8_t)axis;
+  report->gyro_rms_dps = sqrtf(var_total);
+  report->gyro_dom_freq = (float)fft_peak_bin() * fs / (float)FFT_SIZE;
+}
+
+// Cross-spectrum of two simultaneous series at a single frequency f0.
+// Welch average of Hann-windowed single-bin DFTs: with one segment the
+// coherence would be 1 by definition, so at least two are required.
+static void cross_spectrum_at(const float *a, const float *b, int n, float fs,
+                              float f0, float *coh, float *phase_deg) {
+  *coh = 0.0f;
+  *phase_deg = 0.0f;
+  if (n < 2 * COH_SEG || !(f0 > 0.0f) || f0 >= fs / 2.0f)
+    return;
+
+  float mean_a = 0.0f, mean_b = 0.0f;
+  for (int i = 0; i < n; i++) {
+    mean_a += a[i];
+    mean_b += b[i];
+  }
+  mean_a /= (float)n;
+  mean_b /= (float)n;
+
+  float w = 2.0f * (float)M_PI * f0 / fs;
+  float cw = cosf(w), sw = sinf(w);
+  float sxx = 0.0f, syy = 0.0f, sxy_re = 0.0f, sxy_im = 0.0f;
+
+  for (int start = 0; start + COH_SEG <= n; start += COH_SEG / 2) {
+    float xr = 0.0f, xi = 0.0f, yr = 0.0f, yi = 0.0f;
+    float c = 1.0f, s = 0.0f; // e^{-jwi} = c - js, by rotation
+
+    for (int i = 0; i < COH_SEG; i++) {
+      float xa = wind_seg[i] * (a[start + i] - mean_a);
+      float xb = wind_seg[i] * (b[start + i] - mean_b);
+      xr += xa * c;
+      xi -= xa * s;
+      yr += xb * c;
+      yi -= xb * s;
+
+      float c_next = c * cw - s * sw;
+      s = s * cw + c * sw;
+      c = c_next;
+    }
+
+    // Sxy += X * conj(Y)
+    sxx += xr * xr + xi * xi;
+    syy += yr * yr + yi * yi;
+    sxy_re += xr * yr + xi * yi;
+    sxy_im += xi * yr - xr * yi;
+  }
+
+  if (sxx > 0.0f && syy > 0.0f)
+    *coh = (sxy_re * sxy_re + sxy_im * sxy_im) / (sxx * syy);
+  *phase_deg = atan2f(sxy_im, sxy_re) * 180.0f / (float)M_PI;
+}
+
+// Suppress false positive from GCC 14.2.0's aggressive flow analysis
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
+                                 const bb_acq_meta_t *meta,
+                                 bb_telemetry_t *report) {
+  if (sample_count > N_SAMPLES) {
+    ESP_LOGW(TAG, "Sample count %d > FFT Size %d, truncating", sample_count,
+             N_SAMPLES);
+    sample_count = N_SAMPLES;
+  }
+
+  // Measured sample clock: every Hz conversion below uses fs
+  float fs = (meta != NULL) ? meta->fs_hz : 0.0f;
+  if (!(fs > 0.0f) || fs > (float)BB_SAMPLE_RATE_HZ) {
+    fs = (float)bb_config_get()->sample_rate_hz;
+    ESP_LOGW(TAG, "No measured sample rate, using configured %.0f Hz", fs);
+  }
+  if (meta != NULL) {
+    report->t_first_us = meta->t_first_us;
+    report->t_last_us = meta->t_last_us;
+    report->fs_jitter_us = meta->jitter_us;
+  }
+  report->fs_hz = fs;
+  report->n_points = 1;
+
+  // Allocate working buffer for magnitude time-domain calculations
+  float *magnitude = (float *)malloc(sample_count * sizeof(float));
+  if (magnitude == NULL) {
+    ESP_LOGE(TAG, "Failed to allocate memory for DSP processing");
+    return;
+  }
+
+  // Step 1: Convert raw sensor data to G-force magnitudes (point A: IMU 0)
+  float offset[3];
+  bool calibrated = accel_offset(0, offset);
+  float max_value, min_value;
+  int axis = accel_magnitude(raw_data, sample_count, offset, magnitude,
+                             &min_value, &max_value);
+  report->calibrated = calibrated;
 
   // Step 2: Time-Domain Metrics (RMS, Peak, CF)
   // RMS = sqrt(dot(x, x) / n)
@@ -118,26 +332,12 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
       (report->vib_rms > 0.05f) ? (report->vib_peak / report->vib_rms) : 0.0f;
 
   // Step 3: Frequency-Domain Analysis (FFT)
-  // 3.1 Apply Hann Window and Prepare Complex Input
-  for (int i = 0; i < sample_count; i++) {
-    // Remove DC component (Gravity) effectively by windowing?
-    // Ideally we should subtract mean first, but Hann window tapers edges to
-    // zero anyway. Let's subtract 1.0G (Gravity) approx or just let FFT handle
-    // DC at index 0. Windowing the total magnitude (which includes 1G DC) will
-    // create a large logic DC lobe. Better to remove mean first.
-
-    // float val = magnitude[i] - 1.0f; // Approx gravity removal
-    float val = magnitude[i]; // Raw magnitude
-
-    fft_input[i * 2 + 0] = val * wind_hann[i]; // Real part
-    fft_input[i * 2 + 1] = 0.0f;               // Imag part
-  }
+  // 3.0 Calibrated: principal axis instead of |a| (magnitude buffer reused)
+  if (calibrated)
+    accel_axis_series(raw_data, sample_count, offset, axis, magnitude);
 
-  // Zero pad if necessary (though our burst is 1024)
-  for (int i = sample_count; i < FFT_SIZE; i++) {
-    fft_input[i * 2 + 0] = 0.0f;
-    fft_input[i * 2 + 1] = 0.0f;
-  }
+  // 3.1 Apply Hann Window and Prepare Complex Input (mean removed)
+  fft_load_windowed(magnitude, sample_count);
 
   // 3.2 Execute FFT (Radix-2)
   dsps_fft2r_fc32(fft_input, FFT_SIZE);
@@ -160,9 +360,9 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
   int count_low = 0;
   int count_high = 0;
 
-  // Bin 0 = 0Hz. Bin 1 = ~1Hz (0.97Hz to be precise)
-  // Low Band: 10Hz - 100Hz -> Index ~10 to ~102
-  // High Band: 100Hz - 500Hz -> Index ~102 to ~512
+  // Bin k = k * fs / FFT_SIZE, with fs measured for this frame
+  // Low Band: 10Hz - 100Hz
+  // High Band: 100Hz - 500Hz
 
   for (int i = 1; i < FFT_SIZE / 2; i++) {
     float re = fft_input[i * 2 + 0];
@@ -181,7 +381,7 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
     // Mid: 100-500Hz (5 sub-bands of ~80Hz)
     // High: 500-800Hz (5 sub-bands of ~60Hz) - Capped at Nyquist
 
-    float freq = (float)i * SAMPLE_RATE_HZ / FFT_SIZE;
+    float freq = (float)i * fs / FFT_SIZE;
 
     // Low Band: 10-100Hz
     if (freq >= 10 && freq < 100) {
@@ -214,9 +414,14 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
 
   // Calculate Hz
   // Freq = Index * Fs / N
-  float dom_freq = (float)max_fft_idx * SAMPLE_RATE_HZ / (float)FFT_SIZE;
+  float dom_freq = (float)max_fft_idx * fs / (float)FFT_SIZE;
   report->vib_dom_freq = dom_freq;
 
+  // Step 4: Gyro channels (6-axis mode), magnitude buffer reused as scratch
+  report->n_axes = 3;
+  if (bb_sensors_sample_bytes() == BB_IMU6_SAMPLE_BYTES)
+    gyro_features(raw_data, sample_count, fs, magnitude, report);
+
   // Cleanup
   free(magnitude);
 
@@ -224,9 +429,215 @@ void bb_dsp_ai_process_vibration(uint8_t *raw_data, int sample_count,
            "DSP: RMS=%.3f, Peak=%.3f, Freq=%.1fHz, LowBand=%.3f, HighBand=%.3f",
            report->vib_rms, report->vib_peak, report->vib_dom_freq,
            report->vib_band_low, report->vib_band_high);
+}
+
+void bb_dsp_ai_process_cross(uint8_t *raw_a, uint8_t *raw_b, int sample_count,
+                             const bb_acq_meta_t *meta_b,
+                             bb_telemetry_t *report) {
+  if (sample_count > N_SAMPLES)
+    sample_count = N_SAMPLES;
+
+  // Point A was analysed first: same clock, same frame length
+  float fs = report->fs_hz;
+  if (!(fs > 0.0f))
+    return;
+
+  float *mag_a = (float *)malloc(sample_count * sizeof(float));
+  float *mag_b = (float *)malloc(sample_count * sizeof(float));
+  if (mag_a == NULL || mag_b == NULL) {
+    ESP_LOGE(TAG, "Failed to allocate memory for cross-channel DSP");
+    free(mag_a);
+    free(mag_b);
+    return;
+  }
+
+  float off_a[3], off_b[3];
+  bool cal_a = accel_offset(0, off_a);
+  bool cal_b = accel_offset(1, off_b);
+
+  float min_a, max_a, min_b, max_b;
+  int axis_a =
+      accel_magnitude(raw_a, sample_count, off_a, mag_a, &min_a, &max_a);
+  int axis_b =
+      accel_magnitude(raw_b, sample_count, off_b, mag_b, &min_b, &max_b);
+
+  // Point B time-domain metrics
+  float dot_result = 0.0f;
+  dsps_dotprod_f32_ansi(mag_b, mag_b, &dot_result, sample_count);
+  report->p2_rms = sqrtf(dot_result / sample_count);
+  report->p2_peak = max_b;
+  report->p2_crest =
+      (report->p2_rms > 0.05f) ? (report->p2_peak / report->p2_rms) : 0.0f;
+
+  // Point B dominant frequency (same windowing as point A; principal axis
+  // when B is calibrated, as for A)
+  if (cal_b)
+    accel_axis_series(raw_b, sample_count, off_b, axis_b, mag_b);
+  fft_load_windowed(mag_b, sample_count);
+  dsps_fft2r_fc32(fft_input, FFT_SIZE);
+  dsps_bit_rev_fc32(fft_input, FFT_SIZE);
 
-  // Update shared telemetry for Web UI
-  memcpy(&g_last_report, report, sizeof(bb_telemetry_t));
+  int max_fft_idx = fft_peak_bin();
+  float fs_b = (meta_b != NULL && meta_b->fs_hz > 0.0f) ? meta_b->fs_hz : fs;
+  report->p2_dom_freq = (float)max_fft_idx * fs_b / (float)FFT_SIZE;
+
+  // Coherence needs the same kind of series on both sides: axis/axis when
+  // both IMUs are calibrated, uncalibrated |a|/|a| otherwise (a
+  // gravity-removed |a| against one still carrying 1 G skews the estimate)
+  if (cal_a && cal_b) {
+    accel_axis_series(raw_a, sample_count, off_a, axis_a, mag_a);
+  } else if (cal_a || cal_b) {
+    static const float no_offset[3] = {0.0f, 0.0f, 0.0f};
+    float lo, hi;
+    accel_magnitude(raw_a, sample_count, no_offset, mag_a, &lo, &hi);
+    accel_magnitude(raw_b, sample_count, no_offset, mag_b, &lo, &hi);
+  }
+
+  // Put B on A's time grid: each IMU has its own clock (FIFO mode) or a
+  // fixed read skew (burst mode); both are fitted in the acquisition meta
+  if (meta_b != NULL && meta_b->fs_hz > 0.0f && report->t_first_us != 0) {
+    float *aligned = fft_input; // Free again after B's FFT
+    float step = fs_b / fs;
+    float pos = (float)(report->t_first_us - meta_b->t_first_us) * 1e-6f * fs_b;
+    for (int i = 0; i < sample_count; i++, pos += step) {
+      int j = (int)floorf(pos);
+      if (j < 0) {
+        aligned[i] = mag_b[0];
+      } else if (j >= sample_count - 1) {
+        aligned[i] = mag_b[sample_count - 1];
+      } else {
+        float frac = pos - (float)j;
+        aligned[i] = mag_b[j] + frac * (mag_b[j + 1] - mag_b[j]);
+      }
+    }
+    memcpy(mag_b, aligned, sample_count * sizeof(float));
+  }
+
+  // Coherence and phase at point A's dominant frequency
+  cross_spectrum_at(mag_a, mag_b, sample_count, fs, report->vib_dom_freq,
+                    &report->coh_dom, &report->phase_dom_deg);
+  report->n_points = 2;
+
+  free(mag_a);
+  free(mag_b);
+
+  ESP_LOGD(TAG, "DSP B: RMS=%.3f, Freq=%.1fHz, Coh=%.2f, Phase=%.1f deg",
+           report->p2_rms, report->p2_dom_freq, report->coh_dom,
+           report->phase_dom_deg);
 }
 
 #pragma GCC diagnostic pop
+
+// --- Rest calibration ---------------------------------------------------
+// Requested from the Web UI, run by Task_DSP on the next captured frame so
+// the I2C bus is never shared with the acquisition task.
+static _Atomic int s_cal_status = BB_CAL_IDLE;
+
+void bb_dsp_ai_request_calibration(void) {
+  atomic_store(&s_cal_status, BB_CAL_PENDING);
+}
+
+bool bb_dsp_ai_calibration_pending(void) {
+  return atomic_load(&s_cal_status) == BB_CAL_PENDING;
+}
+
+bb_cal_status_t bb_dsp_ai_calibration_status(void) {
+  return (bb_cal_status_t)atomic_load(&s_cal_status);
+}
+
+// Per-axis mean and largest per-axis standard deviation of a frame, in G
+static void accel_rest_stats(const uint8_t *raw_data, int sample_count,
+                             float mean[3], float *std_max) {
+  static const float no_offset[3] = {0.0f, 0.0f, 0.0f};
+  const int stride = bb_sensors_sample_bytes();
+
+  for (int ax = 0; ax < 3; ax++) {
+    float sum = 0.0f;
+    for (int i = 0; i < sample_count; i++)
+      sum += accel_axis_g(&raw_data[i * stride], ax, no_offset);
+    mean[ax] = sum / (float)sample_count;
+  }
+
+  // Second pass: deviations from the mean (no cancellation at 1 G)
+  *std_max = 0.0f;
+  for (int ax = 0; ax < 3; ax++) {
+    float var = 0.0f;
+    for (int i = 0; i < sample_count; i++) {
+      float d = accel_axis_g(&raw_data[i * stride], ax, no_offset) - mean[ax];
+      var += d * d;
+    }
+    float std = sqrtf(var / (float)sample_count);
+    if (std > *std_max)
+      *std_max = std;
+  }
+}
+
+esp_err_t bb_dsp_ai_calibrate(uint8_t *const raw[], int n_imus,
+                              int sample_count) {
+  if (n_imus < 1 || n_imus > BB_MAX_IMUS || sample_count < 2) {
+    atomic_store(&s_cal_status, BB_CAL_FAILED);
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (sample_count > N_SAMPLES)
+    sample_count = N_SAMPLES;
+
+  bb_config_t cfg = *bb_config_get();
+
+  for (int imu = 0; imu < n_imus; imu++) {
+    float mean[3], std_max;
+    accel_rest_stats(raw[imu], sample_count, mean, &std_max);
+
+    if (std_max > BB_CAL_REST_MAX_STD_G) {
+      ESP_LOGW(TAG, "Calibration IMU %d rejected: moving (std %.3f G)", imu,
+               std_max);
+      atomic_store(&s_cal_status, BB_CAL_MOVING);
+      return ESP_ERR_INVALID_STATE;
+    }
+
+    // At rest the mean is gravity plus the sensor offset. A single pose
+    // only separates them along gravity: |mean| - 1 G is the bias there.
+    float norm = sqrtf(mean[0] * mean[0] + mean[1] * mean[1] +
+                       mean[2] * mean[2]);
+    if (norm < 1.0f - BB_CAL_MAX_NORM_ERR_G ||
+        norm > 1.0f + BB_CAL_MAX_NORM_ERR_G) {
+      ESP_LOGW(TAG, "Calibration IMU %d rejected: |g| = %.3f G", imu, norm);
+      atomic_store(&s_cal_status, BB_CAL_FAILED);
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    bb_imu_cal_t *cal = &cfg.imu_cal[imu];
+    for (int ax = 0; ax < 3; ax++) {
+      cal->gravity_g[ax] = mean[ax] / norm;
+      cal->bias_g[ax] = mean[ax] - cal->gravity_g[ax];
+    }
+    cal->valid = true;
+
+    ESP_LOGI(TAG,
+             "Calibration IMU %d: g=(%.3f, %.3f, %.3f) tilt=%.1f deg "
+             "bias=%.4f G std=%.4f G",
+             imu, cal->gravity_g[0], cal->gravity_g[1], cal->gravity_g[2],
+             bb_dsp_ai_cal_tilt_deg(cal), norm - 1.0f, std_max);
+  }
+
+  esp_err_t err = bb_config_set(&cfg);
+  atomic_store(&s_cal_status, (err == ESP_OK) ? BB_CAL_OK : BB_CAL_FAILED);
+  return err;
+}
+
+esp_err_t bb_dsp_ai_clear_calibration(void) {
+  bb_config_t cfg = *bb_config_get();
+  memset(cfg.imu_cal, 0, sizeof(cfg.imu_cal));
+  atomic_store(&s_cal_status, BB_CAL_IDLE);
+  return bb_config_set(&cfg);
+}
+
+float bb_dsp_ai_cal_tilt_deg(const bb_imu_cal_t *cal) {
+  if (cal == NULL || !cal->valid)
+    return 0.0f;
+  float gz = cal->gravity_g[2];
+  if (gz > 1.0f)
+    gz = 1.0f;
+  else if (gz < -1.0f)
+    gz = -1.0f;
+  return acosf(gz) * 180.0f / (float)M_PI;
+}
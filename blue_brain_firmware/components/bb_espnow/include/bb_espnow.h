@@ -2,20 +2,79 @@
 #define BB_ESPNOW_H
 
 #include "bb_connect.h" // For bb_telemetry_t
+#include "bb_sync.h"
 #include "esp_err.h"
+#include "mqtt_client.h"
+#include <stdbool.h>
+#include <stdint.h>
 
+// Contadores de envío desde el arranque
+typedef struct {
+  uint32_t messages; // Reportes aceptados
+  uint32_t frames;   // Tramas confirmadas (incluye fragmentos)
+  uint32_t retries;  // Reintentos de fragmento
+  uint32_t failed;   // Mensajes perdidos tras BB_ESPNOW_RETRIES
+  uint32_t busy;     // Reportes descartados con otro aún en vuelo
+} bb_espnow_stats_t;
 
 /**
  * @brief Initialize ESP-NOW.
  * Requires WiFi to be initialized (station or softap mode).
+ * Con espnow_gateway arranca además la recepción (bb_gateway.h) y con
+ * espnow_sync las balizas de la línea común (bb_sync.h).
  */
 esp_err_t bb_espnow_init(void);
 
 /**
  * @brief Send telemetry data via ESP-NOW.
  * Uses broadcast or the configured destination MAC from bb_config.
+ * El reporte viaja en binario versionado dentro de tramas bb_packet (CRC16,
+ * id de paquete, fragmentos) con reintentos; la llamada no espera al ACK.
  * @param data Pointer to telemetry structure.
+ * @return ESP_OK, o ESP_ERR_INVALID_STATE si el mensaje anterior sigue en
+ * vuelo (este se descarta)
  */
 esp_err_t bb_espnow_send(const bb_telemetry_t *data);
 
+/**
+ * @brief Copia los contadores de envío
+ */
+void bb_espnow_get_stats(bb_espnow_stats_t *out);
+
+/**
+ * @brief Instante de esp_timer -> línea de tiempo común (espnow_sync)
+ * En el maestro es su propio reloj; en un seguidor, la estimación a partir
+ * de las balizas (bb_sync.h).
+ * @param err_us Si no es NULL, error RMS de la estimación (µs)
+ * @return false sin línea común (desactivada, sin balizas o sin ajustar)
+ */
+bool bb_espnow_sync_time(int64_t local_us, int64_t *shared_us,
+                         uint16_t *err_us);
+
+/**
+ * @brief Próximo múltiplo de period_us de la línea común, al menos lead_us
+ * después de now_us, como instante de esp_timer (ráfagas alineadas)
+ * @return false sin línea común
+ */
+bool bb_espnow_sync_next_slot(int64_t now_us, int64_t period_us,
+                              int64_t lead_us, int64_t *local_us);
+
+/**
+ * @brief Papel del nodo (BB_SYNC_*) y copia del estimador del seguidor
+ */
+uint8_t bb_espnow_sync_get(bb_sync_t *out);
+
+// --- Uso interno de bb_connect ---
+
+/**
+ * @brief Gateway: procesa las tramas recibidas y publica los lotes por nodo
+ * que estén listos en node/<id>/telemetry/bin (Task_Comms). Lotes de hasta
+ * batch_size mensajes o max_age_us de espera, como los del propio nodo.
+ * @return µs hasta la siguiente llamada útil (INT64_MAX si no es gateway o
+ * no hay nada pendiente; una trama nueva despierta a Task_Comms)
+ */
+int64_t bb_espnow_gateway_poll(esp_mqtt_client_handle_t client, bool online,
+                               int64_t now_us, int batch_size,
+                               int64_t max_age_us);
+
 #endif // BB_ESPNOW_H
@@ -0,0 +1,154 @@
+/**
+ * @file bb_gateway.h
+ * @brief Gateway ESP-NOW -> MQTT: agregación de los reportes de muchos nodos
+ *
+ * Un nodo en modo gateway recibe las tramas bb_packet de los demás y las
+ * publica por MQTT con su propia sesión, así los nodos no necesitan una
+ * cada uno. Por cada trama válida:
+ *
+ *   1. Reensamblado de fragmentos (bb_packet_reasm_t).
+ *   2. Duplicados por nodo: ventana de los últimos BB_GW_SEQ_WINDOW
+ *      packet_id (bitmap, como el anti-replay de IPsec). Un reintento cuyo
+ *      ACK se perdió llega dos veces y se descarta. Un mensaje atrasado
+ *      dentro de la ventana se acepta (late); más viejo, se descarta.
+ *      Un salto de más de BB_GW_RESTART_GAP es un reinicio del nodo
+ *      (packet_id arranca en un valor aleatorio) y empieza una ventana nueva.
+ *   3. Lote por nodo: los mensajes esperan en un pool común, ordenados por
+ *      packet_id, hasta llenar el lote, vencer su latencia máxima o faltar
+ *      hueco en el pool (sale el lote más antiguo).
+ *
+ * El lote se publica como lote binario 'B' 'K' (bb_telemetry_codec.h) con
+ * los reportes tal como los codificó el nodo, sin decodificarlos.
+ *
+ * Estadísticas por nodo: RSSI (última y media), tramas, mensajes,
+ * duplicados, atrasados, perdidos (huecos de packet_id), reinicios y
+ * descartados.
+ *
+ * Lógica pura (sin esp_now, MQTT ni FreeRTOS): un solo hilo la usa y se
+ * prueba en el host con tráfico simulado.
+ */
+
+#ifndef BB_GATEWAY_H
+#define BB_GATEWAY_H
+
+#include "bb_config.h"
+#include "bb_packet.h"
+#include "bb_telemetry_codec.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_GW_SEQ_WINDOW 64            // Bitmap u64 de packet_id recientes
+#define BB_GW_MSG_MAX BB_TLM_MAX_BYTES // Reporte binario más largo
+
+typedef struct {
+  bool used;
+  uint8_t mac[6];
+  int64_t last_seen_us;
+  int8_t rssi;          // dBm de la última trama
+  int16_t rssi_avg_x16; // Media exponencial (dBm x 16)
+
+  // Ventana de packet_id
+  bool seq_valid;
+  uint32_t hi_id;  // Mayor packet_id aceptado
+  uint64_t window; // Bit i: hi_id - i recibido
+  uint8_t span;    // Posiciones válidas de la ventana (nodo recién visto)
+
+  // Lote pendiente: lista del pool ordenada por packet_id
+  int16_t batch_head;
+  uint8_t batch_count;
+  int64_t batch_open_us;
+
+  // Contadores desde que se vio el nodo
+  uint32_t frames;   // Tramas válidas (fragmentos y repetidas incluidas)
+  uint32_t messages; // Mensajes aceptados
+  uint32_t dups;     // Repetidos descartados
+  uint32_t late;     // Aceptados fuera de orden
+  uint32_t lost;     // packet_id que salieron de la ventana sin llegar
+  uint32_t restarts; // Saltos de packet_id (reinicio del nodo)
+  uint32_t dropped;  // Sin hueco en el pool o fuera de la ventana
+} bb_gw_node_t;
+
+typedef struct {
+  int16_t next;
+  uint32_t packet_id;
+  uint16_t len;
+  uint8_t data[BB_GW_MSG_MAX];
+} bb_gw_msg_t;
+
+typedef struct {
+  bb_gw_node_t nodes[BB_GW_MAX_NODES];
+  bb_gw_msg_t pool[BB_GW_POOL_MSGS];
+  int16_t free_head;
+  uint16_t free_count;
+  bb_packet_reasm_t reasm;
+
+  // Contadores globales
+  uint32_t frames;    // Tramas recibidas
+  uint32_t bad_crc;   // CRC incorrecto
+  uint32_t bad_frame; // Longitud, magic, versión o tipo no válidos
+  uint32_t no_node;   // Tabla de nodos llena
+  uint32_t batches;   // Lotes entregados
+  uint32_t messages;  // Mensajes entregados
+} bb_gw_t;
+
+/**
+ * @brief Estado inicial (~45 KB: reservar con malloc, solo en modo gateway)
+ */
+void bb_gw_init(bb_gw_t *g);
+
+/**
+ * @brief Procesa una trama recibida
+ * @param rssi dBm del paquete (rx_ctrl de ESP-NOW)
+ * @return true si completó un mensaje nuevo (ya está en el lote del nodo)
+ */
+bool bb_gw_rx(bb_gw_t *g, const uint8_t *frame, size_t len, int8_t rssi,
+              int64_t now_us);
+
+/**
+ * @brief Nodo con lote listo para publicar: lleno (batch_size mensajes),
+ * vencido (max_age_us desde el primero) o el más antiguo si queda menos de
+ * un cuarto del pool libre
+ * @return Índice en nodes[], o -1 si no hay ninguno
+ */
+int bb_gw_ready(const bb_gw_t *g, int64_t now_us, int batch_size,
+                int64_t max_age_us);
+
+/**
+ * @brief µs hasta que venza el lote más antiguo (INT64_MAX si no hay)
+ */
+int64_t bb_gw_next_due_us(const bb_gw_t *g, int64_t now_us,
+                          int64_t max_age_us);
+
+/**
+ * @brief Codifica el lote del nodo en binario 'B' 'K' (en orden de
+ * packet_id, los que quepan en cap)
+ * @param count Mensajes incluidos; se liberan con bb_gw_release()
+ * @return Bytes escritos (0 si no hay lote o no cabe ni uno)
+ */
+size_t bb_gw_encode_batch(const bb_gw_t *g, int node, uint8_t *buf,
+                          size_t cap, int *count);
+
+/**
+ * @brief Libera los count primeros mensajes del lote (ya publicados)
+ */
+void bb_gw_release(bb_gw_t *g, int node, int count);
+
+/**
+ * @brief Id del nodo: MAC en hex, como bb_remote_node_id() (13 B)
+ */
+void bb_gw_node_id(const bb_gw_node_t *n, char *out, size_t cap);
+
+/**
+ * @brief Estadísticas de enlace de un nodo en JSON
+ * @return Longitud del texto (truncado a cap - 1 si no cabe)
+ */
+size_t bb_gw_node_json(const bb_gw_t *g, int node, int64_t now_us,
+                       char *buf, size_t cap);
+
+/**
+ * @brief Resumen del gateway en JSON (contadores globales)
+ */
+size_t bb_gw_summary_json(const bb_gw_t *g, char *buf, size_t cap);
+
+#endif // BB_GATEWAY_H
@@ -0,0 +1,172 @@
+/**
+ * @file bb_packet.h
+ * @brief Tramas ESP-NOW de Blue Brain: cabecera, CRC16 y fragmentación
+ *
+ * Cada trama cabe en una ESP-NOW (250 B). Little-endian, sin padding:
+ *
+ *   Cabecera (21 B): magic u8 (0xBB) | versión u8 | tipo u8 | flags u8 |
+ *     mac[6] (emisor) | packet_id u32 | timestamp_ms u32 (desde el
+ *     arranque) | frag_index u8 | frag_count u8 | longitud u8
+ *   Datos (0..BB_PKT_FRAG_PAYLOAD B): trozo frag_index del mensaje
+ *   CRC16 u16: CRC-16/CCITT-FALSE de cabecera + datos
+ *
+ * Un mensaje mayor que BB_PKT_FRAG_PAYLOAD se parte en frag_count tramas
+ * con el mismo packet_id; todas menos la última van llenas, así que el
+ * receptor coloca cada trozo por su índice sin más información. El
+ * reensamblador admite fragmentos en cualquier orden y repetidos, y
+ * descarta el mensaje incompleto a los BB_ESPNOW_REASM_TIMEOUT_MS.
+ *
+ * Tipos: BB_PKT_TELEMETRY lleva el reporte en binario versionado
+ * (bb_telemetry_encode, tools/bb_telemetry_decode.py), el mismo que MQTT.
+ * BB_PKT_BEACON (broadcast, un fragmento) es la baliza de bb_sync.h; su
+ * packet_id es la seq de la baliza, aparte de la numeración de reportes.
+ *
+ * Envío (bb_packet_tx_t): un fragmento en vuelo. El callback de envío de
+ * ESP-NOW trae el ACK de capa MAC (unicast) y decide: siguiente fragmento,
+ * reintento tras BB_ESPNOW_BACKOFF_MS·2^(intento-1) o mensaje fallido
+ * tras BB_ESPNOW_RETRIES intentos. En broadcast no hay ACK.
+ *
+ * Lógica pura (sin esp_now ni FreeRTOS): se prueba en el host.
+ */
+
+#ifndef BB_PACKET_H
+#define BB_PACKET_H
+
+#include "bb_config.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_PKT_MAGIC 0xBB
+#define BB_PKT_VERSION 1
+#define BB_PKT_HEADER_BYTES 21
+#define BB_PKT_CRC_BYTES 2
+#define BB_PKT_FRAME_MAX 250    // ESP_NOW_MAX_DATA_LEN
+#define BB_PKT_FRAG_PAYLOAD 227 // Trama - cabecera - CRC
+#define BB_PKT_MAX_FRAGS 16     // Bitmap u16 del reensamblador
+#define BB_PKT_MSG_MAX (BB_PKT_MAX_FRAGS * BB_PKT_FRAG_PAYLOAD) // 3632 B
+
+// Tipos de mensaje
+#define BB_PKT_TELEMETRY 0x01 // Reporte (bb_telemetry_encode)
+#define BB_PKT_BEACON 0x02    // Baliza de la línea común (bb_sync.h)
+
+typedef struct {
+  uint8_t type;
+  uint8_t flags; // Reservado (0)
+  uint8_t mac[6];
+  uint32_t packet_id;
+  uint32_t timestamp_ms;
+  uint8_t frag_index;
+  uint8_t frag_count;
+} bb_packet_hdr_t;
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poli 0x1021, inicial 0xFFFF)
+ */
+uint16_t bb_packet_crc16(const uint8_t *data, size_t len);
+
+/**
+ * @brief Fragmentos que necesita un mensaje
+ * @return 1..BB_PKT_MAX_FRAGS, o 0 si no cabe
+ */
+uint8_t bb_packet_frag_count(size_t msg_len);
+
+/**
+ * @brief Codifica la trama del fragmento h->frag_index del mensaje
+ * (h->frag_count debe ser bb_packet_frag_count(msg_len))
+ * @return Bytes de la trama, o 0 si los argumentos no son válidos
+ */
+size_t bb_packet_encode(const bb_packet_hdr_t *h, const uint8_t *msg,
+                        size_t msg_len, uint8_t *frame, size_t cap);
+
+/**
+ * @brief Valida una trama recibida y extrae cabecera y datos
+ * @param payload Apunta dentro de frame
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE, ESP_ERR_INVALID_VERSION (magic o
+ * versión) o ESP_ERR_INVALID_CRC
+ */
+esp_err_t bb_packet_decode(const uint8_t *frame, size_t len,
+                           bb_packet_hdr_t *h, const uint8_t **payload,
+                           size_t *payload_len);
+
+// --- Reensamblado (receptor) ---
+
+typedef struct {
+  bool used;
+  uint8_t mac[6];
+  uint32_t packet_id;
+  uint8_t frag_count;
+  uint16_t got;    // Bitmap de fragmentos recibidos
+  size_t last_len; // Longitud del último fragmento
+  int64_t t_first_us;
+  uint8_t buf[BB_PKT_MSG_MAX];
+} bb_packet_slot_t;
+
+typedef struct {
+  bb_packet_slot_t slots[BB_ESPNOW_REASM_SLOTS];
+  uint32_t completed;
+  uint32_t expired; // Incompletos descartados (plazo o falta de hueco)
+  uint32_t dup_frags;
+} bb_packet_reasm_t;
+
+void bb_packet_reasm_init(bb_packet_reasm_t *r);
+
+/**
+ * @brief Añade un fragmento decodificado
+ * @param msg Con true, el mensaje completo (válido hasta la siguiente
+ * llamada; un mensaje de un fragmento apunta a payload)
+ * @return true si el mensaje está completo
+ */
+bool bb_packet_reasm_add(bb_packet_reasm_t *r, const bb_packet_hdr_t *h,
+                         const uint8_t *payload, size_t payload_len,
+                         int64_t now_us, const uint8_t **msg,
+                         size_t *msg_len);
+
+// --- Envío con reintentos (emisor) ---
+
+typedef enum {
+  BB_PKT_TX_SEND,   // Enviar bb_packet_tx_frame() tras delay_us
+  BB_PKT_TX_DONE,   // Mensaje entregado (o emitido, en broadcast)
+  BB_PKT_TX_FAILED, // Un fragmento agotó los intentos: mensaje perdido
+} bb_packet_tx_action_t;
+
+typedef struct {
+  bb_packet_hdr_t hdr;
+  uint8_t msg[BB_PKT_MSG_MAX];
+  size_t len;
+  uint8_t attempt; // Intentos del fragmento en curso
+  bool busy;
+
+  // Contadores desde el arranque
+  uint32_t messages;
+  uint32_t frames;
+  uint32_t retries;
+  uint32_t failed;
+} bb_packet_tx_t;
+
+void bb_packet_tx_init(bb_packet_tx_t *tx);
+
+/**
+ * @brief Copia el mensaje y prepara el primer fragmento
+ * (h->frag_index y h->frag_count se calculan aquí)
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (otro mensaje en vuelo) o
+ * ESP_ERR_INVALID_SIZE
+ */
+esp_err_t bb_packet_tx_start(bb_packet_tx_t *tx, const bb_packet_hdr_t *h,
+                             const uint8_t *msg, size_t len);
+
+/**
+ * @brief Trama del fragmento en curso (cap >= BB_PKT_FRAME_MAX)
+ */
+size_t bb_packet_tx_frame(const bb_packet_tx_t *tx, uint8_t *frame,
+                          size_t cap);
+
+/**
+ * @brief Resultado del envío del fragmento en curso (callback de ESP-NOW,
+ * o false si esp_now_send() falló)
+ */
+bb_packet_tx_action_t bb_packet_tx_result(bb_packet_tx_t *tx, bool ok,
+                                          int64_t *delay_us);
+
+#endif // BB_PACKET_H
@@ -0,0 +1,131 @@
+/**
+ * @file bb_sync.h
+ * @brief Línea de tiempo común entre nodos por balizas ESP-NOW
+ *
+ * El maestro (gateway u otro nodo, espnow_sync = 2) emite cada
+ * BB_SYNC_BEACON_MS una baliza broadcast BB_PKT_BEACON. La línea común es
+ * su esp_timer. En dos pasos, como PTP: cada baliza lleva la hora exacta a
+ * la que salió la anterior (callback de envío), así la cola del driver y la
+ * espera del canal no cuentan. Cada seguidor marca la llegada con su
+ * esp_timer en el callback de recepción y forma pares
+ *
+ *   (llegada local, salida en el maestro) -> offset = maestro - local
+ *
+ * El retardo aéreo solo puede sumar: de cada BB_SYNC_BLOCK balizas vale la
+ * de mayor offset (menor retardo). Sobre los últimos BB_SYNC_FIT_POINTS
+ * puntos así filtrados, una recta por mínimos cuadrados da offset y
+ * deriva del cristal:
+ *
+ *   maestro = local + offset + (local - ref_local) · deriva
+ *
+ * Un punto a más de BB_SYNC_STEP_US de la recta se ignora (retardo raro);
+ * BB_SYNC_BLOCK seguidos son un salto del maestro y la estimación empieza
+ * de nuevo, igual que con otro maestro (MAC) o si reinicia (boot de la
+ * baliza). Sin balizas la recta sigue valiendo BB_SYNC_HOLDOVER_MS.
+ *
+ * Lo que queda de retardo mínimo (~cientos de µs, casi igual en todos los
+ * seguidores) es un desfase común: entre seguidores se cancela.
+ *
+ * Baliza (datos de la trama, 16 B, little-endian): seq u32 | boot u32
+ * (aleatorio por arranque del maestro) | prev_tx_us i64 (esp_timer del
+ * maestro al salir la baliza seq - 1; 0 = desconocido)
+ *
+ * Lógica pura (sin esp_now ni FreeRTOS): el llamador serializa el acceso.
+ */
+
+#ifndef BB_SYNC_H
+#define BB_SYNC_H
+
+#include "bb_config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Papel del nodo (bb_config_t.espnow_sync)
+#define BB_SYNC_OFF 0
+#define BB_SYNC_FOLLOWER 1
+#define BB_SYNC_MASTER 2
+
+#define BB_SYNC_BEACON_BYTES 16
+
+typedef struct {
+  uint32_t seq;
+  uint32_t boot;
+  int64_t prev_tx_us;
+} bb_sync_beacon_t;
+
+typedef struct {
+  int64_t local_us;  // Llegada de la baliza (esp_timer del seguidor)
+  int64_t offset_us; // Salida en el maestro - llegada
+} bb_sync_point_t;
+
+typedef struct {
+  // Maestro seguido
+  bool has_master;
+  uint8_t master_mac[6];
+  uint32_t master_boot;
+
+  // Bloque en curso: la baliza de menor retardo
+  bb_sync_point_t best;
+  int block_n;
+
+  // Puntos filtrados (ring) y recta ajustada
+  bb_sync_point_t pts[BB_SYNC_FIT_POINTS];
+  int n_pts;
+  int head;
+  bool locked;          // Recta con deriva (3 puntos o más)
+  int64_t ref_local_us; // Centro de la recta...
+  int64_t ref_offset_us;
+  int32_t drift_ppb; // ...y pendiente (+ = el local atrasa)
+  uint32_t err_us;   // RMS de los puntos frente a la recta
+  int64_t last_local_us;
+  int outliers_run; // Puntos seguidos lejos de la recta
+
+  // Contadores desde el arranque
+  uint32_t samples;
+  uint32_t outliers;
+  uint32_t resets; // Maestro nuevo, reiniciado o con salto
+} bb_sync_t;
+
+void bb_sync_init(bb_sync_t *s);
+
+/**
+ * @brief Maestro de la baliza recibida: si es otro, o el mismo con otro
+ * boot, la recta se borra en el acto (sus instantes ya no valen)
+ */
+void bb_sync_master(bb_sync_t *s, const uint8_t mac[6], uint32_t boot);
+
+/**
+ * @brief Añade un par (llegada local, salida en el maestro)
+ * @return true si la recta se ha recalculado
+ */
+bool bb_sync_sample(bb_sync_t *s, const uint8_t mac[6], uint32_t boot,
+                    int64_t local_us, int64_t master_us);
+
+/**
+ * @brief Instante local -> línea común
+ * @return false sin recta o sin balizas desde hace BB_SYNC_HOLDOVER_MS
+ */
+bool bb_sync_to_master(const bb_sync_t *s, int64_t local_us,
+                       int64_t *master_us);
+
+/**
+ * @brief Línea común -> instante local (inversa de bb_sync_to_master)
+ */
+bool bb_sync_to_local(const bb_sync_t *s, int64_t master_us,
+                      int64_t *local_us);
+
+/**
+ * @brief Primer múltiplo de period_us de la línea común que cae al menos
+ * lead_us después de now_us, en hora local
+ */
+bool bb_sync_next_slot(const bb_sync_t *s, int64_t now_us, int64_t period_us,
+                       int64_t lead_us, int64_t *local_us);
+
+size_t bb_sync_beacon_encode(const bb_sync_beacon_t *b, uint8_t *buf,
+                             size_t cap);
+
+bool bb_sync_beacon_decode(const uint8_t *buf, size_t len,
+                           bb_sync_beacon_t *b);
+
+#endif // BB_SYNC_H
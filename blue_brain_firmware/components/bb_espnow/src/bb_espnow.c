@@ -1,32 +1,401 @@
 #include "bb_espnow.h"
 #include "bb_config.h"
+#include "bb_gateway.h"
+#include "bb_packet.h"
+#include "bb_remote.h"
+#include "bb_ring.h"
+#include "bb_sync.h"
+#include "bb_telemetry_codec.h"
 #include "esp_log.h"
 #include "esp_now.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "BB_ESPNOW";
 
-// Callback when data is sent
-static void on_data_sent(const uint8_t *mac_addr,
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// --- Envío en curso ---
+// Task_Comms arranca el mensaje; el callback de envío (tarea WiFi) decide
+// y el temporizador manda el siguiente fragmento o el reintento
+static bb_packet_tx_t s_tx;
+static uint8_t s_dest[6];
+static uint8_t s_own_mac[6];
+static uint32_t s_packet_id;
+static uint32_t s_busy; // Mensajes descartados con otro aún en vuelo
+static portMUX_TYPE s_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_tx_timer;
+
+// --- Caché de peers ---
+// esp_now_add_peer() solo en un fallo de caché; el más antiguo sale
+static uint8_t s_peers[BB_ESPNOW_PEER_CACHE][6];
+static int s_peer_count;
+static int s_peer_next;
+
+static esp_err_t peer_ensure(const uint8_t *mac) {
+  if (memcmp(mac, BROADCAST_MAC, 6) == 0)
+    return ESP_OK; // Registrado en bb_espnow_init()
+  for (int i = 0; i < s_peer_count; i++)
+    if (memcmp(s_peers[i], mac, 6) == 0)
+      return ESP_OK;
+
+  uint8_t *slot;
+  if (s_peer_count < BB_ESPNOW_PEER_CACHE) {
+    slot = s_peers[s_peer_count++];
+  } else {
+    slot = s_peers[s_peer_next];
+    s_peer_next = (s_peer_next + 1) % BB_ESPNOW_PEER_CACHE;
+    esp_now_del_peer(slot);
+  }
+
+  esp_now_peer_info_t peer = {0};
+  memcpy(peer.peer_addr, mac, 6);
+  peer.channel = 0;         // Canal actual
+  peer.ifidx = WIFI_IF_STA; // Interfaz de envío
+  peer.encrypt = false;     // Sin cifrado (malla abierta/broadcast)
+  esp_err_t ret = esp_now_add_peer(&peer);
+  if (ret == ESP_ERR_ESPNOW_EXIST)
+    ret = ESP_OK;
+  if (ret != ESP_OK) {
+    memset(slot, 0, 6); // Que no se tome por registrado
+    return ret;
+  }
+  memcpy(slot, mac, 6);
+  return ESP_OK;
+}
+
+// Un solo envío en vuelo entre fragmentos y balizas: así el callback de
+// envío sabe de cuál es (la hora de salida de una baliza viaja en la
+// siguiente). Un fragmento espera al callback de la baliza; una baliza con
+// un fragmento en vuelo no sale (la siguiente empareja igual).
+typedef enum { TX_IDLE, TX_TELEMETRY, TX_BEACON } tx_kind_t;
+
+static tx_kind_t s_inflight; // Bajo s_tx_lock, como el siguiente
+static bool s_tlm_waiting;   // Fragmento retenido por una baliza
+
+// Balizas del maestro (bb_sync.h): numeración, arranque y hora de salida
+// de la anterior, también bajo s_tx_lock
+static uint8_t s_sync_role = BB_SYNC_OFF;
+static esp_timer_handle_t s_beacon_timer;
+static uint32_t s_beacon_seq;
+static uint32_t s_beacon_boot; // Aleatorio: distingue cada arranque
+static int64_t s_beacon_tx_us; // Salida de la baliza anterior (0 = no)
+
+static void tx_send_current(void);
+
+// Aplica el resultado del fragmento en curso y programa lo siguiente
+static void tx_feed(bool ok) {
+  int64_t delay_us;
+  portENTER_CRITICAL(&s_tx_lock);
+  bb_packet_tx_action_t act = bb_packet_tx_result(&s_tx, ok, &delay_us);
+  uint32_t id = s_tx.hdr.packet_id;
+  portEXIT_CRITICAL(&s_tx_lock);
+
+  if (act == BB_PKT_TX_SEND)
+    esp_timer_start_once(s_tx_timer, delay_us);
+  else if (act == BB_PKT_TX_FAILED)
+    ESP_LOGD(TAG, "Mensaje %lu perdido tras %d intentos", (unsigned long)id,
+             BB_ESPNOW_RETRIES);
+}
+
+static void tx_send_current(void) {
+  uint8_t frame[BB_PKT_FRAME_MAX];
+  uint8_t dest[6];
+  portENTER_CRITICAL(&s_tx_lock);
+  if (s_inflight == TX_BEACON) {
+    s_tlm_waiting = true; // Sale en el callback de la baliza
+    portEXIT_CRITICAL(&s_tx_lock);
+    return;
+  }
+  size_t len = bb_packet_tx_frame(&s_tx, frame, sizeof(frame));
+  memcpy(dest, s_dest, 6);
+  if (len != 0)
+    s_inflight = TX_TELEMETRY;
+  portEXIT_CRITICAL(&s_tx_lock);
+  if (len == 0)
+    return;
+
+  // Cola del driver llena o peer borrado: cuenta como intento fallido
+  if (esp_now_send(dest, frame, len) != ESP_OK) {
+    portENTER_CRITICAL(&s_tx_lock);
+    s_inflight = TX_IDLE;
+    portEXIT_CRITICAL(&s_tx_lock);
+    tx_feed(false);
+  }
+}
+
+static void tx_timer_cb(void *arg) { tx_send_current(); }
+
+// ACK de capa MAC del último fragmento (en broadcast siempre éxito), o
+// salida de la baliza
+static void on_data_sent(const esp_now_send_info_t *tx_info,
                          esp_now_send_status_t status) {
-  // Keep it quiet to avoid flooding logs on high frequency
-  // ESP_LOGD(TAG, "Packet sent to "MACSTR", status: %d", MAC2STR(mac_addr),
-  // status);
+  int64_t now_us = esp_timer_get_time(); // Lo primero: hora de la baliza
+  portENTER_CRITICAL(&s_tx_lock);
+  tx_kind_t kind = s_inflight;
+  s_inflight = TX_IDLE;
+  bool tlm = s_tlm_waiting;
+  s_tlm_waiting = false;
+  if (kind == TX_BEACON)
+    s_beacon_tx_us = now_us;
+  portEXIT_CRITICAL(&s_tx_lock);
+
+  if (kind == TX_TELEMETRY)
+    tx_feed(status == ESP_NOW_SEND_SUCCESS);
+  else if (tlm)
+    esp_timer_start_once(s_tx_timer, 0); // El fragmento retenido
 }
 
-static esp_err_t add_peer(const uint8_t *mac_addr) {
-  if (esp_now_is_peer_exist(mac_addr)) {
-    return ESP_OK;
+// --- Línea de tiempo común (bb_sync.h) ---
+// Maestro: baliza broadcast cada BB_SYNC_BEACON_MS desde un esp_timer.
+// Seguidor: el callback de recepción marca la llegada y alimenta el
+// estimador; las tareas leen una copia bajo s_sync_lock.
+static bb_sync_t s_sync;      // Copia publicada (s_sync_lock)
+static bb_sync_t s_sync_work; // Solo la tarea WiFi
+static portMUX_TYPE s_sync_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_rx_valid; // Llegada de la última baliza (tarea WiFi)
+static uint32_t s_rx_boot;
+static uint32_t s_rx_seq;
+static int64_t s_rx_us;
+
+static void beacon_send(void) {
+  portENTER_CRITICAL(&s_tx_lock);
+  if (s_inflight != TX_IDLE) {
+    portEXIT_CRITICAL(&s_tx_lock);
+    return; // Fragmento en vuelo: esta baliza no sale
   }
+  s_inflight = TX_BEACON;
+  bb_sync_beacon_t b = {
+      .seq = s_beacon_seq++,
+      .boot = s_beacon_boot,
+      .prev_tx_us = s_beacon_tx_us,
+  };
+  s_beacon_tx_us = 0; // La de ésta llega en su callback
+  portEXIT_CRITICAL(&s_tx_lock);
 
-  esp_now_peer_info_t peer = {0};
-  memcpy(peer.peer_addr, mac_addr, 6);
-  peer.channel = 0;         // Use current channel
-  peer.ifidx = WIFI_IF_STA; // Send interface
-  peer.encrypt = false;     // No encryption for open mesh/broadcast
+  // packet_id propio (la seq): no abre huecos en la numeración de reportes
+  // que vigila el gateway
+  uint8_t msg[BB_SYNC_BEACON_BYTES];
+  uint8_t frame[BB_PKT_FRAME_MAX];
+  bb_packet_hdr_t hdr = {
+      .type = BB_PKT_BEACON,
+      .packet_id = b.seq,
+      .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+      .frag_count = 1,
+  };
+  memcpy(hdr.mac, s_own_mac, 6);
+  size_t len = bb_sync_beacon_encode(&b, msg, sizeof(msg));
+  len = bb_packet_encode(&hdr, msg, len, frame, sizeof(frame));
+  if (len != 0 && esp_now_send(BROADCAST_MAC, frame, len) == ESP_OK)
+    return;
 
-  return esp_now_add_peer(&peer);
+  portENTER_CRITICAL(&s_tx_lock);
+  s_inflight = TX_IDLE;
+  bool tlm = s_tlm_waiting;
+  s_tlm_waiting = false;
+  portEXIT_CRITICAL(&s_tx_lock);
+  if (tlm)
+    tx_send_current();
+}
+
+static void beacon_timer_cb(void *arg) { beacon_send(); }
+
+// Seguidor (tarea WiFi): la baliza seq trae la salida de la seq - 1, que
+// se empareja con su llegada
+static void sync_on_beacon(const uint8_t *data, int len, int64_t rx_us) {
+  bb_packet_hdr_t h;
+  const uint8_t *payload;
+  size_t payload_len;
+  bb_sync_beacon_t b;
+  if (bb_packet_decode(data, len, &h, &payload, &payload_len) != ESP_OK ||
+      h.type != BB_PKT_BEACON ||
+      !bb_sync_beacon_decode(payload, payload_len, &b))
+    return;
+
+  bb_sync_master(&s_sync_work, h.mac, b.boot);
+  if (s_rx_valid && b.prev_tx_us != 0 && b.boot == s_rx_boot &&
+      b.seq == s_rx_seq + 1)
+    bb_sync_sample(&s_sync_work, h.mac, b.boot, s_rx_us, b.prev_tx_us);
+  s_rx_valid = true;
+  s_rx_boot = b.boot;
+  s_rx_seq = b.seq;
+  s_rx_us = rx_us;
+
+  portENTER_CRITICAL(&s_sync_lock);
+  s_sync = s_sync_work;
+  portEXIT_CRITICAL(&s_sync_lock);
+}
+
+bool bb_espnow_sync_time(int64_t local_us, int64_t *shared_us,
+                         uint16_t *err_us) {
+  if (s_sync_role == BB_SYNC_MASTER) {
+    *shared_us = local_us; // La línea común es este reloj
+    if (err_us)
+      *err_us = 0;
+    return true;
+  }
+  if (s_sync_role != BB_SYNC_FOLLOWER)
+    return false;
+  portENTER_CRITICAL(&s_sync_lock);
+  bool ok = bb_sync_to_master(&s_sync, local_us, shared_us);
+  uint32_t err = s_sync.err_us;
+  portEXIT_CRITICAL(&s_sync_lock);
+  if (err_us)
+    *err_us = (err > UINT16_MAX) ? UINT16_MAX : (uint16_t)err;
+  return ok;
+}
+
+bool bb_espnow_sync_next_slot(int64_t now_us, int64_t period_us,
+                              int64_t lead_us, int64_t *local_us) {
+  if (s_sync_role == BB_SYNC_MASTER) {
+    *local_us = ((now_us + lead_us) / period_us + 1) * period_us;
+    return true;
+  }
+  if (s_sync_role != BB_SYNC_FOLLOWER)
+    return false;
+  portENTER_CRITICAL(&s_sync_lock);
+  bool ok = bb_sync_next_slot(&s_sync, now_us, period_us, lead_us, local_us);
+  portEXIT_CRITICAL(&s_sync_lock);
+  return ok;
+}
+
+uint8_t bb_espnow_sync_get(bb_sync_t *out) {
+  portENTER_CRITICAL(&s_sync_lock);
+  *out = s_sync;
+  portEXIT_CRITICAL(&s_sync_lock);
+  return s_sync_role;
+}
+
+// --- Gateway ---
+// Tarea WiFi (callback de recepción) -> ring SPSC -> Task_Comms, que
+// reensambla, filtra y publica (bb_espnow_gateway_poll). El callback solo
+// copia la trama: nada de locks ni MQTT en la tarea WiFi.
+#define GW_SLOT_BYTES 256 // Longitud u8 + RSSI i8 + trama (<= 250 B)
+
+static bb_gw_t *s_gw; // NULL fuera del modo gateway
+static bb_ring_t s_rx_ring;
+static int64_t s_rx_stamps[BB_GW_RX_RING];
+static int64_t s_gw_next_stats_us;
+
+static void on_data_recv(const esp_now_recv_info_t *info, const uint8_t *data,
+                         int len) {
+  int64_t rx_us = esp_timer_get_time(); // Lo primero: llegada de la baliza
+  if (len <= BB_PKT_HEADER_BYTES || len > BB_PKT_FRAME_MAX ||
+      data[0] != BB_PKT_MAGIC)
+    return;
+  if (data[2] == BB_PKT_BEACON) {
+    if (s_sync_role == BB_SYNC_FOLLOWER)
+      sync_on_beacon(data, len, rx_us);
+    return;
+  }
+  if (!s_gw)
+    return;
+
+  uint8_t *slot = bb_ring_write_acquire(&s_rx_ring);
+  if (!slot) {
+    bb_ring_mark_overrun(&s_rx_ring); // Task_Comms no da abasto
+    return;
+  }
+  slot[0] = (uint8_t)len;
+  slot[1] = (uint8_t)info->rx_ctrl->rssi;
+  memcpy(&slot[2], data, len);
+  bb_ring_write_commit(&s_rx_ring, rx_us);
+
+  // Primera trama pendiente: despertar a Task_Comms (con más, ya lo está)
+  if (bb_ring_available(&s_rx_ring) == 1) {
+    bb_telemetry_t *wake = NULL;
+    xQueueSend(xQueueTelemetry, &wake, 0);
+  }
+}
+
+static esp_err_t gateway_start(void) {
+  uint8_t *storage = malloc(GW_SLOT_BYTES * BB_GW_RX_RING);
+  bb_gw_t *gw = malloc(sizeof(bb_gw_t));
+  if (!storage || !gw) {
+    free(storage);
+    free(gw);
+    return ESP_ERR_NO_MEM;
+  }
+  bb_gw_init(gw);
+  bb_ring_init(&s_rx_ring, storage, s_rx_stamps, GW_SLOT_BYTES,
+               BB_GW_RX_RING);
+  s_gw = gw;
+  s_gw_next_stats_us = esp_timer_get_time() + BB_GW_STATS_MS * 1000LL;
+  ESP_LOGI(TAG, "Gateway activo: %d nodos, %d mensajes en espera (%u B)",
+           BB_GW_MAX_NODES, BB_GW_POOL_MSGS, (unsigned)sizeof(bb_gw_t));
+  return ESP_OK;
+}
+
+// Enlace de cada nodo (retenido) y resumen del gateway
+static void gateway_publish_stats(esp_mqtt_client_handle_t client,
+                                  int64_t now_us) {
+  char topic[80];
+  char json[320];
+  char id[13];
+  for (int i = 0; i < BB_GW_MAX_NODES; i++) {
+    if (!s_gw->nodes[i].used)
+      continue;
+    bb_gw_node_id(&s_gw->nodes[i], id, sizeof(id));
+    snprintf(topic, sizeof(topic), "%s/%s/link", BB_MQTT_TOPIC_NODE, id);
+    size_t len = bb_gw_node_json(s_gw, i, now_us, json, sizeof(json));
+    esp_mqtt_client_enqueue(client, topic, json, len, 0, 1, true);
+  }
+
+  size_t len = bb_gw_summary_json(s_gw, json, sizeof(json));
+  snprintf(topic, sizeof(topic), "%s/%s/gateway", BB_MQTT_TOPIC_NODE,
+           bb_remote_node_id());
+  esp_mqtt_client_enqueue(client, topic, json, len, 0, 1, true);
+  ESP_LOGI(TAG, "Gateway: %s (ring lleno %lu)", json,
+           (unsigned long)bb_ring_overruns(&s_rx_ring));
+}
+
+int64_t bb_espnow_gateway_poll(esp_mqtt_client_handle_t client, bool online,
+                               int64_t now_us, int batch_size,
+                               int64_t max_age_us) {
+  if (!s_gw)
+    return INT64_MAX;
+
+  uint8_t slot[GW_SLOT_BYTES];
+  int64_t stamp;
+  while (bb_ring_read_frame(&s_rx_ring, slot, 1, &stamp))
+    bb_gw_rx(s_gw, &slot[2], slot[0], (int8_t)slot[1], stamp);
+
+  // Sin broker los lotes esperan; la vuelta del broker despierta la tarea
+  if (!online)
+    return INT64_MAX;
+
+  static uint8_t buf[BB_MQTT_BATCH_BYTES];
+  char topic[80];
+  char id[13];
+  int node;
+  while ((node = bb_gw_ready(s_gw, now_us, batch_size, max_age_us)) >= 0) {
+    int count;
+    size_t len = bb_gw_encode_batch(s_gw, node, buf, sizeof(buf), &count);
+    if (len == 0)
+      break;
+    bb_gw_node_id(&s_gw->nodes[node], id, sizeof(id));
+    snprintf(topic, sizeof(topic), "%s/%s/telemetry/bin", BB_MQTT_TOPIC_NODE,
+             id);
+    if (esp_mqtt_client_publish(client, topic, (const char *)buf, len, 1,
+                                0) < 0)
+      return BB_BACKLOG_REPLAY_MS * 1000LL; // El lote espera: reintentar
+    bb_gw_release(s_gw, node, count);
+  }
+
+  if (now_us >= s_gw_next_stats_us) {
+    gateway_publish_stats(client, now_us);
+    s_gw_next_stats_us = now_us + BB_GW_STATS_MS * 1000LL;
+  }
+
+  int64_t in_us = bb_gw_next_due_us(s_gw, now_us, max_age_us);
+  if (s_gw_next_stats_us - now_us < in_us)
+    in_us = s_gw_next_stats_us - now_us;
+  return in_us;
 }
 
 esp_err_t bb_espnow_init(void) {
@@ -38,13 +407,51 @@ esp_err_t bb_espnow_init(void) {
     return ret;
   }
 
-  esp_now_register_send_cb((esp_now_send_cb_t)on_data_sent);
+  const esp_timer_create_args_t timer_args = {.callback = tx_timer_cb,
+                                              .name = "espnow_tx"};
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_tx_timer));
+  bb_packet_tx_init(&s_tx);
+  esp_wifi_get_mac(WIFI_IF_STA, s_own_mac);
+  // Tras un reinicio los ids no repiten los del arranque anterior
+  s_packet_id = esp_random();
+
+  esp_now_register_send_cb(on_data_sent);
 
   // Add Broadcast Peer by default
-  uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-  add_peer(broadcast_mac);
+  esp_now_peer_info_t peer = {0};
+  memcpy(peer.peer_addr, BROADCAST_MAC, 6);
+  peer.ifidx = WIFI_IF_STA;
+  ret = esp_now_add_peer(&peer);
+  if (ret != ESP_OK && ret != ESP_ERR_ESPNOW_EXIST)
+    ESP_LOGE(TAG, "Peer broadcast: %s", esp_err_to_name(ret));
 
   ESP_LOGI(TAG, "ESP-NOW Initialized (Broadcast Peer Added)");
+
+  if (bb_config_get()->espnow_gateway) {
+    ret = gateway_start();
+    if (ret != ESP_OK)
+      ESP_LOGE(TAG, "Gateway sin memoria: solo emisor");
+  }
+
+  s_sync_role = bb_config_get()->espnow_sync;
+  if (s_sync_role == BB_SYNC_MASTER) {
+    const esp_timer_create_args_t beacon_args = {.callback = beacon_timer_cb,
+                                                 .name = "espnow_beacon"};
+    ESP_ERROR_CHECK(esp_timer_create(&beacon_args, &s_beacon_timer));
+    s_beacon_boot = esp_random();
+    esp_timer_start_periodic(s_beacon_timer, BB_SYNC_BEACON_MS * 1000LL);
+    ESP_LOGI(TAG, "Línea común: maestro (baliza cada %d ms)",
+             BB_SYNC_BEACON_MS);
+  } else if (s_sync_role == BB_SYNC_FOLLOWER) {
+    bb_sync_init(&s_sync);
+    bb_sync_init(&s_sync_work);
+    ESP_LOGI(TAG, "Línea común: siguiendo las balizas del maestro");
+  } else {
+    s_sync_role = BB_SYNC_OFF;
+  }
+
+  if (s_gw || s_sync_role == BB_SYNC_FOLLOWER)
+    esp_now_register_recv_cb(on_data_recv);
   return ESP_OK;
 }
 
@@ -55,25 +462,60 @@ esp_err_t bb_espnow_send(const bb_telemetry_t *data) {
     return ESP_OK; // Disabled by user
   }
 
-  // Determine target MAC
-  const uint8_t *dest_mac = cfg->espnow_dest_mac;
+  // Solo Task_Comms envía: el buffer de codificación puede ser estático
+  static uint8_t msg[BB_TLM_MAX_BYTES];
+  size_t len = bb_telemetry_encode(data, msg, sizeof(msg));
+  if (len == 0)
+    return ESP_ERR_INVALID_SIZE;
 
-  // Check if it's a valid unicast/multicast address different from Broadcast
-  // For simplicity, if user set specific MAC, we try to ensure it's added.
-  // If dest_mac is FF:FF... it is already added.
+  esp_err_t ret = peer_ensure(cfg->espnow_dest_mac);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Peer " MACSTR ": %s", MAC2STR(cfg->espnow_dest_mac),
+             esp_err_to_name(ret));
+    return ret;
+  }
 
-  // Note: cfg->espnow_dest_mac is 0xFF by default in my bb_config.c logic?
-  // Let's check bb_config.c defaults.
-  // Yes: memset(cfg->espnow_dest_mac, 0xFF, 6);
+  bb_packet_hdr_t hdr = {
+      .type = BB_PKT_TELEMETRY,
+      .timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000),
+  };
+  memcpy(hdr.mac, s_own_mac, 6);
+
+  portENTER_CRITICAL(&s_tx_lock);
+  hdr.packet_id = s_packet_id;
+  ret = bb_packet_tx_start(&s_tx, &hdr, msg, len);
+  if (ret == ESP_OK) {
+    s_packet_id++;
+    memcpy(s_dest, cfg->espnow_dest_mac, 6);
+  } else if (ret == ESP_ERR_INVALID_STATE) {
+    s_busy++; // El anterior sigue reintentando: este no espera
+  }
+  uint32_t messages = s_tx.messages;
+  portEXIT_CRITICAL(&s_tx_lock);
+  if (ret != ESP_OK)
+    return ret;
 
-  // Ensure peer exists (idempotent)
-  add_peer(dest_mac);
+  tx_send_current();
 
-  // Send
-  esp_err_t ret =
-      esp_now_send(dest_mac, (uint8_t *)data, sizeof(bb_telemetry_t));
-  if (ret != ESP_OK) {
-    // ESP_LOGW(TAG, "Send Error: %s", esp_err_to_name(ret));
+  if (messages % BB_ESPNOW_STATS_EVERY_N == 0) {
+    bb_espnow_stats_t st;
+    bb_espnow_get_stats(&st);
+    ESP_LOGI(TAG,
+             "Envíos: %lu mensajes, %lu tramas, %lu reintentos, %lu perdidos, "
+             "%lu descartados",
+             (unsigned long)st.messages, (unsigned long)st.frames,
+             (unsigned long)st.retries, (unsigned long)st.failed,
+             (unsigned long)st.busy);
   }
-  return ret;
+  return ESP_OK;
+}
+
+void bb_espnow_get_stats(bb_espnow_stats_t *out) {
+  portENTER_CRITICAL(&s_tx_lock);
+  out->messages = s_tx.messages;
+  out->frames = s_tx.frames;
+  out->retries = s_tx.retries;
+  out->failed = s_tx.failed;
+  out->busy = s_busy;
+  portEXIT_CRITICAL(&s_tx_lock);
 }
@@ -0,0 +1,350 @@
+/**
+ * @file bb_gateway.c
+ * @brief Duplicados, orden y lotes por nodo de los mensajes ESP-NOW
+ */
+
+#include "bb_gateway.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RSSI_AVG_DIV 8 // Media exponencial: 1/8 de cada trama nueva
+
+_Static_assert(BB_GW_POOL_MSGS <= INT16_MAX, "Índices del pool en int16_t");
+
+void bb_gw_init(bb_gw_t *g) {
+  memset(g, 0, sizeof(*g));
+  bb_packet_reasm_init(&g->reasm);
+  for (int i = 0; i < BB_GW_POOL_MSGS; i++)
+    g->pool[i].next = (i + 1 < BB_GW_POOL_MSGS) ? i + 1 : -1;
+  g->free_head = 0;
+  g->free_count = BB_GW_POOL_MSGS;
+}
+
+// --- Tabla de nodos ---
+
+static void node_reset(bb_gw_node_t *n, const uint8_t *mac, int64_t now_us) {
+  *n = (bb_gw_node_t){0};
+  n->used = true;
+  memcpy(n->mac, mac, 6);
+  n->batch_head = -1;
+  n->last_seen_us = now_us;
+}
+
+// Nodo de la MAC; si es nuevo ocupa un hueco libre o el del nodo más
+// callado sin lote pendiente (BB_GW_NODE_IDLE_MS sin tramas)
+static bb_gw_node_t *node_for(bb_gw_t *g, const uint8_t *mac,
+                              int64_t now_us) {
+  bb_gw_node_t *free_node = NULL, *idle = NULL;
+  for (int i = 0; i < BB_GW_MAX_NODES; i++) {
+    bb_gw_node_t *n = &g->nodes[i];
+    if (!n->used) {
+      if (!free_node)
+        free_node = n;
+      continue;
+    }
+    if (memcmp(n->mac, mac, 6) == 0)
+      return n;
+    if (n->batch_count == 0 &&
+        now_us - n->last_seen_us > BB_GW_NODE_IDLE_MS * 1000LL &&
+        (!idle || n->last_seen_us < idle->last_seen_us))
+      idle = n;
+  }
+
+  bb_gw_node_t *n = free_node ? free_node : idle;
+  if (!n)
+    return NULL;
+  node_reset(n, mac, now_us);
+  return n;
+}
+
+// --- Ventana de packet_id ---
+
+typedef enum {
+  SEQ_NEW,   // Siguiente o posterior (puede haber hueco)
+  SEQ_LATE,  // Atrasado pero no visto: se acepta
+  SEQ_DUP,   // Ya recibido
+  SEQ_STALE, // Más viejo que la ventana: no se sabe si es repetido
+} seq_result_t;
+
+static uint64_t valid_mask(uint8_t span) {
+  return (span >= 64) ? UINT64_MAX : (1ULL << span) - 1;
+}
+
+// packet_id de la ventana que todavía no han llegado
+static uint32_t window_holes(const bb_gw_node_t *n) {
+  uint64_t missing = ~n->window & valid_mask(n->span);
+  return (uint32_t)__builtin_popcountll(missing);
+}
+
+static void seq_start(bb_gw_node_t *n, uint32_t id) {
+  n->seq_valid = true;
+  n->hi_id = id;
+  n->window = 1;
+  n->span = 1;
+}
+
+// Ya aceptado: los fragmentos repetidos no abren otro reensamblado
+static bool seq_seen(const bb_gw_node_t *n, uint32_t id) {
+  if (!n->seq_valid)
+    return false;
+  int32_t d = (int32_t)(id - n->hi_id);
+  if (d > 0 || d <= -BB_GW_SEQ_WINDOW || (uint32_t)-d >= n->span)
+    return false;
+  return (n->window >> (uint32_t)-d) & 1;
+}
+
+static seq_result_t seq_accept(bb_gw_node_t *n, uint32_t id) {
+  if (!n->seq_valid) {
+    seq_start(n, id);
+    return SEQ_NEW;
+  }
+
+  int32_t d = (int32_t)(id - n->hi_id);
+  if (d > BB_GW_RESTART_GAP || d < -BB_GW_RESTART_GAP) {
+    // Reinicio del nodo: lo que faltaba de la sesión anterior ya no llega
+    n->lost += window_holes(n);
+    n->restarts++;
+    seq_start(n, id);
+    return SEQ_NEW;
+  }
+
+  if (d > 0) {
+    // Las posiciones que salen por arriba sin recibir son pérdidas
+    uint64_t out = (d >= 64) ? valid_mask(n->span)
+                             : valid_mask(n->span) & ~(UINT64_MAX >> d);
+    n->lost += (uint32_t)__builtin_popcountll(~n->window & out);
+    if (d > 64)
+      n->lost += (uint32_t)(d - 64); // Ni siquiera entraron en la ventana
+    n->window = (d >= 64) ? 1 : (n->window << d) | 1;
+    n->span = (n->span + d >= 64) ? 64 : (uint8_t)(n->span + d);
+    n->hi_id = id;
+    return SEQ_NEW;
+  }
+
+  uint32_t back = (uint32_t)-d;
+  if (back >= BB_GW_SEQ_WINDOW || back >= n->span)
+    return SEQ_STALE;
+  uint64_t bit = 1ULL << back;
+  if (n->window & bit)
+    return SEQ_DUP;
+  n->window |= bit;
+  return SEQ_LATE;
+}
+
+// --- Lotes ---
+
+// Inserta en la lista del nodo ordenada por packet_id (un lote son pocos
+// mensajes: la inserción lineal basta)
+static void batch_insert(bb_gw_t *g, bb_gw_node_t *n, int16_t idx) {
+  uint32_t id = g->pool[idx].packet_id;
+  int16_t *link = &n->batch_head;
+  while (*link >= 0 && (int32_t)(g->pool[*link].packet_id - id) < 0)
+    link = &g->pool[*link].next;
+  g->pool[idx].next = *link;
+  *link = idx;
+}
+
+static bool batch_add(bb_gw_t *g, bb_gw_node_t *n, uint32_t id,
+                      const uint8_t *msg, size_t len, int64_t now_us) {
+  if (g->free_head < 0 || len > BB_GW_MSG_MAX)
+    return false;
+  int16_t idx = g->free_head;
+  bb_gw_msg_t *m = &g->pool[idx];
+  g->free_head = m->next;
+  g->free_count--;
+
+  m->packet_id = id;
+  m->len = (uint16_t)len;
+  memcpy(m->data, msg, len);
+  if (n->batch_count == 0)
+    n->batch_open_us = now_us;
+  batch_insert(g, n, idx);
+  n->batch_count++;
+  return true;
+}
+
+bool bb_gw_rx(bb_gw_t *g, const uint8_t *frame, size_t len, int8_t rssi,
+              int64_t now_us) {
+  g->frames++;
+  bb_packet_hdr_t h;
+  const uint8_t *payload;
+  size_t plen;
+  esp_err_t err = bb_packet_decode(frame, len, &h, &payload, &plen);
+  if (err == ESP_ERR_INVALID_CRC) {
+    g->bad_crc++;
+    return false;
+  }
+  if (err != ESP_OK || h.type != BB_PKT_TELEMETRY) {
+    g->bad_frame++;
+    return false;
+  }
+
+  bb_gw_node_t *n = node_for(g, h.mac, now_us);
+  if (!n) {
+    g->no_node++;
+    return false;
+  }
+  n->frames++;
+  n->last_seen_us = now_us;
+  n->rssi = rssi;
+  if (n->frames == 1)
+    n->rssi_avg_x16 = (int16_t)(rssi * 16);
+  else
+    n->rssi_avg_x16 += (rssi * 16 - n->rssi_avg_x16) / RSSI_AVG_DIV;
+
+  if (seq_seen(n, h.packet_id)) {
+    n->dups++; // Reintento cuyo ACK se perdió
+    return false;
+  }
+
+  const uint8_t *msg;
+  size_t msg_len;
+  if (!bb_packet_reasm_add(&g->reasm, &h, payload, plen, now_us, &msg,
+                           &msg_len))
+    return false;
+
+  switch (seq_accept(n, h.packet_id)) {
+  case SEQ_DUP:
+    n->dups++;
+    return false;
+  case SEQ_STALE:
+    n->dropped++;
+    return false;
+  case SEQ_LATE:
+    n->late++;
+    break;
+  case SEQ_NEW:
+    break;
+  }
+
+  if (!batch_add(g, n, h.packet_id, msg, msg_len, now_us)) {
+    n->dropped++; // Pool lleno (broker caído) o mensaje demasiado largo
+    return false;
+  }
+  n->messages++;
+  return true;
+}
+
+int bb_gw_ready(const bb_gw_t *g, int64_t now_us, int batch_size,
+                int64_t max_age_us) {
+  bool pressure = g->free_count < BB_GW_POOL_MSGS / 4;
+  int oldest = -1;
+  for (int i = 0; i < BB_GW_MAX_NODES; i++) {
+    const bb_gw_node_t *n = &g->nodes[i];
+    if (!n->used || n->batch_count == 0)
+      continue;
+    if (n->batch_count >= batch_size ||
+        now_us - n->batch_open_us >= max_age_us)
+      return i;
+    if (oldest < 0 || n->batch_open_us < g->nodes[oldest].batch_open_us)
+      oldest = i;
+  }
+  return pressure ? oldest : -1;
+}
+
+int64_t bb_gw_next_due_us(const bb_gw_t *g, int64_t now_us,
+                          int64_t max_age_us) {
+  int64_t due = INT64_MAX;
+  for (int i = 0; i < BB_GW_MAX_NODES; i++) {
+    const bb_gw_node_t *n = &g->nodes[i];
+    if (!n->used || n->batch_count == 0)
+      continue;
+    int64_t in = n->batch_open_us + max_age_us - now_us;
+    if (in < due)
+      due = (in > 0) ? in : 0;
+  }
+  return due;
+}
+
+size_t bb_gw_encode_batch(const bb_gw_t *g, int node, uint8_t *buf,
+                          size_t cap, int *count) {
+  *count = 0;
+  const bb_gw_node_t *n = &g->nodes[node];
+  if (n->batch_count == 0 || cap < BB_TLM_BATCH_HEADER_BYTES)
+    return 0;
+
+  size_t len = BB_TLM_BATCH_HEADER_BYTES;
+  int c = 0;
+  for (int16_t i = n->batch_head; i >= 0 && c < BB_TLM_BATCH_MAX_COUNT;
+       i = g->pool[i].next) {
+    const bb_gw_msg_t *m = &g->pool[i];
+    if (len + 2 + m->len > cap)
+      break;
+    buf[len] = m->len & 0xFF;
+    buf[len + 1] = m->len >> 8;
+    memcpy(&buf[len + 2], m->data, m->len);
+    len += 2 + m->len;
+    c++;
+  }
+  if (c == 0)
+    return 0;
+
+  buf[0] = BB_TLM_MAGIC0;
+  buf[1] = BB_TLM_BATCH_MAGIC1;
+  buf[2] = BB_TLM_VERSION;
+  buf[3] = (uint8_t)c;
+  *count = c;
+  return len;
+}
+
+void bb_gw_release(bb_gw_t *g, int node, int count) {
+  bb_gw_node_t *n = &g->nodes[node];
+  for (int k = 0; k < count && n->batch_head >= 0; k++) {
+    int16_t idx = n->batch_head;
+    n->batch_head = g->pool[idx].next;
+    g->pool[idx].next = g->free_head;
+    g->free_head = idx;
+    g->free_count++;
+    n->batch_count--;
+  }
+  if (count > 0) {
+    g->batches++;
+    g->messages += count;
+  }
+}
+
+void bb_gw_node_id(const bb_gw_node_t *n, char *out, size_t cap) {
+  snprintf(out, cap, "%02x%02x%02x%02x%02x%02x", n->mac[0], n->mac[1],
+           n->mac[2], n->mac[3], n->mac[4], n->mac[5]);
+}
+
+static size_t clamp_len(int r, size_t cap) {
+  if (r < 0)
+    return 0;
+  return ((size_t)r < cap) ? (size_t)r : cap - 1;
+}
+
+size_t bb_gw_node_json(const bb_gw_t *g, int node, int64_t now_us,
+                       char *buf, size_t cap) {
+  const bb_gw_node_t *n = &g->nodes[node];
+  char id[13];
+  bb_gw_node_id(n, id, sizeof(id));
+  // Perdidos = confirmados + huecos aún en la ventana (pueden llegar tarde)
+  int r = snprintf(
+      buf, cap,
+      "{\"id\":\"%s\",\"rssi\":%d,\"rssi_avg\":%.1f,\"frames\":%lu,"
+      "\"msgs\":%lu,\"dups\":%lu,\"late\":%lu,\"lost\":%lu,"
+      "\"restarts\":%lu,\"dropped\":%lu,\"age_s\":%lld,\"pending\":%u}",
+      id, n->rssi, n->rssi_avg_x16 / 16.0, (unsigned long)n->frames,
+      (unsigned long)n->messages, (unsigned long)n->dups,
+      (unsigned long)n->late, (unsigned long)(n->lost + window_holes(n)),
+      (unsigned long)n->restarts, (unsigned long)n->dropped,
+      (long long)((now_us - n->last_seen_us) / 1000000), n->batch_count);
+  return clamp_len(r, cap);
+}
+
+size_t bb_gw_summary_json(const bb_gw_t *g, char *buf, size_t cap) {
+  int nodes = 0;
+  for (int i = 0; i < BB_GW_MAX_NODES; i++)
+    nodes += g->nodes[i].used;
+  int r = snprintf(
+      buf, cap,
+      "{\"nodes\":%d,\"frames\":%lu,\"bad_crc\":%lu,\"bad_frame\":%lu,"
+      "\"no_node\":%lu,\"reasm_expired\":%lu,\"batches\":%lu,"
+      "\"msgs\":%lu,\"pool_free\":%u}",
+      nodes, (unsigned long)g->frames, (unsigned long)g->bad_crc,
+      (unsigned long)g->bad_frame, (unsigned long)g->no_node,
+      (unsigned long)g->reasm.expired, (unsigned long)g->batches,
+      (unsigned long)g->messages, g->free_count);
+  return clamp_len(r, cap);
+}
@@ -0,0 +1,250 @@
+/**
+ * @file bb_packet.c
+ * @brief Codificación, reensamblado y reintentos de las tramas ESP-NOW
+ */
+
+#include "bb_packet.h"
+#include <string.h>
+
+_Static_assert(BB_PKT_FRAG_PAYLOAD == BB_PKT_FRAME_MAX - BB_PKT_HEADER_BYTES -
+                                          BB_PKT_CRC_BYTES,
+               "Fragmento = trama - cabecera - CRC");
+_Static_assert(BB_PKT_MAX_FRAGS <= 16, "El bitmap de fragmentos es u16");
+
+uint16_t bb_packet_crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                           : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint8_t bb_packet_frag_count(size_t msg_len) {
+  if (msg_len > BB_PKT_MSG_MAX)
+    return 0;
+  if (msg_len == 0)
+    return 1; // Mensaje vacío: una trama sin datos
+  return (uint8_t)((msg_len + BB_PKT_FRAG_PAYLOAD - 1) / BB_PKT_FRAG_PAYLOAD);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+size_t bb_packet_encode(const bb_packet_hdr_t *h, const uint8_t *msg,
+                        size_t msg_len, uint8_t *frame, size_t cap) {
+  if (h->frag_count == 0 || h->frag_count != bb_packet_frag_count(msg_len) ||
+      h->frag_index >= h->frag_count)
+    return 0;
+
+  size_t off = (size_t)h->frag_index * BB_PKT_FRAG_PAYLOAD;
+  size_t n = msg_len - off;
+  if (n > BB_PKT_FRAG_PAYLOAD)
+    n = BB_PKT_FRAG_PAYLOAD;
+  size_t total = BB_PKT_HEADER_BYTES + n + BB_PKT_CRC_BYTES;
+  if (cap < total)
+    return 0;
+
+  uint8_t *p = frame;
+  *p++ = BB_PKT_MAGIC;
+  *p++ = BB_PKT_VERSION;
+  *p++ = h->type;
+  *p++ = h->flags;
+  memcpy(p, h->mac, 6);
+  p += 6;
+  put_u32(p, h->packet_id);
+  p += 4;
+  put_u32(p, h->timestamp_ms);
+  p += 4;
+  *p++ = h->frag_index;
+  *p++ = h->frag_count;
+  *p++ = (uint8_t)n;
+  if (n > 0)
+    memcpy(p, msg + off, n);
+  p += n;
+
+  uint16_t crc = bb_packet_crc16(frame, (size_t)(p - frame));
+  *p++ = crc;
+  *p++ = crc >> 8;
+  return total;
+}
+
+esp_err_t bb_packet_decode(const uint8_t *frame, size_t len,
+                           bb_packet_hdr_t *h, const uint8_t **payload,
+                           size_t *payload_len) {
+  if (len < BB_PKT_HEADER_BYTES + BB_PKT_CRC_BYTES || len > BB_PKT_FRAME_MAX)
+    return ESP_ERR_INVALID_SIZE;
+  if (frame[0] != BB_PKT_MAGIC || frame[1] != BB_PKT_VERSION)
+    return ESP_ERR_INVALID_VERSION;
+
+  size_t n = frame[20];
+  if (len != BB_PKT_HEADER_BYTES + n + BB_PKT_CRC_BYTES)
+    return ESP_ERR_INVALID_SIZE;
+  uint16_t crc = frame[len - 2] | (uint16_t)frame[len - 1] << 8;
+  if (crc != bb_packet_crc16(frame, len - BB_PKT_CRC_BYTES))
+    return ESP_ERR_INVALID_CRC;
+
+  h->type = frame[2];
+  h->flags = frame[3];
+  memcpy(h->mac, &frame[4], 6);
+  h->packet_id = get_u32(&frame[10]);
+  h->timestamp_ms = get_u32(&frame[14]);
+  h->frag_index = frame[18];
+  h->frag_count = frame[19];
+
+  // Con CRC válido esto solo lo produce un emisor con errores
+  if (h->frag_count == 0 || h->frag_count > BB_PKT_MAX_FRAGS ||
+      h->frag_index >= h->frag_count ||
+      (h->frag_index + 1 < h->frag_count && n != BB_PKT_FRAG_PAYLOAD))
+    return ESP_ERR_INVALID_SIZE;
+
+  *payload = &frame[BB_PKT_HEADER_BYTES];
+  *payload_len = n;
+  return ESP_OK;
+}
+
+// --- Reensamblado ---
+
+void bb_packet_reasm_init(bb_packet_reasm_t *r) { *r = (bb_packet_reasm_t){0}; }
+
+static bb_packet_slot_t *slot_for(bb_packet_reasm_t *r,
+                                  const bb_packet_hdr_t *h, int64_t now_us) {
+  bb_packet_slot_t *free_slot = NULL, *oldest = NULL;
+  for (int i = 0; i < BB_ESPNOW_REASM_SLOTS; i++) {
+    bb_packet_slot_t *s = &r->slots[i];
+    if (s->used &&
+        now_us - s->t_first_us > BB_ESPNOW_REASM_TIMEOUT_MS * 1000LL) {
+      s->used = false; // Fragmentos perdidos: no se completará
+      r->expired++;
+    }
+    if (!s->used) {
+      if (!free_slot)
+        free_slot = s;
+      continue;
+    }
+    if (s->packet_id == h->packet_id && memcmp(s->mac, h->mac, 6) == 0)
+      return s;
+    if (!oldest || s->t_first_us < oldest->t_first_us)
+      oldest = s;
+  }
+
+  bb_packet_slot_t *s = free_slot;
+  if (!s) {
+    s = oldest; // Más emisores fragmentando que huecos: pierde el más viejo
+    r->expired++;
+  }
+  s->used = true;
+  memcpy(s->mac, h->mac, 6);
+  s->packet_id = h->packet_id;
+  s->frag_count = h->frag_count;
+  s->got = 0;
+  s->last_len = 0;
+  s->t_first_us = now_us;
+  return s;
+}
+
+bool bb_packet_reasm_add(bb_packet_reasm_t *r, const bb_packet_hdr_t *h,
+                         const uint8_t *payload, size_t payload_len,
+                         int64_t now_us, const uint8_t **msg,
+                         size_t *msg_len) {
+  if (h->frag_count == 1) {
+    r->completed++;
+    *msg = payload;
+    *msg_len = payload_len;
+    return true;
+  }
+
+  bb_packet_slot_t *s = slot_for(r, h, now_us);
+  if (s->frag_count != h->frag_count)
+    return false; // Mismo id con otra longitud: trama ajena, se ignora
+  uint16_t bit = (uint16_t)1u << h->frag_index;
+  if (s->got & bit) {
+    r->dup_frags++; // Reintento cuyo ACK se perdió
+    return false;
+  }
+
+  memcpy(&s->buf[(size_t)h->frag_index * BB_PKT_FRAG_PAYLOAD], payload,
+         payload_len);
+  if (h->frag_index + 1 == h->frag_count)
+    s->last_len = payload_len;
+  s->got |= bit;
+  if (s->got != (uint16_t)((1u << s->frag_count) - 1))
+    return false;
+
+  s->used = false; // El buffer sigue válido hasta la siguiente llamada
+  r->completed++;
+  *msg = s->buf;
+  *msg_len = (size_t)(s->frag_count - 1) * BB_PKT_FRAG_PAYLOAD + s->last_len;
+  return true;
+}
+
+// --- Envío con reintentos ---
+
+void bb_packet_tx_init(bb_packet_tx_t *tx) { *tx = (bb_packet_tx_t){0}; }
+
+esp_err_t bb_packet_tx_start(bb_packet_tx_t *tx, const bb_packet_hdr_t *h,
+                             const uint8_t *msg, size_t len) {
+  if (tx->busy)
+    return ESP_ERR_INVALID_STATE;
+  uint8_t frags = bb_packet_frag_count(len);
+  if (frags == 0)
+    return ESP_ERR_INVALID_SIZE;
+
+  tx->hdr = *h;
+  tx->hdr.frag_index = 0;
+  tx->hdr.frag_count = frags;
+  if (len > 0)
+    memcpy(tx->msg, msg, len);
+  tx->len = len;
+  tx->attempt = 1;
+  tx->busy = true;
+  tx->messages++;
+  return ESP_OK;
+}
+
+size_t bb_packet_tx_frame(const bb_packet_tx_t *tx, uint8_t *frame,
+                          size_t cap) {
+  if (!tx->busy)
+    return 0;
+  return bb_packet_encode(&tx->hdr, tx->msg, tx->len, frame, cap);
+}
+
+bb_packet_tx_action_t bb_packet_tx_result(bb_packet_tx_t *tx, bool ok,
+                                          int64_t *delay_us) {
+  *delay_us = 0;
+  if (!tx->busy)
+    return BB_PKT_TX_DONE; // Callback tardío de un mensaje ya cerrado
+
+  if (ok) {
+    tx->frames++;
+    if (tx->hdr.frag_index + 1 >= tx->hdr.frag_count) {
+      tx->busy = false;
+      return BB_PKT_TX_DONE;
+    }
+    tx->hdr.frag_index++;
+    tx->attempt = 1;
+    return BB_PKT_TX_SEND;
+  }
+
+  if (tx->attempt >= BB_ESPNOW_RETRIES) {
+    tx->busy = false;
+    tx->failed++;
+    return BB_PKT_TX_FAILED;
+  }
+  // BACKOFF·2^(k-1): 10, 20, 40 ms... deja pasar la ráfaga que tapó el ACK
+  *delay_us = (int64_t)BB_ESPNOW_BACKOFF_MS * 1000 << (tx->attempt - 1);
+  tx->attempt++;
+  tx->retries++;
+  return BB_PKT_TX_SEND;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file bb_sync.c
+ * @brief Offset y deriva frente al maestro a partir de las balizas
+ */
+
+#include "bb_sync.h"
+#include <math.h>
+#include <string.h>
+
+#define SYNC_MIN_POINTS 3     // Con menos, la deriva no es fiable
+#define SYNC_MAX_PPB 500000LL // Pendiente mayor: no es un cristal, reiniciar
+
+void bb_sync_init(bb_sync_t *s) { *s = (bb_sync_t){0}; }
+
+// Olvida la recta, no el maestro ni los contadores
+static void restart(bb_sync_t *s) {
+  s->block_n = 0;
+  s->n_pts = 0;
+  s->head = 0;
+  s->locked = false;
+  s->drift_ppb = 0;
+  s->err_us = 0;
+  s->outliers_run = 0;
+}
+
+// Offset previsto por la recta en el instante local
+static int64_t predict(const bb_sync_t *s, int64_t local_us) {
+  int64_t dt = local_us - s->ref_local_us;
+  return s->ref_offset_us + dt * s->drift_ppb / 1000000000LL;
+}
+
+// Mínimos cuadrados offset(local) sobre los puntos filtrados. Una vez por
+// bloque de balizas: double no cuesta nada aquí
+static void fit(bb_sync_t *s) {
+  // Centrado en el punto más reciente: cifras pequeñas para el double
+  int newest = (s->head + BB_SYNC_FIT_POINTS - 1) % BB_SYNC_FIT_POINTS;
+  int64_t x0 = s->pts[newest].local_us;
+  int64_t y0 = s->pts[newest].offset_us;
+  double xm = 0.0, ym = 0.0;
+  for (int i = 0; i < s->n_pts; i++) {
+    xm += (double)(s->pts[i].local_us - x0);
+    ym += (double)(s->pts[i].offset_us - y0);
+  }
+  xm /= s->n_pts;
+  ym /= s->n_pts;
+
+  double sxx = 0.0, sxy = 0.0;
+  for (int i = 0; i < s->n_pts; i++) {
+    double dx = (double)(s->pts[i].local_us - x0) - xm;
+    sxx += dx * dx;
+    sxy += dx * ((double)(s->pts[i].offset_us - y0) - ym);
+  }
+  double slope = (sxx > 0.0) ? sxy / sxx : 0.0;
+  if (slope * 1e9 > SYNC_MAX_PPB || slope * 1e9 < -SYNC_MAX_PPB) {
+    // Puntos incoherentes: empezar desde el más reciente
+    bb_sync_point_t last = s->pts[newest];
+    restart(s);
+    s->pts[0] = last;
+    s->n_pts = 1;
+    s->head = 1;
+    x0 = last.local_us;
+    y0 = last.offset_us;
+    xm = ym = slope = 0.0;
+  }
+
+  s->ref_local_us = x0 + (int64_t)llround(xm);
+  s->ref_offset_us = y0 + (int64_t)llround(ym);
+  s->drift_ppb = (int32_t)llround(slope * 1e9);
+  s->locked = (s->n_pts >= SYNC_MIN_POINTS);
+
+  double m2 = 0.0;
+  for (int i = 0; i < s->n_pts; i++) {
+    double r = (double)(s->pts[i].offset_us -
+                        predict(s, s->pts[i].local_us));
+    m2 += r * r;
+  }
+  s->err_us = (uint32_t)llround(sqrt(m2 / s->n_pts));
+}
+
+void bb_sync_master(bb_sync_t *s, const uint8_t mac[6], uint32_t boot) {
+  if (s->has_master && memcmp(s->master_mac, mac, 6) == 0 &&
+      s->master_boot == boot)
+    return;
+  if (s->has_master)
+    s->resets++; // Otro maestro o el mismo reiniciado: otra línea
+  restart(s);
+  s->has_master = true;
+  memcpy(s->master_mac, mac, 6);
+  s->master_boot = boot;
+}
+
+bool bb_sync_sample(bb_sync_t *s, const uint8_t mac[6], uint32_t boot,
+                    int64_t local_us, int64_t master_us) {
+  bb_sync_master(s, mac, boot);
+  s->samples++;
+
+  int64_t offset = master_us - local_us;
+  if (s->n_pts > 0) {
+    int64_t err = offset - predict(s, local_us);
+    if (err > BB_SYNC_STEP_US || err < -BB_SYNC_STEP_US) {
+      s->outliers++;
+      if (++s->outliers_run < BB_SYNC_BLOCK)
+        return false; // Retardo raro: se ignora
+      s->resets++;    // Persistente: el maestro saltó
+      restart(s);
+    } else {
+      s->outliers_run = 0;
+    }
+  }
+  s->last_local_us = local_us;
+
+  // El retardo solo resta offset: vale la baliza que más tiene frente a la
+  // recta actual (sin ella, la deriva favorecería un extremo del bloque)
+  if (s->block_n == 0 ||
+      offset - predict(s, local_us) >
+          s->best.offset_us - predict(s, s->best.local_us))
+    s->best = (bb_sync_point_t){local_us, offset};
+  if (++s->block_n < BB_SYNC_BLOCK)
+    return false;
+
+  s->pts[s->head] = s->best;
+  s->head = (s->head + 1) % BB_SYNC_FIT_POINTS;
+  if (s->n_pts < BB_SYNC_FIT_POINTS)
+    s->n_pts++;
+  s->block_n = 0;
+  fit(s);
+  return true;
+}
+
+bool bb_sync_to_master(const bb_sync_t *s, int64_t local_us,
+                       int64_t *master_us) {
+  if (!s->locked ||
+      local_us - s->last_local_us > BB_SYNC_HOLDOVER_MS * 1000LL)
+    return false;
+  *master_us = local_us + predict(s, local_us);
+  return true;
+}
+
+bool bb_sync_to_local(const bb_sync_t *s, int64_t master_us,
+                      int64_t *local_us) {
+  if (!s->locked)
+    return false;
+  // local = maestro - offset(local): converge en dos pasos (deriva << 1)
+  int64_t l = master_us - s->ref_offset_us;
+  l = master_us - predict(s, l);
+  *local_us = master_us - predict(s, l);
+  return true;
+}
+
+bool bb_sync_next_slot(const bb_sync_t *s, int64_t now_us, int64_t period_us,
+                       int64_t lead_us, int64_t *local_us) {
+  int64_t m;
+  if (period_us <= 0 || !bb_sync_to_master(s, now_us + lead_us, &m))
+    return false;
+  int64_t slot = (m / period_us + 1) * period_us;
+  return bb_sync_to_local(s, slot, local_us);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+size_t bb_sync_beacon_encode(const bb_sync_beacon_t *b, uint8_t *buf,
+                             size_t cap) {
+  if (cap < BB_SYNC_BEACON_BYTES)
+    return 0;
+  put_u32(buf, b->seq);
+  put_u32(buf + 4, b->boot);
+  put_u32(buf + 8, (uint32_t)b->prev_tx_us);
+  put_u32(buf + 12, (uint32_t)((uint64_t)b->prev_tx_us >> 32));
+  return BB_SYNC_BEACON_BYTES;
+}
+
+bool bb_sync_beacon_decode(const uint8_t *buf, size_t len,
+                           bb_sync_beacon_t *b) {
+  if (len < BB_SYNC_BEACON_BYTES)
+    return false;
+  b->seq = get_u32(buf);
+  b->boot = get_u32(buf + 4);
+  b->prev_tx_us =
+      (int64_t)(get_u32(buf + 8) | (uint64_t)get_u32(buf + 12) << 32);
+  return true;
+}
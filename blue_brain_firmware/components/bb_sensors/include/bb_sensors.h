@@ -1,8 +1,11 @@
 #ifndef BB_SENSORS_H
 #define BB_SENSORS_H
 
+#include "bb_config.h"
 #include "esp_err.h"
 #include "icm42688.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 // --- Configuración Hardware ---
 // Pines definidos para XIAO ESP32-S3
@@ -12,22 +15,160 @@
 #define BB_I2C_MASTER_NUM 0
 #define BB_I2C_MASTER_FREQ_HZ 400000
 #define BB_MPU6050_ADDR 0x68
+#define BB_MPU6050_ADDR_ALT 0x69 // Segundo punto de medida (AD0 a VCC)
 #define BB_ACCEL_SENS_16G 2048.0f
+#define BB_DS18B20_MAX_DEVICES BB_MAX_TEMP_SENSORS
+#define BB_MPU6050_FIFO_SIZE 1024
+#define BB_ACCEL_SAMPLE_BYTES 6
+#define BB_IMU6_SAMPLE_BYTES 12      // Acel XYZ + Giro XYZ (modo acq_gyro)
+#define BB_IMU_SAMPLE_BYTES_MAX BB_IMU6_SAMPLE_BYTES
+#define BB_GYRO_SENS_2000DPS 16.4f   // LSB por °/s a +/- 2000 °/s
+
+// Calidad de una trama de un IMU (contadores baratos durante la captura)
+typedef struct {
+  uint16_t failed_reads; // Transacciones I2C fallidas
+  uint16_t clipped;      // Muestras con algún eje a fondo de escala
+  uint16_t stuck_run;    // Racha más larga de muestras idénticas
+  uint16_t gaps;         // Huecos de tiempo o bloques perdidos
+} bb_acq_quality_t;
+
+typedef enum {
+  BB_QUALITY_OK = 0,
+  BB_QUALITY_DEGRADED, // Se analiza, pero el reporte va marcado
+  BB_QUALITY_BAD,      // Se descarta antes de FFT/inferencia
+} bb_quality_level_t;
+
+// Reloj de muestreo medido de una trama (esp_timer, µs)
+typedef struct {
+  int64_t t_first_us; // Primera muestra
+  int64_t t_last_us;  // Última muestra
+  float fs_hz;        // Frecuencia efectiva: (N-1) / (t_last - t_first)
+  float jitter_us;    // Desviación estándar del intervalo entre muestras
+  bb_acq_quality_t quality;
+} bb_acq_meta_t;
+
+// Lectura de un DS18B20 identificada por su código ROM
+typedef struct {
+  uint64_t rom; // Byte 0 (family code) en el LSB
+  float temp_c;
+  bool valid; // CRC correcto
+} bb_temp_reading_t;
 
 // --- Funciones Públicas ---
 
 /**
  * @brief Inicializa el bus I2C y el MPU6050
+ * El mapa de dispositivos (IMUs, ROMs DS18B20, ICM-42688) se cachea en RTC y
+ * NVS. Si la caché es válida y cada IMU responde a un WHO_AM_I se omiten el
+ * escaneo I2C y la búsqueda 1-Wire; con cfg->maint_mode siempre se escanea.
+ * Requiere NVS inicializado.
  * @return ESP_OK si todo es correcto
  */
 esp_err_t bb_sensors_init(void);
 
+/**
+ * @brief Instante de la primera muestra capturada (esp_timer, µs desde el
+ * arranque): mide el tiempo de arranque hasta el primer dato
+ * @return 0 si aún no se ha capturado ninguna muestra
+ */
+int64_t bb_sensors_first_sample_us(void);
+
+/**
+ * @brief Número de MPU6050 detectados en el bus (1..BB_MAX_IMUS)
+ * El índice 0 es el punto A; si no responde ninguno se asume 0x68.
+ */
+int bb_sensors_imu_count(void);
+
+/**
+ * @brief Dirección I2C del IMU con índice imu (0 si no existe)
+ */
+uint8_t bb_sensors_imu_addr(int imu);
+
+/**
+ * @brief Bytes por muestra de los buffers crudos (fijado al arrancar)
+ * 6 = solo acelerómetro (X, Y, Z); 12 = acelerómetro seguido del giroscopio
+ * (X, Y, Z), big-endian como en los registros del MPU6050.
+ */
+int bb_sensors_sample_bytes(void);
+
 /**
  * @brief Lee una ráfaga de datos crudos del MPU6050 para análisis
- * @param buffer Buffer donde guardar los datos (X, Y, Z int16_t)
- * @param samples Número de muestras a leer
+ * @param raw_data Buffer donde guardar los datos (bb_sensors_sample_bytes()
+ * por muestra)
+ * @param len Número de muestras a leer
+ * @param meta Salida: marcas de tiempo y frecuencia de muestreo medida
+ */
+void bb_sensors_read_accel_burst(uint8_t *raw_data, int len,
+                                 bb_acq_meta_t *meta);
+
+/**
+ * @brief Ráfaga sincronizada de varios IMU: en cada periodo se lee el punto
+ * A e inmediatamente el B, así ambas series comparten reloj de muestreo
+ * Una lectura I2C fallida repite la muestra anterior (nunca bytes viejos del
+ * buffer) y se cuenta en meta->quality junto a saturación, rachas y huecos.
+ * @param raw_data Un buffer por IMU (len * bb_sensors_sample_bytes() cada uno)
+ * @param n_imus IMUs a leer (se limita a bb_sensors_imu_count())
+ * @param meta Salida: marcas de tiempo y calidad de cada IMU
+ */
+void bb_sensors_read_accel_burst_multi(uint8_t *const raw_data[], int n_imus,
+                                       int len, bb_acq_meta_t meta[]);
+
+/**
+ * @brief Calcula la frecuencia efectiva y el jitter a partir de las marcas
+ * de fin de bloque de la FIFO (ajuste lineal t = t0 + k/fs por mínimos
+ * cuadrados, t_first_us queda alineable entre IMUs)
+ * @param block_stamps Marca de la última muestra de cada bloque (µs)
+ * @param n_blocks Número de bloques de la trama
+ * @param block_samples Muestras por bloque
+ * @param nominal_hz Frecuencia configurada (si solo hay un bloque)
+ */
+void bb_sensors_meta_from_blocks(const int64_t *block_stamps, int n_blocks,
+                                 int block_samples, float nominal_hz,
+                                 bb_acq_meta_t *meta);
+
+/**
+ * @brief Cuenta muestras saturadas y la racha más larga de muestras
+ * idénticas de una trama ya capturada (modo continuo). failed_reads y gaps
+ * no se tocan: los aporta quien vació la FIFO.
+ */
+void bb_sensors_quality_scan(const uint8_t *raw_data, int len,
+                             bb_acq_quality_t *quality);
+
+/**
+ * @brief Clasifica una trama según su calidad (umbrales BB_QUAL_* de
+ * bb_config.h). La saturación solo marca la trama: suele ser un golpe real.
+ */
+bb_quality_level_t bb_sensors_quality_level(const bb_acq_quality_t *quality,
+                                            int len);
+
+/**
+ * @brief Configura todos los MPU6050 en modo FIFO (adquisición continua)
+ * El reloj de muestreo lo marca el propio sensor, por lo que no hay huecos
+ * mientras la FIFO se vacíe antes de llenarse (~170 muestras de margen, ~85 en modo 6 ejes).
+ * Las FIFO se reinician seguidas para que los IMU arranquen alineados.
+ * @param sample_rate_hz Frecuencia deseada; se ajusta a
+ * BB_STREAM_RATE_MIN_HZ..BB_STREAM_RATE_MAX_HZ (32..1000 Hz)
+ */
+esp_err_t bb_sensors_stream_start(int sample_rate_hz);
+
+/**
+ * @brief Desactiva la FIFO y vuelve al modo de lectura por ráfaga
+ */
+void bb_sensors_stream_stop(void);
+
+/**
+ * @brief Vacía muestras completas de la FIFO de un IMU
+ * @param imu Índice del IMU (0 = punto A)
+ * @param dst Destino (mismo layout por muestra que la ráfaga)
+ * @param max_samples Máximo de muestras a leer
+ * @param overflow Salida: true si la FIFO desbordó (se reinicia, hay hueco)
+ * @param t_last_us Salida: instante estimado de captura de la última muestra
+ * devuelta (lectura de FIFO_COUNT menos las muestras que quedan detrás)
+ * @return Número de muestras leídas (negativo si falló el I2C; si falla la
+ * lectura de datos la FIFO se reinicia para no perder la alineación)
  */
-void bb_sensors_read_accel_burst(uint8_t *raw_data, int len);
+int bb_sensors_stream_read(int imu, uint8_t *dst, int max_samples,
+                           bool *overflow, int64_t *t_last_us);
 
 /**
  * @brief Lee un solo sample de aceleración (usado internamente o para debug)
@@ -39,8 +180,16 @@ esp_err_t bb_sensors_read_accel_single(float *ax, float *ay, float *az);
 
 /**
  * @brief Obtiene la temperatura del sensor DS18B20
- * @return Temperatura en grados Celsius
+ * @return Temperatura en grados Celsius del primer sensor válido (-99 si no)
  */
 float bb_sensors_get_temp(void);
 
+/**
+ * @brief Lanza un Convert-T simultáneo y lee todos los DS18B20 del bus
+ * @param out Lecturas en orden de búsqueda ROM
+ * @param max Capacidad de out
+ * @return Número de sensores leídos (válidos o no)
+ */
+int bb_sensors_get_temps(bb_temp_reading_t *out, int max);
+
 #endif // BB_SENSORS_H
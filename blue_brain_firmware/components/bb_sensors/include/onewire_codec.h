@@ -0,0 +1,128 @@
+/**
+ * @file onewire_codec.h
+ * @brief Lógica pura del bus 1-Wire (sin dependencias de hardware)
+ *
+ * Decodificación de símbolos RMT capturados, CRC8 Dallas/Maxim, algoritmo de
+ * búsqueda de ROM y conversión del scratchpad DS18B20. Todo este módulo
+ * compila en el host (gcc) para validarlo contra formas de onda grabadas.
+ */
+
+#ifndef ONEWIRE_CODEC_H
+#define ONEWIRE_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Comandos ROM / Función ---
+#define OW_CMD_SEARCH_ROM 0xF0
+#define OW_CMD_MATCH_ROM 0x55
+#define OW_CMD_SKIP_ROM 0xCC
+#define DS18B20_CMD_CONVERT_T 0x44
+#define DS18B20_CMD_READ_SCRATCHPAD 0xBE
+
+#define DS18B20_FAMILY_CODE 0x28
+#define DS18B20_SCRATCHPAD_LEN 9
+
+// --- Temporización (µs, resolución RMT 1 MHz) ---
+#define OW_RESET_LOW_US 500
+#define OW_RESET_WAIT_US 500
+#define OW_SLOT_START_US 6   // Pulso bajo para escribir 1 / iniciar lectura
+#define OW_SLOT_RECOVER_US 64 // Resto del slot en alto tras escribir 1
+#define OW_WRITE0_LOW_US 60
+#define OW_WRITE0_RECOVER_US 10
+#define OW_READ_THRESHOLD_US 15 // Bajo > 15 µs => el esclavo envió un 0
+#define OW_PRESENCE_MIN_US 60
+#define OW_PRESENCE_MAX_US 240
+
+/**
+ * @brief Extrae la duración de cada pulso bajo de una captura RMT
+ *
+ * Cada palabra sigue el layout de rmt_symbol_word_t:
+ * duration0[14:0] level0[15] duration1[30:16] level1[31].
+ * Una duración 0 marca el final de la captura.
+ *
+ * @param symbols Palabras RMT crudas
+ * @param n_symbols Número de palabras
+ * @param low_us Salida: duración de cada pulso bajo en ticks (µs)
+ * @param max_pulses Capacidad de low_us
+ * @return Número de pulsos bajos extraídos
+ */
+size_t ow_extract_low_pulses(const uint32_t *symbols, size_t n_symbols,
+                             uint16_t *low_us, size_t max_pulses);
+
+/**
+ * @brief Verifica el pulso de presencia tras un reset
+ * @param low_us Pulsos bajos de la captura (el primero es el reset propio)
+ * @param n Número de pulsos
+ * @return true si al menos un esclavo respondió
+ */
+bool ow_decode_presence(const uint16_t *low_us, size_t n);
+
+/**
+ * @brief Convierte pulsos bajos de slots de lectura en bits (LSB primero)
+ * @param low_us Pulsos bajos (uno por slot)
+ * @param n_bits Bits esperados (máx 32)
+ * @param out Salida con los bits empaquetados
+ * @return true si hubo suficientes pulsos para todos los bits
+ */
+bool ow_decode_bits(const uint16_t *low_us, size_t n_bits, uint32_t *out);
+
+/**
+ * @brief CRC8 Dallas/Maxim (X^8 + X^5 + X^4 + 1)
+ */
+uint8_t ow_crc8(const uint8_t *data, size_t len);
+
+// --- Búsqueda de ROM (Maxim AN187) ---
+
+/**
+ * @brief Operación "triplet": lee bit id, lee complemento y escribe dirección
+ * @param ctx Contexto del transporte (RMT en el dispositivo, simulador en host)
+ * @param dir_if_conflict Dirección a tomar si ambos bits leídos son 0
+ * @param id_bit Salida: primer bit leído
+ * @param cmp_bit Salida: complemento leído
+ * @param dir_taken Salida: bit finalmente escrito
+ * @return true si la transacción tuvo éxito
+ */
+typedef bool (*ow_triplet_fn)(void *ctx, bool dir_if_conflict, bool *id_bit,
+                              bool *cmp_bit, bool *dir_taken);
+
+/**
+ * @brief Emite reset + SEARCH_ROM. Devuelve false si no hay presencia.
+ */
+typedef bool (*ow_search_begin_fn)(void *ctx);
+
+typedef struct {
+  uint8_t rom[8];
+  int last_discrepancy;
+  bool last_device;
+} ow_search_t;
+
+/**
+ * @brief Reinicia el estado de búsqueda
+ */
+void ow_search_reset(ow_search_t *s);
+
+/**
+ * @brief Encuentra el siguiente dispositivo del bus
+ * @param s Estado de búsqueda (rom contiene el resultado)
+ * @return true si se encontró un dispositivo con CRC válido
+ */
+bool ow_search_next(ow_search_t *s, ow_search_begin_fn begin,
+                    ow_triplet_fn triplet, void *ctx);
+
+/**
+ * @brief Empaqueta un ROM de 8 bytes en uint64_t (byte 0 = family code, LSB)
+ */
+uint64_t ow_rom_to_u64(const uint8_t rom[8]);
+
+/**
+ * @brief Decodifica el scratchpad DS18B20 con verificación CRC
+ * @param sp 9 bytes leídos con READ_SCRATCHPAD
+ * @param temp_c Salida: temperatura en °C (respeta la resolución configurada)
+ * @return true si el CRC es válido y el dato no es todo 0xFF
+ */
+bool ds18b20_decode_scratchpad(const uint8_t sp[DS18B20_SCRATCHPAD_LEN],
+                               float *temp_c);
+
+#endif // ONEWIRE_CODEC_H
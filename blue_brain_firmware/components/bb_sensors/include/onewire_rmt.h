@@ -0,0 +1,49 @@
+/**
+ * @file onewire_rmt.h
+ * @brief Transporte 1-Wire sobre el periférico RMT (TX + RX en loopback)
+ *
+ * El RMT genera los slots con resolución de 1 µs independientemente de la
+ * carga de interrupciones, y captura la línea para decodificar presencia y
+ * bits de lectura con onewire_codec.
+ */
+
+#ifndef ONEWIRE_RMT_H
+#define ONEWIRE_RMT_H
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Crea los canales RMT TX/RX en open-drain sobre el mismo GPIO
+ * @param gpio Pin del bus (requiere pull-up externo de 4.7kΩ)
+ */
+esp_err_t onewire_rmt_init(gpio_num_t gpio);
+
+/**
+ * @brief Pulso de reset y detección de presencia
+ * @param present Salida: true si algún dispositivo respondió
+ */
+esp_err_t onewire_rmt_reset(bool *present);
+
+/**
+ * @brief Escribe bytes (LSB primero)
+ */
+esp_err_t onewire_rmt_write_bytes(const uint8_t *data, size_t len);
+
+/**
+ * @brief Lee bytes (LSB primero)
+ */
+esp_err_t onewire_rmt_read_bytes(uint8_t *data, size_t len);
+
+/**
+ * @brief Enumera todos los dispositivos del bus con SEARCH_ROM
+ * @param roms Salida: códigos ROM de 8 bytes (CRC verificado)
+ * @param max Capacidad de roms
+ * @return Número de dispositivos encontrados
+ */
+int onewire_rmt_search(uint8_t (*roms)[8], int max);
+
+#endif // ONEWIRE_RMT_H
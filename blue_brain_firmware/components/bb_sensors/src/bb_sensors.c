@@ -1,87 +1,319 @@
 #include "bb_sensors.h"
 #include "driver/gpio.h"
 #include "driver/i2c.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 #include "esp_rom_sys.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "i2c_scanner.h"
+#include "nvs.h"
+#include "onewire_codec.h"
+#include "onewire_rmt.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
 
 static const char *TAG = "bb_sensors";
 
-// --- DRIVER DS18B20 (1-Wire Bit-Bang) ---
-// Adaptado del original main.c
+// --- DRIVER DS18B20 (1-Wire sobre RMT, multi-drop) ---
 
-static esp_err_t ds18b20_reset() {
-  gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_OUTPUT);
-  gpio_set_level(BB_DS18B20_GPIO, 0);
-  esp_rom_delay_us(480);
-  gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_INPUT);
-  esp_rom_delay_us(70);
-  int level = gpio_get_level(BB_DS18B20_GPIO);
-  // ESP_LOGD(TAG, "DS18B20 Reset: Presence=%d (0=OK)", level);
-  esp_rom_delay_us(410);
-  return (level == 0) ? ESP_OK : ESP_FAIL;
-}
+static uint8_t s_ds_roms[BB_DS18B20_MAX_DEVICES][8];
+static uint8_t s_ds_fails[BB_DS18B20_MAX_DEVICES]; // Lecturas fallidas seguidas
+static int s_ds_count = 0;
+static bool s_ow_ready = false;
+
+static void sensor_map_update_roms(void);
+
+static esp_err_t ds18b20_scan_bus(void) {
+  memset(s_ds_fails, 0, sizeof(s_ds_fails));
+  s_ds_count = onewire_rmt_search(s_ds_roms, BB_DS18B20_MAX_DEVICES);
 
-static void ds18b20_write_byte(uint8_t data) {
-  for (int i = 0; i < 8; i++) {
-    gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(BB_DS18B20_GPIO, 0);
-    esp_rom_delay_us((data & (1 << i)) ? 2 : 60);
-    gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_INPUT);
-    esp_rom_delay_us((data & (1 << i)) ? 60 : 2);
+  int n_ds = 0;
+  for (int i = 0; i < s_ds_count; i++) {
+    if (s_ds_roms[i][0] != DS18B20_FAMILY_CODE) {
+      ESP_LOGW(TAG, "1-Wire: familia 0x%02X ignorada", s_ds_roms[i][0]);
+      continue;
+    }
+    // Compactar solo DS18B20 al inicio de la lista
+    if (n_ds != i)
+      memcpy(s_ds_roms[n_ds], s_ds_roms[i], 8);
+    ESP_LOGI(TAG, "DS18B20[%d] ROM: %016llX", n_ds,
+             ow_rom_to_u64(s_ds_roms[n_ds]));
+    n_ds++;
   }
-}
+  s_ds_count = n_ds;
 
-static uint8_t ds18b20_read_byte() {
-  uint8_t data = 0;
-  for (int i = 0; i < 8; i++) {
-    gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(BB_DS18B20_GPIO, 0);
-    esp_rom_delay_us(2);
-    gpio_set_direction(BB_DS18B20_GPIO, GPIO_MODE_INPUT);
-    esp_rom_delay_us(10);
-    if (gpio_get_level(BB_DS18B20_GPIO))
-      data |= (1 << i);
-    esp_rom_delay_us(50);
+  if (s_ds_count == 0) {
+    ESP_LOGW(TAG, "DS18B20: ningún dispositivo encontrado en el bus");
+    return ESP_ERR_NOT_FOUND;
   }
-  return data;
+  return ESP_OK;
 }
 
-float bb_sensors_get_temp(void) {
-  // Step 1: Start Converson
-  if (ds18b20_reset() != ESP_OK) {
+static esp_err_t ds18b20_read_one(const uint8_t rom[8], float *temp_c) {
+  bool present = false;
+  if (onewire_rmt_reset(&present) != ESP_OK || !present)
+    return ESP_ERR_NOT_FOUND;
+
+  uint8_t cmd[10];
+  cmd[0] = OW_CMD_MATCH_ROM;
+  memcpy(&cmd[1], rom, 8);
+  cmd[9] = DS18B20_CMD_READ_SCRATCHPAD;
+  esp_err_t ret = onewire_rmt_write_bytes(cmd, sizeof(cmd));
+  if (ret != ESP_OK)
+    return ret;
+
+  uint8_t sp[DS18B20_SCRATCHPAD_LEN];
+  ret = onewire_rmt_read_bytes(sp, sizeof(sp));
+  if (ret != ESP_OK)
+    return ret;
+
+  return ds18b20_decode_scratchpad(sp, temp_c) ? ESP_OK
+                                               : ESP_ERR_INVALID_CRC;
+}
+
+int bb_sensors_get_temps(bb_temp_reading_t *out, int max) {
+  if (!s_ow_ready)
+    return 0;
+
+  // Re-enumerar si el bus quedó vacío (sensor reconectado en caliente)
+  if (s_ds_count == 0) {
+    if (ds18b20_scan_bus() != ESP_OK)
+      return 0;
+    sensor_map_update_roms();
+  }
+
+  // Step 1: Convert T simultáneo para todos los sensores (Skip ROM)
+  bool present = false;
+  if (onewire_rmt_reset(&present) != ESP_OK || !present) {
     ESP_LOGW(TAG, "DS18B20: No presence pulse detected on conversion start");
-    return -99.0f;
+    s_ds_count = 0;
+    return 0;
+  }
+  uint8_t cmd[2] = {OW_CMD_SKIP_ROM, DS18B20_CMD_CONVERT_T};
+  esp_err_t ret = onewire_rmt_write_bytes(cmd, sizeof(cmd));
+  if (ret != ESP_OK) {
+    // Sin Convert T no hay nada que esperar ni leer
+    ESP_LOGW(TAG, "DS18B20: Convert T fallido (%s)", esp_err_to_name(ret));
+    return 0;
   }
-  ds18b20_write_byte(0xCC); // Skip ROM
-  ds18b20_write_byte(0x44); // Convert T
 
-  // Wait for conversion (blocking)
+  // Wait for conversion (12 bit, blocking)
   vTaskDelay(pdMS_TO_TICKS(750));
 
-  // Step 2: Read Scratchpad
-  if (ds18b20_reset() != ESP_OK) {
-    ESP_LOGW(TAG, "DS18B20: No presence pulse detected on read");
-    return -99.0f;
+  // Step 2: Leer cada scratchpad direccionado por ROM (Match ROM)
+  int n = (s_ds_count < max) ? s_ds_count : max;
+  bool rescan = false;
+  for (int i = 0; i < n; i++) {
+    out[i].rom = ow_rom_to_u64(s_ds_roms[i]);
+    out[i].valid = (ds18b20_read_one(s_ds_roms[i], &out[i].temp_c) == ESP_OK);
+    if (!out[i].valid) {
+      out[i].temp_c = -99.0f;
+      ESP_LOGW(TAG, "DS18B20 %016llX: lectura inválida (CRC/presencia)",
+               out[i].rom);
+      if (++s_ds_fails[i] >= BB_DS18B20_RESCAN_FAILS)
+        rescan = true;
+    } else {
+      s_ds_fails[i] = 0;
+      ESP_LOGD(TAG, "DS18B20 %016llX -> %.2f C", out[i].rom, out[i].temp_c);
+    }
   }
-  ds18b20_write_byte(0xCC); // Skip ROM
-  ds18b20_write_byte(0xBE); // Read Scratchpad
 
-  uint8_t low = ds18b20_read_byte();
-  uint8_t high = ds18b20_read_byte();
-  int16_t raw = (high << 8) | low;
-
-  ESP_LOGI(TAG, "DS18B20 Raw: 0x%04X (L:%02X H:%02X) -> %.2f C", raw, low, high,
-           (float)raw / 16.0f);
+  // Un ROM de la caché que falla una y otra vez es una sonda cambiada o
+  // retirada: volver a buscar en el bus y corregir la caché
+  if (rescan) {
+    ESP_LOGW(TAG, "DS18B20: %d fallos seguidos, re-enumerando el bus",
+             BB_DS18B20_RESCAN_FAILS);
+    ds18b20_scan_bus();
+    sensor_map_update_roms();
+  }
+  return n;
+}
 
-  return (float)raw / 16.0f;
+float bb_sensors_get_temp(void) {
+  bb_temp_reading_t readings[BB_DS18B20_MAX_DEVICES];
+  int n = bb_sensors_get_temps(readings, BB_DS18B20_MAX_DEVICES);
+  for (int i = 0; i < n; i++) {
+    if (readings[i].valid)
+      return readings[i].temp_c;
+  }
+  return -99.0f;
 }
 
 // --- MPU6050 & I2C ---
 
+// IMUs presentes en el bus, en orden de punto de medida (A, B)
+static uint8_t s_imu_addr[BB_MAX_IMUS] = {BB_MPU6050_ADDR};
+static int s_imu_count = 1;
+static int s_sample_bytes = BB_ACCEL_SAMPLE_BYTES; // 12 en modo 6 ejes
+
+int bb_sensors_imu_count(void) { return s_imu_count; }
+
+int bb_sensors_sample_bytes(void) { return s_sample_bytes; }
+
+uint8_t bb_sensors_imu_addr(int imu) {
+  return (imu >= 0 && imu < s_imu_count) ? s_imu_addr[imu] : 0;
+}
+
+// --- CACHÉ DEL MAPA DE DISPOSITIVOS (arranque rápido) ---
+// El mapa detectado (IMUs, DS18B20, ICM) se guarda en RTC (sobrevive al deep
+// sleep) y en NVS (sobrevive a un corte). Al arrancar se verifica con un
+// WHO_AM_I por IMU; el escaneo completo solo corre si la caché no vale o en
+// modo mantenimiento.
+#define SENSOR_MAP_MAGIC 0xBB5E0A01u
+#define SENSOR_MAP_NVS_NS "bb_sensors"
+#define SENSOR_MAP_NVS_KEY "dev_map"
+
+typedef struct {
+  uint32_t magic;
+  uint8_t imu_count;
+  uint8_t imu_addr[BB_MAX_IMUS];
+  uint8_t ds_count;
+  uint8_t ds_roms[BB_DS18B20_MAX_DEVICES][8];
+  bool icm_present;
+  uint32_t crc; // CRC32 de los campos anteriores
+} sensor_map_t;
+
+RTC_DATA_ATTR static sensor_map_t s_rtc_map;
+
+// Imagen de configuración del MPU6050: SMPLRT_DIV, CONFIG, GYRO_CONFIG y
+// ACCEL_CONFIG son consecutivos (0x19..0x1C) y se escriben en una ráfaga
+static const uint8_t s_mpu_cfg_block[] = {
+    0x19, // Registro inicial (auto-incremento)
+    0x00, // 0x19 Sample Rate: 1kHz
+    0x00, // 0x1A DLPF: 260Hz
+    0x18, // 0x1B Giro: +/- 2000 dps
+    0x18, // 0x1C Rango: +/- 16g
+};
+static const uint8_t s_mpu_wake[] = {0x6B, 0x00}; // PWR_MGMT_1: Despertar
+
+static int64_t s_first_sample_us = 0;
+
+static uint32_t sensor_map_crc(const sensor_map_t *map) {
+  return esp_rom_crc32_le(0, (const uint8_t *)map,
+                          offsetof(sensor_map_t, crc));
+}
+
+static bool sensor_map_valid(const sensor_map_t *map) {
+  return map->magic == SENSOR_MAP_MAGIC && map->imu_count >= 1 &&
+         map->imu_count <= BB_MAX_IMUS &&
+         map->ds_count <= BB_DS18B20_MAX_DEVICES &&
+         map->crc == sensor_map_crc(map);
+}
+
+static bool sensor_map_load(sensor_map_t *map, const char **source) {
+  if (sensor_map_valid(&s_rtc_map)) {
+    *map = s_rtc_map;
+    *source = "RTC";
+    return true;
+  }
+
+  nvs_handle_t h;
+  if (nvs_open(SENSOR_MAP_NVS_NS, NVS_READONLY, &h) != ESP_OK)
+    return false;
+  size_t len = sizeof(*map);
+  esp_err_t err = nvs_get_blob(h, SENSOR_MAP_NVS_KEY, map, &len);
+  nvs_close(h);
+
+  if (err != ESP_OK || len != sizeof(*map) || !sensor_map_valid(map))
+    return false;
+  *source = "NVS";
+  return true;
+}
+
+static void sensor_map_store(sensor_map_t *map) {
+  map->magic = SENSOR_MAP_MAGIC;
+  map->crc = sensor_map_crc(map);
+  s_rtc_map = *map;
+
+  // NVS solo si el mapa cambió: evita desgastar la flash en cada arranque
+  nvs_handle_t h;
+  if (nvs_open(SENSOR_MAP_NVS_NS, NVS_READWRITE, &h) != ESP_OK)
+    return;
+  sensor_map_t stored;
+  size_t len = sizeof(stored);
+  if (nvs_get_blob(h, SENSOR_MAP_NVS_KEY, &stored, &len) != ESP_OK ||
+      len != sizeof(stored) || memcmp(&stored, map, sizeof(*map)) != 0) {
+    if (nvs_set_blob(h, SENSOR_MAP_NVS_KEY, map, sizeof(*map)) == ESP_OK) {
+      nvs_commit(h);
+      ESP_LOGI(TAG, "Mapa de dispositivos guardado en NVS");
+    }
+  }
+  nvs_close(h);
+}
+
+// Tras re-enumerar el 1-Wire en marcha: la caché guarda los ROM actuales
+// para no arrancar otra vez con los antiguos
+static void sensor_map_update_roms(void) {
+  if (!sensor_map_valid(&s_rtc_map))
+    return; // Sin mapa cacheado (sin IMU) no hay nada que corregir
+  sensor_map_t map = s_rtc_map;
+  map.ds_count = (uint8_t)s_ds_count;
+  memcpy(map.ds_roms, s_ds_roms, sizeof(map.ds_roms));
+  sensor_map_store(&map);
+}
+
+// Verificación rápida: un WHO_AM_I con timeout corto
+static bool mpu_whoami_ok(uint8_t addr) {
+  uint8_t reg = 0x75, val = 0;
+  if (i2c_master_write_read_device(BB_I2C_MASTER_NUM, addr, &reg, 1, &val, 1,
+                                   pdMS_TO_TICKS(10)) != ESP_OK)
+    return false;
+  return val == 0x68 || val == 0x70;
+}
+
+static esp_err_t mpu_apply_config(uint8_t addr) {
+  esp_err_t ret = i2c_master_write_to_device(
+      BB_I2C_MASTER_NUM, addr, s_mpu_wake, sizeof(s_mpu_wake), 100);
+  if (ret == ESP_OK)
+    ret = i2c_master_write_to_device(BB_I2C_MASTER_NUM, addr, s_mpu_cfg_block,
+                                     sizeof(s_mpu_cfg_block), 100);
+  return ret;
+}
+
+// Escaneo completo (caché inválida o mantenimiento): diagnóstico I2C,
+// prueba de ambas direcciones MPU, búsqueda ROM 1-Wire e ICM-42688
+static void sensors_full_scan(sensor_map_t *map) {
+  memset(map, 0, sizeof(*map));
+
+  // DIAGNÓSTICO: Escanear bus I2C antes de configurar MPU6050
+  ESP_LOGI(TAG, "=== DIAGNÓSTICO I2C ===");
+  i2c_scanner_scan();
+
+  // DIAGNÓSTICO: Probar MPU6050 en ambas direcciones (multi-punto)
+  static const uint8_t candidates[BB_MAX_IMUS] = {BB_MPU6050_ADDR,
+                                                  BB_MPU6050_ADDR_ALT};
+  for (int i = 0; i < BB_MAX_IMUS; i++) {
+    if (i2c_scanner_test_mpu6050(candidates[i]) == ESP_OK)
+      map->imu_addr[map->imu_count++] = candidates[i];
+  }
+  ESP_LOGI(TAG, "=======================");
+
+  // Bus 1-Wire (RMT): enumerar los DS18B20
+  if (s_ow_ready) {
+    ds18b20_scan_bus();
+    map->ds_count = (uint8_t)s_ds_count;
+    memcpy(map->ds_roms, s_ds_roms, sizeof(map->ds_roms));
+  }
+
+  // ICM-42688-P (SPI)
+  // Nota: Si el sensor no está conectado, fallará pero no detendremos el flujo
+  // a menos que sea crítico. El usuario dijo "por ahora no lo usaremos".
+  esp_err_t ret = icm42688_init();
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG,
+             "ICM-42688 Init Failed (Maybe not connected?) - Continuing...");
+  } else {
+    map->icm_present = (icm42688_read_whoami() == ICM42688_WHO_AM_I_VAL);
+  }
+}
+
 esp_err_t bb_sensors_init(void) {
+  int64_t t_start = esp_timer_get_time();
+
   // 1. Iniciar I2C
   i2c_config_t conf = {
       .mode = I2C_MODE_MASTER,
@@ -94,75 +326,266 @@ esp_err_t bb_sensors_init(void) {
   i2c_param_config(BB_I2C_MASTER_NUM, &conf);
   i2c_driver_install(BB_I2C_MASTER_NUM, conf.mode, 0, 0, 0);
 
-  // DIAGNÓSTICO: Escanear bus I2C antes de configurar MPU6050
-  ESP_LOGI(TAG, "=== DIAGNÓSTICO I2C ===");
-  i2c_scanner_scan();
-
-  // DIAGNÓSTICO: Probar MPU6050 específicamente
-  esp_err_t mpu_test = i2c_scanner_test_mpu6050(BB_MPU6050_ADDR);
-  if (mpu_test != ESP_OK) {
-    ESP_LOGW(TAG, "Probando dirección alternativa 0x69...");
-    i2c_scanner_test_mpu6050(0x69);
+  // 2. Bus 1-Wire (RMT)
+  if (onewire_rmt_init(BB_DS18B20_GPIO) == ESP_OK) {
+    s_ow_ready = true;
+  } else {
+    ESP_LOGW(TAG, "1-Wire RMT no disponible - sin temperatura");
   }
-  ESP_LOGI(TAG, "=======================");
 
-  // 2. Inicializar MPU6050 (I2C)
-  // Nota: Ya se inicializó el driver I2C arriba.
-  // Aquí podemos poner lógica adicional si fuera necesaria.
+  // 3. Mapa de dispositivos: caché verificada o escaneo completo
+  sensor_map_t map;
+  const char *source = NULL;
+  bool cached = false;
 
-  // 3. Inicializar ICM-42688-P (SPI)
-  // Nota: Si el sensor no está conectado, fallará pero no detendremos el flujo
-  // a menos que sea crítico. El usuario dijo "por ahora no lo usaremos".
-  esp_err_t ret = icm42688_init(); // Assuming this is a new function
-  if (ret != ESP_OK) {
-    ESP_LOGW(TAG,
-             "ICM-42688 Init Failed (Maybe not connected?) - Continuing...");
-    // return ret; // No retornar error fatal
+  if (bb_config_get()->maint_mode) {
+    ESP_LOGW(TAG, "Modo mantenimiento: escaneo completo de buses");
+  } else if (sensor_map_load(&map, &source)) {
+    cached = true;
+    for (int i = 0; i < map.imu_count && cached; i++)
+      cached = mpu_whoami_ok(map.imu_addr[i]);
+    if (!cached)
+      ESP_LOGW(TAG, "Caché (%s) no coincide con el bus: re-escaneando",
+               source);
   }
 
-  // 2. Configurar MPU6050
-  uint8_t cmds[][2] = {
-      {0x6B, 0x00}, // Despertar
-      {0x1A, 0x00}, // DLPF: 260Hz
-      {0x1C, 0x18}, // Rango: +/- 16g
-      {0x19, 0x00}  // Sample Rate: 1kHz
-  };
+  if (cached) {
+    s_rtc_map = map; // Tras un arranque en frío la caché venía de NVS
+    s_ds_count = s_ow_ready ? map.ds_count : 0;
+    memcpy(s_ds_roms, map.ds_roms, sizeof(s_ds_roms));
+    if (map.icm_present)
+      icm42688_init();
+  } else {
+    sensors_full_scan(&map);
+    if (map.imu_count > 0)
+      sensor_map_store(&map); // Sin IMU no se cachea: re-escanear
+  }
+
+  s_imu_count = map.imu_count;
+  memcpy(s_imu_addr, map.imu_addr, sizeof(s_imu_addr));
+  if (s_imu_count == 0) {
+    // Sin sensor: seguir con la dirección por defecto (solo pruebas)
+    s_imu_addr[0] = BB_MPU6050_ADDR;
+    s_imu_count = 1;
+  }
+  ESP_LOGI(TAG, "MPU6050 detectados: %d (punto A = 0x%02X), DS18B20: %d",
+           s_imu_count, s_imu_addr[0], s_ds_count);
 
+  // 4. Configurar MPU6050 (imagen de registros en dos escrituras)
   bool mpu_ok = true;
-  for (int i = 0; i < 4; i++) {
-    esp_err_t ret = i2c_master_write_to_device(
-        BB_I2C_MASTER_NUM, BB_MPU6050_ADDR, cmds[i], 2, 100);
+  for (int imu = 0; imu < s_imu_count && mpu_ok; imu++) {
+    esp_err_t ret = mpu_apply_config(s_imu_addr[imu]);
     if (ret != ESP_OK) {
-      ESP_LOGW(TAG, "MPU6050 no responde (cmd %d): %s - Hardware no conectado?",
-               i, esp_err_to_name(ret));
+      ESP_LOGW(TAG, "MPU6050 0x%02X no responde: %s - Hardware no conectado?",
+               s_imu_addr[imu], esp_err_to_name(ret));
       mpu_ok = false;
-      break;
     }
   }
 
+  // Modo 6 ejes: acel + giro en la misma lectura por muestra
+  s_sample_bytes =
+      bb_config_get()->acq_gyro ? BB_IMU6_SAMPLE_BYTES : BB_ACCEL_SAMPLE_BYTES;
+
   if (mpu_ok) {
-    ESP_LOGI(TAG, "Sensores Inicializados: I2C + MPU6050 OK");
+    ESP_LOGI(TAG, "Sensores Inicializados: I2C + MPU6050 OK (%d ejes)",
+             s_sample_bytes == BB_IMU6_SAMPLE_BYTES ? 6 : 3);
   } else {
     ESP_LOGW(TAG, "Sensores Inicializados: I2C OK, MPU6050 NO DETECTADO");
     ESP_LOGW(TAG, "El firmware continuara sin sensores - Solo para pruebas!");
   }
+  ESP_LOGI(TAG, "Init sensores: %lld ms (%s)",
+           (esp_timer_get_time() - t_start) / 1000,
+           cached ? source : "escaneo completo");
   return ESP_OK;
 }
 
-void bb_sensors_read_accel_burst(uint8_t *raw_data, int len) {
+int64_t bb_sensors_first_sample_us(void) { return s_first_sample_us; }
+
+// --- Calidad de adquisición ---
+
+// Algún eje del acelerómetro a fondo de escala (0x7FFF / 0x8000)
+static inline bool accel_clipped(const uint8_t *sample) {
+  for (int ax = 0; ax < 3; ax++) {
+    uint16_t v = (uint16_t)((sample[ax * 2] << 8) | sample[ax * 2 + 1]);
+    if (v == 0x7FFF || v == 0x8000)
+      return true;
+  }
+  return false;
+}
+
+// Actualiza saturación y racha de muestras idénticas con una muestra nueva
+static inline void quality_sample(bb_acq_quality_t *q, uint16_t *run,
+                                  const uint8_t *sample,
+                                  const uint8_t *prev) {
+  if (accel_clipped(sample))
+    q->clipped++;
+  if (prev != NULL && memcmp(sample, prev, s_sample_bytes) == 0)
+    (*run)++;
+  else
+    *run = 1;
+  if (*run > q->stuck_run)
+    q->stuck_run = *run;
+}
+
+void bb_sensors_quality_scan(const uint8_t *raw_data, int len,
+                             bb_acq_quality_t *quality) {
+  uint16_t run = 0;
+  for (int i = 0; i < len; i++) {
+    const uint8_t *sample = &raw_data[i * s_sample_bytes];
+    quality_sample(quality, &run, sample,
+                   (i > 0) ? sample - s_sample_bytes : NULL);
+  }
+}
+
+bb_quality_level_t bb_sensors_quality_level(const bb_acq_quality_t *quality,
+                                            int len) {
+  if ((int)quality->failed_reads * 100 > len * BB_QUAL_MAX_FAILED_PCT ||
+      quality->stuck_run >= BB_QUAL_STUCK_RUN) {
+    return BB_QUALITY_BAD;
+  }
+  if (quality->failed_reads || quality->clipped || quality->gaps)
+    return BB_QUALITY_DEGRADED;
+  return BB_QUALITY_OK;
+}
+
+void bb_sensors_read_accel_burst_multi(uint8_t *const raw_data[], int n_imus,
+                                       int len, bb_acq_meta_t meta[]) {
   uint8_t reg = 0x3B;
+  // 6 ejes: una sola lectura de 14 bytes (0x3B..0x48 = acel, temp, giro)
+  bool gyro = (s_sample_bytes == BB_IMU6_SAMPLE_BYTES);
+  uint8_t regs[14];
+  int64_t t_first[BB_MAX_IMUS] = {0}, t_prev[BB_MAX_IMUS] = {0};
+  float dt_mean[BB_MAX_IMUS] = {0}; // Welford: media y varianza de dt
+  float dt_m2[BB_MAX_IMUS] = {0};
+  bb_acq_quality_t quality[BB_MAX_IMUS] = {0};
+  uint16_t run[BB_MAX_IMUS] = {0};
+
+  if (n_imus > s_imu_count)
+    n_imus = s_imu_count;
+
   for (int i = 0; i < len; i++) {
-    i2c_master_write_read_device(BB_I2C_MASTER_NUM, BB_MPU6050_ADDR, &reg, 1,
-                                 &raw_data[i * 6], 6, 10);
+    // Lecturas consecutivas A, B: ~150 µs de desfase fijo a 400 kHz
+    for (int k = 0; k < n_imus; k++) {
+      int64_t t = esp_timer_get_time();
+      uint8_t *dst = &raw_data[k][i * s_sample_bytes];
+      uint8_t *prev = (i > 0) ? dst - s_sample_bytes : NULL;
+      esp_err_t ret;
+      if (gyro) {
+        ret = i2c_master_write_read_device(BB_I2C_MASTER_NUM, s_imu_addr[k],
+                                           &reg, 1, regs, sizeof(regs), 10);
+        if (ret == ESP_OK) {
+          memcpy(dst, &regs[0], 6);     // ACCEL_XOUT_H..ACCEL_ZOUT_L
+          memcpy(dst + 6, &regs[8], 6); // GYRO_XOUT_H..GYRO_ZOUT_L
+        }
+      } else {
+        ret = i2c_master_write_read_device(BB_I2C_MASTER_NUM, s_imu_addr[k],
+                                           &reg, 1, dst, 6, 10);
+      }
+      if (ret == ESP_OK) {
+        quality_sample(&quality[k], &run[k], dst, prev);
+      } else {
+        // Mantener la muestra anterior: el DSP nunca ve bytes a medio leer
+        quality[k].failed_reads++;
+        if (prev != NULL)
+          memcpy(dst, prev, s_sample_bytes);
+        else
+          memset(dst, 0, s_sample_bytes);
+      }
+      if (i == 0) {
+        t_first[k] = t;
+        if (s_first_sample_us == 0)
+          s_first_sample_us = t;
+      } else {
+        float dt = (float)(t - t_prev[k]);
+        if (i > 1 && dt > 2.0f * dt_mean[k])
+          quality[k].gaps++; // Tarea desalojada: falta al menos un periodo
+        float delta = dt - dt_mean[k];
+        dt_mean[k] += delta / (float)i;
+        dt_m2[k] += delta * (dt - dt_mean[k]);
+      }
+      t_prev[k] = t;
+    }
     esp_rom_delay_us(1000);
   }
+
+  for (int k = 0; k < n_imus; k++) {
+    meta[k].t_first_us = t_first[k];
+    meta[k].t_last_us = t_prev[k];
+    meta[k].fs_hz =
+        (len > 1 && t_prev[k] > t_first[k])
+            ? (float)(len - 1) * 1e6f / (float)(t_prev[k] - t_first[k])
+            : 0.0f;
+    meta[k].jitter_us = (len > 2) ? sqrtf(dt_m2[k] / (float)(len - 2)) : 0.0f;
+    meta[k].quality = quality[k];
+  }
+}
+
+void bb_sensors_read_accel_burst(uint8_t *raw_data, int len,
+                                 bb_acq_meta_t *meta) {
+  bb_sensors_read_accel_burst_multi(&raw_data, 1, len, meta);
+}
+
+void bb_sensors_meta_from_blocks(const int64_t *block_stamps, int n_blocks,
+                                 int block_samples, float nominal_hz,
+                                 bb_acq_meta_t *meta) {
+  int n_samples = n_blocks * block_samples;
+  float period_us = 0.0f;
+  meta->jitter_us = 0.0f;
+
+  if (n_blocks >= 2 && block_stamps[n_blocks - 1] > block_stamps[0]) {
+    // El reloj lo marca el sensor: ajuste por mínimos cuadrados
+    // t(k) = t0 + k * T sobre la última muestra de cada bloque. El error de
+    // cada marca (< 1 muestra) se promedia, así dos IMU con FIFO propia
+    // quedan alineados en el tiempo con precisión de fracción de muestra.
+    float k_mean = 0.0f, t_mean = 0.0f;
+    for (int i = 0; i < n_blocks; i++) {
+      k_mean += (float)((i + 1) * block_samples - 1);
+      t_mean += (float)(block_stamps[i] - block_stamps[0]);
+    }
+    k_mean /= (float)n_blocks;
+    t_mean /= (float)n_blocks;
+
+    float s_kk = 0.0f, s_kt = 0.0f;
+    for (int i = 0; i < n_blocks; i++) {
+      float dk = (float)((i + 1) * block_samples - 1) - k_mean;
+      s_kk += dk * dk;
+      s_kt += dk * ((float)(block_stamps[i] - block_stamps[0]) - t_mean);
+    }
+    period_us = s_kt / s_kk;
+
+    if (period_us > 0.0f) {
+      meta->t_first_us =
+          block_stamps[0] + (int64_t)(t_mean - period_us * k_mean);
+
+      float span = (float)(block_stamps[n_blocks - 1] - block_stamps[0]);
+      float mean = span / (float)(n_blocks - 1);
+      float m2 = 0.0f;
+      for (int i = 1; i < n_blocks; i++) {
+        float d = (float)(block_stamps[i] - block_stamps[i - 1]) - mean;
+        m2 += d * d;
+      }
+      // Jitter de marcado por bloque, expresado por muestra
+      meta->jitter_us =
+          sqrtf(m2 / (float)(n_blocks - 1)) / (float)block_samples;
+    }
+  }
+
+  if (!(period_us > 0.0f)) {
+    period_us = 1e6f / nominal_hz;
+    meta->t_first_us = block_stamps[n_blocks - 1] -
+                       (int64_t)((float)(n_samples - 1) * period_us);
+  }
+
+  meta->fs_hz = 1e6f / period_us;
+  meta->t_last_us =
+      meta->t_first_us + (int64_t)((float)(n_samples - 1) * period_us);
 }
 
 esp_err_t bb_sensors_read_accel_single(float *ax, float *ay, float *az) {
   uint8_t raw[6];
   uint8_t reg = 0x3B;
   esp_err_t ret = i2c_master_write_read_device(
-      BB_I2C_MASTER_NUM, BB_MPU6050_ADDR, &reg, 1, raw, 6, 10);
+      BB_I2C_MASTER_NUM, s_imu_addr[0], &reg, 1, raw, 6, 10);
 
   if (ret == ESP_OK) {
     *ax = (int16_t)((raw[0] << 8) | raw[1]) / BB_ACCEL_SENS_16G;
@@ -171,3 +594,114 @@ esp_err_t bb_sensors_read_accel_single(float *ax, float *ay, float *az) {
   }
   return ret;
 }
+
+// --- MPU6050 FIFO (Adquisición Continua) ---
+
+#define MPU_REG_SMPLRT_DIV 0x19
+#define MPU_REG_FIFO_EN 0x23
+#define MPU_REG_USER_CTRL 0x6A
+#define MPU_REG_FIFO_COUNT_H 0x72
+#define MPU_REG_FIFO_R_W 0x74
+
+static esp_err_t mpu_write_reg(uint8_t addr, uint8_t reg, uint8_t val) {
+  uint8_t cmd[2] = {reg, val};
+  return i2c_master_write_to_device(BB_I2C_MASTER_NUM, addr, cmd, 2,
+                                    pdMS_TO_TICKS(10));
+}
+
+static esp_err_t mpu_fifo_reset(uint8_t addr) {
+  esp_err_t ret = mpu_write_reg(addr, MPU_REG_USER_CTRL, 0x04); // FIFO_RESET
+  if (ret == ESP_OK)
+    ret = mpu_write_reg(addr, MPU_REG_USER_CTRL, 0x40); // FIFO_EN
+  return ret;
+}
+
+static int s_stream_rate_hz = 1000;
+
+esp_err_t bb_sensors_stream_start(int sample_rate_hz) {
+  if (sample_rate_hz < BB_STREAM_RATE_MIN_HZ)
+    sample_rate_hz = BB_STREAM_RATE_MIN_HZ; // SMPLRT_DIV <= 255
+  if (sample_rate_hz > BB_STREAM_RATE_MAX_HZ)
+    sample_rate_hz = BB_STREAM_RATE_MAX_HZ;
+
+  // DLPF_CFG=0 -> reloj interno 8 kHz: Fs = 8000 / (1 + SMPLRT_DIV)
+  uint8_t div = (uint8_t)(8000 / sample_rate_hz - 1);
+
+  esp_err_t ret = ESP_OK;
+  for (int k = 0; k < s_imu_count && ret == ESP_OK; k++) {
+    ret = mpu_write_reg(s_imu_addr[k], MPU_REG_SMPLRT_DIV, div);
+    // ACCEL_FIFO_EN (+ XG/YG/ZG_FIFO_EN): la FIFO entrega acel y luego giro,
+    // el mismo layout que la ráfaga
+    if (ret == ESP_OK)
+      ret = mpu_write_reg(s_imu_addr[k], MPU_REG_FIFO_EN,
+                          s_sample_bytes == BB_IMU6_SAMPLE_BYTES ? 0x78 : 0x08);
+  }
+  // Resets seguidos: las FIFO de todos los IMU arrancan alineadas (~100 µs)
+  for (int k = 0; k < s_imu_count && ret == ESP_OK; k++)
+    ret = mpu_fifo_reset(s_imu_addr[k]);
+
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "No se pudo activar FIFO: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  s_stream_rate_hz = 8000 / (div + 1);
+  ESP_LOGI(TAG, "FIFO activa en %d IMU: %d Hz (SMPLRT_DIV=%d)", s_imu_count,
+           s_stream_rate_hz, div);
+  return ESP_OK;
+}
+
+void bb_sensors_stream_stop(void) {
+  for (int k = 0; k < s_imu_count; k++) {
+    mpu_write_reg(s_imu_addr[k], MPU_REG_FIFO_EN, 0x00);
+    mpu_write_reg(s_imu_addr[k], MPU_REG_USER_CTRL, 0x00);
+    mpu_write_reg(s_imu_addr[k], MPU_REG_SMPLRT_DIV, 0x00);
+  }
+}
+
+int bb_sensors_stream_read(int imu, uint8_t *dst, int max_samples,
+                           bool *overflow, int64_t *t_last_us) {
+  uint8_t reg = MPU_REG_FIFO_COUNT_H;
+  uint8_t cnt[2];
+  *overflow = false;
+
+  if (imu < 0 || imu >= s_imu_count)
+    return -1;
+  uint8_t addr = s_imu_addr[imu];
+
+  int64_t t_count = esp_timer_get_time();
+  esp_err_t ret = i2c_master_write_read_device(
+      BB_I2C_MASTER_NUM, addr, &reg, 1, cnt, 2, pdMS_TO_TICKS(10));
+  if (ret != ESP_OK)
+    return -1;
+
+  int count = (cnt[0] << 8) | cnt[1];
+  if (count >= BB_MPU6050_FIFO_SIZE) {
+    // 1024 no es múltiplo de 6/12: tras desbordar se pierde la alineación
+    *overflow = true;
+    mpu_fifo_reset(addr);
+    return 0;
+  }
+
+  int avail = count / s_sample_bytes;
+  int n = (avail > max_samples) ? max_samples : avail;
+  if (n == 0)
+    return 0;
+
+  // La muestra más reciente de la FIFO se capturó ~en t_count; las n que
+  // devolvemos son las más antiguas
+  *t_last_us = t_count - (int64_t)(avail - n) * 1000000 / s_stream_rate_hz;
+
+  reg = MPU_REG_FIFO_R_W;
+  ret = i2c_master_write_read_device(BB_I2C_MASTER_NUM, addr, &reg, 1, dst,
+                                     n * s_sample_bytes,
+                                     pdMS_TO_TICKS(20));
+  if (ret != ESP_OK) {
+    // Lectura parcial de la FIFO: muestras desalineadas a partir de aquí
+    mpu_fifo_reset(addr);
+    return -1;
+  }
+  if (s_first_sample_us == 0)
+    s_first_sample_us =
+        *t_last_us - (int64_t)(n - 1) * 1000000 / s_stream_rate_hz;
+  return n;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file onewire_codec.c
+ * @brief Decodificación 1-Wire independiente del hardware
+ */
+
+#include "onewire_codec.h"
+#include <string.h>
+
+// Layout de rmt_symbol_word_t (ESP-IDF 5.x)
+#define RMT_SYM_DURATION0(w) ((uint16_t)((w) & 0x7FFF))
+#define RMT_SYM_LEVEL0(w) (((w) >> 15) & 0x1)
+#define RMT_SYM_DURATION1(w) ((uint16_t)(((w) >> 16) & 0x7FFF))
+#define RMT_SYM_LEVEL1(w) (((w) >> 31) & 0x1)
+
+size_t ow_extract_low_pulses(const uint32_t *symbols, size_t n_symbols,
+                             uint16_t *low_us, size_t max_pulses) {
+  size_t n = 0;
+  uint32_t acc_low = 0; // Un pulso bajo puede venir partido en dos mitades
+
+  for (size_t i = 0; i < n_symbols; i++) {
+    uint16_t dur[2] = {RMT_SYM_DURATION0(symbols[i]),
+                       RMT_SYM_DURATION1(symbols[i])};
+    uint8_t lvl[2] = {RMT_SYM_LEVEL0(symbols[i]), RMT_SYM_LEVEL1(symbols[i])};
+
+    for (int h = 0; h < 2; h++) {
+      if (dur[h] == 0) {
+        // Fin de captura
+        if (acc_low > 0 && n < max_pulses)
+          low_us[n++] = (uint16_t)acc_low;
+        return n;
+      }
+      if (lvl[h] == 0) {
+        acc_low += dur[h];
+      } else if (acc_low > 0) {
+        if (n >= max_pulses)
+          return n;
+        low_us[n++] = (acc_low > 0xFFFF) ? 0xFFFF : (uint16_t)acc_low;
+        acc_low = 0;
+      }
+    }
+  }
+
+  if (acc_low > 0 && n < max_pulses)
+    low_us[n++] = (uint16_t)acc_low;
+  return n;
+}
+
+bool ow_decode_presence(const uint16_t *low_us, size_t n) {
+  // low_us[0] es nuestro propio pulso de reset (loopback)
+  for (size_t i = 1; i < n; i++) {
+    if (low_us[i] >= OW_PRESENCE_MIN_US && low_us[i] <= OW_PRESENCE_MAX_US)
+      return true;
+  }
+  return false;
+}
+
+bool ow_decode_bits(const uint16_t *low_us, size_t n_bits, uint32_t *out) {
+  if (n_bits > 32)
+    return false;
+
+  uint32_t v = 0;
+  for (size_t i = 0; i < n_bits; i++) {
+    if (low_us[i] == 0)
+      return false;
+    if (low_us[i] <= OW_READ_THRESHOLD_US)
+      v |= (1UL << i);
+  }
+  *out = v;
+  return true;
+}
+
+uint8_t ow_crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = data[i];
+    for (int j = 0; j < 8; j++) {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if (mix)
+        crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return crc;
+}
+
+void ow_search_reset(ow_search_t *s) {
+  memset(s->rom, 0, sizeof(s->rom));
+  s->last_discrepancy = 0;
+  s->last_device = false;
+}
+
+bool ow_search_next(ow_search_t *s, ow_search_begin_fn begin,
+                    ow_triplet_fn triplet, void *ctx) {
+  if (s->last_device)
+    return false;
+
+  if (!begin(ctx)) {
+    ow_search_reset(s);
+    return false;
+  }
+
+  int last_zero = 0;
+  for (int bit = 1; bit <= 64; bit++) {
+    int byte_idx = (bit - 1) / 8;
+    uint8_t mask = (uint8_t)(1u << ((bit - 1) % 8));
+
+    bool dir_if_conflict;
+    if (bit < s->last_discrepancy)
+      dir_if_conflict = (s->rom[byte_idx] & mask) != 0;
+    else
+      dir_if_conflict = (bit == s->last_discrepancy);
+
+    bool id_bit, cmp_bit, dir;
+    if (!triplet(ctx, dir_if_conflict, &id_bit, &cmp_bit, &dir)) {
+      ow_search_reset(s);
+      return false;
+    }
+
+    if (id_bit && cmp_bit) {
+      // Ningún dispositivo respondió en este bit
+      ow_search_reset(s);
+      return false;
+    }
+
+    if (!id_bit && !cmp_bit && !dir)
+      last_zero = bit;
+
+    if (dir)
+      s->rom[byte_idx] |= mask;
+    else
+      s->rom[byte_idx] &= (uint8_t)~mask;
+  }
+
+  if (s->rom[0] == 0 || ow_crc8(s->rom, 7) != s->rom[7]) {
+    ow_search_reset(s);
+    return false;
+  }
+
+  s->last_discrepancy = last_zero;
+  if (last_zero == 0)
+    s->last_device = true;
+  return true;
+}
+
+uint64_t ow_rom_to_u64(const uint8_t rom[8]) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | rom[i];
+  return v;
+}
+
+bool ds18b20_decode_scratchpad(const uint8_t sp[DS18B20_SCRATCHPAD_LEN],
+                               float *temp_c) {
+  bool all_ones = true;
+  for (int i = 0; i < DS18B20_SCRATCHPAD_LEN; i++) {
+    if (sp[i] != 0xFF) {
+      all_ones = false;
+      break;
+    }
+  }
+  if (all_ones || ow_crc8(sp, 8) != sp[8])
+    return false;
+
+  int16_t raw = (int16_t)((sp[1] << 8) | sp[0]);
+
+  // Bits indefinidos según resolución (byte de configuración R1:R0)
+  switch ((sp[4] >> 5) & 0x03) {
+  case 0: // 9 bit
+    raw &= ~0x7;
+    break;
+  case 1: // 10 bit
+    raw &= ~0x3;
+    break;
+  case 2: // 11 bit
+    raw &= ~0x1;
+    break;
+  default: // 12 bit
+    break;
+  }
+
+  *temp_c = (float)raw / 16.0f;
+  return true;
+}
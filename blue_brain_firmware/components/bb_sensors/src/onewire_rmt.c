@@ -0,0 +1,241 @@
+/**
+ * @file onewire_rmt.c
+ * @brief Driver 1-Wire basado en RMT (reemplaza el bit-bang con
+ * esp_rom_delay_us)
+ */
+
+#include "onewire_rmt.h"
+#include "driver/rmt_rx.h"
+#include "driver/rmt_tx.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "onewire_codec.h"
+
+static const char *TAG = "ONEWIRE_RMT";
+
+#define OW_RMT_RESOLUTION_HZ 1000000 // 1 tick = 1 µs
+#define OW_RMT_MEM_SYMBOLS 48        // Un bloque de memoria RMT en ESP32-S3
+#define OW_RX_MIN_NS 1000            // Filtro de glitches
+#define OW_RX_IDLE_NS 150000         // > slot completo: fin de captura
+// El reset tiene 500 µs en bajo: con el umbral de los slots la captura
+// acabaría dentro del propio reset, antes del pulso de presencia
+#define OW_RX_RESET_IDLE_NS ((OW_RESET_LOW_US + OW_RESET_WAIT_US) * 1000)
+#define OW_TIMEOUT_MS 20
+
+static rmt_channel_handle_t s_tx_chan = NULL;
+static rmt_channel_handle_t s_rx_chan = NULL;
+static rmt_encoder_handle_t s_copy_encoder = NULL;
+static QueueHandle_t s_rx_queue = NULL;
+static rmt_symbol_word_t s_rx_symbols[OW_RMT_MEM_SYMBOLS];
+
+static const rmt_symbol_word_t SYM_RESET = {.level0 = 0,
+                                            .duration0 = OW_RESET_LOW_US,
+                                            .level1 = 1,
+                                            .duration1 = OW_RESET_WAIT_US};
+static const rmt_symbol_word_t SYM_BIT1 = {.level0 = 0,
+                                           .duration0 = OW_SLOT_START_US,
+                                           .level1 = 1,
+                                           .duration1 = OW_SLOT_RECOVER_US};
+static const rmt_symbol_word_t SYM_BIT0 = {.level0 = 0,
+                                           .duration0 = OW_WRITE0_LOW_US,
+                                           .level1 = 1,
+                                           .duration1 = OW_WRITE0_RECOVER_US};
+
+static const rmt_transmit_config_t s_tx_cfg = {
+    .loop_count = 0,
+    .flags.eot_level = 1, // Liberar la línea al terminar
+};
+
+static const rmt_receive_config_t s_rx_cfg = {
+    .signal_range_min_ns = OW_RX_MIN_NS,
+    .signal_range_max_ns = OW_RX_IDLE_NS,
+};
+
+static const rmt_receive_config_t s_rx_reset_cfg = {
+    .signal_range_min_ns = OW_RX_MIN_NS,
+    .signal_range_max_ns = OW_RX_RESET_IDLE_NS,
+};
+
+static bool IRAM_ATTR ow_rx_done_cb(rmt_channel_handle_t channel,
+                                    const rmt_rx_done_event_data_t *edata,
+                                    void *user_ctx) {
+  BaseType_t woken = pdFALSE;
+  xQueueSendFromISR((QueueHandle_t)user_ctx, edata, &woken);
+  return woken == pdTRUE;
+}
+
+esp_err_t onewire_rmt_init(gpio_num_t gpio) {
+  s_rx_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+  if (s_rx_queue == NULL)
+    return ESP_ERR_NO_MEM;
+
+  // RX primero: el canal TX en loopback comparte el pin
+  rmt_rx_channel_config_t rx_cfg = {
+      .gpio_num = gpio,
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = OW_RMT_RESOLUTION_HZ,
+      .mem_block_symbols = OW_RMT_MEM_SYMBOLS,
+  };
+  esp_err_t ret = rmt_new_rx_channel(&rx_cfg, &s_rx_chan);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Error creando canal RX: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  rmt_tx_channel_config_t tx_cfg = {
+      .gpio_num = gpio,
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = OW_RMT_RESOLUTION_HZ,
+      .mem_block_symbols = OW_RMT_MEM_SYMBOLS,
+      .trans_queue_depth = 4,
+      .flags.io_loop_back = true, // RX ve lo que transmitimos
+      .flags.io_od_mode = true,   // Open-drain: el esclavo puede bajar la línea
+  };
+  ret = rmt_new_tx_channel(&tx_cfg, &s_tx_chan);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Error creando canal TX: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  rmt_copy_encoder_config_t enc_cfg = {};
+  ESP_ERROR_CHECK(rmt_new_copy_encoder(&enc_cfg, &s_copy_encoder));
+
+  rmt_rx_event_callbacks_t cbs = {.on_recv_done = ow_rx_done_cb};
+  ESP_ERROR_CHECK(
+      rmt_rx_register_event_callbacks(s_rx_chan, &cbs, s_rx_queue));
+
+  ESP_ERROR_CHECK(rmt_enable(s_rx_chan));
+  ESP_ERROR_CHECK(rmt_enable(s_tx_chan));
+
+  ESP_LOGI(TAG, "Bus 1-Wire RMT listo en GPIO %d", gpio);
+  return ESP_OK;
+}
+
+// Transmite símbolos y (opcionalmente) captura los pulsos bajos de la línea
+// con la ventana de rx_cfg
+static esp_err_t ow_transfer(const rmt_symbol_word_t *tx, size_t n_tx,
+                             const rmt_receive_config_t *rx_cfg,
+                             uint16_t *low_us, size_t max_pulses,
+                             size_t *n_pulses) {
+  if (s_tx_chan == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  if (low_us != NULL) {
+    xQueueReset(s_rx_queue);
+    esp_err_t ret =
+        rmt_receive(s_rx_chan, s_rx_symbols, sizeof(s_rx_symbols), rx_cfg);
+    if (ret != ESP_OK)
+      return ret;
+  }
+
+  esp_err_t ret = rmt_transmit(s_tx_chan, s_copy_encoder, tx,
+                               n_tx * sizeof(rmt_symbol_word_t), &s_tx_cfg);
+  if (ret != ESP_OK)
+    return ret;
+
+  ret = rmt_tx_wait_all_done(s_tx_chan, OW_TIMEOUT_MS);
+  if (ret != ESP_OK)
+    return ret;
+
+  if (low_us != NULL) {
+    rmt_rx_done_event_data_t evt;
+    if (xQueueReceive(s_rx_queue, &evt, pdMS_TO_TICKS(OW_TIMEOUT_MS)) !=
+        pdTRUE) {
+      return ESP_ERR_TIMEOUT;
+    }
+    *n_pulses = ow_extract_low_pulses((const uint32_t *)evt.received_symbols,
+                                      evt.num_symbols, low_us, max_pulses);
+  }
+  return ESP_OK;
+}
+
+esp_err_t onewire_rmt_reset(bool *present) {
+  uint16_t pulses[4];
+  size_t n = 0;
+  esp_err_t ret = ow_transfer(&SYM_RESET, 1, &s_rx_reset_cfg, pulses, 4, &n);
+  *present = (ret == ESP_OK) && ow_decode_presence(pulses, n);
+  return ret;
+}
+
+esp_err_t onewire_rmt_write_bytes(const uint8_t *data, size_t len) {
+  rmt_symbol_word_t sym[8];
+  for (size_t b = 0; b < len; b++) {
+    for (int i = 0; i < 8; i++)
+      sym[i] = (data[b] & (1 << i)) ? SYM_BIT1 : SYM_BIT0;
+    esp_err_t ret = ow_transfer(sym, 8, NULL, NULL, 0, NULL);
+    if (ret != ESP_OK)
+      return ret;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t ow_read_bits(size_t n_bits, uint32_t *out) {
+  rmt_symbol_word_t sym[8];
+  uint16_t pulses[8];
+  size_t n = 0;
+
+  for (size_t i = 0; i < n_bits; i++)
+    sym[i] = SYM_BIT1; // Slot de lectura == escribir 1
+
+  esp_err_t ret = ow_transfer(sym, n_bits, &s_rx_cfg, pulses, n_bits, &n);
+  if (ret != ESP_OK)
+    return ret;
+  if (n < n_bits || !ow_decode_bits(pulses, n_bits, out))
+    return ESP_ERR_INVALID_RESPONSE;
+  return ESP_OK;
+}
+
+esp_err_t onewire_rmt_read_bytes(uint8_t *data, size_t len) {
+  for (size_t b = 0; b < len; b++) {
+    uint32_t v = 0;
+    esp_err_t ret = ow_read_bits(8, &v);
+    if (ret != ESP_OK)
+      return ret;
+    data[b] = (uint8_t)v;
+  }
+  return ESP_OK;
+}
+
+// --- Adaptadores para ow_search_next() ---
+
+static bool ow_search_begin(void *ctx) {
+  bool present = false;
+  if (onewire_rmt_reset(&present) != ESP_OK || !present)
+    return false;
+  uint8_t cmd = OW_CMD_SEARCH_ROM;
+  return onewire_rmt_write_bytes(&cmd, 1) == ESP_OK;
+}
+
+static bool ow_search_triplet(void *ctx, bool dir_if_conflict, bool *id_bit,
+                              bool *cmp_bit, bool *dir_taken) {
+  uint32_t bits = 0;
+  if (ow_read_bits(2, &bits) != ESP_OK)
+    return false;
+
+  *id_bit = bits & 0x1;
+  *cmp_bit = (bits >> 1) & 0x1;
+  if (*id_bit && *cmp_bit) {
+    *dir_taken = true;
+    return true; // El llamador detecta "sin dispositivos"
+  }
+  *dir_taken = (*id_bit != *cmp_bit) ? *id_bit : dir_if_conflict;
+
+  const rmt_symbol_word_t sym = *dir_taken ? SYM_BIT1 : SYM_BIT0;
+  return ow_transfer(&sym, 1, NULL, NULL, 0, NULL) == ESP_OK;
+}
+
+int onewire_rmt_search(uint8_t (*roms)[8], int max) {
+  ow_search_t s;
+  ow_search_reset(&s);
+
+  int found = 0;
+  while (found < max &&
+         ow_search_next(&s, ow_search_begin, ow_search_triplet, NULL)) {
+    for (int i = 0; i < 8; i++)
+      roms[found][i] = s.rom[i];
+    found++;
+  }
+  return found;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file bb_backlog.h
+ * @brief Cola FIFO persistente en SPIFFS (store-and-forward)
+ *
+ * Registros de tamaño fijo en un fichero circular. La cabecera guarda la
+ * secuencia del siguiente registro a escribir (head) y la del más antiguo
+ * sin enviar (tail): sobreviven a reinicios. Con el log lleno, push()
+ * sobrescribe el más antiguo (contado en dropped). Mientras el fichero
+ * crece (primera vuelta) cada push() comprueba antes que quepa en la
+ * partición (bb_storage_has_room).
+ *
+ * Semántica al menos una vez: el llamador hace pop() después de entregar;
+ * un corte entre entrega y pop() repite esos registros al volver.
+ *
+ * Formato (little-endian nativo del ESP32-S3):
+ *   Cabecera (32 B): magic, schema, rec_bytes, capacity, head, tail,
+ *                    dropped, reservado, crc32 de los campos anteriores
+ *   Ranura i (12 B + rec_bytes): seq u32, len u16, reservado u16, crc32,
+ *                                datos
+ * La ranura de la secuencia s es s % capacity.
+ */
+
+#ifndef BB_BACKLOG_H
+#define BB_BACKLOG_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t count;    // Registros pendientes
+  uint32_t capacity; // Máximo antes de sobrescribir
+  uint32_t dropped;  // Sobrescritos sin enviar (log lleno)
+  uint32_t corrupt;  // Descartados por CRC o secuencia incorrecta
+  uint32_t pushed;   // Escritos desde el arranque
+  uint32_t no_space; // Rechazados: SPIFFS sin hueco para crecer
+} bb_backlog_stats_t;
+
+/**
+ * @brief Abre (o prepara) el log. Si el fichero existente no coincide en
+ * schema, rec_bytes o capacity, se descarta y se empieza vacío.
+ * @param schema Versión del formato del registro del llamador
+ * @return ESP_OK, ESP_ERR_NO_MEM o ESP_ERR_INVALID_ARG
+ */
+esp_err_t bb_backlog_init(const char *path, uint16_t schema,
+                          uint16_t rec_bytes, uint32_t capacity);
+
+/**
+ * @brief Añade un registro al final (len <= rec_bytes)
+ * @return ESP_OK, ESP_ERR_NO_MEM (SPIFFS sin hueco: el registro no se
+ * guarda) o ESP_FAIL si no se pudo escribir en flash
+ */
+esp_err_t bb_backlog_push(const void *rec, size_t len);
+
+/**
+ * @brief Lee el registro index-ésimo desde el más antiguo (sin quitarlo)
+ * @param len_out Longitud del registro (puede ser NULL)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND (no hay tantos) o ESP_ERR_INVALID_CRC
+ * (registro dañado: el llamador debe saltarlo con pop)
+ */
+esp_err_t bb_backlog_peek(uint32_t index, void *rec, size_t cap,
+                          size_t *len_out);
+
+/**
+ * @brief Quita los n registros más antiguos (ya entregados). Al vaciarse
+ * el log se borra el fichero para liberar la partición.
+ */
+esp_err_t bb_backlog_pop(uint32_t n);
+
+/**
+ * @brief Registros pendientes (0 si el log no está inicializado)
+ */
+uint32_t bb_backlog_count(void);
+
+/**
+ * @brief Copia las estadísticas del log
+ */
+void bb_backlog_get_stats(bb_backlog_stats_t *out);
+
+#endif // BB_BACKLOG_H
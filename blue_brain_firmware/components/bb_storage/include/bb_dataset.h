@@ -0,0 +1,113 @@
+/**
+ * @file bb_dataset.h
+ * @brief Dataset de entrenamiento: log binario de solo añadir en SPIFFS
+ *
+ * Cada muestra es un registro de tamaño fijo (etiqueta + n_features float).
+ * Quien captura solo la encola (bb_dataset_append, sin tocar la flash); una
+ * tarea escritora propia las agrupa en bloques de BB_DATASET_BLOCK_RECORDS y
+ * escribe cada bloque de una vez con el fichero ya abierto. Un bloque a
+ * medias baja tras BB_DATASET_IDLE_MS sin muestras nuevas o al pedir
+ * bb_dataset_flush(); el siguiente se completa hasta el límite de bloque,
+ * así que las escrituras vuelven a quedar alineadas.
+ *
+ * El CSV no existe en flash: bb_dataset_export_csv() lo genera al vuelo
+ * mientras se descarga.
+ *
+ * Tamaño acotado: como mucho max_records registros. Lleno, las muestras
+ * nuevas se rechazan en lugar de rotar: un dataset de entrenamiento no
+ * debe perder en silencio sus primeras etiquetas. Cada bloque comprueba
+ * además antes de escribirse que quepa en la partición
+ * (bb_storage_has_room).
+ *
+ * Formato (little-endian nativo del ESP32-S3):
+ *   Cabecera (32 B): magic, schema, n_features, rec_bytes, reservado (18 B),
+ *                    crc32 de los campos anteriores
+ *   Registro i (12 B + 4 * n_features): seq u32 (= i), label i16,
+ *                    reservado u16, features f32[n_features], crc32
+ * Al abrir, un registro final incompleto o dañado (corte a media escritura)
+ * se ignora y el siguiente bloque lo sobrescribe.
+ */
+
+#ifndef BB_DATASET_H
+#define BB_DATASET_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define BB_DATASET_MAX_FEATURES 24  // Features por registro como mucho
+#define BB_DATASET_BLOCK_RECORDS 16 // Registros por escritura en flash
+#define BB_DATASET_QUEUE_LEN 32     // Muestras en espera de la escritora
+#define BB_DATASET_IDLE_MS 2000     // Bloque a medias: baja tras este reposo
+
+typedef struct {
+  uint32_t records;    // En flash
+  uint32_t pending;    // En cola o en el bloque aún sin escribir
+  uint32_t queue_full; // append() rechazados (la escritora no da abasto)
+  uint32_t write_err;  // Registros perdidos por fallo de escritura
+  uint32_t blocks;     // Escrituras en flash desde el arranque
+  uint32_t max;        // Registros como mucho (bb_dataset_init)
+  uint32_t full;       // Muestras rechazadas con el dataset lleno
+  uint32_t no_space;   // Registros perdidos: SPIFFS sin hueco
+} bb_dataset_stats_t;
+
+/**
+ * @brief Sink del CSV: recibe el texto por trozos
+ * @return ESP_OK para seguir; otro valor corta la exportación
+ */
+typedef esp_err_t (*bb_dataset_sink_t)(void *ctx, const char *buf,
+                                       size_t len);
+
+/**
+ * @brief Abre (o prepara) el log y arranca la tarea escritora. Si el fichero
+ * existente no coincide en schema o n_features, se descarta y se empieza
+ * vacío.
+ * @param max_records Tope del dataset (uno mayor que ya hay en flash se
+ * conserva, pero no crece)
+ * @return ESP_OK, ESP_ERR_NO_MEM o ESP_ERR_INVALID_ARG
+ */
+esp_err_t bb_dataset_init(const char *path, uint16_t schema,
+                          uint16_t n_features, uint32_t max_records);
+
+/**
+ * @brief Encola una muestra (no bloquea ni toca la flash)
+ * @param features n_features valores
+ * @return ESP_OK, ESP_ERR_TIMEOUT (cola llena: reintentar), ESP_ERR_NO_MEM
+ * (dataset lleno: no reintentar) o ESP_ERR_INVALID_STATE
+ */
+esp_err_t bb_dataset_append(int16_t label, const float *features);
+
+/**
+ * @brief Escribe en flash todo lo encolado hasta ahora y espera a que acabe
+ * @return ESP_OK, ESP_ERR_TIMEOUT o ESP_ERR_INVALID_STATE
+ */
+esp_err_t bb_dataset_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Borra el dataset (lo encolado antes también)
+ */
+esp_err_t bb_dataset_clear(uint32_t timeout_ms);
+
+/**
+ * @brief Registros en flash (0 si no está inicializado)
+ */
+uint32_t bb_dataset_count(void);
+
+/**
+ * @brief Baja lo pendiente y genera el CSV de todos los registros: una línea
+ * de cabecera (columns + "label") y una por registro. Los dañados se saltan.
+ * @param columns Nombre de cada feature (n_features)
+ * @param decimals Decimales de cada feature (n_features)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND (dataset vacío), ESP_ERR_NO_MEM, ESP_FAIL
+ * (lectura) o el error devuelto por el sink
+ */
+esp_err_t bb_dataset_export_csv(const char *const *columns,
+                                const uint8_t *decimals,
+                                bb_dataset_sink_t sink, void *ctx);
+
+/**
+ * @brief Copia las estadísticas del log
+ */
+void bb_dataset_get_stats(bb_dataset_stats_t *out);
+
+#endif // BB_DATASET_H
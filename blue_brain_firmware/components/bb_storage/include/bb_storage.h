@@ -1,9 +1,37 @@
 #ifndef BB_STORAGE_H
 #define BB_STORAGE_H
 
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Libre siempre en SPIFFS: margen para su recolección y para los ficheros
+// que no tienen tamaño fijo (presupuesto en bb_config.h)
+#define BB_STORAGE_RESERVE_BYTES (64 * 1024)
+
 /**
  * @brief Inicializa el sistema de almacenamiento (SPIFFS/NVS)
  */
 void bb_storage_init(void);
 
+/**
+ * @brief Número de arranque (persistente en NVS, empieza en 1)
+ */
+uint32_t bb_storage_boot_id(void);
+
+/**
+ * @brief Ocupación de la partición SPIFFS (esp_spiffs_info)
+ * @return ESP_OK, o el error de esp_spiffs_info (partición sin montar)
+ */
+esp_err_t bb_storage_usage(size_t *total, size_t *used);
+
+/**
+ * @brief ¿Caben bytes más y siguen libres BB_STORAGE_RESERVE_BYTES?
+ *
+ * Se pregunta antes de hacer crecer un fichero (backlog, series, dataset);
+ * sobrescribir lo que ya ocupa no lo necesita. Sin partición, false.
+ */
+bool bb_storage_has_room(size_t bytes);
+
 #endif // BB_STORAGE_H
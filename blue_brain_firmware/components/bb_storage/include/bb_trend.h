@@ -0,0 +1,138 @@
+/**
+ * @file bb_trend.h
+ * @brief Serie temporal persistente en SPIFFS (tendencias de los reportes)
+ *
+ * Registros de tamaño fijo en un fichero circular que solo se escribe por
+ * el final: la ranura de la secuencia s es s % capacity y no se toca hasta
+ * la vuelta siguiente. No hay cabecera de estado que reescribir en cada
+ * registro (a diferencia de bb_backlog): cada ranura lleva su secuencia y
+ * su crc32, y al abrir se reconstruye todo a partir de ellas.
+ *
+ * Desgaste: los registros esperan en RAM y bajan a flash en bloques de
+ * BB_TREND_FLUSH_RECORDS ranuras alineadas (256 B con ranuras de 32 B), no
+ * uno a uno. SPIFFS reparte las escrituras por la partición.
+ *
+ * Índice disperso en RAM: secuencia y hora de la primera ranura de cada
+ * bloque de BB_TREND_INDEX_EVERY. Se lee al abrir (capacity /
+ * BB_TREND_INDEX_EVERY lecturas) y se mantiene al escribir. Buscar una hora
+ * es una búsqueda binaria sobre el índice más, como mucho, un bloque de
+ * lecturas: O(log n).
+ *
+ * La hora no baja nunca: un registro anterior al último (reloj ajustado
+ * hacia atrás) se guarda con la hora del último. Así el orden de secuencia
+ * es también orden temporal.
+ *
+ * Corte de alimentación: se pierde lo que aún estaba en RAM y, como mucho,
+ * el bloque a medio escribir (falla el crc y se salta).
+ *
+ * Hueco en la partición: mientras el fichero crece (primera vuelta), cada
+ * bloque comprueba antes bb_storage_has_room(); sin hueco se descarta como
+ * un fallo de escritura (contado en no_space). Después se reutilizan las
+ * ranuras y no hace falta preguntar.
+ *
+ * Formato (little-endian nativo del ESP32-S3):
+ *   Cabecera (32 B, solo al crear): magic, schema, data_bytes, capacity,
+ *                                   index_every, reservado x3, crc32
+ *   Ranura i (12 B + data_bytes): seq u32, t_s u32, datos, crc32 de todo
+ *                                 lo anterior
+ *
+ * Cada serie es un bb_trend_t del llamador (un fichero por serie): la
+ * resolución de 10 s y los agregados de bb_history comparten el código.
+ * Solo usa stdio sobre el fichero: en el host la partición es un fichero
+ * cualquiera.
+ */
+
+#ifndef BB_TREND_H
+#define BB_TREND_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define BB_TREND_INDEX_EVERY 32  // Ranuras por entrada del índice en RAM
+#define BB_TREND_FLUSH_RECORDS 8 // Ranuras por escritura en flash
+
+typedef struct {
+  uint32_t count;     // Registros guardados
+  uint32_t capacity;  // Máximo antes de sobrescribir el más antiguo
+  uint32_t oldest_t;  // Hora del más antiguo legible (0 = vacío)
+  uint32_t newest_t;  // Hora del más reciente (0 = vacío)
+  uint32_t appended;  // Añadidos desde el arranque
+  uint32_t corrupt;   // Ranuras saltadas por crc o secuencia incorrecta
+  uint32_t write_err; // Bloques que no se pudieron escribir
+  uint32_t no_space;  // Bloques descartados: SPIFFS sin hueco para crecer
+} bb_trend_stats_t;
+
+typedef struct {
+  uint32_t seq; // UINT32_MAX: primera ranura del bloque ilegible
+  uint32_t t_s;
+} bb_trend_index_t;
+
+// Estado de una serie (campos internos: usar solo la API)
+typedef struct {
+  char path[32];
+  FILE *f;
+  SemaphoreHandle_t lock;   // Añade Task_Comms; consultan Web UI y MQTT
+  uint16_t schema;
+  uint16_t data_bytes;
+  uint32_t capacity;
+  size_t stride;            // Bytes por ranura
+  bb_trend_index_t *index;  // capacity / BB_TREND_INDEX_EVERY entradas
+  uint8_t *pending;         // Ranuras aún en RAM (BB_TREND_FLUSH_RECORDS)
+  uint32_t n_pending;
+  uint8_t *scratch;         // Última ranura leída
+  uint32_t file_slots;      // Ranuras que ya ocupa el fichero
+  uint32_t next_seq;
+  uint32_t last_t;          // La hora no baja
+  uint32_t appended;
+  uint32_t corrupt;
+  uint32_t write_err;
+  uint32_t no_space;
+} bb_trend_t;
+
+/**
+ * @brief Abre (o crea) la serie t (a cero la primera vez). Si el fichero
+ * existente no coincide en schema, data_bytes o capacity, se descarta y se
+ * empieza vacía.
+ * @param capacity Se redondea hacia abajo a múltiplo de
+ * BB_TREND_INDEX_EVERY
+ * @return ESP_OK, ESP_ERR_NO_MEM, ESP_ERR_INVALID_ARG o ESP_FAIL (sin
+ * fichero)
+ */
+esp_err_t bb_trend_init(bb_trend_t *t, const char *path, uint16_t schema,
+                        uint16_t data_bytes, uint32_t capacity);
+
+/**
+ * @brief Añade un registro (data_bytes de data) con hora t_s
+ * @return ESP_OK, ESP_ERR_NO_MEM (SPIFFS sin hueco) o ESP_FAIL si el
+ * bloque no se pudo escribir en flash
+ */
+esp_err_t bb_trend_append(bb_trend_t *t, uint32_t t_s, const void *data);
+
+/**
+ * @brief Escribe en flash lo que espera en RAM (antes de reiniciar)
+ */
+esp_err_t bb_trend_flush(bb_trend_t *t);
+
+/**
+ * @brief Registros con from_s <= t_s <= to_s, repartidos por igual en como
+ * mucho max_points puntos (uno de cada ceil(matched / max_points))
+ *
+ * Cada punto va a out como t_s u32 + data_bytes de datos, uno detrás de
+ * otro; max_points se limita además a lo que cabe en cap.
+ * @param n_out Puntos escritos
+ * @param matched Registros en el rango (puede ser NULL)
+ */
+esp_err_t bb_trend_query(bb_trend_t *t, uint32_t from_s, uint32_t to_s,
+                         uint32_t max_points, uint8_t *out, size_t cap,
+                         uint32_t *n_out, uint32_t *matched);
+
+/**
+ * @brief Copia las estadísticas de la serie
+ */
+void bb_trend_get_stats(bb_trend_t *t, bb_trend_stats_t *out);
+
+#endif // BB_TREND_H
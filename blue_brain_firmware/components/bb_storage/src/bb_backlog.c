@@ -0,0 +1,261 @@
+/**
+ * @file bb_backlog.c
+ * @brief FIFO persistente de registros fijos sobre un fichero circular
+ */
+
+#include "bb_backlog.h"
+#include "bb_storage.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "BB_BACKLOG";
+
+#define BACKLOG_MAGIC 0x474C4242u // "BBLG"
+
+typedef struct {
+  uint32_t magic;
+  uint16_t schema;
+  uint16_t rec_bytes;
+  uint32_t capacity;
+  uint32_t head; // Secuencia del siguiente registro a escribir
+  uint32_t tail; // Secuencia del registro más antiguo pendiente
+  uint32_t dropped;
+  uint32_t reserved;
+  uint32_t crc; // crc32 de los campos anteriores
+} backlog_header_t;
+
+typedef struct {
+  uint32_t seq; // Distingue una ranura vigente de una de la vuelta anterior
+  uint16_t len;
+  uint16_t reserved;
+  uint32_t crc; // crc32 de los datos
+} backlog_slot_t;
+
+_Static_assert(sizeof(backlog_header_t) == 32, "cabecera del backlog");
+_Static_assert(sizeof(backlog_slot_t) == 12, "ranura del backlog");
+
+static struct {
+  char path[32];
+  FILE *f; // Abierto solo mientras hay registros pendientes
+  backlog_header_t hdr;
+  SemaphoreHandle_t lock; // Escribe Task_Comms; leen las estadísticas
+  uint32_t corrupt;
+  uint32_t pushed;
+  uint32_t no_space;
+} s_log;
+
+static uint32_t header_crc(const backlog_header_t *h) {
+  return esp_rom_crc32_le(0, (const uint8_t *)h,
+                          offsetof(backlog_header_t, crc));
+}
+
+static size_t slot_bytes(void) {
+  return sizeof(backlog_slot_t) + s_log.hdr.rec_bytes;
+}
+
+static long slot_offset(uint32_t seq) {
+  return (long)sizeof(backlog_header_t) +
+         (long)(seq % s_log.hdr.capacity) * (long)slot_bytes();
+}
+
+// El fichero solo crece en la primera vuelta (sin fichero, head es 0); luego
+// reutiliza sus ranuras y no hace falta preguntar a la partición
+static bool log_has_room(void) {
+  if (s_log.f == NULL)
+    return bb_storage_has_room(sizeof(backlog_header_t) + slot_bytes());
+  return s_log.hdr.head >= s_log.hdr.capacity ||
+         bb_storage_has_room(slot_bytes());
+}
+
+static esp_err_t header_write(void) {
+  s_log.hdr.crc = header_crc(&s_log.hdr);
+  if (fseek(s_log.f, 0, SEEK_SET) != 0 ||
+      fwrite(&s_log.hdr, sizeof(s_log.hdr), 1, s_log.f) != 1) {
+    return ESP_FAIL;
+  }
+  // Cabecera en flash antes de dar el push/pop por hecho
+  fflush(s_log.f);
+  fsync(fileno(s_log.f));
+  return ESP_OK;
+}
+
+// Log vacío: sin fichero no ocupa la partición (training_data.csv)
+static void log_reset(void) {
+  if (s_log.f != NULL) {
+    fclose(s_log.f);
+    s_log.f = NULL;
+  }
+  remove(s_log.path);
+  s_log.hdr.head = 0;
+  s_log.hdr.tail = 0;
+}
+
+esp_err_t bb_backlog_init(const char *path, uint16_t schema,
+                          uint16_t rec_bytes, uint32_t capacity) {
+  if (path == NULL || strlen(path) >= sizeof(s_log.path) || rec_bytes == 0 ||
+      capacity == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_log.lock == NULL) {
+    s_log.lock = xSemaphoreCreateMutex();
+    if (s_log.lock == NULL)
+      return ESP_ERR_NO_MEM;
+  }
+
+  strlcpy(s_log.path, path, sizeof(s_log.path));
+  memset(&s_log.hdr, 0, sizeof(s_log.hdr));
+  s_log.hdr.magic = BACKLOG_MAGIC;
+  s_log.hdr.schema = schema;
+  s_log.hdr.rec_bytes = rec_bytes;
+  s_log.hdr.capacity = capacity;
+
+  FILE *f = fopen(path, "r+b");
+  if (f == NULL)
+    return ESP_OK; // Nada pendiente
+
+  backlog_header_t h;
+  if (fread(&h, sizeof(h), 1, f) == 1 && h.magic == BACKLOG_MAGIC &&
+      h.crc == header_crc(&h) && h.schema == schema &&
+      h.rec_bytes == rec_bytes && h.capacity == capacity &&
+      h.head - h.tail <= capacity && h.head != h.tail) {
+    s_log.hdr = h;
+    s_log.f = f;
+    ESP_LOGI(TAG, "%lu registros pendientes en %s (%lu perdidos)",
+             (unsigned long)(h.head - h.tail), path,
+             (unsigned long)h.dropped);
+    return ESP_OK;
+  }
+
+  ESP_LOGW(TAG, "%s vacío o de otro formato: se descarta", path);
+  fclose(f);
+  remove(path);
+  return ESP_OK;
+}
+
+esp_err_t bb_backlog_push(const void *rec, size_t len) {
+  static const uint8_t zeros[32];
+
+  if (s_log.lock == NULL || rec == NULL || len > s_log.hdr.rec_bytes)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_log.lock, portMAX_DELAY);
+  esp_err_t err = ESP_OK;
+  if (!log_has_room()) {
+    err = ESP_ERR_NO_MEM;
+    s_log.no_space++;
+  } else if (s_log.f == NULL) {
+    s_log.f = fopen(s_log.path, "w+b");
+    s_log.hdr.head = 0;
+    s_log.hdr.tail = 0;
+    err = (s_log.f != NULL) ? header_write() : ESP_FAIL;
+  }
+
+  if (err == ESP_OK) {
+    backlog_slot_t slot = {
+        .seq = s_log.hdr.head,
+        .len = (uint16_t)len,
+        .crc = esp_rom_crc32_le(0, rec, len),
+    };
+    // Ranura completa (relleno a cero): el fichero crece sin huecos
+    bool ok = fseek(s_log.f, slot_offset(slot.seq), SEEK_SET) == 0 &&
+              fwrite(&slot, sizeof(slot), 1, s_log.f) == 1 &&
+              fwrite(rec, 1, len, s_log.f) == len;
+    for (size_t pad = s_log.hdr.rec_bytes - len; ok && pad > 0;) {
+      size_t n = (pad < sizeof(zeros)) ? pad : sizeof(zeros);
+      ok = fwrite(zeros, 1, n, s_log.f) == n;
+      pad -= n;
+    }
+
+    if (!ok) {
+      err = ESP_FAIL;
+    } else {
+      if (s_log.hdr.head - s_log.hdr.tail == s_log.hdr.capacity) {
+        s_log.hdr.tail++; // Lleno: la ranura era la del más antiguo
+        s_log.hdr.dropped++;
+      }
+      s_log.hdr.head++;
+      err = header_write();
+      if (err == ESP_OK)
+        s_log.pushed++;
+    }
+  }
+  xSemaphoreGive(s_log.lock);
+
+  if (err == ESP_ERR_NO_MEM)
+    ESP_LOGW(TAG, "SPIFFS sin hueco: %s no crece", s_log.path);
+  else if (err != ESP_OK)
+    ESP_LOGE(TAG, "No se pudo escribir en %s", s_log.path);
+  return err;
+}
+
+esp_err_t bb_backlog_peek(uint32_t index, void *rec, size_t cap,
+                          size_t *len_out) {
+  if (s_log.lock == NULL || rec == NULL)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(s_log.lock, portMAX_DELAY);
+  esp_err_t err = ESP_OK;
+  uint32_t seq = s_log.hdr.tail + index;
+  backlog_slot_t slot;
+
+  if (s_log.f == NULL || index >= s_log.hdr.head - s_log.hdr.tail) {
+    err = ESP_ERR_NOT_FOUND;
+  } else if (fseek(s_log.f, slot_offset(seq), SEEK_SET) != 0 ||
+             fread(&slot, sizeof(slot), 1, s_log.f) != 1) {
+    err = ESP_FAIL;
+  } else if (slot.seq != seq || slot.len > cap ||
+             slot.len > s_log.hdr.rec_bytes ||
+             fread(rec, 1, slot.len, s_log.f) != slot.len ||
+             esp_rom_crc32_le(0, rec, slot.len) != slot.crc) {
+    err = ESP_ERR_INVALID_CRC;
+    s_log.corrupt++;
+  } else if (len_out != NULL) {
+    *len_out = slot.len;
+  }
+  xSemaphoreGive(s_log.lock);
+  return err;
+}
+
+esp_err_t bb_backlog_pop(uint32_t n) {
+  if (s_log.lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(s_log.lock, portMAX_DELAY);
+  esp_err_t err = ESP_OK;
+  uint32_t count = s_log.hdr.head - s_log.hdr.tail;
+  if (n > count)
+    n = count;
+  if (n > 0) {
+    s_log.hdr.tail += n;
+    if (s_log.hdr.tail == s_log.hdr.head)
+      log_reset();
+    else
+      err = header_write();
+  }
+  xSemaphoreGive(s_log.lock);
+  return err;
+}
+
+uint32_t bb_backlog_count(void) {
+  if (s_log.lock == NULL)
+    return 0;
+  xSemaphoreTake(s_log.lock, portMAX_DELAY);
+  uint32_t count = s_log.hdr.head - s_log.hdr.tail;
+  xSemaphoreGive(s_log.lock);
+  return count;
+}
+
+void bb_backlog_get_stats(bb_backlog_stats_t *out) {
+  out->count = bb_backlog_count();
+  out->capacity = s_log.hdr.capacity;
+  out->dropped = s_log.hdr.dropped;
+  out->corrupt = s_log.corrupt;
+  out->pushed = s_log.pushed;
+  out->no_space = s_log.no_space;
+}
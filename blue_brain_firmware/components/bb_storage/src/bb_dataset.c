@@ -0,0 +1,480 @@
+/**
+ * @file bb_dataset.c
+ * @brief Log binario del dataset con escritura por bloques en tarea propia
+ */
+
+#include "bb_dataset.h"
+#include "bb_storage.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "BB_DATASET";
+
+#define DATASET_MAGIC 0x53444242u // "BBDS"
+#define DATASET_READ_RECORDS 8    // Registros por lectura al exportar
+#define DATASET_CSV_CHUNK 1024    // Bytes por trozo del CSV
+
+typedef struct {
+  uint32_t magic;
+  uint16_t schema;
+  uint16_t n_features;
+  uint16_t rec_bytes;
+  uint8_t reserved[18];
+  uint32_t crc; // crc32 de los campos anteriores
+} dataset_header_t;
+
+typedef struct {
+  uint32_t seq; // Índice del registro: descarta restos de otro dataset
+  int16_t label;
+  uint16_t reserved;
+  // features f32[n_features], crc32
+} dataset_rec_t;
+
+_Static_assert(sizeof(dataset_header_t) == 32, "cabecera del dataset");
+_Static_assert(sizeof(dataset_rec_t) == 8, "registro del dataset");
+
+// Elemento de la cola: muestra u orden, en el orden en que se pidieron
+typedef enum { OP_RECORD = 0, OP_FLUSH, OP_CLEAR } dataset_op_t;
+
+typedef struct {
+  uint8_t op;
+  uint8_t reserved;
+  int16_t label;
+  float features[BB_DATASET_MAX_FEATURES]; // Solo viajan n_features
+} dataset_item_t;
+
+#define ITEM_BYTES(n) (offsetof(dataset_item_t, features) + (n) * sizeof(float))
+
+static struct {
+  char path[32];
+  dataset_header_t hdr;
+  FILE *f;                // Abierto mientras hay dataset (solo la escritora
+                          // escribe; la exportación lee con lock)
+  SemaphoreHandle_t lock; // Fichero y count
+  SemaphoreHandle_t cmd;  // Un flush/clear a la vez
+  SemaphoreHandle_t done; // La escritora terminó la orden
+  QueueHandle_t queue;
+  uint8_t *block; // BB_DATASET_BLOCK_RECORDS registros por escribir
+  uint32_t n_block;
+  uint32_t count; // Registros en flash
+  uint32_t max_records;
+  uint32_t queue_full;
+  uint32_t write_err;
+  uint32_t blocks;
+  uint32_t full;
+  uint32_t no_space;
+} s_ds;
+
+static uint32_t header_crc(const dataset_header_t *h) {
+  return esp_rom_crc32_le(0, (const uint8_t *)h,
+                          offsetof(dataset_header_t, crc));
+}
+
+static long rec_offset(uint32_t index) {
+  return (long)sizeof(dataset_header_t) + (long)index * s_ds.hdr.rec_bytes;
+}
+
+static bool rec_valid(const uint8_t *rec, uint32_t index) {
+  size_t body = s_ds.hdr.rec_bytes - sizeof(uint32_t);
+  dataset_rec_t r;
+  uint32_t crc;
+  memcpy(&r, rec, sizeof(r));
+  memcpy(&crc, rec + body, sizeof(crc));
+  return r.seq == index && esp_rom_crc32_le(0, rec, body) == crc;
+}
+
+// Dataset nuevo (o borrado): fichero con solo la cabecera. Con lock
+static esp_err_t file_create(void) {
+  if (s_ds.f != NULL)
+    fclose(s_ds.f);
+  s_ds.count = 0;
+  s_ds.f = fopen(s_ds.path, "w+b");
+  if (s_ds.f == NULL)
+    return ESP_FAIL;
+  s_ds.hdr.crc = header_crc(&s_ds.hdr);
+  if (fwrite(&s_ds.hdr, sizeof(s_ds.hdr), 1, s_ds.f) != 1)
+    return ESP_FAIL;
+  fflush(s_ds.f);
+  fsync(fileno(s_ds.f));
+  return ESP_OK;
+}
+
+// Escribe el bloque en curso de una vez. Solo la escritora
+static void block_write(void) {
+  if (s_ds.n_block == 0)
+    return;
+
+  xSemaphoreTake(s_ds.lock, portMAX_DELAY);
+  size_t len = (size_t)s_ds.n_block * s_ds.hdr.rec_bytes;
+  size_t grow = len + ((s_ds.f == NULL) ? sizeof(s_ds.hdr) : 0);
+  if (!bb_storage_has_room(grow)) {
+    s_ds.no_space += s_ds.n_block;
+    ESP_LOGW(TAG, "SPIFFS sin hueco: %lu registros de %s perdidos",
+             (unsigned long)s_ds.n_block, s_ds.path);
+    s_ds.n_block = 0;
+    xSemaphoreGive(s_ds.lock);
+    return;
+  }
+  bool ok = (s_ds.f != NULL || file_create() == ESP_OK) &&
+            fseek(s_ds.f, rec_offset(s_ds.count), SEEK_SET) == 0 &&
+            fwrite(s_ds.block, 1, len, s_ds.f) == len &&
+            fflush(s_ds.f) == 0;
+  if (ok) {
+    fsync(fileno(s_ds.f));
+    s_ds.count += s_ds.n_block;
+    s_ds.blocks++;
+  } else {
+    s_ds.write_err += s_ds.n_block;
+    ESP_LOGE(TAG, "No se pudieron escribir %lu registros en %s",
+             (unsigned long)s_ds.n_block, s_ds.path);
+  }
+  s_ds.n_block = 0;
+  xSemaphoreGive(s_ds.lock);
+}
+
+static void block_add(const dataset_item_t *it) {
+  if (s_ds.count + s_ds.n_block >= s_ds.max_records) {
+    s_ds.full++; // Encolada antes de que append() lo viera lleno
+    return;
+  }
+  uint16_t n = s_ds.hdr.n_features;
+  uint8_t *rec = s_ds.block + (size_t)s_ds.n_block * s_ds.hdr.rec_bytes;
+  dataset_rec_t r = {.seq = s_ds.count + s_ds.n_block, .label = it->label};
+  size_t body = sizeof(r) + n * sizeof(float);
+
+  memcpy(rec, &r, sizeof(r));
+  memcpy(rec + sizeof(r), it->features, n * sizeof(float));
+  uint32_t crc = esp_rom_crc32_le(0, rec, body);
+  memcpy(rec + body, &crc, sizeof(crc));
+  s_ds.n_block++;
+
+  // Bloque lleno o límite de bloque (tras un bloque a medias): a flash
+  if ((s_ds.count + s_ds.n_block) % BB_DATASET_BLOCK_RECORDS == 0)
+    block_write();
+}
+
+static void writer_task(void *arg) {
+  dataset_item_t it;
+
+  for (;;) {
+    // Con un bloque a medias, esperar como mucho BB_DATASET_IDLE_MS
+    TickType_t wait = (s_ds.n_block > 0) ? pdMS_TO_TICKS(BB_DATASET_IDLE_MS)
+                                         : portMAX_DELAY;
+    if (xQueueReceive(s_ds.queue, &it, wait) != pdTRUE) {
+      block_write();
+      continue;
+    }
+
+    switch (it.op) {
+    case OP_RECORD:
+      block_add(&it);
+      break;
+    case OP_FLUSH:
+      block_write();
+      xSemaphoreGive(s_ds.done);
+      break;
+    case OP_CLEAR:
+      xSemaphoreTake(s_ds.lock, portMAX_DELAY);
+      s_ds.n_block = 0;
+      if (s_ds.f != NULL) {
+        fclose(s_ds.f);
+        s_ds.f = NULL;
+      }
+      remove(s_ds.path); // Sin fichero hasta la próxima muestra
+      s_ds.count = 0;
+      xSemaphoreGive(s_ds.lock);
+      xSemaphoreGive(s_ds.done);
+      break;
+    }
+  }
+}
+
+// Abre el fichero existente y cuenta sus registros válidos (antes de arrancar
+// la escritora)
+static void file_open_existing(void) {
+  FILE *f = fopen(s_ds.path, "r+b");
+  if (f == NULL)
+    return; // Sin dataset: se crea con la primera muestra
+
+  dataset_header_t h;
+  long size = -1;
+  if (fread(&h, sizeof(h), 1, f) == 1 && h.magic == DATASET_MAGIC &&
+      h.crc == header_crc(&h) && h.schema == s_ds.hdr.schema &&
+      h.n_features == s_ds.hdr.n_features &&
+      h.rec_bytes == s_ds.hdr.rec_bytes && fseek(f, 0, SEEK_END) == 0) {
+    size = ftell(f);
+  }
+  if (size < (long)sizeof(h)) {
+    ESP_LOGW(TAG, "%s vacío o de otro formato: se descarta", s_ds.path);
+    fclose(f);
+    remove(s_ds.path);
+    return;
+  }
+
+  // Registros completos; de ellos, el último bloque se comprueba entero (un
+  // corte a media escritura solo puede haber dañado ese)
+  uint32_t n = (uint32_t)((size - (long)sizeof(h)) / h.rec_bytes);
+  uint32_t check = (n < BB_DATASET_BLOCK_RECORDS) ? n
+                                                  : BB_DATASET_BLOCK_RECORDS;
+  uint32_t first = n - check;
+  size_t len = (size_t)check * h.rec_bytes;
+  uint32_t valid = first;
+  if (check > 0 && fseek(f, rec_offset(first), SEEK_SET) == 0 &&
+      fread(s_ds.block, 1, len, f) == len) {
+    while (valid < n &&
+           rec_valid(s_ds.block + (size_t)(valid - first) * h.rec_bytes,
+                     valid)) {
+      valid++;
+    }
+  }
+  // Cola dañada o a medias fuera: un registro válido detrás de uno dañado
+  // no debe reaparecer cuando se escriba por encima menos de lo que había
+  if (size != rec_offset(valid)) {
+    ESP_LOGW(TAG, "%s: %lu registros finales dañados, se descartan",
+             s_ds.path, (unsigned long)(n - valid));
+    fclose(f);
+    f = (truncate(s_ds.path, rec_offset(valid)) == 0)
+            ? fopen(s_ds.path, "r+b")
+            : NULL;
+    if (f == NULL) {
+      ESP_LOGE(TAG, "No se pudo recortar %s: se descarta", s_ds.path);
+      remove(s_ds.path);
+      return;
+    }
+  }
+
+  s_ds.f = f;
+  s_ds.count = valid;
+  ESP_LOGI(TAG, "%lu registros en %s", (unsigned long)valid, s_ds.path);
+}
+
+esp_err_t bb_dataset_init(const char *path, uint16_t schema,
+                          uint16_t n_features, uint32_t max_records) {
+  if (path == NULL || strlen(path) >= sizeof(s_ds.path) || n_features == 0 ||
+      n_features > BB_DATASET_MAX_FEATURES || max_records == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_ds.queue != NULL)
+    return ESP_ERR_INVALID_STATE; // Ya arrancado
+
+  strlcpy(s_ds.path, path, sizeof(s_ds.path));
+  s_ds.max_records = max_records;
+  memset(&s_ds.hdr, 0, sizeof(s_ds.hdr));
+  s_ds.hdr.magic = DATASET_MAGIC;
+  s_ds.hdr.schema = schema;
+  s_ds.hdr.n_features = n_features;
+  s_ds.hdr.rec_bytes =
+      sizeof(dataset_rec_t) + n_features * sizeof(float) + sizeof(uint32_t);
+
+  s_ds.block = malloc((size_t)BB_DATASET_BLOCK_RECORDS * s_ds.hdr.rec_bytes);
+  s_ds.lock = xSemaphoreCreateMutex();
+  s_ds.cmd = xSemaphoreCreateMutex();
+  s_ds.done = xSemaphoreCreateBinary();
+  if (s_ds.block == NULL || s_ds.lock == NULL || s_ds.cmd == NULL ||
+      s_ds.done == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  file_open_existing();
+
+  QueueHandle_t q = xQueueCreate(BB_DATASET_QUEUE_LEN, ITEM_BYTES(n_features));
+  if (q == NULL)
+    return ESP_ERR_NO_MEM;
+  s_ds.queue = q;
+  if (xTaskCreate(writer_task, "ds_writer", 3072, NULL, 3, NULL) != pdPASS) {
+    vQueueDelete(q);
+    s_ds.queue = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+esp_err_t bb_dataset_append(int16_t label, const float *features) {
+  if (s_ds.queue == NULL || features == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  // count sin lock: como mucho deja pasar unas pocas que la escritora tira
+  if (s_ds.count >= s_ds.max_records) {
+    s_ds.full++;
+    return ESP_ERR_NO_MEM;
+  }
+  dataset_item_t it = {.op = OP_RECORD, .label = label};
+  memcpy(it.features, features, s_ds.hdr.n_features * sizeof(float));
+  if (xQueueSend(s_ds.queue, &it, 0) != pdTRUE) {
+    s_ds.queue_full++;
+    return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+// Orden a la escritora detrás de lo ya encolado; espera a que la complete
+static esp_err_t command(dataset_op_t op, uint32_t timeout_ms) {
+  if (s_ds.queue == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+  if (xSemaphoreTake(s_ds.cmd, ticks) != pdTRUE)
+    return ESP_ERR_TIMEOUT;
+  xSemaphoreTake(s_ds.done, 0); // Aviso de una orden anterior que expiró
+
+  dataset_item_t it = {.op = op};
+  esp_err_t err = ESP_ERR_TIMEOUT;
+  if (xQueueSend(s_ds.queue, &it, ticks) == pdTRUE &&
+      xSemaphoreTake(s_ds.done, ticks) == pdTRUE) {
+    err = ESP_OK;
+  }
+  xSemaphoreGive(s_ds.cmd);
+  return err;
+}
+
+esp_err_t bb_dataset_flush(uint32_t timeout_ms) {
+  return command(OP_FLUSH, timeout_ms);
+}
+
+esp_err_t bb_dataset_clear(uint32_t timeout_ms) {
+  esp_err_t err = command(OP_CLEAR, timeout_ms);
+  if (err == ESP_OK)
+    ESP_LOGI(TAG, "Dataset borrado");
+  return err;
+}
+
+uint32_t bb_dataset_count(void) {
+  if (s_ds.lock == NULL)
+    return 0;
+  xSemaphoreTake(s_ds.lock, portMAX_DELAY);
+  uint32_t n = s_ds.count;
+  xSemaphoreGive(s_ds.lock);
+  return n;
+}
+
+// Añade texto al trozo y lo entrega al sink cuando no cabe más
+typedef struct {
+  char *buf;
+  size_t len;
+  bb_dataset_sink_t sink;
+  void *ctx;
+} csv_out_t;
+
+static esp_err_t csv_put(csv_out_t *o, const char *s, size_t n) {
+  if (o->len + n > DATASET_CSV_CHUNK) {
+    esp_err_t err = o->sink(o->ctx, o->buf, o->len);
+    o->len = 0;
+    if (err != ESP_OK)
+      return err;
+  }
+  memcpy(o->buf + o->len, s, n);
+  o->len += n;
+  return ESP_OK;
+}
+
+// Una línea del CSV a partir de un registro
+static size_t csv_line(const uint8_t *rec, const uint8_t *decimals,
+                       char *line, size_t cap) {
+  dataset_rec_t r;
+  memcpy(&r, rec, sizeof(r));
+  size_t n = 0;
+  for (uint16_t i = 0; i < s_ds.hdr.n_features && n < cap; i++) {
+    float v;
+    memcpy(&v, rec + sizeof(r) + i * sizeof(float), sizeof(v));
+    n += snprintf(line + n, cap - n, "%.*f,", decimals[i], v);
+  }
+  if (n < cap)
+    n += snprintf(line + n, cap - n, "%d\n", r.label);
+  return (n < cap) ? n : cap - 1;
+}
+
+esp_err_t bb_dataset_export_csv(const char *const *columns,
+                                const uint8_t *decimals,
+                                bb_dataset_sink_t sink, void *ctx) {
+  if (columns == NULL || decimals == NULL || sink == NULL)
+    return ESP_ERR_INVALID_ARG;
+
+  // Lo encolado también sale en la descarga
+  esp_err_t err = bb_dataset_flush(1000);
+  if (err != ESP_OK)
+    return err;
+  uint32_t total = bb_dataset_count();
+  if (total == 0)
+    return ESP_ERR_NOT_FOUND;
+
+  size_t rd_bytes = (size_t)DATASET_READ_RECORDS * s_ds.hdr.rec_bytes;
+  uint8_t *rd = malloc(rd_bytes);
+  csv_out_t o = {.buf = malloc(DATASET_CSV_CHUNK), .sink = sink, .ctx = ctx};
+  if (rd == NULL || o.buf == NULL) {
+    free(rd);
+    free(o.buf);
+    return ESP_ERR_NO_MEM;
+  }
+
+  char line[24 * BB_DATASET_MAX_FEATURES];
+  for (uint16_t i = 0; i < s_ds.hdr.n_features && err == ESP_OK; i++) {
+    err = csv_put(&o, columns[i], strlen(columns[i]));
+    if (err == ESP_OK)
+      err = csv_put(&o, ",", 1);
+  }
+  if (err == ESP_OK)
+    err = csv_put(&o, "label\n", 6);
+
+  uint32_t skipped = 0;
+  for (uint32_t i = 0; i < total && err == ESP_OK;) {
+    uint32_t n = total - i;
+    if (n > DATASET_READ_RECORDS)
+      n = DATASET_READ_RECORDS;
+    size_t len = (size_t)n * s_ds.hdr.rec_bytes;
+
+    // Lock solo durante la lectura: la escritora sigue con la captura
+    xSemaphoreTake(s_ds.lock, portMAX_DELAY);
+    bool ok = s_ds.f != NULL && fseek(s_ds.f, rec_offset(i), SEEK_SET) == 0 &&
+              fread(rd, 1, len, s_ds.f) == len;
+    xSemaphoreGive(s_ds.lock);
+    if (!ok) {
+      err = ESP_FAIL; // También si se borró el dataset a mitad
+      break;
+    }
+
+    for (uint32_t k = 0; k < n && err == ESP_OK; k++) {
+      const uint8_t *rec = rd + (size_t)k * s_ds.hdr.rec_bytes;
+      if (!rec_valid(rec, i + k)) {
+        skipped++;
+        continue;
+      }
+      err = csv_put(&o, line, csv_line(rec, decimals, line, sizeof(line)));
+    }
+    i += n;
+  }
+  if (err == ESP_OK && o.len > 0)
+    err = sink(ctx, o.buf, o.len);
+
+  free(rd);
+  free(o.buf);
+  if (skipped > 0)
+    ESP_LOGW(TAG, "%lu registros dañados omitidos del CSV",
+             (unsigned long)skipped);
+  return err;
+}
+
+void bb_dataset_get_stats(bb_dataset_stats_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (s_ds.queue == NULL)
+    return;
+  xSemaphoreTake(s_ds.lock, portMAX_DELAY);
+  out->records = s_ds.count;
+  // n_block solo lo cambia la escritora: lectura aproximada sin lock
+  out->pending = uxQueueMessagesWaiting(s_ds.queue) + s_ds.n_block;
+  out->write_err = s_ds.write_err;
+  out->blocks = s_ds.blocks;
+  out->max = s_ds.max_records;
+  out->no_space = s_ds.no_space;
+  xSemaphoreGive(s_ds.lock);
+  out->queue_full = s_ds.queue_full;
+  out->full = s_ds.full;
+}
@@ -1,16 +1,39 @@
+#include "bb_storage.h"
 #include "esp_log.h"
 #include "esp_spiffs.h"
+#include "nvs.h"
 
 static const char *TAG = "BB_STORAGE";
 
+static uint32_t s_boot_id = 0;
+
+// Contador de arranques en NVS: identifica los reportes de cada arranque
+static void boot_count_update(void)
+{
+    nvs_handle_t h;
+    if (nvs_open("bb_storage", NVS_READWRITE, &h) != ESP_OK) {
+        ESP_LOGW(TAG, "Boot counter unavailable");
+        return;
+    }
+    uint32_t boots = 0;
+    nvs_get_u32(h, "boots", &boots);
+    s_boot_id = boots + 1;
+    nvs_set_u32(h, "boots", s_boot_id);
+    nvs_commit(h);
+    nvs_close(h);
+    ESP_LOGI(TAG, "Boot #%lu", (unsigned long)s_boot_id);
+}
+
 void bb_storage_init(void)
 {
     ESP_LOGI(TAG, "Initializing Storage (SPIFFS/NVS)");
+
+    boot_count_update();
     
     esp_vfs_spiffs_conf_t conf = {
       .base_path = "/spiffs",
       .partition_label = "storage",
-      .max_files = 5,
+      .max_files = 8, // 4 series + dataset + backlog + descarga/bench
       .format_if_mount_failed = true
     };
     
@@ -18,6 +41,28 @@ void bb_storage_init(void)
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to mount SPIFFS (%s)", esp_err_to_name(ret));
     } else {
-        ESP_LOGI(TAG, "SPIFFS mounted");
+        size_t total = 0, used = 0;
+        bb_storage_usage(&total, &used);
+        ESP_LOGI(TAG, "SPIFFS mounted (%u of %u KB used)",
+                 (unsigned)(used / 1024), (unsigned)(total / 1024));
+    }
+}
+
+uint32_t bb_storage_boot_id(void)
+{
+    return s_boot_id;
+}
+
+esp_err_t bb_storage_usage(size_t *total, size_t *used)
+{
+    return esp_spiffs_info("storage", total, used);
+}
+
+bool bb_storage_has_room(size_t bytes)
+{
+    size_t total = 0, used = 0;
+    if (bb_storage_usage(&total, &used) != ESP_OK) {
+        return false;
     }
+    return used + bytes + BB_STORAGE_RESERVE_BYTES <= total;
 }
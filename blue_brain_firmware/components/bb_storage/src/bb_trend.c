@@ -0,0 +1,404 @@
+/**
+ * @file bb_trend.c
+ * @brief Serie temporal circular de registros fijos con índice disperso
+ */
+
+#include "bb_trend.h"
+#include "bb_storage.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "BB_TREND";
+
+#define TREND_MAGIC 0x53544242u          // "BBTS"
+#define TREND_NO_SEQ UINT32_MAX          // Entrada sin registro legible
+#define TREND_BLOCK BB_TREND_INDEX_EVERY // Ranuras por entrada del índice
+
+typedef struct {
+  uint32_t magic;
+  uint16_t schema;
+  uint16_t data_bytes;
+  uint32_t capacity;
+  uint32_t index_every;
+  uint32_t reserved[3];
+  uint32_t crc; // crc32 de los campos anteriores
+} trend_header_t;
+
+_Static_assert(sizeof(trend_header_t) == 32, "cabecera de la serie");
+// Capacidad múltiplo de TREND_BLOCK: un bloque de escritura no da la vuelta
+_Static_assert(TREND_BLOCK % BB_TREND_FLUSH_RECORDS == 0,
+               "bloques de escritura");
+
+static uint32_t header_crc(const trend_header_t *h) {
+  return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(trend_header_t, crc));
+}
+
+static long slot_offset(const bb_trend_t *t, uint32_t slot) {
+  return (long)sizeof(trend_header_t) + (long)slot * (long)t->stride;
+}
+
+static uint32_t oldest_seq(const bb_trend_t *t) {
+  uint32_t cap = t->capacity;
+  return (t->next_seq > cap) ? t->next_seq - cap : 0;
+}
+
+// Ranura completa en buf: seq, hora, datos y crc de todo lo anterior
+static void slot_pack(const bb_trend_t *t, uint8_t *buf, uint32_t seq,
+                      uint32_t t_s, const void *data) {
+  size_t n = t->data_bytes;
+  memcpy(buf, &seq, 4);
+  memcpy(buf + 4, &t_s, 4);
+  memcpy(buf + 8, data, n);
+  uint32_t crc = esp_rom_crc32_le(0, buf, 8 + n);
+  memcpy(buf + 8 + n, &crc, 4);
+}
+
+// Lee una ranura en t->scratch. false si no está escrita, falla el crc o
+// su secuencia no corresponde a esa ranura
+static bool slot_read(bb_trend_t *t, uint32_t slot, uint32_t *seq,
+                      uint32_t *t_s) {
+  size_t n = t->data_bytes;
+  uint8_t *b = t->scratch;
+  uint32_t crc;
+  if (fseek(t->f, slot_offset(t, slot), SEEK_SET) != 0 ||
+      fread(b, t->stride, 1, t->f) != 1)
+    return false;
+  memcpy(seq, b, 4);
+  memcpy(t_s, b + 4, 4);
+  memcpy(&crc, b + 8 + n, 4);
+  return crc == esp_rom_crc32_le(0, b, 8 + n) &&
+         *seq % t->capacity == slot;
+}
+
+// Registro seq en t->scratch: de RAM si aún no bajó a flash, si no de su
+// ranura (que hasta el flush guarda el de la vuelta anterior)
+static bool record_read(bb_trend_t *t, uint32_t seq, uint32_t *t_s) {
+  uint32_t flushed = t->next_seq - t->n_pending;
+  if (seq >= flushed && seq < t->next_seq) {
+    memcpy(t->scratch, t->pending + (seq - flushed) * t->stride, t->stride);
+    memcpy(t_s, t->scratch + 4, 4);
+    return true;
+  }
+  uint32_t got;
+  return slot_read(t, seq % t->capacity, &got, t_s) && got == seq;
+}
+
+// Hora del primer registro legible desde seq (antes de end); UINT32_MAX si
+// no queda ninguno. El índice ahorra la lectura en los inicios de bloque
+static uint32_t time_from(bb_trend_t *t, uint32_t seq, uint32_t end) {
+  for (; seq < end; seq++) {
+    uint32_t slot = seq % t->capacity;
+    uint32_t ts;
+    if (slot % TREND_BLOCK == 0 && t->index[slot / TREND_BLOCK].seq == seq)
+      return t->index[slot / TREND_BLOCK].t_s;
+    if (record_read(t, seq, &ts))
+      return ts;
+  }
+  return UINT32_MAX;
+}
+
+// Primera secuencia con hora >= from (next_seq si no hay). Binaria sobre
+// los inicios de bloque, lineal dentro del bloque que queda
+static uint32_t lower_bound(bb_trend_t *t, uint32_t from) {
+  uint32_t lo = oldest_seq(t), hi = t->next_seq;
+  uint32_t k_lo = (lo + TREND_BLOCK - 1) / TREND_BLOCK;
+  uint32_t k_hi = (hi + TREND_BLOCK - 1) / TREND_BLOCK;
+  uint32_t a = k_lo, b = k_hi;
+  while (a < b) {
+    uint32_t mid = a + (b - a) / 2;
+    if (time_from(t, mid * TREND_BLOCK, hi) >= from)
+      b = mid;
+    else
+      a = mid + 1;
+  }
+
+  uint32_t start = (a > k_lo) ? (a - 1) * TREND_BLOCK : lo;
+  uint32_t stop = (a < k_hi) ? a * TREND_BLOCK : hi;
+  for (uint32_t seq = start; seq < stop; seq++) {
+    uint32_t ts;
+    if (record_read(t, seq, &ts) && ts >= from)
+      return seq;
+  }
+  return stop;
+}
+
+// Baja a flash las ranuras en RAM. Son las de un solo bloque alineado, así
+// que van seguidas en el fichero. Si falla (o el fichero tendría que crecer
+// sin hueco en la partición) se descartan y la secuencia vuelve atrás: el
+// fichero no queda con huecos
+static esp_err_t flush_locked(bb_trend_t *t) {
+  uint32_t n = t->n_pending;
+  if (n == 0)
+    return ESP_OK;
+  uint32_t seq0 = t->next_seq - n;
+  uint32_t slot0 = seq0 % t->capacity;
+  t->n_pending = 0;
+
+  if (slot0 + n > t->file_slots &&
+      !bb_storage_has_room((slot0 + n - t->file_slots) * t->stride)) {
+    t->next_seq = seq0;
+    t->no_space++;
+    return ESP_ERR_NO_MEM;
+  }
+  if (fseek(t->f, slot_offset(t, slot0), SEEK_SET) != 0 ||
+      fwrite(t->pending, t->stride, n, t->f) != n ||
+      fflush(t->f) != 0) {
+    t->next_seq = seq0;
+    t->write_err++;
+    return ESP_FAIL;
+  }
+  fsync(fileno(t->f));
+  if (slot0 + n > t->file_slots)
+    t->file_slots = slot0 + n;
+
+  for (uint32_t i = 0; i < n; i++) {
+    if ((slot0 + i) % TREND_BLOCK == 0) {
+      bb_trend_index_t *e = &t->index[(slot0 + i) / TREND_BLOCK];
+      e->seq = seq0 + i;
+      memcpy(&e->t_s, t->pending + i * t->stride + 4, 4);
+    }
+  }
+  return ESP_OK;
+}
+
+// Índice, siguiente secuencia y última hora a partir de las propias ranuras
+static void recover(bb_trend_t *t) {
+  uint32_t cap = t->capacity;
+  uint32_t present = 0;
+  if (fseek(t->f, 0, SEEK_END) == 0) {
+    long size = ftell(t->f) - (long)sizeof(trend_header_t);
+    present = (size > 0) ? (uint32_t)(size / (long)t->stride) : 0;
+  }
+  if (present > cap)
+    present = cap;
+  t->file_slots = present;
+
+  // Bloque con la primera ranura más nueva
+  bool found = false;
+  uint32_t best = 0, best_seq = 0, best_t = 0;
+  for (uint32_t b = 0; b < cap / TREND_BLOCK && b * TREND_BLOCK < present;
+       b++) {
+    uint32_t seq, ts;
+    if (!slot_read(t, b * TREND_BLOCK, &seq, &ts))
+      continue;
+    t->index[b] = (bb_trend_index_t){seq, ts};
+    if (!found || seq > best_seq) {
+      found = true;
+      best = b;
+      best_seq = seq;
+      best_t = ts;
+    }
+  }
+  if (!found)
+    return; // Vacía (o solo el primer bloque, a medio escribir)
+
+  // Dentro de ese bloque, la racha de secuencias seguidas acaba en el
+  // último registro escrito
+  uint32_t end = (best + 1) * TREND_BLOCK;
+  for (uint32_t slot = best * TREND_BLOCK + 1; slot < present && slot < end;
+       slot++) {
+    uint32_t seq, ts;
+    if (!slot_read(t, slot, &seq, &ts) || seq != best_seq + 1)
+      break;
+    best_seq = seq;
+    best_t = ts;
+  }
+  t->next_seq = best_seq + 1;
+  t->last_t = best_t;
+}
+
+static void buffers_free(bb_trend_t *t) {
+  free(t->index);
+  free(t->pending);
+  free(t->scratch);
+  t->index = NULL;
+  t->pending = NULL;
+  t->scratch = NULL;
+}
+
+// Cabecera que corresponde a la configuración de t
+static void header_make(const bb_trend_t *t, trend_header_t *h) {
+  memset(h, 0, sizeof(*h));
+  h->magic = TREND_MAGIC;
+  h->schema = t->schema;
+  h->data_bytes = t->data_bytes;
+  h->capacity = t->capacity;
+  h->index_every = TREND_BLOCK;
+  h->crc = header_crc(h);
+}
+
+esp_err_t bb_trend_init(bb_trend_t *t, const char *path, uint16_t schema,
+                        uint16_t data_bytes, uint32_t capacity) {
+  capacity -= capacity % TREND_BLOCK;
+  if (t == NULL || path == NULL || strlen(path) >= sizeof(t->path) ||
+      data_bytes == 0 || capacity == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (t->lock == NULL) {
+    t->lock = xSemaphoreCreateMutex();
+    if (t->lock == NULL)
+      return ESP_ERR_NO_MEM;
+  }
+  if (t->f != NULL) {
+    fclose(t->f);
+    t->f = NULL;
+  }
+  buffers_free(t);
+
+  strlcpy(t->path, path, sizeof(t->path));
+  t->schema = schema;
+  t->data_bytes = data_bytes;
+  t->capacity = capacity;
+  t->stride = 12 + data_bytes;
+  t->n_pending = 0;
+  t->file_slots = 0;
+  t->next_seq = 0;
+  t->last_t = 0;
+
+  t->index = malloc((capacity / TREND_BLOCK) * sizeof(bb_trend_index_t));
+  t->pending = malloc(BB_TREND_FLUSH_RECORDS * t->stride);
+  t->scratch = malloc(t->stride);
+  if (t->index == NULL || t->pending == NULL || t->scratch == NULL) {
+    buffers_free(t);
+    return ESP_ERR_NO_MEM;
+  }
+  for (uint32_t b = 0; b < capacity / TREND_BLOCK; b++)
+    t->index[b].seq = TREND_NO_SEQ;
+
+  trend_header_t hdr;
+  header_make(t, &hdr);
+  FILE *f = fopen(path, "r+b");
+  if (f != NULL) {
+    trend_header_t h;
+    if (fread(&h, sizeof(h), 1, f) == 1 &&
+        memcmp(&h, &hdr, sizeof(h)) == 0) {
+      t->f = f;
+      recover(t);
+      ESP_LOGI(TAG, "%lu registros en %s (siguiente #%lu)",
+               (unsigned long)(t->next_seq - oldest_seq(t)), path,
+               (unsigned long)t->next_seq);
+      return ESP_OK;
+    }
+    ESP_LOGW(TAG, "%s de otro formato: se descarta", path);
+    fclose(f);
+  }
+
+  t->f = fopen(path, "w+b");
+  if (t->f == NULL || fwrite(&hdr, sizeof(hdr), 1, t->f) != 1 ||
+      fflush(t->f) != 0) {
+    ESP_LOGE(TAG, "No se pudo crear %s", path);
+    if (t->f != NULL)
+      fclose(t->f);
+    t->f = NULL;
+    return ESP_FAIL;
+  }
+  fsync(fileno(t->f));
+  return ESP_OK;
+}
+
+esp_err_t bb_trend_append(bb_trend_t *t, uint32_t t_s, const void *data) {
+  if (t == NULL || t->f == NULL || data == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(t->lock, portMAX_DELAY);
+  if (t_s < t->last_t)
+    t_s = t->last_t;
+  slot_pack(t, t->pending + t->n_pending * t->stride, t->next_seq, t_s,
+            data);
+  t->n_pending++;
+  t->next_seq++;
+  t->last_t = t_s;
+  t->appended++;
+  esp_err_t err = ESP_OK;
+  if (t->next_seq % BB_TREND_FLUSH_RECORDS == 0)
+    err = flush_locked(t); // Bloque completo
+  xSemaphoreGive(t->lock);
+
+  if (err == ESP_ERR_NO_MEM)
+    ESP_LOGW(TAG, "SPIFFS sin hueco: %s no crece", t->path);
+  else if (err != ESP_OK)
+    ESP_LOGE(TAG, "No se pudo escribir en %s", t->path);
+  return err;
+}
+
+esp_err_t bb_trend_flush(bb_trend_t *t) {
+  if (t == NULL || t->f == NULL)
+    return ESP_ERR_INVALID_STATE;
+  xSemaphoreTake(t->lock, portMAX_DELAY);
+  esp_err_t err = flush_locked(t);
+  xSemaphoreGive(t->lock);
+  return err;
+}
+
+esp_err_t bb_trend_query(bb_trend_t *t, uint32_t from_s, uint32_t to_s,
+                         uint32_t max_points, uint8_t *out, size_t cap,
+                         uint32_t *n_out, uint32_t *matched) {
+  if (out == NULL || n_out == NULL)
+    return ESP_ERR_INVALID_ARG;
+  *n_out = 0;
+  if (matched != NULL)
+    *matched = 0;
+  if (t == NULL || t->f == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  // Lo que espera en RAM sale de ahí (record_read): consultar no fuerza
+  // escrituras de bloques a medias
+  xSemaphoreTake(t->lock, portMAX_DELAY);
+  uint32_t first = 0, end = 0;
+  if (from_s <= to_s) {
+    first = lower_bound(t, from_s);
+    end = (to_s == UINT32_MAX) ? t->next_seq : lower_bound(t, to_s + 1);
+  }
+  size_t point = 4 + t->data_bytes;
+  if (max_points > cap / point)
+    max_points = cap / point;
+  uint32_t n = end - first;
+  uint32_t step = (max_points > 0) ? (n + max_points - 1) / max_points : 0;
+
+  uint32_t count = 0;
+  for (uint32_t seq = first; step > 0 && seq < end; seq += step) {
+    // Un registro ilegible se cambia por el siguiente de su mismo tramo
+    for (uint32_t s = seq; s < seq + step && s < end; s++) {
+      uint32_t ts;
+      if (record_read(t, s, &ts)) {
+        memcpy(out + count * point, &ts, 4);
+        memcpy(out + count * point + 4, t->scratch + 8, point - 4);
+        count++;
+        break;
+      }
+      t->corrupt++;
+    }
+  }
+  xSemaphoreGive(t->lock);
+
+  *n_out = count;
+  if (matched != NULL)
+    *matched = n;
+  return ESP_OK;
+}
+
+void bb_trend_get_stats(bb_trend_t *t, bb_trend_stats_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (t == NULL || t->f == NULL)
+    return;
+
+  xSemaphoreTake(t->lock, portMAX_DELAY);
+  uint32_t oldest = oldest_seq(t);
+  out->count = t->next_seq - oldest;
+  out->capacity = t->capacity;
+  if (out->count > 0) {
+    out->newest_t = t->last_t;
+    uint32_t ts = time_from(t, oldest, t->next_seq);
+    out->oldest_t = (ts == UINT32_MAX) ? 0 : ts;
+  }
+  out->appended = t->appended;
+  out->corrupt = t->corrupt;
+  out->write_err = t->write_err;
+  out->no_space = t->no_space;
+  xSemaphoreGive(t->lock);
+}
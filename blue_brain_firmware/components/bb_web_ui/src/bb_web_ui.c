@@ -1,11 +1,18 @@
 #include "bb_web_ui.h"
+#include "bb_backlog.h"
 #include "bb_config.h"
+#include "bb_connect.h"
+#include "bb_dataset.h"
+#include "bb_espnow.h"
+#include "bb_history.h"
+#include "bb_storage.h"
 #include "cJSON.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_system.h"        // For esp_restart
 #include "freertos/FreeRTOS.h" // For vTaskDelay
 #include "freertos/task.h"
+#include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
@@ -58,6 +65,19 @@ static int g_capture_label = 0;
 static float g_capture_freq = 1.0;
 static long g_capture_next_ts = 0; // ms
 
+// Columnas del dataset: orden del registro binario (bb_dataset) y del CSV
+#define TRAIN_FEATURES 17
+static const char *const k_train_columns[TRAIN_FEATURES] = {
+    "rms",        "fft_low_0",  "fft_low_1",  "fft_low_2",  "fft_low_3",
+    "fft_low_4",  "fft_mid_0",  "fft_mid_1",  "fft_mid_2",  "fft_mid_3",
+    "fft_mid_4",  "fft_high_0", "fft_high_1", "fft_high_2", "fft_high_3",
+    "fft_high_4", "peak_freq"};
+static const uint8_t k_train_decimals[TRAIN_FEATURES] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 2};
+
+// CSV del formato anterior (antes de bb_dataset): solo se borra
+#define TRAIN_LEGACY_CSV "/spiffs/training_data.csv"
+
 // Helper to get time in ms
 static int64_t get_time_ms() {
   struct timeval tv;
@@ -112,9 +132,13 @@ static esp_err_t api_command_handler(httpd_req_t *req) {
 
       httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
     } else if (strcmp(cmd->valuestring, "clear_dataset") == 0) {
-      remove("/spiffs/training_data.csv"); // Use standard remove
-      ESP_LOGI(TAG, "Dataset Cleared");
-      httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
+      remove(TRAIN_LEGACY_CSV);
+      if (bb_dataset_clear(2000) == ESP_OK) {
+        ESP_LOGI(TAG, "Dataset Cleared");
+        httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
+      } else {
+        httpd_resp_send_500(req);
+      }
     } else {
       httpd_resp_send_500(req);
     }
@@ -123,10 +147,15 @@ static esp_err_t api_command_handler(httpd_req_t *req) {
   return ESP_OK;
 }
 
+static esp_err_t dataset_chunk_sink(void *ctx, const char *buf, size_t len) {
+  return httpd_resp_send_chunk((httpd_req_t *)ctx, buf, len);
+}
+
 // GET /download_dataset
+// El CSV se genera al vuelo desde el log binario (bb_dataset)
 static esp_err_t download_dataset_handler(httpd_req_t *req) {
-  FILE *f = fopen("/spiffs/training_data.csv", "r");
-  if (!f) {
+  bb_dataset_flush(1000); // Muestras aún en cola también cuentan
+  if (bb_dataset_count() == 0) {
     httpd_resp_send_404(req);
     return ESP_FAIL;
   }
@@ -135,15 +164,12 @@ static esp_err_t download_dataset_handler(httpd_req_t *req) {
   httpd_resp_set_hdr(req, "Content-Disposition",
                      "attachment; filename=\"training_data.csv\"");
 
-  char chunk[256];
-  size_t chunksize;
-  while ((chunksize = fread(chunk, 1, sizeof(chunk), f)) > 0) {
-    if (httpd_resp_send_chunk(req, chunk, chunksize) != ESP_OK) {
-      fclose(f);
-      return ESP_FAIL;
-    }
+  esp_err_t err = bb_dataset_export_csv(k_train_columns, k_train_decimals,
+                                        dataset_chunk_sink, req);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Descarga del dataset cortada: %s", esp_err_to_name(err));
+    return ESP_FAIL; // Sin chunk final: el cliente ve la descarga incompleta
   }
-  fclose(f);
   httpd_resp_send_chunk(req, NULL, 0); // End
   return ESP_OK;
 }
@@ -169,38 +195,35 @@ static void training_tick() {
     bb_telemetry_t report = {0};
     bb_dsp_ai_get_latest(&report);
 
-    // Append to file
-    FILE *f = fopen("/spiffs/training_data.csv", "a");
-    if (f) {
-      // Header if new?
-      if (ftell(f) == 0) {
-        fprintf(f, "rms,");
-        for (int i = 0; i < 5; i++)
-          fprintf(f, "fft_low_%d,", i);
-        for (int i = 0; i < 5; i++)
-          fprintf(f, "fft_mid_%d,", i);
-        for (int i = 0; i < 5; i++)
-          fprintf(f, "fft_high_%d,", i);
-        fprintf(f, "peak_freq,label\n");
-      }
-
-      // Data
-      fprintf(f, "%.4f,", report.vib_rms);
-      for (int i = 0; i < 5; i++)
-        fprintf(f, "%.4f,", report.fft_bands_low[i]);
-      for (int i = 0; i < 5; i++)
-        fprintf(f, "%.4f,", report.fft_bands_mid[i]);
-      for (int i = 0; i < 5; i++)
-        fprintf(f, "%.4f,", report.fft_bands_high[i]);
-      fprintf(f, "%.2f,%d\n", report.vib_dom_freq, g_capture_label);
-
-      fclose(f);
-      g_capture_count++;
-
-      if (g_capture_count >= g_capture_target) {
-        g_capture_active = false;
-        ESP_LOGI(TAG, "Capture Complete!");
-      }
+    // Discarded frame (no features): wait for the next good one
+    if (report.quality == BB_QUALITY_BAD)
+      return;
+
+    // Solo se encola: la escritora de bb_dataset baja bloques enteros
+    float features[TRAIN_FEATURES];
+    features[0] = report.vib_rms;
+    for (int i = 0; i < 5; i++) {
+      features[1 + i] = report.fft_bands_low[i];
+      features[6 + i] = report.fft_bands_mid[i];
+      features[11 + i] = report.fft_bands_high[i];
+    }
+    features[16] = report.vib_dom_freq;
+    esp_err_t err = bb_dataset_append((int16_t)g_capture_label, features);
+    if (err == ESP_ERR_NO_MEM) {
+      g_capture_active = false; // Dataset lleno: descargar y borrar
+      bb_dataset_flush(1000);
+      ESP_LOGW(TAG, "Dataset lleno: captura detenida en %d muestras",
+               g_capture_count);
+      return;
+    }
+    if (err != ESP_OK)
+      return; // Cola llena: se reintenta en el siguiente tick
+
+    g_capture_count++;
+    if (g_capture_count >= g_capture_target) {
+      g_capture_active = false;
+      bb_dataset_flush(1000); // La captura entera en flash al terminar
+      ESP_LOGI(TAG, "Capture Complete!");
     }
     g_capture_next_ts = now + interval_ms;
   }
@@ -213,6 +236,102 @@ static void training_task_entry(void *arg) {
   }
 }
 
+#if BB_DATASET_BENCH
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include <unistd.h>
+
+// Captura sin límite de frecuencia con el formato anterior (fopen "a",
+// fprintf y fclose por muestra) y con bloques binarios como la escritora de
+// bb_dataset (fichero abierto, un fwrite + fsync cada
+// BB_DATASET_BLOCK_RECORDS). µs por muestra en las primeras y en las últimas
+// DATASET_BENCH_WIN, con el fichero ya crecido: la frecuencia máxima es
+// 1e6 / µs. Ventanas de bloques enteros. Escribe ~130 KB + ~80 KB en SPIFFS
+// y los borra al acabar
+#define DATASET_BENCH_N (63 * BB_DATASET_BLOCK_RECORDS)
+#define DATASET_BENCH_WIN (6 * BB_DATASET_BLOCK_RECORDS)
+#define DATASET_BENCH_REC (12 + 4 * TRAIN_FEATURES)
+
+static void bench_csv_sample(const char *path, const float *f, int label) {
+  FILE *fp = fopen(path, "a");
+  if (fp == NULL)
+    return;
+  if (ftell(fp) == 0) {
+    for (int i = 0; i < TRAIN_FEATURES; i++)
+      fprintf(fp, "%s,", k_train_columns[i]);
+    fprintf(fp, "label\n");
+  }
+  for (int i = 0; i < TRAIN_FEATURES; i++)
+    fprintf(fp, "%.*f,", k_train_decimals[i], f[i]);
+  fprintf(fp, "%d\n", label);
+  fclose(fp);
+}
+
+static void bench_bin_sample(FILE *fp, uint8_t *block, uint32_t seq,
+                             const float *f, int16_t label) {
+  uint8_t *rec =
+      block + (seq % BB_DATASET_BLOCK_RECORDS) * DATASET_BENCH_REC;
+  int16_t hdr[2] = {label, 0};
+  memcpy(rec, &seq, 4);
+  memcpy(rec + 4, hdr, 4);
+  memcpy(rec + 8, f, 4 * TRAIN_FEATURES);
+  uint32_t crc = esp_rom_crc32_le(0, rec, DATASET_BENCH_REC - 4);
+  memcpy(rec + DATASET_BENCH_REC - 4, &crc, 4);
+  if ((seq + 1) % BB_DATASET_BLOCK_RECORDS == 0) {
+    fwrite(block, DATASET_BENCH_REC, BB_DATASET_BLOCK_RECORDS, fp);
+    fflush(fp);
+    fsync(fileno(fp));
+  }
+}
+
+static void dataset_bench(void) {
+  static uint8_t block[BB_DATASET_BLOCK_RECORDS * DATASET_BENCH_REC];
+  const char *csv = "/spiffs/bench.csv", *bin = "/spiffs/bench.bin";
+  float f[TRAIN_FEATURES];
+  int64_t first[2] = {0}, last[2] = {0}, t0 = 0;
+
+  for (int i = 0; i < TRAIN_FEATURES; i++)
+    f[i] = 0.0123f * (i + 1);
+  remove(csv);
+  remove(bin);
+
+  for (int i = 0; i < DATASET_BENCH_N; i++) {
+    if (i == 0 || i == DATASET_BENCH_N - DATASET_BENCH_WIN)
+      t0 = esp_timer_get_time();
+    f[0] += 0.001f;
+    bench_csv_sample(csv, f, 1);
+    if (i == DATASET_BENCH_WIN - 1)
+      first[0] = esp_timer_get_time() - t0;
+  }
+  last[0] = esp_timer_get_time() - t0;
+
+  FILE *fp = fopen(bin, "w+b");
+  for (uint32_t i = 0; fp != NULL && i < DATASET_BENCH_N; i++) {
+    if (i == 0 || i == DATASET_BENCH_N - DATASET_BENCH_WIN)
+      t0 = esp_timer_get_time();
+    f[0] += 0.001f;
+    bench_bin_sample(fp, block, i, f, 1);
+    if (i == DATASET_BENCH_WIN - 1)
+      first[1] = esp_timer_get_time() - t0;
+  }
+  last[1] = esp_timer_get_time() - t0;
+  if (fp != NULL)
+    fclose(fp);
+
+  for (int k = 0; k < 2; k++) {
+    float us_first = (float)first[k] / DATASET_BENCH_WIN;
+    float us_last = (float)last[k] / DATASET_BENCH_WIN;
+    ESP_LOGI(TAG,
+             "Bench dataset %s: %.0f us/muestra (primeras %d), %.0f us "
+             "(últimas %d): máx %.0f Hz",
+             k ? "binario" : "CSV", us_first, DATASET_BENCH_WIN, us_last,
+             DATASET_BENCH_WIN, 1e6f / us_last);
+  }
+  remove(csv);
+  remove(bin);
+}
+#endif
+
 // POST /api/v1/time
 static esp_err_t api_time_post_handler(httpd_req_t *req) {
   // ... (Previous implementation)
@@ -233,12 +352,12 @@ static esp_err_t api_time_post_handler(httpd_req_t *req) {
   if (root) {
     cJSON *epoch = cJSON_GetObjectItem(root, "epoch");
     if (epoch) {
-      struct timeval tv;
-      tv.tv_sec = (time_t)epoch->valuedouble; // Use double for large ints in JS
-      tv.tv_usec = 0;
-      settimeofday(&tv, NULL);
-      ESP_LOGI(TAG, "Time updated to: %ld", tv.tv_sec);
-      httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
+      // Segundos con decimales (ms del navegador). Con SNTP se ignora
+      int64_t wall_us = (int64_t)(epoch->valuedouble * 1e6);
+      bool applied = bb_connect_set_time(wall_us);
+      ESP_LOGI(TAG, "Time updated to: %lld%s", (long long)(wall_us / 1000000),
+               applied ? "" : " (ignorado, hora SNTP)");
+      httpd_resp_send(req, applied ? "OK" : "SNTP", HTTPD_RESP_USE_STRLEN);
     } else {
       httpd_resp_send_500(req);
     }
@@ -270,11 +389,82 @@ static esp_err_t api_status_handler(httpd_req_t *req) {
   strftime(strftime_buf, sizeof(strftime_buf), "%Y-%m-%d %H:%M:%S", &timeinfo);
   cJSON_AddStringToObject(root, "timestamp", strftime_buf);
 
+  // Hora de los reportes (bb_clock.h): fuente, sincronizaciones y deriva
+  bb_clock_t clock;
+  bb_connect_clock_get(&clock);
+  cJSON_AddStringToObject(root, "time_src",
+                          bb_clock_source_name(clock.source));
+  cJSON_AddNumberToObject(root, "time_syncs", clock.syncs);
+  if (clock.drift_valid)
+    cJSON_AddNumberToObject(root, "clock_drift_ppm", clock.drift_ppb / 1000.0);
+
+  // Línea de tiempo común de las balizas ESP-NOW (bb_sync.h)
+  static bb_sync_t sync; // ~300 B: fuera de la pila del servidor HTTP
+  uint8_t role = bb_espnow_sync_get(&sync);
+  cJSON_AddStringToObject(root, "sync_role",
+                          role == BB_SYNC_MASTER     ? "master"
+                          : role == BB_SYNC_FOLLOWER ? "follower"
+                                                     : "off");
+  if (role == BB_SYNC_FOLLOWER) {
+    cJSON_AddBoolToObject(root, "sync_locked", sync.locked);
+    cJSON_AddNumberToObject(root, "sync_err_us", sync.err_us);
+    cJSON_AddNumberToObject(root, "sync_drift_ppm", sync.drift_ppb / 1000.0);
+    cJSON_AddNumberToObject(root, "sync_resets", sync.resets);
+  }
+
   // Telemetry
   cJSON_AddNumberToObject(root, "rms", report.vib_rms);
   cJSON_AddNumberToObject(root, "peak", report.vib_peak);
   cJSON_AddNumberToObject(root, "crest", report.crest_factor);
   cJSON_AddNumberToObject(root, "temp", report.temp_c);
+  cJSON_AddNumberToObject(root, "fs_hz", report.fs_hz);
+  cJSON_AddNumberToObject(root, "dom_freq", report.vib_dom_freq);
+  cJSON_AddNumberToObject(root, "n_points", report.n_points);
+  if (report.n_points > 1) {
+    cJSON_AddNumberToObject(root, "p2_rms", report.p2_rms);
+    cJSON_AddNumberToObject(root, "p2_dom_freq", report.p2_dom_freq);
+    cJSON_AddNumberToObject(root, "coh", report.coh_dom);
+    cJSON_AddNumberToObject(root, "phase_deg", report.phase_dom_deg);
+  }
+  cJSON_AddNumberToObject(root, "boot_ms", report.boot_to_sample_ms);
+  cJSON_AddBoolToObject(root, "calibrated", report.calibrated);
+  cJSON_AddNumberToObject(root, "quality", report.quality);
+  cJSON_AddNumberToObject(root, "q_failed", report.q_failed_reads);
+  cJSON_AddNumberToObject(root, "q_clipped", report.q_clipped);
+  cJSON_AddNumberToObject(root, "q_stuck", report.q_stuck_run);
+  cJSON_AddNumberToObject(root, "q_gaps", report.q_gaps);
+  cJSON_AddNumberToObject(root, "seq", report.seq);
+
+  // Store-and-forward: reportes en flash esperando al broker
+  bb_backlog_stats_t backlog;
+  bb_backlog_get_stats(&backlog);
+  cJSON_AddNumberToObject(root, "backlog", backlog.count);
+  cJSON_AddNumberToObject(root, "backlog_dropped", backlog.dropped);
+  cJSON_AddNumberToObject(root, "backlog_no_space", backlog.no_space);
+  cJSON_AddNumberToObject(root, "report_dropped", bb_report_dropped());
+
+  // Ocupación de SPIFFS (presupuesto en bb_config.h)
+  size_t fs_total = 0, fs_used = 0;
+  if (bb_storage_usage(&fs_total, &fs_used) == ESP_OK) {
+    cJSON_AddNumberToObject(root, "fs_used", fs_used);
+    cJSON_AddNumberToObject(root, "fs_total", fs_total);
+  }
+
+  // Tendencias en flash (bb_history.h): puntos y hora del más antiguo
+  bb_trend_stats_t trend;
+  bb_history_get_stats(BB_HIST_RAW, &trend);
+  cJSON_AddNumberToObject(root, "trend_count", trend.count);
+  cJSON_AddNumberToObject(root, "trend_oldest", trend.oldest_t);
+  uint32_t hist_no_space = 0;
+  for (int r = 0; r < BB_HIST_COUNT; r++) {
+    bb_history_get_stats((bb_history_res_t)r, &trend);
+    hist_no_space += trend.no_space;
+  }
+  cJSON_AddNumberToObject(root, "hist_no_space", hist_no_space);
+  if (report.n_axes == 6) {
+    cJSON_AddNumberToObject(root, "gyro_rms", report.gyro_rms_dps);
+    cJSON_AddNumberToObject(root, "gyro_dom_freq", report.gyro_dom_freq);
+  }
 
   // AI Result
   cJSON_AddNumberToObject(root, "ai_class", report.ai_class);
@@ -295,6 +485,14 @@ static esp_err_t api_status_handler(httpd_req_t *req) {
   cJSON_AddNumberToObject(root, "train_count", g_capture_count);
   cJSON_AddNumberToObject(root, "train_target", g_capture_target);
 
+  // Dataset en flash y muestras rechazadas con la cola llena
+  bb_dataset_stats_t ds;
+  bb_dataset_get_stats(&ds);
+  cJSON_AddNumberToObject(root, "train_stored", ds.records);
+  cJSON_AddNumberToObject(root, "train_queue_full", ds.queue_full);
+  cJSON_AddNumberToObject(root, "train_max", ds.max);
+  cJSON_AddNumberToObject(root, "train_full", ds.full + ds.no_space);
+
   const char *sys_info = cJSON_PrintUnformatted(root);
   httpd_resp_send(req, sys_info, HTTPD_RESP_USE_STRLEN);
 
@@ -317,6 +515,20 @@ static esp_err_t api_config_get_handler(httpd_req_t *req) {
   cJSON_AddNumberToObject(root, "sample_rate", cfg->sample_rate_hz);
   cJSON_AddNumberToObject(root, "n_samples", cfg->n_samples);
   cJSON_AddBoolToObject(root, "espnow_en", cfg->espnow_enabled);
+  cJSON_AddBoolToObject(root, "espnow_gw", cfg->espnow_gateway);
+  cJSON_AddNumberToObject(root, "espnow_sync", cfg->espnow_sync);
+  cJSON_AddBoolToObject(root, "acq_continuous", cfg->acq_continuous);
+  cJSON_AddBoolToObject(root, "acq_gyro", cfg->acq_gyro);
+  cJSON_AddBoolToObject(root, "maint_mode", cfg->maint_mode);
+  cJSON_AddBoolToObject(root, "mqtt_binary", cfg->mqtt_binary);
+  cJSON_AddNumberToObject(root, "mqtt_batch_size", cfg->mqtt_batch_size);
+  cJSON_AddNumberToObject(root, "mqtt_batch_max_ms", cfg->mqtt_batch_max_ms);
+  cJSON_AddBoolToObject(root, "rbe_en", cfg->rbe_enabled);
+  cJSON_AddNumberToObject(root, "rbe_db_pct", cfg->rbe_db_pct);
+  cJSON_AddNumberToObject(root, "rbe_db_g", cfg->rbe_db_g);
+  cJSON_AddNumberToObject(root, "rbe_db_temp", cfg->rbe_db_temp_c);
+  cJSON_AddNumberToObject(root, "rbe_heartbeat_s", cfg->rbe_heartbeat_s);
+  cJSON_AddStringToObject(root, "sntp_server", cfg->sntp_server);
 
   // Thresholds
   cJSON_AddNumberToObject(root, "rms_warn", cfg->rms_alert_warn);
@@ -384,9 +596,16 @@ static esp_err_t api_config_post_handler(httpd_req_t *req) {
     strlcpy(new_cfg.mqtt_topic_telemetry, item->valuestring,
             sizeof(new_cfg.mqtt_topic_telemetry));
 
+  // Mismo rango que bb_sensors_stream_start y el canal MQTT
   item = cJSON_GetObjectItem(root, "sample_rate");
-  if (item)
-    new_cfg.sample_rate_hz = item->valueint;
+  if (item) {
+    int hz = item->valueint;
+    if (hz < BB_STREAM_RATE_MIN_HZ)
+      hz = BB_STREAM_RATE_MIN_HZ;
+    if (hz > BB_STREAM_RATE_MAX_HZ)
+      hz = BB_STREAM_RATE_MAX_HZ;
+    new_cfg.sample_rate_hz = hz;
+  }
 
   item = cJSON_GetObjectItem(root, "n_samples");
   if (item)
@@ -396,6 +615,65 @@ static esp_err_t api_config_post_handler(httpd_req_t *req) {
   if (item)
     new_cfg.espnow_enabled = cJSON_IsTrue(item);
 
+  item = cJSON_GetObjectItem(root, "espnow_gw");
+  if (item)
+    new_cfg.espnow_gateway = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "espnow_sync");
+  if (item && item->valueint >= 0 && item->valueint <= 2)
+    new_cfg.espnow_sync = (uint8_t)item->valueint;
+
+  item = cJSON_GetObjectItem(root, "acq_continuous");
+  if (item)
+    new_cfg.acq_continuous = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "acq_gyro");
+  if (item)
+    new_cfg.acq_gyro = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "maint_mode");
+  if (item)
+    new_cfg.maint_mode = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "mqtt_binary");
+  if (item)
+    new_cfg.mqtt_binary = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "mqtt_batch_size");
+  if (item && item->valueint >= 1)
+    new_cfg.mqtt_batch_size = (item->valueint > BB_MQTT_BATCH_MAX)
+                                  ? BB_MQTT_BATCH_MAX
+                                  : (uint8_t)item->valueint;
+
+  item = cJSON_GetObjectItem(root, "mqtt_batch_max_ms");
+  if (item && item->valueint > 0)
+    new_cfg.mqtt_batch_max_ms = item->valueint;
+
+  item = cJSON_GetObjectItem(root, "rbe_en");
+  if (item)
+    new_cfg.rbe_enabled = cJSON_IsTrue(item);
+
+  item = cJSON_GetObjectItem(root, "rbe_db_pct");
+  if (item && item->valuedouble >= 0.0)
+    new_cfg.rbe_db_pct = (float)item->valuedouble;
+
+  item = cJSON_GetObjectItem(root, "rbe_db_g");
+  if (item && item->valuedouble >= 0.0)
+    new_cfg.rbe_db_g = (float)item->valuedouble;
+
+  item = cJSON_GetObjectItem(root, "rbe_db_temp");
+  if (item && item->valuedouble >= 0.0)
+    new_cfg.rbe_db_temp_c = (float)item->valuedouble;
+
+  item = cJSON_GetObjectItem(root, "rbe_heartbeat_s");
+  if (item && item->valueint >= 10)
+    new_cfg.rbe_heartbeat_s = item->valueint;
+
+  item = cJSON_GetObjectItem(root, "sntp_server");
+  if (cJSON_IsString(item) && strlen(item->valuestring) > 0)
+    strlcpy(new_cfg.sntp_server, item->valuestring,
+            sizeof(new_cfg.sntp_server));
+
   // Thresholds Parsing
   item = cJSON_GetObjectItem(root, "rms_warn");
   if (item)
@@ -428,10 +706,139 @@ static esp_err_t api_config_post_handler(httpd_req_t *req) {
 static esp_err_t restart_handler(httpd_req_t *req) {
   httpd_resp_send(req, "Restarting...", HTTPD_RESP_USE_STRLEN);
   vTaskDelay(pdMS_TO_TICKS(100)); // Allow response to flush
+  bb_history_flush();              // Tendencias aún en RAM
+  bb_dataset_flush(1000);          // Bloque de entrenamiento a medias
   esp_restart();
   return ESP_OK;
 }
 
+// GET /api/v1/trend?res=<raw|min|hour|day>&from=<s UTC>&to=<s UTC>&max=<n>
+// Histórico en binario (formatos en bb_telemetry_codec.h). Por defecto,
+// la serie de 10 s: las 12 h hasta el último punto en
+// BB_TREND_DEFAULT_POINTS
+static esp_err_t api_trend_handler(httpd_req_t *req) {
+  char query[128], val[16];
+  bool have_query =
+      httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+
+  bb_history_res_t res = BB_HIST_RAW;
+  if (have_query &&
+      httpd_query_key_value(query, "res", val, sizeof(val)) == ESP_OK &&
+      !bb_history_parse_res(val, &res)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "res desconocida");
+    return ESP_OK;
+  }
+  uint32_t from_s, to_s, max_points;
+  bb_history_default_query(res, &from_s, &to_s, &max_points);
+  uint32_t span = to_s - from_s;
+  bool have_from = false;
+  if (have_query) {
+    if (httpd_query_key_value(query, "to", val, sizeof(val)) == ESP_OK)
+      to_s = strtoul(val, NULL, 10);
+    if (httpd_query_key_value(query, "from", val, sizeof(val)) == ESP_OK) {
+      from_s = strtoul(val, NULL, 10);
+      have_from = true;
+    }
+    if (httpd_query_key_value(query, "max", val, sizeof(val)) == ESP_OK)
+      max_points = strtoul(val, NULL, 10);
+  }
+  if (!have_from)
+    from_s = (to_s > span) ? to_s - span : 0;
+  if (max_points < 1 || max_points > bb_history_query_max(res)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "max fuera de rango");
+    return ESP_OK;
+  }
+
+  uint8_t *buf = NULL;
+  size_t len = 0;
+  esp_err_t err = bb_history_query(res, from_s, to_s, max_points, &buf, &len,
+                                   NULL, NULL);
+  if (err == ESP_ERR_NO_MEM) {
+    httpd_resp_send_500(req);
+    return ESP_OK;
+  }
+  if (err != ESP_OK) {
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "sin serie de tendencias");
+    return ESP_OK;
+  }
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_send(req, (const char *)buf, len);
+  free(buf);
+  return ESP_OK;
+}
+
+// GET /api/v1/calibrate
+// Estado de la calibración en reposo y resultado guardado por IMU
+static esp_err_t api_calibrate_get_handler(httpd_req_t *req) {
+  static const char *const status_names[] = {"idle", "pending", "ok",
+                                             "moving", "failed"};
+  const bb_config_t *cfg = bb_config_get();
+  bb_cal_status_t st = bb_dsp_ai_calibration_status();
+
+  cJSON *root = cJSON_CreateObject();
+  cJSON_AddStringToObject(root, "status", status_names[st]);
+  cJSON *imus = cJSON_AddArrayToObject(root, "imus");
+  for (int i = 0; i < BB_MAX_IMUS; i++) {
+    const bb_imu_cal_t *cal = &cfg->imu_cal[i];
+    cJSON *imu = cJSON_CreateObject();
+    cJSON_AddBoolToObject(imu, "valid", cal->valid);
+    if (cal->valid) {
+      cJSON_AddNumberToObject(imu, "tilt_deg", bb_dsp_ai_cal_tilt_deg(cal));
+      cJSON_AddItemToObject(imu, "gravity",
+                            cJSON_CreateFloatArray(cal->gravity_g, 3));
+      cJSON_AddItemToObject(imu, "bias",
+                            cJSON_CreateFloatArray(cal->bias_g, 3));
+    }
+    cJSON_AddItemToArray(imus, imu);
+  }
+
+  const char *res = cJSON_PrintUnformatted(root);
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_send(req, res, HTTPD_RESP_USE_STRLEN);
+
+  free((void *)res);
+  cJSON_Delete(root);
+  return ESP_OK;
+}
+
+// POST /api/v1/calibrate
+// Sin cuerpo: calibrar con la próxima trama. {"clear":true}: borrar.
+static esp_err_t api_calibrate_post_handler(httpd_req_t *req) {
+  char buf[64];
+  int remaining = req->content_len;
+  bool clear = false;
+
+  if (remaining >= sizeof(buf)) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  if (remaining > 0) {
+    int ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0)
+      return ESP_FAIL;
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root) {
+      clear = cJSON_IsTrue(cJSON_GetObjectItem(root, "clear"));
+      cJSON_Delete(root);
+    }
+  }
+
+  if (clear) {
+    if (bb_dsp_ai_clear_calibration() != ESP_OK) {
+      httpd_resp_send_500(req);
+      return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Calibration cleared");
+  } else {
+    bb_dsp_ai_request_calibration();
+    ESP_LOGI(TAG, "Calibration requested (next frame, machine at rest)");
+  }
+  httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
+  return ESP_OK;
+}
+
 // Checksum handler / captive portal related
 // For Android Captive Portal, usually handles /generate_204
 static esp_err_t captive_handler(httpd_req_t *req) {
@@ -445,7 +852,7 @@ static esp_err_t captive_handler(httpd_req_t *req) {
 void bb_web_ui_start(void) {
   httpd_handle_t server = NULL;
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-  config.max_uri_handlers = 12;
+  config.max_uri_handlers = 16;
 
   ESP_LOGI(TAG, "Starting HTTP Server...");
 
@@ -500,6 +907,24 @@ void bb_web_ui_start(void) {
                             .user_ctx = NULL};
     httpd_register_uri_handler(server, &time_uri);
 
+    httpd_uri_t cal_get_uri = {.uri = "/api/v1/calibrate",
+                               .method = HTTP_GET,
+                               .handler = api_calibrate_get_handler,
+                               .user_ctx = NULL};
+    httpd_register_uri_handler(server, &cal_get_uri);
+
+    httpd_uri_t cal_post_uri = {.uri = "/api/v1/calibrate",
+                                .method = HTTP_POST,
+                                .handler = api_calibrate_post_handler,
+                                .user_ctx = NULL};
+    httpd_register_uri_handler(server, &cal_post_uri);
+
+    httpd_uri_t trend_uri = {.uri = "/api/v1/trend",
+                             .method = HTTP_GET,
+                             .handler = api_trend_handler,
+                             .user_ctx = NULL};
+    httpd_register_uri_handler(server, &trend_uri);
+
     // Training APIs
     httpd_uri_t cmd_uri = {.uri = "/api/v1/command",
                            .method = HTTP_POST,
@@ -514,6 +939,19 @@ void bb_web_ui_start(void) {
     httpd_register_uri_handler(server, &dl_uri);
 
     // Start Background Training Task
+    if (bb_dataset_init(BB_DATASET_PATH, BB_DATASET_SCHEMA, TRAIN_FEATURES,
+                        BB_DATASET_MAX_RECORDS) != ESP_OK) {
+      ESP_LOGE(TAG, "Dataset de entrenamiento no disponible");
+    }
+    FILE *legacy = fopen(TRAIN_LEGACY_CSV, "r");
+    if (legacy != NULL) {
+      fclose(legacy);
+      ESP_LOGW(TAG, "%s es del formato anterior: se borra con clear_dataset",
+               TRAIN_LEGACY_CSV);
+    }
+#if BB_DATASET_BENCH
+    dataset_bench();
+#endif
     xTaskCreate(training_task_entry, "train_task", 4096, NULL, 5, NULL);
 
     // Captive Portal Catch-All (simplified)
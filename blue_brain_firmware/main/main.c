@@ -5,9 +5,13 @@
  */
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include <math.h>
+#include <stdatomic.h>
 #include <stdint.h> // Required for uint8_t
 #include <stdio.h>
 #include <stdlib.h> // Required for malloc/free
@@ -17,75 +21,630 @@
 #include "bb_config.h"
 #include "bb_connect.h"
 #include "bb_dsp_ai.h"
+#include "bb_espnow.h"
+#include "bb_pool.h"
 #include "bb_power.h"
+#include "bb_remote.h"
+#include "bb_ring.h"
 #include "bb_sensors.h"
 #include "bb_storage.h"
+#include "bb_waveform.h"
 #include "bb_web_ui.h"
 
 static const char *TAG = "BLUE_BRAIN_MAIN";
 
-// --- TAREA DE ANÁLISIS DE VIBRACIÓN (CORE 1) ---
-void Task_Vibration_Analysis(void *pvParameters) {
-  bb_telemetry_t report;
+// =============================================================
+// PIPELINE: Adquisición (C1) -> DSP (C1) -> Inferencia (C0)
+// =============================================================
+// Las etapas intercambian punteros a tramas de un pool pequeño, así la
+// ráfaga N+1 se captura mientras la N se analiza y la N-1 se reporta.
+// La temperatura va aparte (Task_Temp): el reporte lleva la última lectura.
+#define STATS_EVERY_N_FRAMES 10
 
-  // Buffer en Heap para no desbordar el stack
-  // Allocate MAX size (defined in bb_config.h)
-  size_t buffer_size =
-      BB_N_SAMPLES * 6; // 6 bytes por muestra (int16_t x, y, z)
-  uint8_t *raw_data = (uint8_t *)calloc(1, buffer_size);
+typedef struct {
+  // Un buffer por punto de medida (IMU), capturados en paralelo. El tamaño
+  // en bytes es fijo: en modo 6 ejes caben la mitad de muestras.
+  uint8_t raw[BB_MAX_IMUS][BB_N_SAMPLES * BB_ACCEL_SAMPLE_BYTES];
+  int n_imus;
+  int n_samples;
+  uint32_t seq;
 
-  if (raw_data == NULL) {
-    ESP_LOGE(TAG,
-             "FATAL: No hay memoria para el buffer de vibración (%d bytes)",
-             buffer_size);
+  // Marcas de tiempo por etapa (esp_timer, µs)
+  int64_t t_acq_start;
+  int64_t t_acq_end;
+  int64_t t_dsp_end;
+
+  bb_acq_meta_t meta[BB_MAX_IMUS]; // Reloj de muestreo y calidad por IMU
+  bb_quality_level_t quality;      // Peor nivel de los IMU de la trama
+
+  bb_telemetry_t *report; // Del pool de reportes, se publica sin copiar
+} bb_frame_t;
+
+BB_POOL_STATIC(s_frame_pool, bb_frame_t, BB_POOL_FRAMES);
+
+static QueueHandle_t xQueueFrameDsp = NULL;   // Adquisición -> DSP
+static QueueHandle_t xQueueFrameInfer = NULL; // DSP -> Inferencia
+
+// Estadísticas de latencia por etapa (solo las escribe Task_Inference)
+typedef struct {
+  uint32_t frames;
+  int64_t acq_us;
+  int64_t dsp_us;
+  int64_t infer_us;
+  int64_t e2e_us;
+  int64_t window_start_us;
+} bb_pipeline_stats_t;
+
+static bb_pipeline_stats_t s_stats;
+
+// --- ADQUISICIÓN CONTINUA (Ring SPSC FIFO -> Etapa de Adquisición) ---
+// Bloques de BB_ACQ_BLOCK_SAMPLES muestras; los bytes dependen del modo
+#define ACQ_BLOCK_BYTES_MAX (BB_ACQ_BLOCK_SAMPLES * BB_IMU_SAMPLE_BYTES_MAX)
+
+// Un ring por IMU: cada MPU6050 tiene su propia FIFO y su propio reloj
+static int64_t s_ring_stamps[BB_MAX_IMUS][BB_ACQ_RING_BLOCKS];
+static bb_ring_t s_acq_ring[BB_MAX_IMUS];
+static int s_n_rings = 0;
+static TaskHandle_t s_acq_task = NULL;
+static _Atomic uint32_t s_stream_failed[BB_MAX_IMUS]; // Lecturas I2C fallidas
+
+// Productor: vacía las FIFO de los MPU6050 en bloques del ring (CORE 1)
+void Task_Fifo_Drain(void *pvParameters) {
+  static uint8_t drop_block[ACQ_BLOCK_BYTES_MAX]; // Si el ring está lleno
+  int sample_rate = bb_config_get()->sample_rate_hz;
+  int sample_bytes = bb_sensors_sample_bytes();
+
+  if (bb_sensors_stream_start(sample_rate) != ESP_OK) {
+    ESP_LOGE(TAG, "Adquisición continua no disponible");
     vTaskDelete(NULL);
     return;
   }
 
-  ESP_LOGI(TAG, "Tarea de Análisis Iniciada. Buffer de %d bytes reservado.",
-           buffer_size);
+  // Despertar cada medio bloque: la FIFO (170/85 muestras) nunca se llena
+  int wake_ms = (BB_ACQ_BLOCK_SAMPLES * 500) / sample_rate;
+  TickType_t period = pdMS_TO_TICKS(wake_ms > 0 ? wake_ms : 1);
+  if (period == 0)
+    period = 1;
+
+  uint8_t *block[BB_MAX_IMUS] = {NULL};
+  bool dropping[BB_MAX_IMUS] = {false};
+  int fill[BB_MAX_IMUS] = {0};
+
+  while (1) {
+    vTaskDelay(period);
+
+    // Frecuencia cambiada en caliente (MQTT o Web UI): reprogramar las FIFO.
+    // Los bloques a medias se pierden y la trama que los cruza sale marcada
+    int want_rate = bb_config_get()->sample_rate_hz;
+    if (want_rate != sample_rate) {
+      ESP_LOGI(TAG, "Stream: %d -> %d Hz", sample_rate, want_rate);
+      sample_rate = want_rate;
+      if (bb_sensors_stream_start(sample_rate) != ESP_OK) {
+        for (int k = 0; k < s_n_rings; k++)
+          atomic_fetch_add(&s_stream_failed[k], 1);
+      }
+      for (int k = 0; k < s_n_rings; k++) {
+        if (fill[k] > 0)
+          bb_ring_mark_overrun(&s_acq_ring[k]);
+        fill[k] = 0;
+      }
+      wake_ms = (BB_ACQ_BLOCK_SAMPLES * 500) / sample_rate;
+      period = pdMS_TO_TICKS(wake_ms > 0 ? wake_ms : 1);
+      if (period == 0)
+        period = 1;
+    }
+
+    // Transacciones intercaladas: drenar la FIFO de A y después la de B
+    for (int k = 0; k < s_n_rings; k++) {
+      bb_ring_t *ring = &s_acq_ring[k];
+
+      while (1) {
+        if (block[k] == NULL) {
+          block[k] = bb_ring_write_acquire(ring);
+          dropping[k] = (block[k] == NULL);
+          if (dropping[k])
+            block[k] = drop_block; // Pipeline atrasado: se pierde el bloque
+        }
+
+        bool overflow = false;
+        int64_t t_last = 0;
+        int n = bb_sensors_stream_read(
+            k, block[k] + fill[k] * sample_bytes,
+            BB_ACQ_BLOCK_SAMPLES - fill[k], &overflow, &t_last);
+        if (overflow) {
+          ESP_LOGW(TAG, "FIFO MPU6050[%d] desbordada - hueco en el stream", k);
+          bb_ring_mark_overrun(ring);
+        }
+        if (n < 0) {
+          // La FIFO se reinició: el bloque en curso queda con un hueco
+          atomic_fetch_add(&s_stream_failed[k], 1);
+          bb_ring_mark_overrun(ring);
+        }
+        if (n <= 0)
+          break;
+
+        fill[k] += n;
+        if (fill[k] == BB_ACQ_BLOCK_SAMPLES) {
+          if (dropping[k]) {
+            bb_ring_mark_overrun(ring);
+          } else {
+            bb_ring_write_commit(ring, t_last);
+            xTaskNotifyGive(s_acq_task);
+          }
+          block[k] = NULL;
+          fill[k] = 0;
+        }
+      }
+    }
+  }
+}
+
+// Lee una trama de n_blocks de cada ring. Si B quedó desfasado respecto a A
+// (overrun en un solo ring) descarta bloques del más antiguo y devuelve 1
+// punto; la trama siguiente vuelve a estar alineada.
+static int acq_read_rings(bb_frame_t *frame, uint32_t n_blocks,
+                          float nominal_hz) {
+  static uint8_t skip_block[ACQ_BLOCK_BYTES_MAX];
+  static uint32_t last_overruns[BB_MAX_IMUS], last_failed[BB_MAX_IMUS];
+  int64_t stamps[BB_N_SAMPLES / BB_ACQ_BLOCK_SAMPLES];
+
+  for (int k = 0; k < s_n_rings; k++) {
+    bb_ring_read_frame(&s_acq_ring[k], frame->raw[k], n_blocks, stamps);
+    bb_sensors_meta_from_blocks(stamps, n_blocks, BB_ACQ_BLOCK_SAMPLES,
+                                nominal_hz, &frame->meta[k]);
+
+    // Calidad: lo que el productor vio desde la trama anterior + barrido
+    bb_acq_quality_t *q = &frame->meta[k].quality;
+    uint32_t overruns = bb_ring_overruns(&s_acq_ring[k]);
+    uint32_t failed = atomic_load(&s_stream_failed[k]);
+    *q = (bb_acq_quality_t){0};
+    q->gaps = (uint16_t)(overruns - last_overruns[k]);
+    q->failed_reads = (uint16_t)(failed - last_failed[k]);
+    last_overruns[k] = overruns;
+    last_failed[k] = failed;
+    bb_sensors_quality_scan(frame->raw[k], n_blocks * BB_ACQ_BLOCK_SAMPLES, q);
+  }
+  if (s_n_rings < 2)
+    return 1;
+
+  float block_us = (float)BB_ACQ_BLOCK_SAMPLES * 1e6f / frame->meta[0].fs_hz;
+  float skew_us =
+      (float)(frame->meta[1].t_first_us - frame->meta[0].t_first_us);
+  int skew_blocks = (int)lroundf(skew_us / block_us);
+  if (skew_blocks == 0)
+    return 2;
+
+  // skew > 0: A va por detrás (datos más antiguos) -> descartar en A
+  bb_ring_t *behind = &s_acq_ring[skew_blocks > 0 ? 0 : 1];
+  ESP_LOGW(TAG, "Rings desalineados %d bloques: realineando", skew_blocks);
+  for (int i = 0; i < abs(skew_blocks); i++) {
+    if (!bb_ring_read_frame(behind, skip_block, 1, NULL))
+      break;
+  }
+  return 1;
+}
+
+// Resume la calidad de los IMU de la trama en su reporte y devuelve el peor
+// nivel: una trama BAD no pasa por FFT ni inferencia
+static bb_quality_level_t frame_quality(bb_frame_t *frame) {
+  bb_telemetry_t *report = frame->report;
+  bb_quality_level_t level = BB_QUALITY_OK;
+
+  for (int k = 0; k < frame->n_imus; k++) {
+    const bb_acq_quality_t *q = &frame->meta[k].quality;
+    bb_quality_level_t l = bb_sensors_quality_level(q, frame->n_samples);
+    if (l > level)
+      level = l;
+    report->q_failed_reads += q->failed_reads;
+    report->q_clipped += q->clipped;
+    report->q_gaps += q->gaps;
+    if (q->stuck_run > report->q_stuck_run)
+      report->q_stuck_run = q->stuck_run;
+  }
+  report->quality = (uint8_t)level;
+  return level;
+}
+
+// Ráfaga inmediata pedida por MQTT (solo modo ráfaga: en continuo no hay
+// pausa entre tramas que adelantar)
+static esp_err_t remote_capture_now(void) {
+  if (s_acq_task == NULL || s_n_rings > 0)
+    return ESP_ERR_NOT_SUPPORTED;
+  xTaskNotifyGive(s_acq_task);
+  return ESP_OK;
+}
+
+// Nueva calibración en reposo con la próxima ráfaga (adelantada si se puede)
+static esp_err_t remote_baseline_reset(void) {
+  bb_dsp_ai_request_calibration();
+  remote_capture_now();
+  return ESP_OK;
+}
+
+// Hueco mínimo hasta una ráfaga alineada (antes, el hueco siguiente)
+#define ACQ_SYNC_LEAD_US 10000
+
+// Espera a la siguiente ráfaga (modo ráfaga). Con línea común
+// (espnow_sync) empieza en un múltiplo de BB_REPORT_INTERVAL_MS del reloj
+// del maestro, a la vez en todos los nodos: bloqueada hasta
+// BB_SYNC_SPIN_US antes y el resto en espera activa (el tick es de 1 ms).
+// Sin ella, cadencia propia desde last_wake. Una captura remota adelanta la
+// ráfaga y la cadencia sigue desde ella.
+static void acq_wait_burst(TickType_t *last_wake) {
+  static bool synced;
+  int64_t now_us = esp_timer_get_time();
+  int64_t start_us;
+  bool sync = bb_espnow_sync_next_slot(now_us, BB_REPORT_INTERVAL_MS * 1000LL,
+                                       ACQ_SYNC_LEAD_US, &start_us);
+  if (sync != synced) {
+    ESP_LOGI(TAG, "%s", sync ? "Ráfagas alineadas a la línea común"
+                             : "Sin línea común: cadencia propia");
+    synced = sync;
+  }
+
+  if (!sync) {
+    TickType_t interval = pdMS_TO_TICKS(BB_REPORT_INTERVAL_MS);
+    TickType_t waited = xTaskGetTickCount() - *last_wake;
+    if (waited < interval && ulTaskNotifyTake(pdTRUE, interval - waited)) {
+      ESP_LOGI(TAG, "Captura inmediata pedida por MQTT");
+      *last_wake = xTaskGetTickCount();
+    } else {
+      *last_wake += interval;
+    }
+    return;
+  }
+
+  int64_t block_us = start_us - now_us - BB_SYNC_SPIN_US;
+  if (block_us >= 1000 &&
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(block_us / 1000))) {
+    ESP_LOGI(TAG, "Captura inmediata pedida por MQTT");
+  } else {
+    while (esp_timer_get_time() < start_us) {
+      // Unos ms como mucho: el instante de la primera muestra es lo que
+      // se alinea entre nodos
+    }
+  }
+  *last_wake = xTaskGetTickCount();
+}
+
+// --- ETAPA 1: ADQUISICIÓN (CORE 1) ---
+void Task_Acquisition(void *pvParameters) {
+  // El modo se fija al arrancar (cambiarlo desde la Web UI o por MQTT pide
+  // reiniciar el nodo); n_samples y la frecuencia se leen en cada trama
+  bool continuous = bb_config_get()->acq_continuous;
+  int n_imus = bb_sensors_imu_count();
+  int sample_bytes = bb_sensors_sample_bytes();
+  int max_samples = (int)sizeof(((bb_frame_t *)0)->raw[0]) / sample_bytes;
+  uint32_t last_overruns = 0;
+  uint32_t seq = 0;
+  TickType_t last_wake = xTaskGetTickCount();
+
+  if (continuous) {
+    // 24 KB por IMU: solo se reservan los rings de los sensores presentes.
+    // En modo 6 ejes los bloques doblan su tamaño y el ring tiene la mitad.
+    uint16_t block_bytes = BB_ACQ_BLOCK_SAMPLES * sample_bytes;
+    uint16_t ring_blocks =
+        BB_ACQ_RING_BLOCKS * BB_ACCEL_SAMPLE_BYTES / sample_bytes;
+    for (int k = 0; k < n_imus; k++) {
+      uint8_t *storage = malloc((size_t)ring_blocks * block_bytes);
+      if (storage == NULL) {
+        ESP_LOGE(TAG, "Sin memoria para el ring del IMU %d", k);
+        break;
+      }
+      bb_ring_init(&s_acq_ring[k], storage, s_ring_stamps[k], block_bytes,
+                   ring_blocks);
+      s_n_rings++;
+    }
+    if (s_n_rings > 0)
+      n_imus = s_n_rings;
+    else
+      continuous = false; // Sin rings: seguir en modo ráfaga
+  }
+  s_acq_task = xTaskGetCurrentTaskHandle(); // Ring lleno o captura remota
+  if (continuous) {
+    xTaskCreatePinnedToCore(Task_Fifo_Drain, "Vib_Fifo", 4096, NULL, 7, NULL,
+                            1);
+    ESP_LOGI(TAG, "Modo continuo: %d ring(s) de %d bloques x %d muestras",
+             s_n_rings, s_acq_ring[0].n_blocks, BB_ACQ_BLOCK_SAMPLES);
+  }
 
   while (1) {
+    // Tomar una trama y su reporte de los pools (esperar si están agotados)
+    bb_frame_t *frame;
+    while ((frame = bb_pool_alloc(&s_frame_pool)) == NULL)
+      vTaskDelay(pdMS_TO_TICKS(10));
+    while ((frame->report = bb_report_alloc()) == NULL)
+      vTaskDelay(pdMS_TO_TICKS(10));
+
     // Leer configuración actual
     const bb_config_t *cfg = bb_config_get();
     int current_samples = cfg->n_samples;
 
     // Sanity check
-    if (current_samples > BB_N_SAMPLES)
-      current_samples = BB_N_SAMPLES;
+    if (current_samples > max_samples)
+      current_samples = max_samples;
     if (current_samples < 64)
       current_samples = 64;
 
-    ESP_LOGI(TAG, "Iniciando ráfaga de %d muestras...", current_samples);
+    if (continuous) {
+      // Consumir una trama completa del ring (la siguiente ya se captura)
+      uint32_t frame_blocks = current_samples / BB_ACQ_BLOCK_SAMPLES;
+      current_samples = frame_blocks * BB_ACQ_BLOCK_SAMPLES;
 
-    // 1. Adquisición de Datos (Bloqueante/Precisa)
-    bb_sensors_read_accel_burst(raw_data, current_samples);
+      for (int k = 0; k < s_n_rings; k++) {
+        while (bb_ring_available(&s_acq_ring[k]) < frame_blocks)
+          ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      }
+      frame->t_acq_start = esp_timer_get_time();
+      frame->n_imus =
+          acq_read_rings(frame, frame_blocks, (float)cfg->sample_rate_hz);
 
-    // 2. Procesamiento DSP (Cálculo de RMS, Peak, etc)
-    bb_dsp_ai_process_vibration(raw_data, current_samples, &report);
+      uint32_t overruns = 0;
+      for (int k = 0; k < s_n_rings; k++)
+        overruns += bb_ring_overruns(&s_acq_ring[k]);
+      if (overruns != last_overruns) {
+        ESP_LOGW(TAG, "Stream con huecos: %lu bloques perdidos (total %lu)",
+                 (unsigned long)(overruns - last_overruns),
+                 (unsigned long)overruns);
+        last_overruns = overruns;
+      }
+    } else {
+      // Cadencia fija desde el inicio de cada ráfaga: DSP y temperatura ya
+      // no alargan el ciclo porque corren en paralelo. La primera ráfaga sale
+      // sin espera (tiempo hasta el primer dato tras despertar).
+      if (seq > 0)
+        acq_wait_burst(&last_wake);
 
-    // 3. Adquisición de Temperatura
-    report.temp_c = bb_sensors_get_temp();
+      ESP_LOGI(TAG, "Iniciando ráfaga de %d muestras x %d IMU...",
+               current_samples, n_imus);
+      uint8_t *bufs[BB_MAX_IMUS];
+      for (int k = 0; k < BB_MAX_IMUS; k++)
+        bufs[k] = frame->raw[k];
+      frame->t_acq_start = esp_timer_get_time();
+      bb_sensors_read_accel_burst_multi(bufs, n_imus, current_samples,
+                                        frame->meta);
+      frame->n_imus = n_imus;
+    }
 
-    // 4. Telemetría Local y Remota
-    ESP_LOGW(TAG, "==== REPORTE BLUE BRAIN ====");
-    ESP_LOGI(TAG, "RMS: %.3f G | Peak: %.3f G | CF: %.2f", report.vib_rms,
-             report.vib_peak, report.crest_factor);
-    ESP_LOGI(TAG, "Temp: %.2f C", report.temp_c);
+    frame->t_acq_end = esp_timer_get_time();
+    frame->n_samples = current_samples;
+    frame->seq = seq++;
+    frame->quality = frame_quality(frame);
 
-    // Enviar a la cola para que bb_connect lo procese (MQTT/ESP-NOW)
-    if (xQueueTelemetry != NULL) {
-      if (xQueueSend(xQueueTelemetry, &report, 0) != pdPASS) {
-        ESP_LOGW(TAG, "Cola llena, telemetría descartada");
-      } else {
-        ESP_LOGD(TAG, "Datos enviados a Task_Comms");
-      }
+    xQueueSend(xQueueFrameDsp, &frame, portMAX_DELAY);
+  }
+}
+
+// --- ETAPA 2: DSP (CORE 1) ---
+void Task_DSP(void *pvParameters) {
+  while (1) {
+    bb_frame_t *frame = NULL;
+    xQueueReceive(xQueueFrameDsp, &frame, portMAX_DELAY);
+
+    // Trama inservible (I2C caído, sensor congelado): ni FFT ni calibración,
+    // el reporte sale solo con los contadores de calidad
+    if (frame->quality == BB_QUALITY_BAD) {
+      ESP_LOGW(TAG, "Trama #%lu descartada por calidad",
+               (unsigned long)frame->seq);
+      frame->t_dsp_end = esp_timer_get_time();
+      xQueueSend(xQueueFrameInfer, &frame, portMAX_DELAY);
+      continue;
+    }
+
+    // Calibración pedida desde la Web UI: usa esta misma trama (en reposo)
+    // y ya se aplica a su propio reporte
+    if (bb_dsp_ai_calibration_pending()) {
+      uint8_t *raw[BB_MAX_IMUS];
+      for (int i = 0; i < frame->n_imus; i++)
+        raw[i] = frame->raw[i];
+      bb_dsp_ai_calibrate(raw, frame->n_imus, frame->n_samples);
+    }
+
+    // Procesamiento DSP (Cálculo de RMS, Peak, FFT, Bandas)
+    bb_dsp_ai_process_vibration(frame->raw[0], frame->n_samples,
+                                &frame->meta[0], frame->report);
+    // Segundo punto: rasgos propios + coherencia/fase A-B
+    if (frame->n_imus > 1) {
+      bb_dsp_ai_process_cross(frame->raw[0], frame->raw[1], frame->n_samples,
+                              &frame->meta[1], frame->report);
+    }
+    frame->t_dsp_end = esp_timer_get_time();
+
+    xQueueSend(xQueueFrameInfer, &frame, portMAX_DELAY);
+  }
+}
+
+static void pipeline_stats_update(const bb_frame_t *frame, int64_t t_end) {
+  if (s_stats.frames == 0)
+    s_stats.window_start_us = frame->t_acq_start;
+
+  s_stats.frames++;
+  s_stats.acq_us += frame->t_acq_end - frame->t_acq_start;
+  s_stats.dsp_us += frame->t_dsp_end - frame->t_acq_end;
+  s_stats.infer_us += t_end - frame->t_dsp_end;
+  s_stats.e2e_us += t_end - frame->t_acq_start;
+
+  if (s_stats.frames < STATS_EVERY_N_FRAMES)
+    return;
+
+  uint32_t n = s_stats.frames;
+  float window_s = (float)(t_end - s_stats.window_start_us) / 1e6f;
+  ESP_LOGI(TAG,
+           "Pipeline[%lu tramas]: acq=%lld ms dsp=%lld ms infer=%lld ms "
+           "e2e=%lld ms | %.2f reportes/min",
+           (unsigned long)n, s_stats.acq_us / n / 1000,
+           s_stats.dsp_us / n / 1000, s_stats.infer_us / n / 1000,
+           s_stats.e2e_us / n / 1000,
+           (window_s > 0.0f) ? (60.0f * n / window_s) : 0.0f);
+  memset(&s_stats, 0, sizeof(s_stats));
+
+  bb_pool_stats_t st;
+  bb_pool_get_stats(&s_frame_pool, &st);
+  ESP_LOGI(TAG, "Pool tramas: %lu/%lu en uso, max %lu, agotado %lu veces",
+           (unsigned long)st.in_use, (unsigned long)st.capacity,
+           (unsigned long)st.high_watermark, (unsigned long)st.exhausted);
+  bb_report_log_stats();
+}
+
+static void frame_retain(void *frame) {
+  bb_pool_retain(&s_frame_pool, frame);
+}
+
+static void frame_release(void *frame) {
+  bb_pool_release(&s_frame_pool, frame);
+}
+
+// Forma de onda bajo demanda (MQTT): bb_waveform retiene la trama si la
+// necesita y publica directamente desde frame->raw. En modo ráfaga guarda
+// además la última (el pool tiene holgura entre ráfagas); en continuo las
+// tres tramas hacen falta en el pipeline y "last" espera a la siguiente.
+static void frame_offer_waveform(bb_frame_t *frame, bool keep_last) {
+  bb_wave_src_t src = {
+      .n_imus = (uint8_t)frame->n_imus,
+      .sample_bytes = (uint8_t)bb_sensors_sample_bytes(),
+      .n_samples = (uint16_t)frame->n_samples,
+      .frame_seq = frame->seq,
+      .t_first_us = frame->meta[0].t_first_us,
+      .fs_hz = frame->meta[0].fs_hz,
+      .accel_lsb_per_g = BB_ACCEL_SENS_16G,
+      .gyro_lsb_per_dps = BB_GYRO_SENS_2000DPS,
+      .quality = (uint8_t)frame->quality,
+      .owner = frame,
+      .retain = frame_retain,
+      .release = frame_release,
+  };
+  for (int k = 0; k < frame->n_imus; k++)
+    src.raw[k] = frame->raw[k];
+  bb_wave_frame_done(&src, keep_last);
+}
+
+// --- TEMPERATURA (CORE 0, cadencia propia) ---
+// El Convert T de los DS18B20 bloquea 750 ms: leído por trama limitaría el
+// pipeline a ~1.3 tramas/s (tramas cortas en continuo agotarían el pool).
+// Esta tarea lee cada BB_TEMP_PERIOD_MS y deja la lectura en caché.
+typedef struct {
+  bb_temp_reading_t r[BB_DS18B20_MAX_DEVICES];
+  int n;
+} temp_cache_t;
+
+static temp_cache_t s_temps; // n = 0 hasta la primera lectura
+static portMUX_TYPE s_temps_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void Task_Temp(void *pvParameters) {
+  TickType_t last = xTaskGetTickCount();
+  while (1) {
+    temp_cache_t c;
+    c.n = bb_sensors_get_temps(c.r, BB_DS18B20_MAX_DEVICES);
+    taskENTER_CRITICAL(&s_temps_mux);
+    s_temps = c;
+    taskEXIT_CRITICAL(&s_temps_mux);
+    vTaskDelayUntil(&last, pdMS_TO_TICKS(BB_TEMP_PERIOD_MS));
+  }
+}
+
+// --- ETAPA 3: INFERENCIA + REPORTE (CORE 0) ---
+void Task_Inference(void *pvParameters) {
+  bool keep_last_frame = !bb_config_get()->acq_continuous;
+
+  while (1) {
+    bb_frame_t *frame = NULL;
+    xQueueReceive(xQueueFrameInfer, &frame, portMAX_DELAY);
+    bb_telemetry_t *report = frame->report;
+
+    // Temperatura: última lectura de Task_Temp (no bloquea)
+    temp_cache_t temps;
+    taskENTER_CRITICAL(&s_temps_mux);
+    temps = s_temps;
+    taskEXIT_CRITICAL(&s_temps_mux);
+    report->temp_c = -99.0f;
+    report->temp_count = (uint8_t)temps.n;
+    for (int i = 0; i < temps.n; i++) {
+      report->temp_points_c[i] = temps.r[i].temp_c;
+      report->temp_rom[i] = temps.r[i].rom;
+      if (temps.r[i].valid && report->temp_c == -99.0f)
+        report->temp_c = temps.r[i].temp_c;
+    }
+
+    // Telemetría Local y Remota
+    ESP_LOGW(TAG, "==== REPORTE BLUE BRAIN #%lu ====",
+             (unsigned long)frame->seq);
+    ESP_LOGI(TAG, "RMS: %.3f G | Peak: %.3f G | CF: %.2f", report->vib_rms,
+             report->vib_peak, report->crest_factor);
+    ESP_LOGI(TAG, "Fs: %.1f Hz (jitter %.1f us) | Dom: %.1f Hz",
+             report->fs_hz, report->fs_jitter_us, report->vib_dom_freq);
+    if (report->n_points > 1) {
+      ESP_LOGI(TAG, "B: RMS %.3f G | Peak %.3f G | Dom %.1f Hz", report->p2_rms,
+               report->p2_peak, report->p2_dom_freq);
+      ESP_LOGI(TAG, "A/B @ %.1f Hz: coherencia %.2f | fase %.1f deg",
+               report->vib_dom_freq, report->coh_dom, report->phase_dom_deg);
+    }
+    if (report->n_axes == 6) {
+      ESP_LOGI(TAG, "Giro: RMS %.2f dps | Dom %.1f Hz (eje %c)",
+               report->gyro_rms_dps, report->gyro_dom_freq,
+               "XYZ"[report->gyro_axis % 3]);
+    }
+    if (report->quality != BB_QUALITY_OK) {
+      ESP_LOGW(TAG,
+               "Calidad %s: %u lecturas fallidas, %u saturadas, racha %u, "
+               "%u huecos",
+               report->quality == BB_QUALITY_BAD ? "MALA (descartada)"
+                                                 : "degradada",
+               report->q_failed_reads, report->q_clipped, report->q_stuck_run,
+               report->q_gaps);
+    }
+    ESP_LOGI(TAG, "Temp: %.2f C", report->temp_c);
+    for (int i = 0; i < report->temp_count; i++) {
+      ESP_LOGI(TAG, "  T[%d] %016llX: %.2f C", i, report->temp_rom[i],
+               report->temp_points_c[i]);
+    }
+
+    // Battery Voltage (antes de publicar: el reporte pasa a solo lectura)
+    report->batt_v = bb_power_get_battery_voltage();
+
+    // Inicio en la línea común de las balizas ESP-NOW: empareja las tramas
+    // de varios nodos (en continuo no se alinean, pero se sabe su desfase)
+    int64_t t_sync_us;
+    if (bb_espnow_sync_time(frame->meta[0].t_first_us, &t_sync_us,
+                            &report->sync_err_us))
+      report->t_sync_us = t_sync_us;
+    report->boot_to_sample_ms =
+        (uint32_t)(bb_sensors_first_sample_us() / 1000);
+    if (frame->seq == 0) {
+      ESP_LOGI(TAG, "Arranque -> primera muestra: %lu ms",
+               (unsigned long)report->boot_to_sample_ms);
     }
 
-    vTaskDelay(pdMS_TO_TICKS(5000)); // Intervalo entre reportes
+    pipeline_stats_update(frame, esp_timer_get_time());
+    frame_offer_waveform(frame, keep_last_frame);
+
+    // Publicar por referencia (MQTT/ESP-NOW/Web UI) y liberar la trama
+    frame->report = NULL;
+    bb_report_submit(report);
+    bb_pool_release(&s_frame_pool, frame);
   }
 }
 
+static esp_err_t pipeline_start(void) {
+  xQueueFrameDsp = xQueueCreate(BB_POOL_FRAMES, sizeof(bb_frame_t *));
+  xQueueFrameInfer = xQueueCreate(BB_POOL_FRAMES, sizeof(bb_frame_t *));
+  if (!xQueueFrameDsp || !xQueueFrameInfer)
+    return ESP_ERR_NO_MEM;
+
+  // Pool estático (tamaño fijado en compilación, bb_config.h)
+  bb_pool_init(&s_frame_pool, BB_POOL_INIT_ARGS(s_frame_pool));
+  ESP_LOGI(TAG, "Pipeline: %d tramas x %d bytes", BB_POOL_FRAMES,
+           sizeof(bb_frame_t));
+
+  // Adquisición con máxima prioridad en Core 1, DSP detrás en el mismo core
+  xTaskCreatePinnedToCore(Task_Acquisition, "Vib_Acq", 4096, NULL, 6, NULL, 1);
+  xTaskCreatePinnedToCore(Task_DSP, "Vib_DSP", 8192, NULL, 5, NULL, 1);
+  // Inferencia en Core 0 junto a las comunicaciones; la temperatura, detrás
+  xTaskCreatePinnedToCore(Task_Inference, "Vib_Infer", 4096, NULL, 4, NULL,
+                          0);
+  xTaskCreatePinnedToCore(Task_Temp, "Temp", 3072, NULL, 2, NULL, 0);
+  return ESP_OK;
+}
+
 // --- PUNTO DE ENTRADA PRINCIPAL ---
 void app_main(void) {
   // 1. Inicializar NVS (Requerido por WiFi/OTA/MQTT/Config)
@@ -109,13 +668,17 @@ void app_main(void) {
   // 3. Inicializar DSP
   bb_dsp_ai_init();
 
-  // 4. Lanzar Conectividad (WiFi + MQTT + OTA + Queue + Power) en CORE 0
+  // 4. Lanzar Conectividad (WiFi + MQTT + OTA + Queue + Power) en CORE 0.
+  // Las acciones remotas se registran antes de que llegue ningún comando
+  const bb_remote_hooks_t hooks = {.capture_now = remote_capture_now,
+                                   .baseline_reset = remote_baseline_reset};
+  bb_remote_set_hooks(&hooks);
   bb_connect_init();
 
   // 4.5 Iniciar Web UI (Dashboard + API + Captive Portal)
   bb_web_ui_start();
 
-  // 5. Lanzar Análisis en CORE 1 (Máxima prioridad para muestreo)
-  xTaskCreatePinnedToCore(Task_Vibration_Analysis, "Vib_Analyst", 8192, NULL, 5,
-                          NULL, 1);
+  // 5. Lanzar Pipeline de Análisis (Adquisición/DSP en CORE 1, Inferencia en
+  // CORE 0)
+  ESP_ERROR_CHECK(pipeline_start());
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+/**
+ * @file bb_test.h
+ * @brief Aserciones mínimas de los tests en el host
+ *
+ * CHECK() no aborta: cuenta el fallo, imprime dónde y sigue. Cada test
+ * termina con BB_TEST_END(), que devuelve 1 si algo falló (ctest lo marca).
+ */
+
+#ifndef BB_TEST_H
+#define BB_TEST_H
+
+#include <stdio.h>
+
+static int bb_test_failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      bb_test_failures++;                                                      \
+      printf("FALLO %s:%d: %s\n", __FILE__, __LINE__, #cond);                  \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long _a = (long long)(a), _b = (long long)(b);                        \
+    if (_a != _b) {                                                            \
+      bb_test_failures++;                                                      \
+      printf("FALLO %s:%d: %s == %s (%lld != %lld)\n", __FILE__, __LINE__,     \
+             #a, #b, _a, _b);                                                  \
+    }                                                                          \
+  } while (0)
+
+#define BB_TEST_END()                                                          \
+  do {                                                                         \
+    printf("%s: %s\n", __FILE__, bb_test_failures ? "FALLO" : "OK");           \
+    return bb_test_failures ? 1 : 0;                                           \
+  } while (0)
+
+#endif // BB_TEST_H
@@ -0,0 +1,16 @@
+// Stub de host: se incluye antes de cada fuente (-include). Lo que newlib de
+// IDF da y la libc del host quizá no.
+#ifndef BB_HOST_H
+#define BB_HOST_H
+
+#include <stddef.h>
+
+#ifndef BB_HOST_HAVE_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+// Bytes que el stub de bb_storage_has_room() da por libres en SPIFFS
+// (SIZE_MAX por defecto); un test lo baja para simular la partición llena
+extern size_t bb_host_spiffs_free;
+
+#endif // BB_HOST_H
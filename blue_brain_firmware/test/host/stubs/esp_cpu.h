@@ -0,0 +1,12 @@
+// Stub de host: contador de ciclos (solo para estadísticas)
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t esp_cpu_get_cycle_count(void) {
+  return (uint32_t)clock();
+}
+
+#endif // ESP_CPU_H
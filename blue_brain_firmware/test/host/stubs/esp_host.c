@@ -0,0 +1,40 @@
+// Stub de host: lo poco de IDF que no es solo cabecera
+#include "bb_storage.h"
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t bb_host_spiffs_free = SIZE_MAX;
+
+const char *esp_err_to_name(esp_err_t code) {
+  static char buf[16];
+  snprintf(buf, sizeof(buf), "0x%x", code);
+  return buf;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+  }
+  return ~crc;
+}
+
+// bb_storage.c necesita NVS y SPIFFS: del módulo, solo el hueco libre
+bool bb_storage_has_room(size_t bytes) { return bytes <= bb_host_spiffs_free; }
+
+#ifndef BB_HOST_HAVE_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size > 0) {
+    size_t n = (len < size - 1) ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
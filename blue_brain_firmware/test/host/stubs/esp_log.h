@@ -0,0 +1,18 @@
+// Stub de host: el log de IDF va a stdout
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) printf("E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+// Sin salida, pero el formato se comprueba igual
+#define ESP_LOGD(tag, fmt, ...)                                                \
+  do {                                                                         \
+    if (0)                                                                     \
+      printf(fmt, ##__VA_ARGS__);                                              \
+  } while (0)
+#define ESP_LOGV(tag, fmt, ...) ESP_LOGD(tag, fmt, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,9 @@
+// Stub de host: el reloj lo lleva cada test (tiempo simulado)
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
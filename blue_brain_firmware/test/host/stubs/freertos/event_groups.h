@@ -0,0 +1,10 @@
+// Stub de host: solo el tipo (ningún módulo probado usa grupos de eventos)
+#ifndef FREERTOS_EVENT_GROUPS_H
+#define FREERTOS_EVENT_GROUPS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_event_group *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#endif // FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,15 @@
+// Stub de host: colas de FreeRTOS sobre pthreads (freertos_host.c)
+#ifndef FREERTOS_QUEUE_H
+#define FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(uint32_t len, uint32_t item_size);
+void vQueueDelete(QueueHandle_t q);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+uint32_t uxQueueMessagesWaiting(QueueHandle_t q);
+
+#endif // FREERTOS_QUEUE_H
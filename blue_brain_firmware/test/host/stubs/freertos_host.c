@@ -0,0 +1,159 @@
+// Stub de host: colas, semáforos y tareas de FreeRTOS sobre pthreads
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_queue {
+  pthread_mutex_t m;
+  pthread_cond_t c;
+  uint32_t len, item_size, head, n;
+  uint8_t *buf;
+};
+
+QueueHandle_t xQueueCreate(uint32_t len, uint32_t item_size) {
+  QueueHandle_t q = calloc(1, sizeof(*q));
+  if (q == NULL)
+    return NULL;
+  pthread_mutex_init(&q->m, NULL);
+  pthread_cond_init(&q->c, NULL);
+  q->len = len;
+  q->item_size = item_size;
+  q->buf = malloc((size_t)len * (item_size ? item_size : 1));
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t q) {
+  pthread_cond_destroy(&q->c);
+  pthread_mutex_destroy(&q->m);
+  free(q->buf);
+  free(q);
+}
+
+// Con q->m tomado: espera a que se cumpla la condición o venza el plazo
+static bool wait_for(QueueHandle_t q, TickType_t wait, bool want_space) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  if (wait != portMAX_DELAY) {
+    ts.tv_sec += wait / 1000;
+    ts.tv_nsec += (long)(wait % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+  }
+  while (want_space ? q->n == q->len : q->n == 0) {
+    if (wait == 0)
+      return false;
+    int r = (wait == portMAX_DELAY) ? pthread_cond_wait(&q->c, &q->m)
+                                    : pthread_cond_timedwait(&q->c, &q->m, &ts);
+    if (r == ETIMEDOUT && (want_space ? q->n == q->len : q->n == 0))
+      return false;
+  }
+  return true;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  pthread_mutex_lock(&q->m);
+  if (!wait_for(q, wait, true)) {
+    pthread_mutex_unlock(&q->m);
+    return pdFAIL;
+  }
+  if (q->item_size)
+    memcpy(q->buf + (size_t)((q->head + q->n) % q->len) * q->item_size, item,
+           q->item_size);
+  q->n++;
+  pthread_cond_broadcast(&q->c);
+  pthread_mutex_unlock(&q->m);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  pthread_mutex_lock(&q->m);
+  if (!wait_for(q, wait, false)) {
+    pthread_mutex_unlock(&q->m);
+    return pdFALSE;
+  }
+  if (q->item_size)
+    memcpy(item, q->buf + (size_t)q->head * q->item_size, q->item_size);
+  q->head = (q->head + 1) % q->len;
+  q->n--;
+  pthread_cond_broadcast(&q->c);
+  pthread_mutex_unlock(&q->m);
+  return pdTRUE;
+}
+
+uint32_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  pthread_mutex_lock(&q->m);
+  uint32_t n = q->n;
+  pthread_mutex_unlock(&q->m);
+  return n;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  QueueHandle_t q = xQueueCreate(1, 0);
+  if (q != NULL)
+    q->n = 1; // Un mutex nace libre
+  return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xQueueCreate(1, 0); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+  return xQueueReceive(s, NULL, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  return xQueueSend(s, NULL, 0);
+}
+
+typedef struct {
+  TaskFunction_t fn;
+  void *arg;
+} task_start_t;
+
+static void *task_trampoline(void *p) {
+  task_start_t start = *(task_start_t *)p;
+  free(p);
+  start.fn(start.arg);
+  return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, uint32_t prio, TaskHandle_t *handle) {
+  task_start_t *start = malloc(sizeof(*start));
+  if (start == NULL)
+    return pdFAIL;
+  start->fn = fn;
+  start->arg = arg;
+  pthread_t th;
+  if (pthread_create(&th, NULL, task_trampoline, start) != 0) {
+    free(start);
+    return pdFAIL;
+  }
+  pthread_detach(th);
+  if (handle != NULL)
+    *handle = NULL;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg, uint32_t prio,
+                                   TaskHandle_t *handle, BaseType_t core) {
+  return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  struct timespec ts = {ticks / 1000, (long)(ticks % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,12 @@
+// Stub de host: lo que bb_waveform usa del cliente MQTT (lo implementa el
+// broker de pega de cada test)
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                            const char *data, int len, int qos, int retain);
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client);
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,268 @@
+/**
+ * @file test_backlog.c
+ * @brief bb_backlog: contrato del log (orden, reinicio, desborde, CRC,
+ * schema) y store-and-forward contra un broker de pega intermitente
+ *
+ * El broker simulado hace de Mosquitto en localhost: acepta o rechaza cada
+ * publicación según el guion de cortes y anota qué secuencias llegan. El
+ * "nodo" sigue la política de Task_Comms: todo reporte pasa por él, va al
+ * backlog si no hay broker o si queda histórico (para no adelantarlo), y el
+ * histórico se reenvía en orden quitando cada registro después del PUBACK.
+ */
+
+#include "bb_backlog.h"
+#include "bb_test.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "backlog.bin"
+
+typedef struct {
+  uint32_t seq;
+  uint8_t pad[200];
+} rec_t;
+
+static void make(rec_t *r, uint32_t seq) {
+  memset(r, (int)(seq & 0xFF), sizeof(*r));
+  r->seq = seq;
+}
+
+static void test_contract(void) {
+  rec_t r, o;
+  size_t len;
+
+  remove(PATH);
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(r), 0), ESP_ERR_INVALID_ARG);
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(r), 8), ESP_OK);
+  CHECK_EQ(bb_backlog_count(), 0);
+  CHECK_EQ(bb_backlog_peek(0, &o, sizeof(o), &len), ESP_ERR_NOT_FOUND);
+
+  for (uint32_t i = 1; i <= 5; i++) {
+    make(&r, i);
+    CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+  }
+  CHECK_EQ(bb_backlog_count(), 5);
+  CHECK_EQ(bb_backlog_peek(0, &o, sizeof(o), &len), ESP_OK);
+  CHECK_EQ(o.seq, 1);
+  CHECK_EQ(len, sizeof(o));
+  CHECK_EQ(bb_backlog_pop(2), ESP_OK);
+
+  // Reinicio: head/tail salen de la cabecera
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(r), 8), ESP_OK);
+  CHECK_EQ(bb_backlog_count(), 3);
+  CHECK_EQ(bb_backlog_peek(0, &o, sizeof(o), &len), ESP_OK);
+  CHECK_EQ(o.seq, 3);
+
+  // Desborde: 3 + 7 = 10 en 8 ranuras, se pierden los 2 más antiguos
+  for (uint32_t i = 6; i <= 12; i++) {
+    make(&r, i);
+    CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+  }
+  bb_backlog_stats_t st;
+  bb_backlog_get_stats(&st);
+  CHECK_EQ(st.count, 8);
+  CHECK_EQ(st.dropped, 2);
+  for (uint32_t i = 0; i < 8; i++) {
+    CHECK_EQ(bb_backlog_peek(i, &o, sizeof(o), &len), ESP_OK);
+    CHECK_EQ(o.seq, 5 + i);
+  }
+
+  // Un byte dañado en el segundo registro pendiente (secuencia del log 5)
+  FILE *f = fopen(PATH, "r+b");
+  CHECK(f != NULL);
+  long stride = 12 + (long)sizeof(r);
+  fseek(f, 32 + (5 % 8) * stride + 20, SEEK_SET);
+  fputc(0xAA, f);
+  fclose(f);
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(r), 8), ESP_OK);
+  CHECK_EQ(bb_backlog_peek(1, &o, sizeof(o), &len), ESP_ERR_INVALID_CRC);
+  CHECK_EQ(bb_backlog_peek(2, &o, sizeof(o), &len), ESP_OK);
+
+  // Otro schema: se descarta el fichero
+  CHECK_EQ(bb_backlog_init(PATH, 2, sizeof(r), 8), ESP_OK);
+  CHECK_EQ(bb_backlog_count(), 0);
+  f = fopen(PATH, "rb");
+  CHECK(f == NULL);
+
+  // Vaciarlo borra el fichero; un registro corto conserva su longitud
+  for (uint32_t i = 1; i <= 3; i++) {
+    make(&r, i);
+    bb_backlog_push(&r, sizeof(r));
+  }
+  bb_backlog_pop(3);
+  f = fopen(PATH, "rb");
+  CHECK(f == NULL);
+  bb_backlog_push(&r, 10);
+  CHECK_EQ(bb_backlog_peek(0, &o, sizeof(o), &len), ESP_OK);
+  CHECK_EQ(len, 10);
+  bb_backlog_pop(1);
+}
+
+// Partición llena: el fichero no crece, pero al dar la vuelta reutiliza sus
+// ranuras sin pedir hueco
+static void test_no_space(void) {
+  rec_t r, o;
+  size_t len;
+  bb_backlog_stats_t st;
+  long stride = 12 + (long)sizeof(r);
+
+  remove(PATH);
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(r), 4), ESP_OK);
+  bb_host_spiffs_free = 32 + stride - 1;
+  make(&r, 1);
+  CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_ERR_NO_MEM);
+  CHECK_EQ(bb_backlog_count(), 0);
+
+  bb_host_spiffs_free = SIZE_MAX;
+  for (uint32_t i = 1; i <= 3; i++) {
+    make(&r, i);
+    CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+  }
+  bb_host_spiffs_free = stride - 1; // La cuarta ranura ya no cabe
+  make(&r, 4);
+  CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_ERR_NO_MEM);
+  CHECK_EQ(bb_backlog_count(), 3);
+
+  bb_host_spiffs_free = stride;
+  CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+  bb_host_spiffs_free = 0;
+  for (uint32_t i = 5; i <= 8; i++) {
+    make(&r, i);
+    CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+  }
+  bb_host_spiffs_free = SIZE_MAX;
+  CHECK_EQ(bb_backlog_peek(0, &o, sizeof(o), &len), ESP_OK);
+  CHECK_EQ(o.seq, 5);
+  bb_backlog_get_stats(&st);
+  CHECK_EQ(st.no_space, 2);
+  CHECK_EQ(st.count, 4);
+  bb_backlog_pop(4);
+}
+
+// --- Broker de pega ---
+
+#define SIM_STEP_S 1    // Resolución de la simulación
+#define REPORT_EVERY_S 5
+#define REPLAY_PER_STEP 5 // ~mqtt_batch_size cada BB_BACKLOG_REPLAY_MS
+#define FLAKY_PCT 10      // Publicaciones que fallan con broker arriba
+#define REBOOT_PCT 1      // Cortes de alimentación entre PUBACK y pop()
+
+typedef struct {
+  bool online;
+  uint32_t *hits; // Veces que llegó cada secuencia
+  uint32_t last;  // Última secuencia recibida
+  uint32_t out_of_order;
+} broker_t;
+
+static bool broker_publish(broker_t *b, const rec_t *r) {
+  if (!b->online || rand() % 100 < FLAKY_PCT)
+    return false;
+  // Solo se admite repetir la última (PUBACK sin pop() por un reinicio)
+  if (r->seq < b->last)
+    b->out_of_order++;
+  b->last = r->seq;
+  b->hits[r->seq]++;
+  return true;
+}
+
+static bool sim_online(int t_s, int end_s, const int (*cuts)[2], int n_cuts) {
+  for (int i = 0; i < n_cuts; i++) {
+    if (t_s >= cuts[i][0] && t_s < cuts[i][1])
+      return false;
+  }
+  return t_s < end_s;
+}
+
+typedef struct {
+  uint32_t made;
+  uint32_t lost;    // Nunca llegaron al broker
+  uint32_t dup;     // Llegaron más de una vez
+  uint32_t dropped; // Según bb_backlog
+} sim_result_t;
+
+// Una jornada de 'minutes' minutos con los cortes dados ([inicio, fin) s)
+static sim_result_t simulate(uint32_t capacity, int minutes,
+                             const int (*cuts)[2], int n_cuts) {
+  sim_result_t res = {0};
+  int end_s = minutes * 60;
+  uint32_t max_reports = (uint32_t)(end_s / REPORT_EVERY_S) + 1;
+  broker_t b = {.hits = calloc(max_reports + 1, sizeof(uint32_t))};
+
+  remove(PATH);
+  CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(rec_t), capacity), ESP_OK);
+
+  // Se sigue hasta vaciar el backlog con el broker de vuelta
+  for (int t = 0; t < end_s || bb_backlog_count() > 0; t += SIM_STEP_S) {
+    b.online = t >= end_s || sim_online(t, end_s, cuts, n_cuts);
+    rec_t r;
+
+    if (t < end_s && t % REPORT_EVERY_S == 0) {
+      make(&r, ++res.made);
+      // Task_Comms: directo solo si no hay histórico delante
+      if (bb_backlog_count() > 0 || !broker_publish(&b, &r))
+        CHECK_EQ(bb_backlog_push(&r, sizeof(r)), ESP_OK);
+    }
+
+    for (int i = 0; i < REPLAY_PER_STEP && b.online; i++) {
+      size_t len;
+      esp_err_t err = bb_backlog_peek(0, &r, sizeof(r), &len);
+      if (err == ESP_ERR_NOT_FOUND)
+        break;
+      CHECK_EQ(err, ESP_OK);
+      if (!broker_publish(&b, &r))
+        break; // Se reintenta en la siguiente vuelta
+      if (rand() % 100 < REBOOT_PCT) {
+        // Reinicio antes del pop(): al volver se repite este registro
+        CHECK_EQ(bb_backlog_init(PATH, 1, sizeof(rec_t), capacity), ESP_OK);
+        break;
+      }
+      bb_backlog_pop(1);
+    }
+  }
+
+  bb_backlog_stats_t st;
+  bb_backlog_get_stats(&st);
+  res.dropped = st.dropped;
+  for (uint32_t s = 1; s <= res.made; s++) {
+    res.lost += b.hits[s] == 0;
+    res.dup += b.hits[s] > 1;
+  }
+  CHECK_EQ(b.out_of_order, 0);
+  free(b.hits);
+  return res;
+}
+
+static void test_store_and_forward(void) {
+  srand(1);
+
+  // 2 h con cortes de 10 min, 1 min y 30 min: 2 h de capacidad no pierde nada
+  static const int cuts[][2] = {{600, 1200}, {2400, 2460}, {3600, 5400}};
+  sim_result_t r = simulate(1440, 120, cuts, 3);
+  CHECK_EQ(r.made, 1440);
+  CHECK_EQ(r.lost, 0);
+  CHECK_EQ(r.dropped, 0);
+  printf("2 h, 41 min sin broker: %" PRIu32 " reportes, %" PRIu32
+         " repetidos\n",
+         r.made, r.dup);
+
+  // Corte más largo que la capacidad: se pierden justo los más antiguos
+  static const int long_cut[][2] = {{60, 3660}};
+  r = simulate(240, 90, long_cut, 1);
+  CHECK(r.dropped > 0);
+  CHECK_EQ(r.lost, r.dropped);
+  printf("1 h sin broker, 240 ranuras: %" PRIu32 " perdidos de %" PRIu32 "\n",
+         r.lost, r.made);
+
+  remove(PATH);
+}
+
+int main(void) {
+  test_contract();
+  test_no_space();
+  test_store_and_forward();
+  BB_TEST_END();
+}
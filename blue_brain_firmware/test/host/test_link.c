@@ -0,0 +1,236 @@
+/**
+ * @file test_link.c
+ * @brief bb_link: máquina de estados WiFi/MQTT con eventos simulados
+ *
+ * El test hace de bb_connect: entrega los eventos, cuenta las acciones
+ * pedidas y dispara el temporizador cuando vence el plazo devuelto.
+ */
+
+#include "bb_config.h"
+#include "bb_link.h"
+#include "bb_test.h"
+#include <stdio.h>
+
+#define S 1000000LL
+
+static int64_t s_now;
+static bb_link_t s_link;
+static int s_connect, s_disconnect, s_mqtt_start, s_mqtt_stop;
+static int64_t s_timer_at = -1;
+
+static bb_link_out_t ev(bb_link_event_t e) {
+  bb_link_out_t o = bb_link_event(&s_link, e, s_now);
+  s_connect += (o.actions & BB_LINK_ACT_CONNECT) != 0;
+  s_disconnect += (o.actions & BB_LINK_ACT_DISCONNECT) != 0;
+  s_mqtt_start += (o.actions & BB_LINK_ACT_MQTT_START) != 0;
+  s_mqtt_stop += (o.actions & BB_LINK_ACT_MQTT_STOP) != 0;
+  if (o.actions & BB_LINK_ACT_TIMER)
+    s_timer_at = s_now + o.timer_us;
+  return o;
+}
+
+static void fire_timer(void) {
+  CHECK(s_timer_at >= 0);
+  s_now = s_timer_at;
+  s_timer_at = -1;
+  ev(BB_LINK_EV_TIMER);
+}
+
+static void full_connect(void) {
+  ev(BB_LINK_EV_WIFI_UP);
+  s_now += 300000;
+  ev(BB_LINK_EV_GOT_IP);
+  s_now += 200000;
+  ev(BB_LINK_EV_MQTT_UP);
+}
+
+static void test_boot(void) {
+  bb_link_init(&s_link, 1234, 0);
+  s_now = 100000;
+  ev(BB_LINK_EV_START);
+  CHECK_EQ(s_link.state, BB_LINK_CONNECTING);
+  CHECK_EQ(s_connect, 1);
+
+  s_now += 1200000;
+  ev(BB_LINK_EV_WIFI_UP);
+  CHECK_EQ(s_link.state, BB_LINK_ASSOCIATED);
+  s_now += 300000;
+  ev(BB_LINK_EV_GOT_IP);
+  CHECK_EQ(s_link.state, BB_LINK_IP);
+  CHECK_EQ(s_mqtt_start, 1);
+  s_now += 500000;
+  ev(BB_LINK_EV_MQTT_UP);
+  CHECK(bb_link_online(&s_link));
+  CHECK_EQ(s_link.connect_ms, 2000);
+  CHECK_EQ(s_link.reconnects, 0);
+
+  // Temporizador viejo (asociación) que vence ya en ONLINE: se ignora
+  s_now += 20 * S;
+  bb_link_out_t o = bb_link_event(&s_link, BB_LINK_EV_TIMER, s_now);
+  CHECK_EQ(o.actions, 0);
+  CHECK(bb_link_online(&s_link));
+}
+
+static void test_ap_outage(void) {
+  // AP apagado 10 min: cada intento falla con desconexión inmediata
+  s_now = 100 * S;
+  ev(BB_LINK_EV_WIFI_DOWN);
+  CHECK_EQ(s_link.state, BB_LINK_BACKOFF);
+  CHECK_EQ(s_mqtt_stop, 1);
+  CHECK_EQ(s_link.failures, 1);
+
+  int64_t outage_end = s_now + 600 * S;
+  int tries = 0;
+  for (;;) {
+    fire_timer();
+    tries++;
+    if (s_now >= outage_end)
+      break;
+    s_now += 50000;
+    ev(BB_LINK_EV_WIFI_DOWN); // No se encuentra el AP
+  }
+  printf("AP caído 10 min: %d intentos de asociación\n", tries);
+  CHECK(tries < 15);
+  CHECK(s_link.last_backoff_us <= BB_LINK_BACKOFF_MAX_MS * 1000LL);
+
+  full_connect();
+  CHECK(bb_link_online(&s_link));
+  CHECK_EQ(s_link.reconnects, 1);
+}
+
+static void test_flapping(void) {
+  // Un enlace que cae a los 10 s no resetea el backoff
+  uint32_t f0 = s_link.failures;
+  s_now += 10 * S;
+  ev(BB_LINK_EV_WIFI_DOWN);
+  CHECK_EQ(s_link.failures, f0 + 1);
+  fire_timer();
+  full_connect();
+
+  // Estable más de BB_LINK_STABLE_MS: vuelve al primer plazo
+  s_now += BB_LINK_STABLE_MS * 1000LL + S;
+  ev(BB_LINK_EV_WIFI_DOWN);
+  CHECK_EQ(s_link.failures, 1);
+  CHECK(s_link.last_backoff_us >= BB_LINK_BACKOFF_MIN_MS * 500LL);
+  CHECK(s_link.last_backoff_us <= BB_LINK_BACKOFF_MIN_MS * 1000LL);
+}
+
+static void test_timeouts(void) {
+  // Asociación colgada: desasociar + backoff
+  fire_timer();
+  CHECK_EQ(s_link.state, BB_LINK_CONNECTING);
+  int d0 = s_disconnect;
+  fire_timer();
+  CHECK_EQ(s_link.state, BB_LINK_BACKOFF);
+  CHECK_EQ(s_disconnect, d0 + 1);
+  CHECK_EQ(s_link.failures, 2);
+  // La desconexión que provoca no cuenta otra vez
+  ev(BB_LINK_EV_WIFI_DOWN);
+  CHECK_EQ(s_link.failures, 2);
+
+  // DHCP sin respuesta
+  fire_timer();
+  ev(BB_LINK_EV_WIFI_UP);
+  CHECK_EQ(s_link.state, BB_LINK_ASSOCIATED);
+  fire_timer();
+  CHECK_EQ(s_link.state, BB_LINK_BACKOFF);
+  CHECK_EQ(s_link.failures, 3);
+  CHECK_EQ(s_disconnect, d0 + 2);
+}
+
+static void test_broker_down(void) {
+  // Broker caído con WiFi bien: no se toca WiFi ni el cliente MQTT
+  fire_timer();
+  full_connect();
+  int c0 = s_connect, ms0 = s_mqtt_stop;
+  s_now += 5 * S;
+  ev(BB_LINK_EV_MQTT_DOWN);
+  CHECK_EQ(s_link.state, BB_LINK_IP);
+  for (int i = 0; i < 3; i++) {
+    s_now += 10 * S;
+    ev(BB_LINK_EV_MQTT_TRY);
+    s_now += 100000;
+    ev(BB_LINK_EV_MQTT_DOWN);
+  }
+  s_now += 10 * S;
+  ev(BB_LINK_EV_MQTT_TRY);
+  s_now += 250000;
+  ev(BB_LINK_EV_MQTT_UP);
+  CHECK(bb_link_online(&s_link));
+  CHECK_EQ(s_connect, c0);
+  CHECK_EQ(s_mqtt_stop, ms0);
+  CHECK_EQ(s_link.connect_ms, 250);
+
+  // Primer intento MQTT con IP nueva: cuenta desde esp_wifi_connect()
+  s_now += 100 * S;
+  ev(BB_LINK_EV_WIFI_DOWN);
+  fire_timer();
+  s_now += S;
+  ev(BB_LINK_EV_WIFI_UP);
+  ev(BB_LINK_EV_GOT_IP);
+  ev(BB_LINK_EV_MQTT_TRY);
+  s_now += 200000;
+  ev(BB_LINK_EV_MQTT_UP);
+  CHECK_EQ(s_link.connect_ms, 1200);
+
+  // IP perdida: parar MQTT y desasociar; 100 s estable antes
+  ms0 = s_mqtt_stop;
+  s_now += 100 * S;
+  ev(BB_LINK_EV_LOST_IP);
+  CHECK_EQ(s_link.state, BB_LINK_BACKOFF);
+  CHECK_EQ(s_mqtt_stop, ms0 + 1);
+  CHECK_EQ(s_link.failures, 1);
+
+  bb_link_metrics_t m = bb_link_metrics(&s_link, s_now);
+  CHECK(m.uptime_pm > 0 && m.uptime_pm < 1000);
+  CHECK_EQ(m.reconnects, s_link.reconnects);
+}
+
+static void test_fleet_jitter(void) {
+  // 30 nodos caen a la vez (AP reiniciado): el primer reintento se reparte
+  int64_t min_us = INT64_MAX, max_us = 0;
+  for (uint32_t n = 0; n < 30; n++) {
+    bb_link_t x;
+    bb_link_init(&x, 0xA0B1C2u * (n + 1), 0);
+    bb_link_event(&x, BB_LINK_EV_START, 0);
+    bb_link_event(&x, BB_LINK_EV_WIFI_UP, 0);
+    bb_link_event(&x, BB_LINK_EV_GOT_IP, 0);
+    bb_link_event(&x, BB_LINK_EV_MQTT_UP, 0);
+    bb_link_out_t o = bb_link_event(&x, BB_LINK_EV_WIFI_DOWN, 3600 * S);
+    CHECK(o.actions & BB_LINK_ACT_TIMER);
+    if (o.timer_us < min_us)
+      min_us = o.timer_us;
+    if (o.timer_us > max_us)
+      max_us = o.timer_us;
+  }
+  CHECK(min_us >= BB_LINK_BACKOFF_MIN_MS * 500LL);
+  CHECK(max_us <= BB_LINK_BACKOFF_MIN_MS * 1000LL);
+  CHECK(max_us - min_us > BB_LINK_BACKOFF_MIN_MS * 200LL);
+}
+
+static void test_backoff_cap(void) {
+  bb_link_init(&s_link, 7, 0);
+  s_now = 0;
+  ev(BB_LINK_EV_START);
+  for (int i = 0; i < 100; i++) {
+    ev(BB_LINK_EV_WIFI_DOWN);
+    fire_timer();
+  }
+  CHECK(s_link.last_backoff_us >= BB_LINK_BACKOFF_MAX_MS * 500LL);
+  CHECK(s_link.last_backoff_us <= BB_LINK_BACKOFF_MAX_MS * 1000LL);
+
+  bb_link_metrics_t m = bb_link_metrics(&s_link, s_now);
+  CHECK_EQ(m.uptime_pm, 0);
+  CHECK_EQ(m.reconnects, 0);
+}
+
+int main(void) {
+  test_boot();
+  test_ap_outage();
+  test_flapping();
+  test_timeouts();
+  test_broker_down();
+  test_fleet_jitter();
+  test_backoff_cap();
+  BB_TEST_END();
+}
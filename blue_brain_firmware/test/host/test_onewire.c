@@ -0,0 +1,319 @@
+/**
+ * @file test_onewire.c
+ * @brief onewire_codec: capturas RMT grabadas (presencia, slots de lectura,
+ * pulsos partidos y glitches), CRC8, scratchpad DS18B20 en cada resolución y
+ * búsqueda de ROM sobre un bus multi-drop simulado
+ */
+
+#include "bb_test.h"
+#include "onewire_codec.h"
+#include <stdio.h>
+#include <string.h>
+
+// Palabra rmt_symbol_word_t: duration0[14:0] level0[15] duration1[30:16]
+// level1[31]
+#define SYM(d0, l0, d1, l1)                                                    \
+  ((uint32_t)(d0) | ((uint32_t)(l0) << 15) | ((uint32_t)(d1) << 16) |          \
+   ((uint32_t)(l1) << 31))
+
+// Capturas del loopback TX/RX a 1 MHz (1 tick = 1 µs). La última mitad en
+// alto tiene duración 0: el RMT cerró la captura por inactividad.
+
+// Reset propio de 500 µs, 31 µs de espera del esclavo y presencia de 118 µs
+static const uint32_t CAP_PRESENCE[] = {SYM(500, 0, 31, 1),
+                                        SYM(118, 0, 0, 1)};
+// Nadie responde: sólo se ve nuestro reset
+static const uint32_t CAP_EMPTY[] = {SYM(500, 0, 0, 1)};
+// Presencia partida en dos mitades bajas consecutivas (60 + 52 µs) y
+// terminada en otra palabra
+static const uint32_t CAP_PRESENCE_SPLIT[] = {
+    SYM(500, 0, 29, 1), SYM(60, 0, 52, 0), SYM(380, 1, 0, 1)};
+// Rebote de 3 µs al soltar la línea antes de la presencia real
+static const uint32_t CAP_PRESENCE_RINGING[] = {
+    SYM(500, 0, 2, 1), SYM(3, 0, 27, 1), SYM(121, 0, 0, 1)};
+// Sólo ruido tras el reset: ni 20 µs ni 300 µs son una presencia
+static const uint32_t CAP_NOISE[] = {SYM(500, 0, 40, 1), SYM(20, 0, 90, 1),
+                                     SYM(300, 0, 0, 1)};
+
+// Ocho slots de lectura del byte 0xA5 (LSB primero: 1 0 1 0 0 1 0 1). Un 1
+// es nuestro pulso de 6 µs estirado por la capacidad de la línea; un 0 es
+// el esclavo reteniendo la línea ~30 µs.
+static const uint32_t CAP_READ_A5[] = {
+    SYM(7, 0, 63, 1),  SYM(29, 0, 41, 1), SYM(6, 0, 64, 1),
+    SYM(31, 0, 39, 1), SYM(28, 0, 42, 1), SYM(8, 0, 62, 1),
+    SYM(30, 0, 40, 1), SYM(7, 0, 0, 1)};
+
+#define N_SYM(a) (sizeof(a) / sizeof(a[0]))
+
+static void test_presence(void) {
+  uint16_t p[4];
+  size_t n = ow_extract_low_pulses(CAP_PRESENCE, N_SYM(CAP_PRESENCE), p, 4);
+  CHECK_EQ(n, 2);
+  CHECK_EQ(p[0], 500);
+  CHECK_EQ(p[1], 118);
+  CHECK(ow_decode_presence(p, n));
+
+  n = ow_extract_low_pulses(CAP_EMPTY, N_SYM(CAP_EMPTY), p, 4);
+  CHECK_EQ(n, 1);
+  CHECK(!ow_decode_presence(p, n));
+
+  n = ow_extract_low_pulses(CAP_PRESENCE_SPLIT, N_SYM(CAP_PRESENCE_SPLIT), p,
+                            4);
+  CHECK_EQ(n, 2);
+  CHECK_EQ(p[1], 112);
+  CHECK(ow_decode_presence(p, n));
+
+  n = ow_extract_low_pulses(CAP_PRESENCE_RINGING, N_SYM(CAP_PRESENCE_RINGING),
+                            p, 4);
+  CHECK_EQ(n, 3);
+  CHECK_EQ(p[1], 3);
+  CHECK(ow_decode_presence(p, n));
+
+  n = ow_extract_low_pulses(CAP_NOISE, N_SYM(CAP_NOISE), p, 4);
+  CHECK_EQ(n, 3);
+  CHECK(!ow_decode_presence(p, n));
+
+  // Los bordes de la ventana de presencia
+  const uint16_t edge_lo[] = {500, OW_PRESENCE_MIN_US};
+  const uint16_t edge_hi[] = {500, OW_PRESENCE_MAX_US + 1};
+  CHECK(ow_decode_presence(edge_lo, 2));
+  CHECK(!ow_decode_presence(edge_hi, 2));
+
+  // El propio reset nunca cuenta como presencia
+  const uint16_t only_reset[] = {120};
+  CHECK(!ow_decode_presence(only_reset, 1));
+}
+
+static void test_read_slots(void) {
+  uint16_t p[8];
+  uint32_t v = 0;
+  size_t n = ow_extract_low_pulses(CAP_READ_A5, N_SYM(CAP_READ_A5), p, 8);
+  CHECK_EQ(n, 8);
+  CHECK(ow_decode_bits(p, 8, &v));
+  CHECK_EQ(v, 0xA5);
+
+  // El umbral: 15 µs todavía es un 1, 16 µs ya es un 0
+  const uint16_t edge[] = {OW_READ_THRESHOLD_US, OW_READ_THRESHOLD_US + 1};
+  CHECK(ow_decode_bits(edge, 2, &v));
+  CHECK_EQ(v, 0x1);
+
+  // Un slot 0 partido (mitad baja que sigue en la palabra siguiente) es un
+  // único pulso largo, no un 1 seguido de otro bit
+  const uint32_t split[] = {SYM(7, 0, 63, 1), SYM(12, 0, 14, 0),
+                            SYM(44, 1, 0, 1)};
+  n = ow_extract_low_pulses(split, N_SYM(split), p, 8);
+  CHECK_EQ(n, 2);
+  CHECK_EQ(p[1], 26);
+  CHECK(ow_decode_bits(p, 2, &v));
+  CHECK_EQ(v, 0x1);
+
+  // Captura cortada: faltan slots y el llamante lo detecta con n < n_bits
+  n = ow_extract_low_pulses(CAP_READ_A5, 5, p, 8);
+  CHECK_EQ(n, 5);
+
+  // La capacidad de salida se respeta
+  n = ow_extract_low_pulses(CAP_READ_A5, N_SYM(CAP_READ_A5), p, 3);
+  CHECK_EQ(n, 3);
+
+  // Un pulso que ocupa varias palabras satura en vez de dar la vuelta
+  const uint32_t stuck[] = {SYM(0x7FFF, 0, 0x7FFF, 0), SYM(0x7FFF, 0, 10, 1),
+                            SYM(7, 0, 0, 1)};
+  n = ow_extract_low_pulses(stuck, N_SYM(stuck), p, 8);
+  CHECK_EQ(n, 2);
+  CHECK_EQ(p[0], 0xFFFF);
+  CHECK_EQ(p[1], 7);
+
+  // Más de 32 bits o un pulso nulo no se decodifican
+  CHECK(!ow_decode_bits(p, 33, &v));
+  const uint16_t zero[] = {7, 0};
+  CHECK(!ow_decode_bits(zero, 2, &v));
+}
+
+static void test_crc(void) {
+  // Ejemplo de la nota de aplicación Maxim AN27
+  const uint8_t rom[8] = {0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2};
+  CHECK_EQ(ow_crc8(rom, 7), 0xA2);
+  CHECK_EQ(ow_crc8(rom, 8), 0); // El CRC sobre datos + CRC da 0
+  const uint8_t check[] = "123456789";
+  CHECK_EQ(ow_crc8(check, 9), 0xA1); // CRC-8/MAXIM-DOW
+  CHECK_EQ(ow_crc8(check, 0), 0);
+  CHECK_EQ(ow_rom_to_u64(rom), 0xA200000001B81C02ULL);
+}
+
+// Scratchpad con la temperatura cruda y la resolución (9..12 bit)
+static void make_scratchpad(uint8_t sp[9], uint16_t raw, int bits) {
+  sp[0] = (uint8_t)raw;
+  sp[1] = (uint8_t)(raw >> 8);
+  sp[2] = 0x4B; // TH
+  sp[3] = 0x46; // TL
+  sp[4] = (uint8_t)(((bits - 9) << 5) | 0x1F);
+  sp[5] = 0xFF;
+  sp[6] = 0x0C;
+  sp[7] = 0x10;
+  sp[8] = ow_crc8(sp, 8);
+}
+
+static void test_scratchpad(void) {
+  uint8_t sp[9];
+  float t = 0;
+
+  // Hoja de datos: +25.0625 °C = 0x0191, -10.125 °C = 0xFF5E
+  make_scratchpad(sp, 0x0191, 12);
+  CHECK(ds18b20_decode_scratchpad(sp, &t));
+  CHECK(t == 25.0625f);
+  make_scratchpad(sp, 0xFF5E, 12);
+  CHECK(ds18b20_decode_scratchpad(sp, &t));
+  CHECK(t == -10.125f);
+
+  // Con menos resolución los bits bajos son indefinidos y se descartan
+  static const struct {
+    int bits;
+    float pos, neg;
+  } res[] = {{9, 25.0f, -10.5f},
+             {10, 25.25f, -10.25f},
+             {11, 25.375f, -10.125f},
+             {12, 25.4375f, -10.125f}};
+  for (size_t i = 0; i < sizeof(res) / sizeof(res[0]); i++) {
+    make_scratchpad(sp, 0x0191 | 0x7, res[i].bits); // Basura en los bajos
+    CHECK(ds18b20_decode_scratchpad(sp, &t));
+    CHECK(t == res[i].pos);
+    make_scratchpad(sp, 0xFF5E, res[i].bits);
+    CHECK(ds18b20_decode_scratchpad(sp, &t));
+    CHECK(t == res[i].neg);
+  }
+
+  // Valor de encendido (85 °C) y extremos del rango
+  make_scratchpad(sp, 0x0550, 12);
+  CHECK(ds18b20_decode_scratchpad(sp, &t));
+  CHECK(t == 85.0f);
+  make_scratchpad(sp, 0xFC90, 12);
+  CHECK(ds18b20_decode_scratchpad(sp, &t));
+  CHECK(t == -55.0f);
+
+  // CRC roto, línea sin esclavo (todo 0xFF) y todo ceros con CRC válido
+  make_scratchpad(sp, 0x0191, 12);
+  sp[0] ^= 0x01;
+  CHECK(!ds18b20_decode_scratchpad(sp, &t));
+  memset(sp, 0xFF, sizeof(sp));
+  CHECK(!ds18b20_decode_scratchpad(sp, &t));
+  memset(sp, 0, sizeof(sp));
+  CHECK(ds18b20_decode_scratchpad(sp, &t));
+  CHECK(t == 0.0f);
+}
+
+// --- Bus multi-drop simulado: AND cableado de los esclavos aún activos ---
+
+#define SIM_MAX_DEVS 8
+
+typedef struct {
+  uint8_t rom[SIM_MAX_DEVS][8];
+  int n_devs;
+  bool active[SIM_MAX_DEVS];
+  int bit;           // Próximo bit de la búsqueda (0..63)
+  int vanish_at_bit; // Todos se desconectan en este bit (-1: nunca)
+} sim_bus_t;
+
+static bool sim_begin(void *ctx) {
+  sim_bus_t *bus = ctx;
+  for (int i = 0; i < bus->n_devs; i++)
+    bus->active[i] = true;
+  bus->bit = 0;
+  return bus->n_devs > 0;
+}
+
+static bool sim_triplet(void *ctx, bool dir_if_conflict, bool *id_bit,
+                        bool *cmp_bit, bool *dir_taken) {
+  sim_bus_t *bus = ctx;
+  bool id = true, cmp = true; // La línea en reposo lee 1
+  for (int i = 0; i < bus->n_devs; i++) {
+    if (!bus->active[i] || bus->bit == bus->vanish_at_bit)
+      continue;
+    bool b = (bus->rom[i][bus->bit / 8] >> (bus->bit % 8)) & 1;
+    id = id && b;
+    cmp = cmp && !b;
+  }
+  *id_bit = id;
+  *cmp_bit = cmp;
+  *dir_taken = (id != cmp) ? id : dir_if_conflict;
+
+  // Los que no coinciden con la dirección escrita se retiran
+  for (int i = 0; i < bus->n_devs; i++) {
+    bool b = (bus->rom[i][bus->bit / 8] >> (bus->bit % 8)) & 1;
+    if (b != *dir_taken)
+      bus->active[i] = false;
+  }
+  bus->bit++;
+  return true;
+}
+
+static void sim_add(sim_bus_t *bus, uint64_t serial) {
+  uint8_t *rom = bus->rom[bus->n_devs++];
+  rom[0] = DS18B20_FAMILY_CODE;
+  for (int i = 1; i < 7; i++)
+    rom[i] = (uint8_t)(serial >> (8 * (i - 1)));
+  rom[7] = ow_crc8(rom, 7);
+}
+
+// Busca hasta agotar el bus y marca cada ROM encontrado
+static int sim_search_all(sim_bus_t *bus, int found[SIM_MAX_DEVS]) {
+  ow_search_t s;
+  ow_search_reset(&s);
+  int n = 0;
+  memset(found, 0, sizeof(int) * SIM_MAX_DEVS);
+  while (n <= SIM_MAX_DEVS && ow_search_next(&s, sim_begin, sim_triplet, bus)) {
+    n++;
+    for (int i = 0; i < bus->n_devs; i++) {
+      if (memcmp(s.rom, bus->rom[i], 8) == 0)
+        found[i]++;
+    }
+  }
+  CHECK(s.last_device || n == 0);
+  return n;
+}
+
+static void test_search(void) {
+  sim_bus_t bus = {.vanish_at_bit = -1};
+  int found[SIM_MAX_DEVS];
+
+  // Bus vacío: sin presencia no hay búsqueda
+  CHECK_EQ(sim_search_all(&bus, found), 0);
+
+  // Uno solo: sin discrepancias
+  sim_add(&bus, 0x0000015A2B3C4DULL);
+  CHECK_EQ(sim_search_all(&bus, found), 1);
+  CHECK_EQ(found[0], 1);
+
+  // Varios, incluidos dos que sólo difieren en el primer bit del serie y
+  // otro en el último
+  sim_add(&bus, 0x0000015A2B3C4CULL);
+  sim_add(&bus, 0x80015A2B3C4DULL);
+  sim_add(&bus, 0x0000000000000001ULL);
+  sim_add(&bus, 0x0000FFFFFFFFFFFFULL);
+  CHECK_EQ(sim_search_all(&bus, found), 5);
+  for (int i = 0; i < bus.n_devs; i++)
+    CHECK_EQ(found[i], 1);
+
+  // Un ROM con CRC corrupto aborta esa vuelta de la búsqueda
+  sim_bus_t bad = {.vanish_at_bit = -1};
+  sim_add(&bad, 0x123456);
+  bad.rom[0][7] ^= 0xFF;
+  ow_search_t s;
+  ow_search_reset(&s);
+  CHECK(!ow_search_next(&s, sim_begin, sim_triplet, &bad));
+
+  // Todos se desconectan a mitad: bits 1/1 => búsqueda reiniciada
+  bus.vanish_at_bit = 20;
+  ow_search_reset(&s);
+  CHECK(!ow_search_next(&s, sim_begin, sim_triplet, &bus));
+  CHECK_EQ(s.last_discrepancy, 0);
+  CHECK(!s.last_device);
+}
+
+int main(void) {
+  test_presence();
+  test_read_slots();
+  test_crc();
+  test_scratchpad();
+  test_search();
+  BB_TEST_END();
+}
@@ -0,0 +1,160 @@
+/**
+ * @file test_packet.c
+ * @brief bb_packet: ida y vuelta codificar -> fragmentar -> decodificar ->
+ * reensamblar, CRC, caducidad de mensajes a medias y reintentos del emisor
+ */
+
+#include "bb_packet.h"
+#include "bb_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bb_packet_reasm_t s_reasm;
+static bb_packet_tx_t s_tx;
+static uint8_t s_msg[BB_PKT_MSG_MAX];
+
+static void test_crc(void) {
+  const uint8_t check[] = "123456789";
+  CHECK_EQ(bb_packet_crc16(check, 9), 0x29B1); // CRC-16/CCITT-FALSE
+  CHECK_EQ(bb_packet_frag_count(0), 1);
+  CHECK_EQ(bb_packet_frag_count(BB_PKT_FRAG_PAYLOAD), 1);
+  CHECK_EQ(bb_packet_frag_count(BB_PKT_FRAG_PAYLOAD + 1), 2);
+  CHECK_EQ(bb_packet_frag_count(BB_PKT_MSG_MAX), BB_PKT_MAX_FRAGS);
+  CHECK_EQ(bb_packet_frag_count(BB_PKT_MSG_MAX + 1), 0);
+}
+
+// Cada longitud en los bordes de fragmento; los fragmentos llegan al revés
+// y repetidos, y cualquier byte alterado se rechaza
+static void test_round_trip(void) {
+  static const size_t lens[] = {0,   1,   200, BB_PKT_FRAG_PAYLOAD,
+                                228, 240, 454, 455,
+                                BB_PKT_MSG_MAX};
+  for (size_t i = 0; i < sizeof(s_msg); i++)
+    s_msg[i] = (uint8_t)rand();
+  bb_packet_reasm_init(&s_reasm);
+
+  for (size_t li = 0; li < sizeof(lens) / sizeof(lens[0]); li++) {
+    size_t len = lens[li];
+    bb_packet_hdr_t h = {
+        .type = BB_PKT_TELEMETRY,
+        .mac = {1, 2, 3, 4, 5, 6},
+        .packet_id = 100 + (uint32_t)li,
+        .timestamp_ms = 0xDEADBEEF,
+        .frag_count = bb_packet_frag_count(len),
+    };
+    uint8_t frames[BB_PKT_MAX_FRAGS][BB_PKT_FRAME_MAX];
+    size_t flen[BB_PKT_MAX_FRAGS];
+    for (int f = 0; f < h.frag_count; f++) {
+      h.frag_index = (uint8_t)f;
+      flen[f] = bb_packet_encode(&h, s_msg, len, frames[f], BB_PKT_FRAME_MAX);
+      CHECK(flen[f] > 0 && flen[f] <= BB_PKT_FRAME_MAX);
+    }
+
+    int done = 0;
+    for (int f = h.frag_count - 1; f >= 0; f--) {
+      for (int dup = 0; dup < 2; dup++) {
+        bb_packet_hdr_t g;
+        const uint8_t *p, *out;
+        size_t pl, olen;
+        CHECK_EQ(bb_packet_decode(frames[f], flen[f], &g, &p, &pl), ESP_OK);
+        CHECK_EQ(g.packet_id, h.packet_id);
+        CHECK_EQ(g.timestamp_ms, 0xDEADBEEF);
+        CHECK_EQ(g.frag_index, f);
+        CHECK(memcmp(g.mac, h.mac, 6) == 0);
+        if (bb_packet_reasm_add(&s_reasm, &g, p, pl, 1000, &out, &olen)) {
+          done++;
+          CHECK_EQ(olen, len);
+          CHECK(len == 0 || memcmp(out, s_msg, len) == 0);
+        }
+      }
+    }
+    // Sin fragmentar no hay estado: el duplicado vuelve a entregarse
+    CHECK_EQ(done, h.frag_count == 1 ? 2 : 1);
+
+    for (size_t b = 0; b < flen[0]; b++) {
+      uint8_t bad[BB_PKT_FRAME_MAX];
+      bb_packet_hdr_t g;
+      const uint8_t *p;
+      size_t pl;
+      memcpy(bad, frames[0], flen[0]);
+      bad[b] ^= 0x10;
+      CHECK(bb_packet_decode(bad, flen[0], &g, &p, &pl) != ESP_OK);
+    }
+    bb_packet_hdr_t g;
+    const uint8_t *p;
+    size_t pl;
+    CHECK(bb_packet_decode(frames[0], flen[0] - 1, &g, &p, &pl) != ESP_OK);
+  }
+  CHECK(s_reasm.dup_frags > 0);
+
+  // No cabe en la trama de destino
+  bb_packet_hdr_t h = {.frag_count = 1};
+  uint8_t small[BB_PKT_HEADER_BYTES + 10];
+  CHECK_EQ(bb_packet_encode(&h, s_msg, 100, small, sizeof(small)), 0);
+}
+
+static void test_expiry(void) {
+  // Un mensaje a medias caduca cuando otro necesita hueco tras el plazo
+  bb_packet_reasm_init(&s_reasm);
+  bb_packet_hdr_t h = {.packet_id = 7, .frag_count = 2};
+  uint8_t f0[BB_PKT_FRAME_MAX];
+  size_t l0 = bb_packet_encode(&h, s_msg, 300, f0, sizeof(f0));
+  bb_packet_hdr_t g;
+  const uint8_t *p, *out;
+  size_t pl, olen;
+  CHECK_EQ(bb_packet_decode(f0, l0, &g, &p, &pl), ESP_OK);
+  CHECK(!bb_packet_reasm_add(&s_reasm, &g, p, pl, 0, &out, &olen));
+
+  int64_t later = (BB_ESPNOW_REASM_TIMEOUT_MS + 100) * 1000LL;
+  g.packet_id = 8;
+  g.frag_count = 1;
+  CHECK(bb_packet_reasm_add(&s_reasm, &g, p, 5, later, &out, &olen));
+  g.packet_id = 9;
+  g.frag_count = 2;
+  CHECK(!bb_packet_reasm_add(&s_reasm, &g, p, pl, later, &out, &olen));
+  CHECK_EQ(s_reasm.expired, 1);
+}
+
+static void test_tx_retries(void) {
+  // Dos fragmentos: el 0 falla dos veces y pasa; el 1 agota los intentos
+  bb_packet_tx_init(&s_tx);
+  bb_packet_hdr_t th = {.packet_id = 1};
+  int64_t d;
+  uint8_t fb[BB_PKT_FRAME_MAX];
+
+  CHECK_EQ(bb_packet_tx_start(&s_tx, &th, s_msg, 240), ESP_OK);
+  CHECK_EQ(bb_packet_tx_start(&s_tx, &th, s_msg, 240), ESP_ERR_INVALID_STATE);
+  CHECK_EQ(bb_packet_tx_frame(&s_tx, fb, sizeof(fb)), BB_PKT_FRAME_MAX);
+
+  CHECK_EQ(bb_packet_tx_result(&s_tx, false, &d), BB_PKT_TX_SEND);
+  CHECK_EQ(d, BB_ESPNOW_BACKOFF_MS * 1000LL);
+  CHECK_EQ(bb_packet_tx_result(&s_tx, false, &d), BB_PKT_TX_SEND);
+  CHECK_EQ(d, BB_ESPNOW_BACKOFF_MS * 2000LL);
+  CHECK_EQ(bb_packet_tx_result(&s_tx, true, &d), BB_PKT_TX_SEND);
+  CHECK_EQ(d, 0);
+
+  CHECK_EQ(bb_packet_tx_frame(&s_tx, fb, sizeof(fb)),
+           BB_PKT_HEADER_BYTES + (240 - BB_PKT_FRAG_PAYLOAD) +
+               BB_PKT_CRC_BYTES);
+  for (int i = 1; i < BB_ESPNOW_RETRIES; i++)
+    CHECK_EQ(bb_packet_tx_result(&s_tx, false, &d), BB_PKT_TX_SEND);
+  CHECK_EQ(bb_packet_tx_result(&s_tx, false, &d), BB_PKT_TX_FAILED);
+
+  // El emisor queda libre para el siguiente
+  CHECK_EQ(bb_packet_tx_start(&s_tx, &th, s_msg, 100), ESP_OK);
+  CHECK_EQ(bb_packet_tx_result(&s_tx, true, &d), BB_PKT_TX_DONE);
+  CHECK_EQ(s_tx.messages, 2);
+  CHECK_EQ(s_tx.frames, 2);
+  CHECK_EQ(s_tx.retries, 4);
+  CHECK_EQ(s_tx.failed, 1);
+}
+
+int main(void) {
+  srand(1);
+  test_crc();
+  test_round_trip();
+  test_expiry();
+  test_tx_retries();
+  BB_TEST_END();
+}
@@ -0,0 +1,178 @@
+/**
+ * @file test_pool.c
+ * @brief bb_pool: reserva/retención/liberación, estadísticas y carreras de
+ * refcount entre hilos
+ */
+
+#include "bb_pool.h"
+#include "bb_test.h"
+#include <pthread.h>
+#include <string.h>
+
+typedef struct {
+  uint32_t owner; // Hilo que lo tiene reservado (detecta reservas dobles)
+  uint32_t pad[7];
+} obj_t;
+
+#define N_THREADS 4
+#define N_ITERS 200000
+
+BB_POOL_STATIC(small, obj_t, 3);
+BB_POOL_STATIC(shared, obj_t, 8);
+
+static void test_init(void) {
+  static obj_t st[BB_POOL_MAX_OBJS + 1];
+  static atomic_int refs[BB_POOL_MAX_OBJS + 1];
+  bb_pool_t p;
+
+  CHECK(!bb_pool_init(&p, "x", NULL, sizeof(obj_t), 4, refs));
+  CHECK(!bb_pool_init(&p, "x", (uint8_t *)st, sizeof(obj_t), 0, refs));
+  CHECK(!bb_pool_init(&p, "x", (uint8_t *)st, sizeof(obj_t),
+                      BB_POOL_MAX_OBJS + 1, refs));
+  CHECK(bb_pool_init(&p, "x", (uint8_t *)st, sizeof(obj_t), BB_POOL_MAX_OBJS,
+                     refs));
+
+  // Con 32 objetos la máscara está llena: todos deben salir
+  for (int i = 0; i < BB_POOL_MAX_OBJS; i++)
+    CHECK(bb_pool_alloc(&p) != NULL);
+  CHECK(bb_pool_alloc(&p) == NULL);
+}
+
+static void test_alloc_release(void) {
+  CHECK(bb_pool_init(&small, BB_POOL_INIT_ARGS(small)));
+
+  obj_t *a = bb_pool_alloc(&small);
+  obj_t *b = bb_pool_alloc(&small);
+  obj_t *c = bb_pool_alloc(&small);
+  CHECK(a && b && c && a != b && b != c && a != c);
+  CHECK(bb_pool_alloc(&small) == NULL);
+  CHECK(bb_pool_alloc(&small) == NULL);
+
+  bb_pool_stats_t st;
+  bb_pool_get_stats(&small, &st);
+  CHECK_EQ(st.capacity, 3);
+  CHECK_EQ(st.in_use, 3);
+  CHECK_EQ(st.high_watermark, 3);
+  CHECK_EQ(st.allocs, 3);
+  CHECK_EQ(st.exhausted, 2);
+
+  // Dos referencias: la primera liberación no lo devuelve al pool
+  CHECK_EQ(bb_pool_refcount(&small, b), 1);
+  bb_pool_retain(&small, b);
+  CHECK_EQ(bb_pool_refcount(&small, b), 2);
+  CHECK(!bb_pool_release(&small, b));
+  CHECK(bb_pool_alloc(&small) == NULL);
+  CHECK(bb_pool_release(&small, b));
+  CHECK_EQ(bb_pool_refcount(&small, b), 0);
+
+  // Doble liberación: se ignora y el refcount no queda negativo
+  CHECK(!bb_pool_release(&small, b));
+  CHECK_EQ(bb_pool_refcount(&small, b), 0);
+
+  // Punteros ajenos o desalineados
+  obj_t other;
+  CHECK(!bb_pool_release(&small, &other));
+  CHECK_EQ(bb_pool_refcount(&small, &other), -1);
+  CHECK_EQ(bb_pool_refcount(&small, (uint8_t *)a + 1), -1);
+  bb_pool_retain(&small, &other);
+
+  CHECK(bb_pool_alloc(&small) == b);
+  CHECK(bb_pool_release(&small, a));
+  CHECK(bb_pool_release(&small, b));
+  CHECK(bb_pool_release(&small, c));
+
+  bb_pool_get_stats(&small, &st);
+  CHECK_EQ(st.in_use, 0);
+  CHECK_EQ(st.high_watermark, 3);
+  CHECK_EQ(st.allocs, 4);
+}
+
+// Cada hilo reserva, marca el objeto como suyo, comprueba que nadie más lo
+// toca y lo suelta. Con más hilos que objetos se fuerza el agotamiento.
+static atomic_uint s_double_owner;
+
+static void *alloc_worker(void *arg) {
+  uint32_t id = (uint32_t)(uintptr_t)arg;
+  for (int i = 0; i < N_ITERS; i++) {
+    obj_t *o = bb_pool_alloc(&small);
+    if (o == NULL)
+      continue;
+    if (o->owner != 0)
+      atomic_fetch_add(&s_double_owner, 1);
+    o->owner = id;
+    for (int k = 0; k < 7; k++)
+      o->pad[k] = id;
+    for (int k = 0; k < 7; k++) {
+      if (o->pad[k] != id || o->owner != id)
+        atomic_fetch_add(&s_double_owner, 1);
+    }
+    o->owner = 0;
+    bb_pool_release(&small, o);
+  }
+  return NULL;
+}
+
+static void test_alloc_race(void) {
+  CHECK(bb_pool_init(&small, BB_POOL_INIT_ARGS(small)));
+  memset(small_storage, 0, sizeof(small_storage));
+
+  pthread_t th[N_THREADS];
+  for (uintptr_t i = 0; i < N_THREADS; i++)
+    pthread_create(&th[i], NULL, alloc_worker, (void *)(i + 1));
+  for (int i = 0; i < N_THREADS; i++)
+    pthread_join(th[i], NULL);
+
+  bb_pool_stats_t st;
+  bb_pool_get_stats(&small, &st);
+  CHECK_EQ(atomic_load(&s_double_owner), 0);
+  CHECK_EQ(st.in_use, 0);
+  CHECK(st.high_watermark <= 3);
+  CHECK_EQ(st.allocs + st.exhausted, (uint32_t)N_THREADS * N_ITERS);
+}
+
+// Como un frame compartido por varios consumidores: todos retienen y
+// sueltan a la vez; exactamente una liberación debe devolverlo al pool.
+static obj_t *s_objs[8];
+static atomic_uint s_freed;
+
+static void *refcount_worker(void *arg) {
+  (void)arg;
+  for (int i = 0; i < N_ITERS / 4; i++) {
+    obj_t *o = s_objs[i % 8];
+    bb_pool_retain(&shared, o);
+    if (bb_pool_release(&shared, o))
+      atomic_fetch_add(&s_freed, 1);
+  }
+  return NULL;
+}
+
+static void test_refcount_race(void) {
+  CHECK(bb_pool_init(&shared, BB_POOL_INIT_ARGS(shared)));
+  for (int i = 0; i < 8; i++)
+    s_objs[i] = bb_pool_alloc(&shared);
+
+  pthread_t th[N_THREADS];
+  for (int i = 0; i < N_THREADS; i++)
+    pthread_create(&th[i], NULL, refcount_worker, NULL);
+  for (int i = 0; i < N_THREADS; i++)
+    pthread_join(th[i], NULL);
+
+  // La referencia del dueño sigue viva: nada se ha liberado por el camino
+  CHECK_EQ(atomic_load(&s_freed), 0);
+  for (int i = 0; i < 8; i++) {
+    CHECK_EQ(bb_pool_refcount(&shared, s_objs[i]), 1);
+    CHECK(bb_pool_release(&shared, s_objs[i]));
+  }
+
+  bb_pool_stats_t st;
+  bb_pool_get_stats(&shared, &st);
+  CHECK_EQ(st.in_use, 0);
+}
+
+int main(void) {
+  test_init();
+  test_alloc_release();
+  test_alloc_race();
+  test_refcount_race();
+  BB_TEST_END();
+}
@@ -0,0 +1,139 @@
+/**
+ * @file test_ring.c
+ * @brief bb_ring: orden, wrap-around, marcas de tiempo, ring lleno y un
+ * productor/consumidor en hilos distintos
+ */
+
+#include "bb_ring.h"
+#include "bb_test.h"
+#include <pthread.h>
+#include <string.h>
+
+#define BLOCK 8
+#define N_BLOCKS 4
+
+static uint8_t s_storage[BLOCK * N_BLOCKS];
+static int64_t s_stamps[N_BLOCKS];
+
+static bool push(bb_ring_t *r, uint8_t v) {
+  uint8_t *w = bb_ring_write_acquire(r);
+  if (w == NULL) {
+    bb_ring_mark_overrun(r);
+    return false;
+  }
+  memset(w, v, BLOCK);
+  bb_ring_write_commit(r, 1000 + v);
+  return true;
+}
+
+static void test_init(void) {
+  bb_ring_t r;
+  CHECK(!bb_ring_init(&r, s_storage, NULL, BLOCK, 3));
+  CHECK(!bb_ring_init(&r, s_storage, NULL, BLOCK, 1));
+  CHECK(!bb_ring_init(&r, NULL, NULL, BLOCK, N_BLOCKS));
+  CHECK(bb_ring_init(&r, s_storage, NULL, BLOCK, N_BLOCKS));
+  CHECK_EQ(bb_ring_available(&r), 0);
+}
+
+static void test_order_wrap(void) {
+  bb_ring_t r;
+  CHECK(bb_ring_init(&r, s_storage, s_stamps, BLOCK, N_BLOCKS));
+
+  uint8_t d[BLOCK * N_BLOCKS];
+  int64_t st[N_BLOCKS];
+
+  for (uint8_t i = 0; i < 3; i++)
+    CHECK(push(&r, i));
+  CHECK(!bb_ring_read_frame(&r, d, 4, st)); // Faltan bloques
+  CHECK(!bb_ring_read_frame(&r, d, 0, st));
+  CHECK(bb_ring_read_frame(&r, d, 2, st));
+  CHECK_EQ(d[0], 0);
+  CHECK_EQ(d[BLOCK], 1);
+  CHECK_EQ(st[1], 1001);
+
+  // 3..5 dan la vuelta al final del almacenamiento
+  for (uint8_t i = 3; i < 6; i++)
+    CHECK(push(&r, i));
+  CHECK_EQ(bb_ring_available(&r), 4);
+  CHECK(!push(&r, 99)); // Lleno
+  CHECK_EQ(bb_ring_overruns(&r), 1);
+  CHECK_EQ(r.max_fill, 4);
+
+  CHECK(bb_ring_read_frame(&r, d, 4, st));
+  for (int i = 0; i < 4; i++) {
+    CHECK_EQ(d[i * BLOCK], 2 + i);
+    CHECK_EQ(d[i * BLOCK + BLOCK - 1], 2 + i);
+    CHECK_EQ(st[i], 1002 + i);
+  }
+  CHECK_EQ(bb_ring_available(&r), 0);
+  CHECK(!bb_ring_read_frame(&r, d, N_BLOCKS + 1, NULL));
+
+  bb_ring_reset(&r);
+  CHECK_EQ(bb_ring_available(&r), 0);
+  CHECK_EQ(bb_ring_overruns(&r), 0);
+}
+
+// SPSC real: el productor numera los bloques, el consumidor lee de a 3 (no
+// divide al tamaño del ring, así el wrap cae en mitad de un frame) y exige
+// que la numeración sea continua salvo por los descartados por overrun.
+#define SPSC_BLOCKS 16
+#define SPSC_TOTAL 500000u
+#define SPSC_FRAME 3
+
+static uint8_t s_spsc_storage[sizeof(uint32_t) * SPSC_BLOCKS];
+static bb_ring_t s_spsc;
+static atomic_bool s_done;
+
+static void *producer(void *arg) {
+  (void)arg;
+  for (uint32_t seq = 0; seq < SPSC_TOTAL; seq++) {
+    uint8_t *w = bb_ring_write_acquire(&s_spsc);
+    if (w == NULL) {
+      bb_ring_mark_overrun(&s_spsc);
+      continue;
+    }
+    memcpy(w, &seq, sizeof(seq));
+    bb_ring_write_commit(&s_spsc, seq);
+  }
+  atomic_store(&s_done, true);
+  return NULL;
+}
+
+static void test_spsc(void) {
+  CHECK(bb_ring_init(&s_spsc, s_spsc_storage, NULL, sizeof(uint32_t),
+                     SPSC_BLOCKS));
+
+  pthread_t th;
+  pthread_create(&th, NULL, producer, NULL);
+
+  uint32_t frame[SPSC_FRAME];
+  uint32_t read = 0, bad = 0;
+  int64_t last = -1;
+  for (;;) {
+    bool done = atomic_load(&s_done);
+    if (bb_ring_read_frame(&s_spsc, (uint8_t *)frame, SPSC_FRAME, NULL)) {
+      for (int i = 0; i < SPSC_FRAME; i++) {
+        if ((int64_t)frame[i] <= last)
+          bad++;
+        last = frame[i];
+      }
+      read += SPSC_FRAME;
+    } else if (done) {
+      break;
+    }
+  }
+  pthread_join(th, NULL);
+
+  uint32_t left = bb_ring_available(&s_spsc);
+  CHECK_EQ(bad, 0);
+  CHECK(left < SPSC_FRAME);
+  CHECK_EQ(read + left + bb_ring_overruns(&s_spsc), SPSC_TOTAL);
+  CHECK(s_spsc.max_fill <= SPSC_BLOCKS);
+}
+
+int main(void) {
+  test_init();
+  test_order_wrap();
+  test_spsc();
+  BB_TEST_END();
+}
@@ -0,0 +1,262 @@
+/**
+ * @file test_rollup.c
+ * @brief bb_rollup: cierre de intervalos en los bordes de minuto, hora y
+ * día, métricas ausentes (NAN), reloj hacia atrás y la ida y vuelta
+ * codificar -> fusionar con la que bb_history retoma tras un reinicio
+ */
+
+#include "bb_rollup.h"
+#include "bb_test.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DAY0 1700006400u // 2023-11-15 00:00:00 UTC
+
+static uint64_t s_rng = 88172645463325252ULL;
+
+static float rnd(float lo, float hi) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 7;
+  s_rng ^= s_rng << 17;
+  return lo + (hi - lo) * (float)(s_rng % 1000001) / 1000000.0f;
+}
+
+static void sample(float v[BB_ROLLUP_METRICS], float a, float temp) {
+  v[BB_ROLLUP_RMS_A] = a;
+  v[BB_ROLLUP_PEAK_A] = 2.0f * a;
+  v[BB_ROLLUP_RMS_B] = NAN; // Un solo punto de medida
+  v[BB_ROLLUP_TEMP] = temp;
+}
+
+static void test_boundaries(void) {
+  bb_rollup_t r;
+  bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS];
+  float v[BB_ROLLUP_METRICS];
+  int n_closed[BB_ROLLUP_LEVELS] = {0};
+
+  CHECK_EQ(bb_rollup_period_s(BB_ROLLUP_MINUTE), 60);
+  CHECK_EQ(bb_rollup_period_s(BB_ROLLUP_HOUR), 3600);
+  CHECK_EQ(bb_rollup_period_s(BB_ROLLUP_DAY), 86400);
+
+  // La primera muestra abre los tres niveles sin cerrar nada
+  bb_rollup_init(&r);
+  sample(v, 1.05f, 20.0f);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 5, v, closed), 0);
+  CHECK_EQ(r.cur[BB_ROLLUP_MINUTE].start_s, DAY0);
+  CHECK_EQ(r.cur[BB_ROLLUP_HOUR].start_s, DAY0);
+  CHECK_EQ(r.cur[BB_ROLLUP_DAY].start_s, DAY0);
+
+  // Una muestra cada 10 s durante un día y un poco más
+  for (uint32_t t = DAY0 + 15; t <= DAY0 + 86400 + 5; t += 10) {
+    sample(v, 1.0f + (float)(t % 60) / 100.0f, 20.0f);
+    uint8_t mask = bb_rollup_add(&r, t, v, closed);
+
+    // El último segundo de cada intervalo todavía no cierra
+    CHECK(t % 60 != 59 || mask == 0);
+    CHECK_EQ((mask & 1) != 0, t % 60 == 5);
+    CHECK_EQ((mask & 2) != 0, t % 3600 == 5);
+    CHECK_EQ((mask & 4) != 0, t % 86400 == 5);
+    for (int l = 0; l < BB_ROLLUP_LEVELS; l++) {
+      if (!(mask & (1u << l)))
+        continue;
+      n_closed[l]++;
+      uint32_t p = bb_rollup_period_s((bb_rollup_level_t)l);
+      CHECK_EQ(closed[l].start_s, t - 5 - p); // El intervalo anterior entero
+      CHECK_EQ(closed[l].m[BB_ROLLUP_RMS_A].n, p / 10);
+    }
+    if (mask & 1) {
+      const bb_rollup_agg_t *a = &closed[BB_ROLLUP_MINUTE].m[BB_ROLLUP_RMS_A];
+      CHECK(fabsf(a->min - 1.05f) < 1e-6f); // Segundos 5, 15 ... 55
+      CHECK(fabsf(a->max - 1.55f) < 1e-6f);
+      CHECK(fabsf(a->sum - 7.8f) < 1e-4f);
+      CHECK_EQ(closed[BB_ROLLUP_MINUTE].m[BB_ROLLUP_TEMP].n, 6);
+    }
+  }
+  CHECK_EQ(n_closed[BB_ROLLUP_MINUTE], 1440);
+  CHECK_EQ(n_closed[BB_ROLLUP_HOUR], 24);
+  CHECK_EQ(n_closed[BB_ROLLUP_DAY], 1);
+  CHECK_EQ(r.cur[BB_ROLLUP_DAY].start_s, DAY0 + 86400);
+  CHECK_EQ(r.added, 8641);
+
+  // Un hueco de varios intervalos cierra sólo el último con datos
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 86400 + 3 * 3600, v, closed), 3);
+  CHECK_EQ(closed[BB_ROLLUP_MINUTE].start_s, DAY0 + 86400);
+  CHECK_EQ(closed[BB_ROLLUP_HOUR].start_s, DAY0 + 86400);
+  CHECK_EQ(r.cur[BB_ROLLUP_HOUR].start_s, DAY0 + 86400 + 3 * 3600);
+}
+
+static void test_missing(void) {
+  bb_rollup_t r;
+  bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS];
+  float v[BB_ROLLUP_METRICS];
+  uint8_t rec[BB_ROLLUP_BYTES];
+
+  // RMS_B nunca llega y la temperatura sólo en una muestra
+  bb_rollup_init(&r);
+  sample(v, 0.3f, NAN);
+  bb_rollup_add(&r, DAY0, v, closed);
+  sample(v, 0.4f, -5.25f);
+  bb_rollup_add(&r, DAY0 + 20, v, closed);
+  sample(v, 0.2f, NAN);
+  bb_rollup_add(&r, DAY0 + 40, v, closed);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 60, v, closed), 1);
+
+  const bb_rollup_bucket_t *b = &closed[BB_ROLLUP_MINUTE];
+  CHECK_EQ(b->m[BB_ROLLUP_RMS_A].n, 3);
+  CHECK_EQ(b->m[BB_ROLLUP_RMS_B].n, 0);
+  CHECK_EQ(b->m[BB_ROLLUP_TEMP].n, 1);
+  CHECK(b->m[BB_ROLLUP_TEMP].min == -5.25f);
+  CHECK(b->m[BB_ROLLUP_TEMP].max == -5.25f);
+
+  // La métrica ausente queda con n = 0 en el registro y no entra al fusionar
+  bb_rollup_encode(b, rec);
+  uint16_t n;
+  memcpy(&n, rec + BB_ROLLUP_RMS_B * 10, 2);
+  CHECK_EQ(n, 0);
+  for (int i = 2; i < 10; i++)
+    CHECK_EQ(rec[BB_ROLLUP_RMS_B * 10 + i], 0);
+  bb_rollup_bucket_t m = {.start_s = DAY0};
+  bb_rollup_merge(&m, rec);
+  CHECK_EQ(m.m[BB_ROLLUP_RMS_B].n, 0);
+  CHECK_EQ(m.m[BB_ROLLUP_TEMP].n, 1);
+  CHECK(fabsf(m.m[BB_ROLLUP_TEMP].min + 5.25f) < 1e-4f);
+  CHECK(fabsf(m.m[BB_ROLLUP_TEMP].sum + 5.25f) < 1e-4f);
+
+  // Un intervalo sin ninguna métrica no sale al cerrarse
+  for (int i = 0; i < BB_ROLLUP_METRICS; i++)
+    v[i] = NAN;
+  bb_rollup_init(&r);
+  bb_rollup_add(&r, DAY0, v, closed);
+  bb_rollup_add(&r, DAY0 + 30, v, closed);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 60, v, closed), 0);
+  CHECK_EQ(r.cur[BB_ROLLUP_MINUTE].start_s, DAY0 + 60);
+  CHECK_EQ(r.added, 3);
+}
+
+static void test_clock_backwards(void) {
+  bb_rollup_t r;
+  bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS];
+  float v[BB_ROLLUP_METRICS];
+
+  bb_rollup_init(&r);
+  sample(v, 1.0f, 20.0f);
+  bb_rollup_add(&r, DAY0 + 3600 + 125, v, closed);
+
+  // El SNTP retrasa el reloj: minuto, hora y día anteriores cuentan en los
+  // intervalos en curso, que no se reabren ni se cierran
+  sample(v, 3.0f, 21.0f);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 3600 + 30, v, closed), 0);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 10, v, closed), 0);
+  CHECK_EQ(bb_rollup_add(&r, DAY0 - 86400, v, closed), 0);
+  CHECK_EQ(r.cur[BB_ROLLUP_MINUTE].start_s, DAY0 + 3600 + 120);
+  CHECK_EQ(r.cur[BB_ROLLUP_HOUR].start_s, DAY0 + 3600);
+  CHECK_EQ(r.cur[BB_ROLLUP_DAY].start_s, DAY0);
+  CHECK_EQ(r.cur[BB_ROLLUP_MINUTE].m[BB_ROLLUP_RMS_A].n, 4);
+
+  // Al volver a avanzar se cierra con todas las muestras
+  CHECK_EQ(bb_rollup_add(&r, DAY0 + 3600 + 180, v, closed), 1);
+  const bb_rollup_agg_t *a = &closed[BB_ROLLUP_MINUTE].m[BB_ROLLUP_RMS_A];
+  CHECK_EQ(a->n, 4);
+  CHECK(a->min == 1.0f);
+  CHECK(a->max == 3.0f);
+  CHECK(fabsf(a->sum - 10.0f) < 1e-5f);
+}
+
+// La hora reconstruida a partir de sus minutos codificados coincide con la
+// calculada en vivo salvo por la cuantización
+static void test_resume_round_trip(void) {
+  bb_rollup_t r, resumed;
+  bb_rollup_bucket_t closed[BB_ROLLUP_LEVELS];
+  float v[BB_ROLLUP_METRICS];
+  uint8_t rec[BB_ROLLUP_BYTES];
+  const uint32_t t0 = DAY0 + 5 * 3600;
+
+  bb_rollup_init(&r);
+  bb_rollup_init(&resumed);
+  bb_rollup_open(&resumed, BB_ROLLUP_HOUR, t0 + 1234);
+  CHECK_EQ(resumed.cur[BB_ROLLUP_HOUR].start_s, t0);
+
+  int minutes = 0;
+  for (uint32_t t = t0; t < t0 + 3600; t += 7) {
+    v[BB_ROLLUP_RMS_A] = rnd(0.05f, 2.0f);
+    v[BB_ROLLUP_PEAK_A] = rnd(1.0f, 16.0f);
+    v[BB_ROLLUP_RMS_B] = rnd(0.0f, 0.5f);
+    v[BB_ROLLUP_TEMP] = rnd(-20.0f, 45.0f);
+    if (bb_rollup_add(&r, t, v, closed) & 1) {
+      bb_rollup_encode(&closed[BB_ROLLUP_MINUTE], rec);
+      bb_rollup_merge(&resumed.cur[BB_ROLLUP_HOUR], rec);
+      minutes++;
+    }
+  }
+  // El último minuto se cierra como haría la hora siguiente
+  bb_rollup_add(&r, t0 + 3600, v, closed);
+  bb_rollup_encode(&closed[BB_ROLLUP_MINUTE], rec);
+  bb_rollup_merge(&resumed.cur[BB_ROLLUP_HOUR], rec);
+  CHECK_EQ(minutes + 1, 60);
+
+  const bb_rollup_bucket_t *live = &closed[BB_ROLLUP_HOUR];
+  const bb_rollup_bucket_t *got = &resumed.cur[BB_ROLLUP_HOUR];
+  CHECK_EQ(live->start_s, t0);
+  for (int m = 0; m < BB_ROLLUP_METRICS; m++) {
+    const bb_rollup_agg_t *a = &live->m[m], *b = &got->m[m];
+    float q = (m == BB_ROLLUP_TEMP) ? 0.005f : 0.0005f; // Medio paso
+    CHECK_EQ(a->n, b->n);
+    CHECK(fabsf(a->min - b->min) <= q + 1e-5f);
+    CHECK(fabsf(a->max - b->max) <= q + 1e-5f);
+    CHECK(fabsf(a->sum / a->n - b->sum / b->n) <= q + 1e-4f);
+    float rms_a = sqrtf(a->sumsq / a->n), rms_b = sqrtf(b->sumsq / b->n);
+    CHECK(fabsf(rms_a - rms_b) <= q + 1e-4f);
+  }
+
+  // Fusionar en una hora ya abierta acumula
+  bb_rollup_bucket_t twice = *got;
+  bb_rollup_encode(&closed[BB_ROLLUP_MINUTE], rec);
+  bb_rollup_merge(&twice, rec);
+  CHECK_EQ(twice.m[BB_ROLLUP_RMS_A].n,
+           got->m[BB_ROLLUP_RMS_A].n + closed[BB_ROLLUP_MINUTE].m[0].n);
+}
+
+static void test_encode_limits(void) {
+  bb_rollup_bucket_t b = {.start_s = DAY0};
+  uint8_t rec[BB_ROLLUP_BYTES];
+
+  // n satura en u16; fuera de rango satura al tipo (sin vueltas)
+  bb_rollup_agg_t *a = &b.m[BB_ROLLUP_RMS_A];
+  a->n = 70000;
+  a->min = -1.0f;
+  a->max = 80.0f;
+  a->sum = 70000.0f;
+  a->sumsq = 70000.0f;
+  bb_rollup_agg_t *t = &b.m[BB_ROLLUP_TEMP];
+  t->n = 2;
+  t->min = -400.0f;
+  t->max = 400.0f;
+  t->sum = 0.0f;
+  t->sumsq = 2.0f * 400.0f * 400.0f;
+  bb_rollup_encode(&b, rec);
+
+  uint16_t n, u;
+  int16_t s;
+  memcpy(&n, rec + BB_ROLLUP_RMS_A * 10, 2);
+  CHECK_EQ(n, UINT16_MAX);
+  memcpy(&u, rec + BB_ROLLUP_RMS_A * 10 + 2, 2);
+  CHECK_EQ(u, 0);
+  memcpy(&u, rec + BB_ROLLUP_RMS_A * 10 + 4, 2);
+  CHECK_EQ(u, UINT16_MAX);
+  memcpy(&u, rec + BB_ROLLUP_RMS_A * 10 + 6, 2);
+  CHECK_EQ(u, 1000);
+  memcpy(&s, rec + BB_ROLLUP_TEMP * 10 + 2, 2);
+  CHECK_EQ(s, INT16_MIN);
+  memcpy(&s, rec + BB_ROLLUP_TEMP * 10 + 4, 2);
+  CHECK_EQ(s, INT16_MAX);
+}
+
+int main(void) {
+  test_boundaries();
+  test_missing();
+  test_clock_backwards();
+  test_resume_round_trip();
+  test_encode_limits();
+  BB_TEST_END();
+}
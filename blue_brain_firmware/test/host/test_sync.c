@@ -0,0 +1,218 @@
+/**
+ * @file test_sync.c
+ * @brief bb_sync: línea común con relojes sintéticos desviados
+ *
+ * Dos seguidores con cristales a +35 y -22 ppm (y una deriva lenta encima)
+ * escuchan 2 h de balizas de un maestro: retardos con cola exponencial,
+ * picos de 2-20 ms, balizas perdidas, un reinicio del maestro y, en la
+ * segunda pasada, un salto de 50 ms de su reloj. Cada 5 s los dos piden el
+ * siguiente hueco común y se mide su error contra el reloj del maestro.
+ */
+
+#include "bb_sync.h"
+#include "bb_test.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NODES 2
+#define SIM_US (2 * 3600e6)
+#define REBOOT_US 3600e6
+#define STEP_AT_US 5400e6
+#define SLOT_US 5000000
+#define MAX_BURSTS 2000
+
+static uint64_t s_rng;
+
+static double urnd(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 7;
+  s_rng ^= s_rng << 17;
+  return (s_rng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double erand(double mean) { return -mean * log(1.0 - urnd()); }
+
+typedef struct {
+  double ppm, wander;
+  double lk, tk; // Ancla del reloj local: marca lk en el instante real tk
+  bb_sync_t s;
+  int64_t rx_us;
+  uint32_t rx_seq;
+  bool has_rx;
+} node_t;
+
+static double rate(const node_t *n) {
+  return 1.0 + (n->ppm + n->wander) * 1e-6;
+}
+
+static double local_at(const node_t *n, double t) {
+  return n->lk + (t - n->tk) * rate(n);
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double pct(double *v, int n, int p) {
+  qsort(v, (size_t)n, sizeof(double), cmp_double);
+  return v[(size_t)n * p / 100 - (p == 100)];
+}
+
+static void simulate(bool step) {
+  static double errs[NODES][MAX_BURSTS], rel[MAX_BURSTS];
+  int ne[NODES] = {0}, nr = 0, big[NODES] = {0};
+  double lock_t[NODES] = {-1, -1}, relock_t[NODES] = {-1, -1};
+  node_t nodes[NODES] = {
+      {.ppm = 35.0, .lk = 12.3e6},
+      {.ppm = -22.0, .lk = 987.6e6},
+  };
+  const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+  uint32_t boot = 0xABCD, seq = 0;
+  double master0 = 0; // Instante real en que el reloj del maestro marcó 0
+  double prev_tx = 0;
+  bool prev_ok = false, rebooted = false;
+
+  s_rng = 88172645463325252ULL;
+  for (int i = 0; i < NODES; i++)
+    bb_sync_init(&nodes[i].s);
+
+  for (double t = 1e6; t < SIM_US; t += 1e6) {
+    if (!rebooted && t >= REBOOT_US) {
+      rebooted = true;
+      master0 = t - 3e6;
+      boot = 0x1234;
+      seq = 0;
+      prev_ok = false;
+    }
+    if (step && t == STEP_AT_US)
+      master0 -= 50000; // Salto sin reinicio
+
+    for (int i = 0; i < NODES; i++) {
+      nodes[i].lk = local_at(&nodes[i], t);
+      nodes[i].tk = t;
+      nodes[i].wander += (urnd() - 0.5) * 0.02; // ±0.01 ppm/s
+    }
+
+    // La baliza sale tras la cola del driver; su hora de salida real (el
+    // callback de envío) viaja en la siguiente
+    double air = t + 200 + erand(800);
+    double tx_done = air + 20 + urnd() * 60;
+    bb_sync_beacon_t b = {seq, boot,
+                          prev_ok ? (int64_t)(prev_tx - master0) : 0};
+    uint8_t wire[BB_SYNC_BEACON_BYTES];
+    CHECK_EQ(bb_sync_beacon_encode(&b, wire, sizeof(wire)),
+             BB_SYNC_BEACON_BYTES);
+
+    for (int i = 0; i < NODES; i++) {
+      node_t *n = &nodes[i];
+      if (urnd() < 0.05)
+        continue; // Baliza perdida
+      double d = 30 + erand(60);
+      if (urnd() < 0.03)
+        d += 2000 + urnd() * 18000; // Reintento MAC, canal ocupado
+      int64_t rx = (int64_t)local_at(n, air + d);
+
+      bb_sync_beacon_t got;
+      CHECK(bb_sync_beacon_decode(wire, sizeof(wire), &got));
+      bb_sync_master(&n->s, mac, got.boot);
+      if (n->has_rx && got.prev_tx_us != 0 && n->rx_seq + 1 == got.seq)
+        bb_sync_sample(&n->s, mac, got.boot, n->rx_us, got.prev_tx_us);
+      n->rx_us = rx;
+      n->rx_seq = got.seq;
+      n->has_rx = true;
+    }
+    prev_tx = tx_done;
+    prev_ok = true;
+    seq++;
+
+    if ((long)(t / 1e6) % 5 != 0)
+      continue;
+
+    // Ráfaga en el siguiente hueco común: error contra el reloj del maestro
+    double slot_err[NODES];
+    bool ok[NODES];
+    for (int i = 0; i < NODES; i++) {
+      node_t *n = &nodes[i];
+      int64_t loc;
+      ok[i] = bb_sync_next_slot(&n->s, (int64_t)local_at(n, t), SLOT_US,
+                                50000, &loc);
+      if (!ok[i])
+        continue;
+      double m = n->tk + (loc - n->lk) / rate(n) - master0;
+      slot_err[i] = m - llround(m / SLOT_US) * (double)SLOT_US;
+      if (lock_t[i] < 0)
+        lock_t[i] = t;
+      if (rebooted && relock_t[i] < 0)
+        relock_t[i] = t - REBOOT_US;
+      big[i] += fabs(slot_err[i]) > 1000;
+      if (ne[i] < MAX_BURSTS)
+        errs[i][ne[i]++] = fabs(slot_err[i]);
+    }
+    if (ok[0] && ok[1] && nr < MAX_BURSTS)
+      rel[nr++] = fabs(slot_err[0] - slot_err[1]);
+  }
+
+  for (int i = 0; i < NODES; i++) {
+    const node_t *n = &nodes[i];
+    double real_ppm = -(n->ppm + n->wander) / rate(n);
+    double p99 = pct(errs[i], ne[i], 99);
+    printf("%s nodo %d: enganche %.0f s, tras reinicio %.0f s, |error| p99 "
+           "%.0f us, deriva %.2f ppm (real %.2f), %u reinicios\n",
+           step ? "salto" : "base ", i, lock_t[i] / 1e6, relock_t[i] / 1e6,
+           p99, n->s.drift_ppb / 1000.0, real_ppm, (unsigned)n->s.resets);
+
+    CHECK(lock_t[i] >= 0 && lock_t[i] <= 30e6);
+    CHECK(relock_t[i] >= 0 && relock_t[i] <= 30e6);
+    CHECK(p99 < 100);
+    CHECK(fabs(n->s.drift_ppb / 1000.0 - real_ppm) < 1.0);
+    CHECK(n->s.locked);
+    // El salto se nota en una ráfaga como mucho antes de rehacer la recta
+    CHECK_EQ(n->s.resets, step ? 2 : 1);
+    CHECK(big[i] <= (step ? 1 : 0));
+  }
+  double rel_p99 = pct(rel, nr, 99);
+  printf("%s entre nodos: p99 %.0f us en %d ráfagas\n",
+         step ? "salto" : "base ", rel_p99, nr);
+  CHECK(rel_p99 < 100);
+  CHECK(nr > 1300);
+}
+
+static void test_conversions(void) {
+  bb_sync_t s;
+  bb_sync_init(&s);
+  int64_t out;
+  CHECK(!bb_sync_to_master(&s, 1000, &out)); // Sin puntos no hay línea
+
+  // Maestro 1 s por delante y seguidor a +10 ppm
+  const uint8_t mac[6] = {9, 9, 9, 9, 9, 9};
+  bb_sync_master(&s, mac, 1);
+  for (int k = 0; k < 40 * BB_SYNC_BLOCK; k++) {
+    int64_t local = 5000000 + (int64_t)k * 1000000;
+    int64_t master = 1000000 + (int64_t)(local * (1.0 - 10e-6));
+    bb_sync_sample(&s, mac, 1, local, master);
+  }
+  CHECK(s.locked);
+  int64_t m, l;
+  CHECK(bb_sync_to_master(&s, 50000000, &m));
+  CHECK(bb_sync_to_local(&s, m, &l));
+  CHECK(llabs(l - 50000000) <= 1);
+  CHECK(llabs(m - (1000000 + (int64_t)(50000000 * (1.0 - 10e-6)))) < 20);
+
+  bb_sync_beacon_t b = {7, 8, 123456789012LL}, got;
+  uint8_t wire[BB_SYNC_BEACON_BYTES];
+  CHECK_EQ(bb_sync_beacon_encode(&b, wire, sizeof(wire) - 1), 0);
+  CHECK_EQ(bb_sync_beacon_encode(&b, wire, sizeof(wire)), sizeof(wire));
+  CHECK(!bb_sync_beacon_decode(wire, sizeof(wire) - 1, &got));
+  CHECK(bb_sync_beacon_decode(wire, sizeof(wire), &got));
+  CHECK(got.seq == 7 && got.boot == 8 && got.prev_tx_us == 123456789012LL);
+}
+
+int main(void) {
+  test_conversions();
+  simulate(false);
+  simulate(true);
+  BB_TEST_END();
+}
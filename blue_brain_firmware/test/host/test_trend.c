@@ -0,0 +1,334 @@
+/**
+ * @file test_trend.c
+ * @brief bb_trend: consultas por rango contra una búsqueda exhaustiva
+ *
+ * Una copia en RAM de lo que debe haber en la serie (hora y valor por
+ * secuencia) hace de referencia: tras huecos de tiempo, horas repetidas,
+ * vueltas del fichero y reinicios, cada rango al azar debe dar los mismos
+ * registros, y el diezmado uno de cada ceil(matched / max_points). También
+ * cortes a media escritura, ranuras dañadas y la partición llena.
+ */
+
+#include "bb_test.h"
+#include "bb_trend.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "trend.bin"
+#define DATA 20 // Como bb_telemetry_trend_point: ranuras de 32 B
+#define POINT (4 + DATA)
+#define STRIDE (12 + DATA)
+#define HDR 32
+
+static bb_trend_t s_t;
+static uint8_t s_out[600 * POINT];
+
+static uint64_t s_rng = 88172645463325252ULL;
+
+static uint32_t rnd(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 7;
+  s_rng ^= s_rng << 17;
+  return (uint32_t)s_rng;
+}
+
+static void rec(uint32_t v, uint8_t *d) {
+  memset(d, (int)(v & 0xFF), DATA);
+  memcpy(d, &v, 4);
+}
+
+static uint32_t pt_t(uint32_t i) {
+  uint32_t v;
+  memcpy(&v, s_out + i * POINT, 4);
+  return v;
+}
+
+static uint32_t pt_v(uint32_t i) {
+  uint32_t v;
+  memcpy(&v, s_out + i * POINT + 4, 4);
+  return v;
+}
+
+static long file_size(void) {
+  FILE *f = fopen(PATH, "rb");
+  if (f == NULL)
+    return -1;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+static void corrupt_slot(uint32_t slot) {
+  FILE *f = fopen(PATH, "r+b");
+  CHECK(f != NULL);
+  if (f == NULL)
+    return;
+  fseek(f, HDR + (long)slot * STRIDE + 10, SEEK_SET);
+  fputc(0x55, f);
+  fclose(f);
+}
+
+static void test_basic(void) {
+  uint8_t d[DATA];
+  uint32_t n, m;
+  bb_trend_stats_t st;
+
+  remove(PATH);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 20), ESP_ERR_INVALID_ARG);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 100), ESP_OK); // -> 96
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.capacity, 96);
+  CHECK_EQ(st.count, 0);
+
+  for (uint32_t i = 0; i < 50; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, 1000 + 10 * i, d), ESP_OK);
+  }
+  bb_trend_get_stats(&s_t, &st);
+  CHECK(st.count == 50 && st.oldest_t == 1000 && st.newest_t == 1490);
+  CHECK_EQ(file_size(), HDR + 48 * STRIDE); // Los 2 últimos, aún en RAM
+
+  // Los extremos entre dos registros no cuentan; en uno, sí
+  CHECK_EQ(bb_trend_query(&s_t, 1095, 1200, 100, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 11 && m == 11 && pt_t(0) == 1100 && pt_v(10) == 20);
+  CHECK_EQ(bb_trend_query(&s_t, 1200, 1100, 100, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 0 && m == 0);
+  // max_points se limita a lo que cabe en out
+  CHECK_EQ(bb_trend_query(&s_t, 0, UINT32_MAX, 100, s_out, 5 * POINT, &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 5 && m == 50 && pt_v(1) == 10);
+  // Los que esperan en RAM salen en la consulta, que no los escribe
+  CHECK_EQ(bb_trend_query(&s_t, 1475, UINT32_MAX, 100, s_out, sizeof(s_out),
+                          &n, &m),
+           ESP_OK);
+  CHECK(n == 2 && pt_t(0) == 1480 && pt_v(0) == 48 && pt_v(1) == 49);
+  CHECK_EQ(file_size(), HDR + 48 * STRIDE);
+
+  // Reinicio: los 5 registros aún en RAM se pierden
+  for (uint32_t i = 50; i < 53; i++) {
+    rec(i, d);
+    bb_trend_append(&s_t, 1000 + 10 * i, d);
+  }
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 100), ESP_OK);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK(st.count == 48 && st.newest_t == 1470);
+
+  // La hora no baja: se guarda con la del último
+  rec(999, d);
+  bb_trend_append(&s_t, 500, d);
+  bb_trend_flush(&s_t);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.newest_t, 1470);
+  CHECK_EQ(bb_trend_query(&s_t, 1470, 1470, 10, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(m == 2 && pt_v(1) == 999);
+
+  // Otro formato: se descarta
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 2, DATA, 100), ESP_OK);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.count, 0);
+}
+
+static void test_wrap_and_damage(void) {
+  uint8_t d[DATA];
+  uint32_t n, m;
+  bb_trend_stats_t st;
+
+  remove(PATH);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 96), ESP_OK);
+  for (uint32_t i = 0; i < 300; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, 1000 + 10 * i, d), ESP_OK);
+  }
+  bb_trend_flush(&s_t);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK(st.count == 96 && st.oldest_t == 1000 + 10 * 204 &&
+        st.newest_t == 3990);
+
+  // Registros sobrescritos ya no salen
+  CHECK_EQ(bb_trend_query(&s_t, 3000, 3500, 1000, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(m == 47 && n == 47 && pt_t(0) == 3040 && pt_v(0) == 204);
+  for (uint32_t i = 0; i < n; i++)
+    CHECK_EQ(pt_v(i), 204 + i);
+
+  // El bloque más nuevo a medio escribir (seq 296..299, ranuras 8..11): al
+  // abrir se salta y el siguiente append lo sobrescribe
+  corrupt_slot(299 % 96);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 96), ESP_OK);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.newest_t, 3980);
+  rec(777, d);
+  bb_trend_append(&s_t, 4000, d);
+  CHECK_EQ(bb_trend_query(&s_t, 3970, 4000, 10, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 3 && pt_v(2) == 777);
+
+  // Una ranura dañada en medio: cuenta en matched, no sale en el resultado
+  corrupt_slot(250 % 96);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 96), ESP_OK);
+  CHECK_EQ(bb_trend_query(&s_t, 3480, 3520, 100, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 4 && m == 5);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.corrupt, 1);
+}
+
+// --- Referencia exhaustiva ---
+
+#define CAP 4320 // BB_TREND_MAX_RECORDS
+#define TOTAL 20000
+#define UNFLUSHED 5 // Añadidos justo antes del reinicio
+
+static uint32_t s_ts[TOTAL + UNFLUSHED];
+
+// Registros en la serie: las secuencias lo..hi-1
+static void check_queries(uint32_t lo, uint32_t hi, int queries) {
+  uint32_t span = s_ts[hi - 1] - s_ts[lo] + 100;
+  int bad = 0;
+  for (int q = 0; q < queries; q++) {
+    uint32_t from = s_ts[lo] - 50 + rnd() % span;
+    uint32_t to = from + rnd() % (q % 4 == 0 ? span : 3000);
+    uint32_t max = 1 + rnd() % 600;
+    if (q % 5 == 0)
+      max = 100000; // Sin diezmado (lo limita el tamaño de out)
+
+    uint32_t first = hi, end = hi;
+    for (uint32_t s = lo; s < hi; s++) {
+      if (first == hi && s_ts[s] >= from)
+        first = s;
+      if (s_ts[s] > to) {
+        end = s;
+        break;
+      }
+    }
+    if (first > end)
+      first = end;
+    uint32_t matched = end - first;
+    uint32_t fit = sizeof(s_out) / POINT;
+    uint32_t lim = (max > fit) ? fit : max;
+    uint32_t step = (matched + lim - 1) / lim;
+
+    uint32_t n, m;
+    CHECK_EQ(bb_trend_query(&s_t, from, to, max, s_out, sizeof(s_out), &n,
+                            &m),
+             ESP_OK);
+    uint32_t want = step ? (matched + step - 1) / step : 0;
+    bool ok = m == matched && n == want;
+    for (uint32_t k = 0; ok && k < n; k++)
+      ok = pt_t(k) == s_ts[first + k * step] && pt_v(k) == first + k * step;
+    if (!ok && bad++ < 5)
+      printf("rango %" PRIu32 "..%" PRIu32 " max %" PRIu32 ": matched %" PRIu32
+             "/%" PRIu32 ", n %" PRIu32 "/%" PRIu32 "\n",
+             from, to, max, m, matched, n, want);
+  }
+  CHECK_EQ(bad, 0);
+}
+
+static void test_random_ranges(void) {
+  uint8_t d[DATA];
+  bb_trend_stats_t st;
+
+  // Huecos (sin hora, nodo apagado) y horas repetidas
+  uint32_t t = 1760000000;
+  for (uint32_t i = 0; i < TOTAL + UNFLUSHED; i++) {
+    uint32_t r = rnd() % 100;
+    t += (r < 20) ? 0 : (r < 97) ? 1 + rnd() % 20 : 600 + rnd() % 7200;
+    s_ts[i] = t;
+  }
+
+  remove(PATH);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, CAP), ESP_OK);
+  for (uint32_t i = 0; i < CAP / 2; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, s_ts[i], d), ESP_OK);
+  }
+  check_queries(0, CAP / 2, 300); // Primera vuelta, sin llenar
+
+  for (uint32_t i = CAP / 2; i < TOTAL; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, s_ts[i], d), ESP_OK);
+  }
+  check_queries(TOTAL - CAP, TOTAL, 300);
+
+  // Los que esperan en RAM ocupan ranuras que en flash aún tienen los de
+  // la vuelta anterior: la consulta da los nuevos
+  for (uint32_t i = TOTAL; i < TOTAL + UNFLUSHED; i++) {
+    rec(i, d);
+    bb_trend_append(&s_t, s_ts[i], d);
+  }
+  check_queries(TOTAL + UNFLUSHED - CAP, TOTAL + UNFLUSHED, 300);
+
+  // Reinicio sin flush: se pierde lo que estaba en RAM
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, CAP), ESP_OK);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK_EQ(st.count, CAP);
+  CHECK_EQ(st.newest_t, s_ts[TOTAL - 1]);
+  CHECK_EQ(st.oldest_t, s_ts[TOTAL - CAP]);
+  check_queries(TOTAL - CAP, TOTAL, 300);
+}
+
+// Partición llena: el fichero no crece, pero al dar la vuelta sí escribe
+static void test_no_space(void) {
+  uint8_t d[DATA];
+  bb_trend_stats_t st;
+  uint32_t n, m;
+
+  remove(PATH);
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 64), ESP_OK);
+  for (uint32_t i = 0; i < 16; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, 100 + i, d), ESP_OK);
+  }
+  bb_host_spiffs_free = BB_TREND_FLUSH_RECORDS * STRIDE - 1;
+  esp_err_t last = ESP_OK;
+  for (uint32_t i = 16; i < 24; i++) {
+    rec(i, d);
+    last = bb_trend_append(&s_t, 100 + i, d);
+  }
+  CHECK_EQ(last, ESP_ERR_NO_MEM);
+  bb_trend_get_stats(&s_t, &st);
+  CHECK(st.count == 16 && st.no_space == 1);
+
+  // Con hueco el bloque descartado se rehace con las mismas secuencias
+  bb_host_spiffs_free = BB_TREND_FLUSH_RECORDS * STRIDE;
+  for (uint32_t i = 16; i < 64; i++) {
+    rec(i, d);
+    if (i == 24)
+      bb_host_spiffs_free = SIZE_MAX;
+    CHECK_EQ(bb_trend_append(&s_t, 200 + i, d), ESP_OK);
+  }
+  bb_host_spiffs_free = 0;
+  for (uint32_t i = 64; i < 80; i++) {
+    rec(i, d);
+    CHECK_EQ(bb_trend_append(&s_t, 200 + i, d), ESP_OK);
+  }
+  bb_host_spiffs_free = SIZE_MAX;
+  CHECK_EQ(bb_trend_init(&s_t, PATH, 1, DATA, 64), ESP_OK);
+  CHECK_EQ(bb_trend_query(&s_t, 0, UINT32_MAX, 100, s_out, sizeof(s_out), &n,
+                          &m),
+           ESP_OK);
+  CHECK(n == 64 && pt_v(0) == 16 && pt_v(63) == 79);
+}
+
+int main(void) {
+  test_basic();
+  test_wrap_and_damage();
+  test_random_ranges();
+  test_no_space();
+  BB_TEST_END();
+}
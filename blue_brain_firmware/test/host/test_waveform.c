@@ -0,0 +1,428 @@
+/**
+ * @file test_waveform.c
+ * @brief bb_waveform + bb_wave_codec: subida por trozos contra un broker de
+ * pega y reensamblado byte a byte
+ *
+ * El broker guarda cada publicación por topic (como un suscriptor a
+ * .../wave/#), rechaza una parte al azar y vacía su outbox QoS 1 a ritmo
+ * fijo. El reensamblador hace lo que tools/bb_wave_reassemble.py: lee el
+ * manifiesto, comprueba el CRC de cada trozo, decodifica los bloques WZ y
+ * compara las muestras con el CRC total y con la trama original.
+ */
+
+#include "bb_test.h"
+#include "bb_wave_codec.h"
+#include "bb_waveform.h"
+#include "esp_rom_crc.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BOOT_ID 7
+
+static int64_t g_now;
+int64_t esp_timer_get_time(void) { return g_now; }
+uint32_t bb_storage_boot_id(void) { return BOOT_ID; }
+
+// --- Broker de pega ---
+
+#define MAX_MSGS 256
+
+typedef struct {
+  char topic[64];
+  uint8_t *data;
+  int len;
+} msg_t;
+
+static struct {
+  bool online;
+  int flaky_pct;
+  double drain_bps; // Vaciado del outbox QoS 1
+  double outbox;
+  int64_t outbox_t;
+  msg_t msgs[MAX_MSGS];
+  int n_msgs;
+  int rejected;
+} s_broker;
+
+static void broker_reset(bool online, int flaky_pct, double drain_bps) {
+  for (int i = 0; i < s_broker.n_msgs; i++)
+    free(s_broker.msgs[i].data);
+  memset(&s_broker, 0, sizeof(s_broker));
+  s_broker.online = online;
+  s_broker.flaky_pct = flaky_pct;
+  s_broker.drain_bps = drain_bps;
+  s_broker.outbox_t = g_now;
+}
+
+static void broker_drain(void) {
+  s_broker.outbox -= (g_now - s_broker.outbox_t) * s_broker.drain_bps / 1e6;
+  if (s_broker.outbox < 0)
+    s_broker.outbox = 0;
+  s_broker.outbox_t = g_now;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client) {
+  broker_drain();
+  return (int)s_broker.outbox;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                            const char *data, int len, int qos, int retain) {
+  if (!s_broker.online || rand() % 100 < s_broker.flaky_pct) {
+    s_broker.rejected++;
+    return -1;
+  }
+  broker_drain();
+  s_broker.outbox += len;
+  CHECK(s_broker.n_msgs < MAX_MSGS);
+  msg_t *m = &s_broker.msgs[s_broker.n_msgs++];
+  snprintf(m->topic, sizeof(m->topic), "%s", topic);
+  m->data = malloc((size_t)len + 1);
+  memcpy(m->data, data, (size_t)len);
+  m->data[len] = '\0';
+  m->len = len;
+  return s_broker.n_msgs;
+}
+
+// Último mensaje con ese topic (un reintento del cliente lo repetiría)
+static const msg_t *broker_find(uint32_t id, const char *leaf) {
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%d/%lu/%s", BB_MQTT_TOPIC_WAVE, BOOT_ID,
+           (unsigned long)id, leaf);
+  for (int i = s_broker.n_msgs - 1; i >= 0; i--) {
+    if (strcmp(s_broker.msgs[i].topic, topic) == 0)
+      return &s_broker.msgs[i];
+  }
+  return NULL;
+}
+
+// --- Decodificador WZ (espejo de bb_wave_codec.c) ---
+
+typedef struct {
+  const uint8_t *p;
+  size_t bits, pos;
+  bool err;
+} wz_reader_t;
+
+static uint32_t get_bits(wz_reader_t *r, int n) {
+  uint32_t v = 0;
+  while (n-- > 0) {
+    if (r->pos >= r->bits) {
+      r->err = true;
+      return 0;
+    }
+    v = (v << 1) | ((r->p[r->pos >> 3] >> (7 - (r->pos & 7))) & 1u);
+    r->pos++;
+  }
+  return v;
+}
+
+static uint32_t wz_abs(int32_t v) { return (uint32_t)(v < 0 ? -v : v); }
+
+// Bytes crudos escritos en raw, o -1 si el bloque no es válido
+static int wz_decode(const uint8_t *z, size_t zlen, uint8_t *raw, size_t cap) {
+  if (zlen < BB_WZ_HEADER_BYTES || z[0] != BB_WZ_MAGIC0 ||
+      z[1] != BB_WZ_MAGIC1 || z[2] != BB_WZ_VERSION || z[4] < 1 ||
+      z[4] > BB_WZ_MAX_AXES) {
+    return -1;
+  }
+  int n_axes = z[4];
+  int n_samples = z[6] | (z[7] << 8);
+  size_t raw_bytes = (size_t)n_samples * n_axes * 2;
+  if (raw_bytes > cap)
+    return -1;
+  if (z[3] == BB_WZ_MODE_STORED) {
+    if (zlen != BB_WZ_HEADER_BYTES + raw_bytes)
+      return -1;
+    memcpy(raw, z + BB_WZ_HEADER_BYTES, raw_bytes);
+    return (int)raw_bytes;
+  }
+
+  struct {
+    int32_t h0, h1, h2;
+    uint32_t cost[3];
+    uint32_t a, n;
+  } ch[BB_WZ_MAX_AXES] = {0};
+  for (int a = 0; a < n_axes; a++) {
+    ch[a].a = 32;
+    ch[a].n = 1;
+  }
+
+  wz_reader_t r = {.p = z + BB_WZ_HEADER_BYTES,
+                   .bits = (zlen - BB_WZ_HEADER_BYTES) * 8};
+  uint8_t *p = raw;
+  for (int i = 0; i < n_samples; i++) {
+    for (int a = 0; a < n_axes; a++, p += 2) {
+      typeof(&ch[0]) c = &ch[a];
+      int k = 0;
+      while (k < 16 && (c->n << k) < c->a)
+        k++;
+      uint32_t q = 0;
+      while (q < 24 && get_bits(&r, 1))
+        q++;
+      uint32_t u = (q < 24) ? (q << k) | get_bits(&r, k) : get_bits(&r, 20);
+      int32_t e = (int32_t)(u >> 1) ^ -(int32_t)(u & 1u);
+
+      int32_t x = e;
+      if (i > 0) {
+        int best = 0;
+        int max_o = (i - 2 < 2) ? i - 2 : 2;
+        for (int o = 1; o <= max_o; o++) {
+          if (c->cost[o] < c->cost[best])
+            best = o;
+        }
+        int32_t pred = (best == 0)   ? c->h0
+                       : (best == 1) ? 2 * c->h0 - c->h1
+                                     : 3 * c->h0 - 3 * c->h1 + c->h2;
+        x = e + pred;
+      }
+      int32_t e1 = x - c->h0;
+      int32_t e2 = e1 - (c->h0 - c->h1);
+      int32_t e3 = e2 - (c->h0 - 2 * c->h1 + c->h2);
+
+      c->a += wz_abs(e);
+      if (++c->n >= 32) {
+        c->a = (c->a + 1) >> 1;
+        c->n >>= 1;
+      }
+      if (i >= 1)
+        c->cost[0] += wz_abs(e1) - (c->cost[0] >> 4);
+      for (int o = 1; o < 3 && i >= o + 1; o++) {
+        if (i == o + 1)
+          c->cost[o] = c->cost[o - 1];
+        c->cost[o] += wz_abs(o == 1 ? e2 : e3) - (c->cost[o] >> 4);
+      }
+      c->h2 = c->h1;
+      c->h1 = c->h0;
+      c->h0 = x;
+      p[0] = (uint8_t)((uint16_t)x >> 8);
+      p[1] = (uint8_t)x;
+    }
+  }
+  return r.err ? -1 : (int)raw_bytes;
+}
+
+static void test_codec(void) {
+  enum { N = 256, AXES = 6 };
+  static uint8_t raw[N * AXES * 2], back[N * AXES * 2];
+  static uint8_t z[BB_WZ_MAX_BYTES(N, AXES)];
+
+  CHECK_EQ(bb_wz_encode(raw, N, 0, z, sizeof(z)), -1);
+  CHECK_EQ(bb_wz_encode(raw, N, AXES, z, sizeof(z) - 1), -1);
+
+  // Vibración típica (senoidal + ruido de pocos LSB): comprime
+  for (int i = 0; i < N * AXES; i++) {
+    int16_t v = (int16_t)(4000 * sin(i / AXES * 0.07 + i % AXES) +
+                          rand() % 17 - 8);
+    raw[2 * i] = (uint8_t)((uint16_t)v >> 8);
+    raw[2 * i + 1] = (uint8_t)v;
+  }
+  int zlen = bb_wz_encode(raw, N, AXES, z, sizeof(z));
+  CHECK(zlen > 0 && z[3] == BB_WZ_MODE_RICE);
+  CHECK(zlen * 3 < (int)sizeof(raw) * 2);
+  CHECK_EQ(wz_decode(z, (size_t)zlen, back, sizeof(back)), sizeof(raw));
+  CHECK(memcmp(raw, back, sizeof(raw)) == 0);
+
+  // Saltos de fondo de escala: fuerzan el escape de 20 bits
+  for (int i = 0; i < N * AXES; i++) {
+    int16_t v = (i / AXES) % 7 == 3 ? (i & 1 ? 32767 : -32768) : (int16_t)i;
+    raw[2 * i] = (uint8_t)((uint16_t)v >> 8);
+    raw[2 * i + 1] = (uint8_t)v;
+  }
+  zlen = bb_wz_encode(raw, N, AXES, z, sizeof(z));
+  CHECK_EQ(wz_decode(z, (size_t)zlen, back, sizeof(back)), sizeof(raw));
+  CHECK(memcmp(raw, back, sizeof(raw)) == 0);
+
+  // Ruido blanco a fondo de escala: va tal cual
+  for (size_t i = 0; i < sizeof(raw); i++)
+    raw[i] = (uint8_t)rand();
+  zlen = bb_wz_encode(raw, N, AXES, z, sizeof(z));
+  CHECK_EQ(zlen, BB_WZ_MAX_BYTES(N, AXES));
+  CHECK_EQ(z[3], BB_WZ_MODE_STORED);
+  CHECK_EQ(wz_decode(z, (size_t)zlen, back, sizeof(back)), sizeof(raw));
+  CHECK(memcmp(raw, back, sizeof(raw)) == 0);
+}
+
+// --- Tramas del pool (refcount) ---
+
+typedef struct {
+  uint8_t raw[BB_MAX_IMUS][BB_N_SAMPLES * 6];
+  int refs;
+} frame_t;
+
+static frame_t s_frames[2];
+
+static void frame_retain(void *o) { ((frame_t *)o)->refs++; }
+static void frame_release(void *o) { ((frame_t *)o)->refs--; }
+
+static bb_wave_src_t frame_src(frame_t *f, int sample_bytes, int64_t t0) {
+  bb_wave_src_t src = {
+      .n_imus = BB_MAX_IMUS,
+      .sample_bytes = (uint8_t)sample_bytes,
+      .n_samples = (uint16_t)(sizeof(f->raw[0]) / sample_bytes),
+      .t_first_us = t0,
+      .fs_hz = 4000.0f,
+      .accel_lsb_per_g = 16384.0f,
+      .gyro_lsb_per_dps = 131.0f,
+      .owner = f,
+      .retain = frame_retain,
+      .release = frame_release,
+  };
+  for (int k = 0; k < BB_MAX_IMUS; k++)
+    src.raw[k] = f->raw[k];
+  f->refs = 1; // La del pipeline
+  for (int k = 0; k < BB_MAX_IMUS; k++) {
+    for (int i = 0; i < src.n_samples * sample_bytes / 2; i++) {
+      int16_t v = (int16_t)(3000 * sin(i * 0.05 + k) + rand() % 33 - 16);
+      f->raw[k][2 * i] = (uint8_t)((uint16_t)v >> 8);
+      f->raw[k][2 * i + 1] = (uint8_t)v;
+    }
+  }
+  return src;
+}
+
+// Llama a bb_wave_poll cuando pide hasta que termina; devuelve la duración
+static int64_t run_upload(void) {
+  int64_t t0 = g_now;
+  for (;;) {
+    int64_t wait = bb_wave_poll((esp_mqtt_client_handle_t)1, s_broker.online,
+                                g_now);
+    if (wait == INT64_MAX)
+      return g_now - t0;
+    g_now += wait;
+  }
+}
+
+static long json_num(const char *json, const char *key) {
+  char k[32];
+  snprintf(k, sizeof(k), "\"%s\":", key);
+  const char *p = strstr(json, k);
+  return p ? strtol(p + strlen(k), NULL, 10) : -1;
+}
+
+// Reensambla la subida 'id' y la compara con la trama
+static void check_upload(uint32_t id, const bb_wave_src_t *src, bool wz) {
+  const msg_t *m = broker_find(id, "m");
+  CHECK(m != NULL);
+  if (m == NULL)
+    return;
+  const char *json = (const char *)m->data;
+  CHECK(strstr(json, wz ? "\"codec\":\"wz1\"" : "\"codec\":\"raw\"") != NULL);
+  CHECK_EQ(json_num(json, "n_samples"), src->n_samples);
+  CHECK_EQ(json_num(json, "sample_bytes"), src->sample_bytes);
+
+  long n_chunks = json_num(json, "n_chunks");
+  long per_imu = json_num(json, "chunks_per_imu");
+  CHECK(n_chunks == per_imu * src->n_imus && n_chunks > 0);
+  const char *crc = strstr(json, "\"crc\":[") + 7;
+
+  static uint8_t imu[BB_MAX_IMUS][BB_N_SAMPLES * 6];
+  size_t fill[BB_MAX_IMUS] = {0};
+  uint32_t total_crc = 0;
+  for (long n = 0; n < n_chunks; n++) {
+    char leaf[24];
+    snprintf(leaf, sizeof(leaf), "%ld", n);
+    const msg_t *c = broker_find(id, leaf);
+    uint32_t want = (uint32_t)strtoul(crc, (char **)&crc, 10);
+    crc++; // ','
+    CHECK(c != NULL);
+    if (c == NULL)
+      continue;
+    CHECK_EQ(esp_rom_crc32_le(0, c->data, (uint32_t)c->len), want);
+
+    int k = (int)(n / per_imu);
+    uint8_t *dst = imu[k] + fill[k];
+    size_t room = sizeof(imu[k]) - fill[k];
+    int len = c->len;
+    if (wz) {
+      len = wz_decode(c->data, (size_t)c->len, dst, room);
+      CHECK(len > 0);
+    } else {
+      CHECK((size_t)len <= room);
+      memcpy(dst, c->data, (size_t)len);
+    }
+    if (len > 0)
+      fill[k] += (size_t)len;
+  }
+
+  size_t imu_bytes = (size_t)src->n_samples * src->sample_bytes;
+  for (int k = 0; k < src->n_imus; k++) {
+    CHECK_EQ(fill[k], imu_bytes);
+    CHECK(memcmp(imu[k], src->raw[k], imu_bytes) == 0);
+    total_crc = esp_rom_crc32_le(total_crc, imu[k], (uint32_t)imu_bytes);
+  }
+  CHECK_EQ(total_crc, (uint32_t)strtoul(strstr(json, "\"crc32\":") + 8,
+                                        NULL, 10));
+}
+
+static void test_last_raw(void) {
+  broker_reset(true, 10, 20e3);
+  bb_wave_src_t src = frame_src(&s_frames[0], 6, g_now);
+
+  bb_wave_frame_done(&src, true);
+  CHECK_EQ(s_frames[0].refs, 2); // Pipeline + "última"
+  CHECK(!bb_wave_command("peak", 4));
+  CHECK(bb_wave_command("last\n", 5));
+  CHECK(!bb_wave_command("next", 4)); // Ya hay una en curso
+
+  int64_t us = run_upload();
+  check_upload(1, &src, false);
+  CHECK(s_broker.rejected > 0);
+  CHECK_EQ(s_frames[0].refs, 1);
+  printf("last: %d mensajes, %d rechazados, %lld ms\n", s_broker.n_msgs,
+         s_broker.rejected, (long long)(us / 1000));
+}
+
+static void test_next_wz(void) {
+  broker_reset(true, 10, 8e3); // Outbox lento: manda el control de flujo
+  g_now += 1000000;
+  CHECK(bb_wave_command("next z", 6));
+
+  // Empezó antes de la petición: no vale
+  bb_wave_src_t old = frame_src(&s_frames[0], 12, g_now - 1000);
+  bb_wave_frame_done(&old, false);
+  CHECK_EQ(s_frames[0].refs, 1);
+  CHECK_EQ(bb_wave_poll((esp_mqtt_client_handle_t)1, true, g_now), INT64_MAX);
+
+  g_now += 500000;
+  bb_wave_src_t src = frame_src(&s_frames[1], 12, g_now);
+  bb_wave_frame_done(&src, false);
+  CHECK_EQ(s_frames[1].refs, 2);
+
+  int64_t us = run_upload();
+  check_upload(2, &src, true);
+  CHECK_EQ(s_frames[1].refs, 1);
+
+  long zbytes = json_num((const char *)broker_find(2, "m")->data, "zbytes");
+  long bytes = json_num((const char *)broker_find(2, "m")->data, "bytes");
+  CHECK(zbytes > 0 && zbytes * 3 < bytes * 2);
+  printf("next z: %ld -> %ld B, %d rechazados, %lld ms\n", bytes, zbytes,
+         s_broker.rejected, (long long)(us / 1000));
+}
+
+static void test_outage(void) {
+  broker_reset(false, 0, 20e3);
+  bb_wave_src_t src = frame_src(&s_frames[0], 6, g_now);
+  bb_wave_frame_done(&src, true);
+  CHECK(bb_wave_command("last", 4));
+
+  // Sin broker la trama sigue retenida hasta el timeout y luego se suelta
+  int64_t us = run_upload();
+  CHECK(us > BB_WAVE_TIMEOUT_MS * 1000LL);
+  CHECK_EQ(s_broker.n_msgs, 0);
+  CHECK_EQ(s_frames[0].refs, 1);
+  CHECK(bb_wave_command("next", 4)); // Libre otra vez
+}
+
+int main(void) {
+  srand(1);
+  test_codec();
+  test_last_raw();
+  test_next_wz();
+  test_outage();
+  broker_reset(false, 0, 0);
+  BB_TEST_END();
+}
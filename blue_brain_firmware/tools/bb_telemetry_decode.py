@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+"""Decodificador de la telemetría binaria de Blue Brain (bb_telemetry_codec.h).
+
+Uso:
+    python bb_telemetry_decode.py reporte.bin [...]     # ficheros binarios
+    mosquitto_sub -t hcaa/plcs/bluebrain/telemetry/bin -F %x | \
+        python bb_telemetry_decode.py --hex             # un payload hex por línea
+    mosquitto_sub -t hcaa/plcs/bluebrain/telemetry/bin -F %x | \
+        python bb_telemetry_decode.py --hex --check     # pérdidas/duplicados
+
+Imprime cada reporte como JSON (una línea), con las 15 bandas FFT incluidas.
+Los lotes ('B' 'K') se expanden en un reporte por línea, y las respuestas de
+tendencias ('B' 'R', topic .../node/<id>/trend o /api/v1/trend) y de
+agregados por minuto/hora/día ('B' 'U', mismo topic con "res") en un punto
+por línea.
+
+--check cuenta por arranque los números de secuencia recibidos y, al cerrar
+la entrada, informa de huecos, duplicados y reportes fuera de orden (para
+verificar el store-and-forward contra un broker local). Los huecos que
+declara "rbe_skip" (omitidos a propósito por RBE) no cuentan como pérdidas.
+Acepta también líneas JSON del topic de texto (-F %p).
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b"BT"
+BATCH_MAGIC = b"BK"
+TREND_MAGIC = b"BR"
+ROLLUP_MAGIC = b"BU"
+VERSION = 1
+HEADER = struct.Struct("<2sBBH")
+BATCH_HEADER = struct.Struct("<2sBB")
+TREND_HEADER = struct.Struct("<2sBBHI")
+ROLLUP_HEADER = struct.Struct("<2sBBBxHI")
+
+F_P2 = 0x01
+F_GYRO = 0x02
+F_CAL = 0x04
+F_QUALITY = 0x08
+F_SEQ = 0x10
+F_RBE = 0x20
+F_LINK = 0x40
+F_TIME = 0x80
+
+X_SYNC = 0x01  # Extensión tras las temperaturas
+
+CORE = struct.Struct("<qqI12f15fbB")
+P2 = struct.Struct("<6f")
+GYRO = struct.Struct("<Bff")
+QUALITY = struct.Struct("<4H")
+SEQ = struct.Struct("<II")
+LINK = struct.Struct("<bHHH")
+TIME = struct.Struct("<qB")
+TIME_SOURCES = ("none", "sntp", "manual")
+TEMP = struct.Struct("<Qf")
+SYNC = struct.Struct("<qH")
+TREND_POINT = struct.Struct("<I6Hh2HbB")
+# Agregados: t + por métrica n, min, max, media, rms (bb_rollup.h)
+ROLLUP_POINT = struct.Struct("<I15HH4h")
+ROLLUP_LEVELS = ("min", "hour", "day")
+ROLLUP_METRICS = (("rms", 1000), ("peak", 1000), ("p2_rms", 1000),
+                  ("temp", 100))
+
+CORE_FIELDS = ("rms", "peak", "p2p", "crest", "dom_freq", "band_lo",
+               "band_hi", "fs", "jitter_us", "temp", "batt", "ai_conf")
+
+
+def decode(payload):
+    """Devuelve un dict con el reporte; lanza ValueError si no es válido."""
+    if len(payload) < HEADER.size:
+        raise ValueError("payload corto: %d bytes" % len(payload))
+    magic, version, flags, body_len = HEADER.unpack_from(payload, 0)
+    if magic != MAGIC:
+        raise ValueError("magic incorrecto: %r" % magic)
+    if version > VERSION:
+        raise ValueError("versión %d no soportada (máx %d)" % (version, VERSION))
+    if len(payload) < HEADER.size + body_len:
+        raise ValueError("cuerpo truncado: %d < %d" %
+                         (len(payload) - HEADER.size, body_len))
+
+    off = HEADER.size
+    core = CORE.unpack_from(payload, off)
+    off += CORE.size
+
+    out = {"version": version, "t0_us": core[0], "t1_us": core[1],
+           "boot_ms": core[2]}
+    out.update(zip(CORE_FIELDS, core[3:15]))
+    out["fft_bands_low"] = list(core[15:20])
+    out["fft_bands_mid"] = list(core[20:25])
+    out["fft_bands_high"] = list(core[25:30])
+    out["ai_class"] = core[30]
+    out["quality"] = core[31]
+    out["cal"] = 1 if flags & F_CAL else 0
+
+    if flags & F_P2:
+        rms, peak, crest, dom, coh, phase = P2.unpack_from(payload, off)
+        off += P2.size
+        out["p2"] = {"rms": rms, "peak": peak, "crest": crest,
+                     "dom_freq": dom}
+        out["coh"] = coh
+        out["phase"] = phase
+    if flags & F_GYRO:
+        axis, rms, dom = GYRO.unpack_from(payload, off)
+        off += GYRO.size
+        out["gyro"] = {"rms": rms, "dom_freq": dom, "axis": "xyz"[axis % 3]}
+    if flags & F_QUALITY:
+        fail, clip, stuck, gaps = QUALITY.unpack_from(payload, off)
+        off += QUALITY.size
+        out["q"] = {"fail": fail, "clip": clip, "stuck": stuck, "gaps": gaps}
+    if flags & F_SEQ:
+        out["boot"], out["seq"] = SEQ.unpack_from(payload, off)
+        off += SEQ.size
+    if flags & F_RBE:
+        (out["rbe_skip"],) = struct.unpack_from("<H", payload, off)
+        off += 2
+    if flags & F_LINK:
+        rssi, reconn, conn_ms, up = LINK.unpack_from(payload, off)
+        off += LINK.size
+        out["link"] = {"rssi": rssi, "reconn": reconn, "conn_ms": conn_ms,
+                       "up": up / 1000.0}
+    if flags & F_TIME:
+        t_unix_us, src = TIME.unpack_from(payload, off)
+        off += TIME.size
+        out["ts"] = t_unix_us // 1000  # ms, como el JSON
+        out["ts_us"] = t_unix_us
+        out["ts_src"] = (TIME_SOURCES[src] if src < len(TIME_SOURCES)
+                         else str(src))
+
+    (count,) = struct.unpack_from("<B", payload, off)
+    off += 1
+    temps = []
+    for _ in range(count):
+        rom, c = TEMP.unpack_from(payload, off)
+        off += TEMP.size
+        temps.append({"rom": "%016X" % rom, "c": c})
+    out["temps"] = temps
+
+    end = HEADER.size + body_len
+    if off < end:
+        (ext,) = struct.unpack_from("<B", payload, off)
+        off += 1
+        if ext & X_SYNC:
+            out["sync_us"], out["sync_err_us"] = SYNC.unpack_from(payload, off)
+            off += SYNC.size
+    # Bytes restantes del cuerpo: campos de versiones compatibles, se ignoran
+    return out
+
+
+def decode_trend(payload):
+    """Lista de puntos de una respuesta de tendencias."""
+    if len(payload) < TREND_HEADER.size:
+        raise ValueError("tendencias cortas: %d bytes" % len(payload))
+    _, version, size, count, matched = TREND_HEADER.unpack_from(payload, 0)
+    if version > VERSION:
+        raise ValueError("versión %d no soportada (máx %d)" % (version, VERSION))
+    if size < TREND_POINT.size or (TREND_HEADER.size + count * size >
+                                   len(payload)):
+        raise ValueError("tendencias truncadas (%d puntos de %d B)" %
+                         (count, size))
+    points = []
+    for i in range(count):
+        (t, rms, peak, p2_rms, p2_peak, crest, dom, temp, gyro, batt, ai,
+         quality) = TREND_POINT.unpack_from(payload,
+                                            TREND_HEADER.size + i * size)
+        points.append({"t": t, "rms": rms / 1000, "peak": peak / 1000,
+                       "p2_rms": p2_rms / 1000, "p2_peak": p2_peak / 1000,
+                       "crest": crest / 100, "dom_freq": dom / 10,
+                       "temp": temp / 100, "gyro_rms": gyro / 100,
+                       "batt": batt / 1000, "ai_class": ai,
+                       "quality": quality})
+    return points
+
+
+def decode_rollup(payload):
+    """Lista de intervalos de una respuesta de agregados."""
+    if len(payload) < ROLLUP_HEADER.size:
+        raise ValueError("agregados cortos: %d bytes" % len(payload))
+    _, version, level, size, count, matched = ROLLUP_HEADER.unpack_from(
+        payload, 0)
+    if version > VERSION:
+        raise ValueError("versión %d no soportada (máx %d)" % (version, VERSION))
+    if (level >= len(ROLLUP_LEVELS) or size < ROLLUP_POINT.size or
+            ROLLUP_HEADER.size + count * size > len(payload)):
+        raise ValueError("agregados truncados (%d puntos de %d B)" %
+                         (count, size))
+    points = []
+    for i in range(count):
+        values = ROLLUP_POINT.unpack_from(payload,
+                                          ROLLUP_HEADER.size + i * size)
+        point = {"t": values[0], "res": ROLLUP_LEVELS[level]}
+        for m, (name, scale) in enumerate(ROLLUP_METRICS):
+            n, lo, hi, mean, rms = values[1 + 5 * m:6 + 5 * m]
+            if n:
+                point[name] = {"n": n, "min": lo / scale, "max": hi / scale,
+                               "mean": mean / scale, "rms": rms / scale}
+        points.append(point)
+    return points
+
+
+def decode_payload(payload):
+    """Lista de reportes de un payload MQTT (reporte suelto, lote,
+    tendencias o agregados)."""
+    if payload[:2] == TREND_MAGIC:
+        return decode_trend(payload)
+    if payload[:2] == ROLLUP_MAGIC:
+        return decode_rollup(payload)
+    if payload[:2] != BATCH_MAGIC:
+        return [decode(payload)]
+    if len(payload) < BATCH_HEADER.size:
+        raise ValueError("lote corto: %d bytes" % len(payload))
+    _, version, count = BATCH_HEADER.unpack_from(payload, 0)
+    if version > VERSION:
+        raise ValueError("versión %d no soportada (máx %d)" % (version, VERSION))
+    off = BATCH_HEADER.size
+    reports = []
+    for _ in range(count):
+        (length,) = struct.unpack_from("<H", payload, off)
+        off += 2
+        if off + length > len(payload):
+            raise ValueError("lote truncado en el reporte %d" % len(reports))
+        reports.append(decode(payload[off:off + length]))
+        off += length
+    return reports
+
+
+class SeqChecker:
+    """Secuencias recibidas por arranque: huecos, duplicados y desorden."""
+
+    def __init__(self):
+        self.seen = {}
+        self.last = {}
+        self.skipped = {}
+        self.duplicates = 0
+        self.out_of_order = 0
+
+    def add(self, report):
+        if "seq" not in report:
+            return
+        boot, seq = report.get("boot", 0), report["seq"]
+        seen = self.seen.setdefault(boot, set())
+        if seq in seen:
+            self.duplicates += 1
+        elif seq < self.last.get(boot, 0):
+            self.out_of_order += 1
+        if seq not in seen:
+            self.skipped[boot] = (self.skipped.get(boot, 0) +
+                                  report.get("rbe_skip", 0))
+        seen.add(seq)
+        self.last[boot] = max(seq, self.last.get(boot, 0))
+
+    def summary(self):
+        lost = 0
+        for boot, seen in sorted(self.seen.items()):
+            skipped = self.skipped.get(boot, 0)
+            missing = max(seen) - len(seen) - skipped
+            lost += missing
+            print("arranque %d: %d reportes (1..%d), %d omitidos por RBE, "
+                  "%d perdidos" % (boot, len(seen), max(seen), skipped,
+                                   missing), file=sys.stderr)
+        print("duplicados %d, fuera de orden %d" %
+              (self.duplicates, self.out_of_order), file=sys.stderr)
+        return 1 if lost or self.duplicates else 0
+
+
+def parse_line(line):
+    """Una línea de mosquitto_sub: payload hex (-F %x) o JSON (-F %p)."""
+    if line.startswith("{"):
+        obj = json.loads(line)
+        return obj["batch"] if "batch" in obj else [obj]
+    return decode_payload(bytes.fromhex(line))
+
+
+def main(argv):
+    args = argv[1:]
+    checker = SeqChecker() if "--check" in args else None
+    args = [a for a in args if a != "--check"]
+
+    if args and args[0] == "--hex":
+        payloads = (line.strip() for line in sys.stdin if line.strip())
+    elif args:
+        payloads = (open(path, "rb").read() for path in args)
+    else:
+        payloads = [sys.stdin.buffer.read()]
+
+    status = 0
+    try:
+        for payload in payloads:
+            try:
+                if isinstance(payload, str):
+                    reports = parse_line(payload)
+                else:
+                    reports = decode_payload(payload)
+                for report in reports:
+                    if checker:
+                        checker.add(report)
+                    else:
+                        print(json.dumps(report))
+            except (ValueError, struct.error) as exc:
+                print("error: %s" % exc, file=sys.stderr)
+                status = 1
+    except KeyboardInterrupt:
+        pass  # Ctrl+C sobre mosquitto_sub: resumen de lo recibido
+    if checker:
+        status |= checker.summary()
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+"""Reensambla las formas de onda crudas que Blue Brain sube por MQTT.
+
+Uso:
+    mosquitto_sub -v -F '%t %x' -t 'hcaa/plcs/bluebrain/wave/#' | \\
+        python bb_wave_reassemble.py --out capturas/
+    mosquitto_pub -t hcaa/plcs/bluebrain/cmd/waveform -m next   # o "last"
+    mosquitto_pub -t hcaa/plcs/bluebrain/cmd/waveform -m "next z"  # comprimida
+
+Cada línea de entrada es "<topic> <payload en hex>". Por cada subida
+(wave/<arranque>/<id>/) llegan un manifiesto JSON ("m") y los trozos
+0..n_chunks-1. Al completarse se comprueba el CRC32 de cada trozo y del
+total y se escribe wave_<arranque>_<id>.csv: una fila por muestra con el
+tiempo (s desde la primera muestra) y los ejes de cada IMU en G (y °/s en
+modo 6 ejes), sin calibración. Con --raw se guarda también el .bin tal cual
+llegó (IMU A y después B, int16 big-endian).
+
+Con "z" cada trozo es un bloque WZ independiente (codec "wz1" en el
+manifiesto, bb_wave_codec.h) de "chunk" muestras de un IMU; wz_decode() lo
+devuelve bit a bit a las muestras crudas antes de comprobar el CRC total.
+En señales modeladas del MPU6050 a ±16 g (ruido ~18 LSB) ocupa entre 1/2.2
+(máquina sana o parada) y 1/1.5 (defecto de rodamiento) del crudo en 3
+ejes, y ~1/2.8 en 6 ejes; el ruido blanco a fondo de escala viaja tal cual.
+
+Al cerrar la entrada se listan las subidas incompletas y los trozos que
+faltan (basta con volver a pedir la forma de onda).
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import zlib
+
+WZ_HEADER = struct.Struct("<2sBBBBH")
+WZ_VERSION = 1
+WZ_ESCAPE_Q = 24
+WZ_ESCAPE_BITS = 20
+WZ_RESET = 32
+WZ_COST_SHIFT = 4
+WZ_MAX_K = 16
+
+AXES_ACCEL = ("ax", "ay", "az")
+AXES_GYRO = ("gx", "gy", "gz")
+
+
+class Transfer:
+    def __init__(self, key):
+        self.key = key
+        self.manifest = None
+        self.chunks = {}
+        self.done = False
+
+    def complete(self):
+        return (self.manifest is not None and
+                len(self.chunks) >= self.manifest["n_chunks"])
+
+    def missing(self):
+        if self.manifest is None:
+            return ["manifiesto"]
+        return [str(i) for i in range(self.manifest["n_chunks"])
+                if i not in self.chunks]
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0  # En bits
+
+    def bit(self):
+        byte = self.pos >> 3
+        if byte >= len(self.data):
+            raise ValueError("flujo WZ truncado")
+        b = (self.data[byte] >> (7 - (self.pos & 7))) & 1
+        self.pos += 1
+        return b
+
+    def bits(self, n):
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | self.bit()
+        return v
+
+
+def wz_decode(block):
+    """Bloque WZ (bb_wave_codec.h) -> muestras int16 big-endian entrelazadas.
+
+    Reproduce bit a bit el estado del codificador: elección de predictor
+    por coste y k de Rice adaptativo.
+    """
+    magic, version, mode, n_axes, _, n_samples = WZ_HEADER.unpack_from(block)
+    if magic != b"WZ" or version > WZ_VERSION:
+        raise ValueError("bloque WZ no válido")
+    body = block[WZ_HEADER.size:]
+    if mode == 1:
+        if len(body) != n_samples * n_axes * 2:
+            raise ValueError("bloque WZ almacenado de tamaño incorrecto")
+        return bytes(body)
+    if mode != 0:
+        raise ValueError("modo WZ %d desconocido" % mode)
+
+    rd = BitReader(body)
+    # Por eje: historia, coste de los órdenes 1..3 y estado de Rice
+    h = [[0, 0, 0] for _ in range(n_axes)]
+    cost = [[0, 0, 0] for _ in range(n_axes)]
+    acc = [32] * n_axes
+    cnt = [1] * n_axes
+    mask = 0xFFFFFFFF
+    out = bytearray()
+
+    for i in range(n_samples):
+        for a in range(n_axes):
+            h0, h1, h2 = h[a]
+            c = cost[a]
+            best = 0
+            for o in range(1, min(i - 2, 2) + 1):
+                if c[o] < c[best]:
+                    best = o
+            k = 0
+            while k < WZ_MAX_K and (cnt[a] << k) < acc[a]:
+                k += 1
+            q = 0
+            while q < WZ_ESCAPE_Q and rd.bit():
+                q += 1
+            if q < WZ_ESCAPE_Q:
+                u = (q << k) | rd.bits(k)
+            else:
+                u = rd.bits(WZ_ESCAPE_BITS)
+            e = (u >> 1) ^ -(u & 1)
+
+            if i == 0:
+                x = e
+            else:
+                pred = (h0, 2 * h0 - h1, 3 * h0 - 3 * h1 + h2)[best]
+                x = pred + e
+            if not -32768 <= x <= 32767:
+                raise ValueError("muestra fuera de rango: flujo dañado")
+            out += struct.pack(">h", x)
+
+            acc[a] += abs(e)
+            cnt[a] += 1
+            if cnt[a] >= WZ_RESET:
+                acc[a] = (acc[a] + 1) >> 1
+                cnt[a] >>= 1
+            e1 = x - h0
+            e2 = e1 - (h0 - h1)
+            e3 = e2 - (h0 - 2 * h1 + h2)
+            if i >= 1:
+                c[0] = (c[0] + abs(e1) - (c[0] >> WZ_COST_SHIFT)) & mask
+            for o, eo in ((1, e2), (2, e3)):
+                if i < o + 1:
+                    break
+                if i == o + 1:
+                    c[o] = c[o - 1]
+                c[o] = (c[o] + abs(eo) - (c[o] >> WZ_COST_SHIFT)) & mask
+            h[a] = [x, h0, h1]
+    return bytes(out)
+
+
+def verify(tr):
+    """Devuelve (datos por IMU, errores)."""
+    m = tr.manifest
+    errors = []
+    chunks = []
+    for i in range(m["n_chunks"]):
+        crc = zlib.crc32(tr.chunks[i]) & 0xFFFFFFFF
+        if crc != m["crc"][i]:
+            errors.append("trozo %d: crc %08x != %08x" % (i, crc, m["crc"][i]))
+        chunk = tr.chunks[i]
+        if m.get("codec", "raw") == "wz1":
+            try:
+                chunk = wz_decode(chunk)
+            except (ValueError, struct.error) as e:
+                errors.append("trozo %d: %s" % (i, e))
+        chunks.append(chunk)
+
+    blob = b"".join(chunks)
+    if len(blob) != m["bytes"]:
+        errors.append("%d bytes != %d" % (len(blob), m["bytes"]))
+    if zlib.crc32(blob) & 0xFFFFFFFF != m["crc32"]:
+        errors.append("crc32 total incorrecto")
+
+    per_imu = m["chunks_per_imu"]
+    imus = [b"".join(chunks[k * per_imu + i] for i in range(per_imu))
+            for k in range(m["n_imus"])]
+    return imus, errors
+
+
+def write_csv(path, m, imus):
+    n_ax = m["sample_bytes"] // 2
+    sample = struct.Struct(">%dh" % n_ax)
+    names = (AXES_ACCEL + AXES_GYRO)[:n_ax]
+    scales = [m["g_lsb"]] * 3 + [m["dps_lsb"]] * 3
+    fs = m["fs"] if m["fs"] > 0 else 1.0
+
+    with open(path, "w") as f:
+        cols = ["t_s"] + ["%s_%s" % ("AB"[k], a)
+                          for k in range(len(imus)) for a in names]
+        f.write(",".join(cols) + "\n")
+        for i in range(m["n_samples"]):
+            row = ["%.6f" % (i / fs)]
+            for raw in imus:
+                vals = sample.unpack_from(raw, i * m["sample_bytes"])
+                row += ["%.5f" % (v / scales[a]) for a, v in enumerate(vals)]
+            f.write(",".join(row) + "\n")
+
+
+def finish(tr, args):
+    m = tr.manifest
+    imus, errors = verify(tr)
+    name = "wave_%s_%s" % tr.key
+    label = "%s (trama %d, %s, %d IMU x %d muestras, %.1f Hz)" % (
+        name, m["frame"], m["mode"], m["n_imus"], m["n_samples"], m["fs"])
+    if errors:
+        print("%s: ERROR %s" % (label, "; ".join(errors)), file=sys.stderr)
+        return False
+
+    os.makedirs(args.out, exist_ok=True)
+    write_csv(os.path.join(args.out, name + ".csv"), m, imus)
+    if args.raw:
+        with open(os.path.join(args.out, name + ".bin"), "wb") as f:
+            f.write(b"".join(imus))
+    sent = ""
+    if "zbytes" in m and m.get("codec") == "wz1":
+        sent = " (%d B comprimida, x%.2f)" % (
+            m["zbytes"], m["bytes"] / max(m["zbytes"], 1))
+    print("%s: OK, %d B%s en %d trozos" % (label, m["bytes"], sent,
+                                           m["n_chunks"]))
+    return True
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("files", nargs="*", help="capturas (por defecto stdin)")
+    ap.add_argument("--out", default=".", help="directorio de salida")
+    ap.add_argument("--raw", action="store_true", help="guardar también .bin")
+    args = ap.parse_args()
+
+    transfers = {}
+    ok = failed = 0
+    streams = [open(p) for p in args.files] if args.files else [sys.stdin]
+    try:
+        for stream in streams:
+            for line in stream:
+                parts = line.split()
+                if len(parts) != 2 or "/wave/" not in parts[0]:
+                    continue
+                *_, boot, xfer, leaf = parts[0].split("/")
+                key = (boot, xfer)
+                tr = transfers.get(key)
+                if tr is None or tr.done:
+                    # Un id repetido tras completar es otra subida
+                    tr = transfers[key] = Transfer(key)
+                payload = bytes.fromhex(parts[1])
+                if leaf == "m":
+                    tr.manifest = json.loads(payload.decode())
+                else:
+                    tr.chunks[int(leaf)] = payload
+                if tr.complete():
+                    tr.done = True
+                    if finish(tr, args):
+                        ok += 1
+                    else:
+                        failed += 1
+    except KeyboardInterrupt:
+        pass
+
+    pending = [t for t in transfers.values() if not t.done]
+    for tr in pending:
+        print("wave_%s_%s: incompleta, faltan %s" %
+              (tr.key + (", ".join(tr.missing()),)), file=sys.stderr)
+    print("%d formas de onda correctas, %d con error, %d incompletas" %
+          (ok, failed, len(pending)), file=sys.stderr)
+    return 1 if failed or pending else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())